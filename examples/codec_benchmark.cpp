@@ -0,0 +1,106 @@
+#include <BPX/BPX.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/*
+    Compares the cost per pixel of decoding and encoding a frame one pixel
+    at a time (`get_unsafe`/`set_unsafe`) with whole rows (`read_row`/
+    `write_row`), and with `brightness`, which runs on the row codecs, for
+    every pixel format. A plain `memcpy` of the RGBA_U8 frame gives the
+    floor the row codecs approach for that format.
+
+    Usage: codec_benchmark
+
+    The frame is 3840x2160. Times are in nanoseconds per pixel, on one thread.
+*/
+
+namespace {
+
+constexpr int WIDTH = 3840;
+constexpr int HEIGHT = 2160;
+
+struct Format { bpx::PixelFormat format; const char* name; };
+
+constexpr Format FORMATS[] = {
+    { bpx::PixelFormat::L_U8, "L_U8" }, { bpx::PixelFormat::L_F16, "L_F16" }, { bpx::PixelFormat::L_F32, "L_F32" },
+    { bpx::PixelFormat::LA_U8, "LA_U8" }, { bpx::PixelFormat::LA_F16, "LA_F16" }, { bpx::PixelFormat::LA_F32, "LA_F32" },
+    { bpx::PixelFormat::RGB_565, "RGB_565" }, { bpx::PixelFormat::BGR_565, "BGR_565" },
+    { bpx::PixelFormat::RGB_U8, "RGB_U8" }, { bpx::PixelFormat::BGR_U8, "BGR_U8" },
+    { bpx::PixelFormat::RGB_F16, "RGB_F16" }, { bpx::PixelFormat::BGR_F16, "BGR_F16" },
+    { bpx::PixelFormat::RGB_F32, "RGB_F32" }, { bpx::PixelFormat::BGR_F32, "BGR_F32" },
+    { bpx::PixelFormat::RGBA_5551, "RGBA_5551" }, { bpx::PixelFormat::BGRA_5551, "BGRA_5551" },
+    { bpx::PixelFormat::RGBA_4444, "RGBA_4444" }, { bpx::PixelFormat::BGRA_4444, "BGRA_4444" },
+    { bpx::PixelFormat::RGBA_U8, "RGBA_U8" }, { bpx::PixelFormat::BGRA_U8, "BGRA_U8" },
+    { bpx::PixelFormat::RGBA_F16, "RGBA_F16" }, { bpx::PixelFormat::BGRA_F16, "BGRA_F16" },
+    { bpx::PixelFormat::RGBA_F32, "RGBA_F32" }, { bpx::PixelFormat::BGRA_F32, "BGRA_F32" },
+};
+
+template <typename F>
+double best_time(int runs, F&& f)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+void benchmark(const Format& format, int runs)
+{
+    const double pixels = WIDTH * static_cast<double>(HEIGHT);
+
+    bpx::Image image(WIDTH, HEIGHT, bpx::BLANK, format.format);
+    bpx::map(image, [](int x, int y, bpx::Color) {
+        return bpx::Color{ static_cast<uint8_t>(x), static_cast<uint8_t>(y), static_cast<uint8_t>(x ^ y), 200 };
+    });
+
+    // Both loops decode every pixel and encode it back unchanged
+    const double per_pixel = best_time(runs, [&] {
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < WIDTH; x++) {
+                image.set_unsafe(x, y, image.get_unsafe(x, y));
+            }
+        }
+    });
+
+    std::vector<bpx::Color> row(WIDTH);
+    const double per_row = best_time(runs, [&] {
+        for (int y = 0; y < HEIGHT; y++) {
+            image.read_row(0, y, row.data(), WIDTH);
+            image.write_row(0, y, row.data(), WIDTH);
+        }
+    });
+
+    const double adjust = best_time(runs, [&] { bpx::brightness(image, 1.0f); });
+
+    std::cout << std::left << std::setw(10) << format.name << std::right << std::fixed << std::setprecision(2)
+              << "  get/set " << std::setw(6) << per_pixel * 1e9 / pixels
+              << "   read/write_row " << std::setw(6) << per_row * 1e9 / pixels
+              << "   brightness " << std::setw(6) << adjust * 1e9 / pixels << "\n";
+}
+
+} // namespace
+
+int main()
+{
+    const int runs = 3;
+
+    for (const Format& format : FORMATS) {
+        benchmark(format, runs);
+    }
+
+    bpx::Image src(WIDTH, HEIGHT, bpx::BLANK, bpx::PixelFormat::RGBA_U8);
+    bpx::Image dst(WIDTH, HEIGHT, bpx::BLANK, bpx::PixelFormat::RGBA_U8);
+    const double copy = best_time(runs, [&] { std::memcpy(dst.data(), src.data(), src.data_size()); });
+    std::cout << "memcpy of the RGBA_U8 frame " << std::fixed << std::setprecision(2)
+              << copy * 1e9 / (WIDTH * static_cast<double>(HEIGHT)) << " ns per pixel\n";
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <BPX/BPX.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+    Compares QOI with PNG on encode and decode throughput and on size.
+
+    Usage: qoi_benchmark [image files...]
+
+    Without arguments, a noisy gradient (photo-like) and a grid (UI-like) are
+    generated. Throughputs are in megapixels per second, on one thread.
+*/
+
+namespace {
+
+template <typename F>
+double best_time(int runs, F&& f)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+void benchmark(const std::string& name, const bpx::Image& image, int runs)
+{
+    const double mpx = image.width() * static_cast<double>(image.height()) / 1e6;
+
+    bpx::ImageEncoder encoder;
+    std::vector<uint8_t> png, qoi;
+
+    const double png_enc = best_time(runs, [&] { encoder.encode(image, bpx::EncodeFormat::PNG, png); });
+    const double qoi_enc = best_time(runs, [&] { encoder.encode(image, bpx::EncodeFormat::QOI, qoi); });
+    const double png_dec = best_time(runs, [&] { bpx::Image::load_from_memory(png.data(), png.size()); });
+    const double qoi_dec = best_time(runs, [&] { bpx::Image::load_from_memory(qoi.data(), qoi.size()); });
+
+    std::cout << name << " (" << image.width() << "x" << image.height() << ")\n"
+              << std::fixed << std::setprecision(1)
+              << "  PNG  " << std::setw(8) << png.size() / 1024.0 << " KiB   encode "
+              << std::setw(7) << mpx / png_enc << " MP/s   decode " << std::setw(7) << mpx / png_dec << " MP/s\n"
+              << "  QOI  " << std::setw(8) << qoi.size() / 1024.0 << " KiB   encode "
+              << std::setw(7) << mpx / qoi_enc << " MP/s   decode " << std::setw(7) << mpx / qoi_dec << " MP/s\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const int runs = 5;
+
+    if (argc > 1) {
+        // Images are benchmarked as RGBA_U8, the layout both codecs take as is
+        bpx::DecodeOptions options;
+        options.convert = true;
+        options.format = bpx::PixelFormat::RGBA_U8;
+
+        for (int i = 1; i < argc; i++) {
+            try {
+                benchmark(argv[i], bpx::Image(argv[i], options), runs);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        return 0;
+    }
+
+    bpx::ColorRamp ramp({
+        { bpx::WHITE, 0.0f },
+        { bpx::RED, 0.3f },
+        { bpx::BLUE, 0.7f },
+        { bpx::BLACK, 1.0f }
+    });
+    bpx::Image photo = bpx::generate_gradient_radial(1920, 1080, ramp, 960, 540, 1200, 0);
+    bpx::map(photo, [](int x, int y, bpx::Color color) {
+        const uint32_t n = (static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(y) * 19349663u);
+        const int d = static_cast<int>((n >> 13) % 7) - 3;
+        auto clamp = [](int v) { return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v)); };
+        return bpx::Color{ clamp(color.r + d), clamp(color.g + d), clamp(color.b + d), color.a };
+    });
+    benchmark("Noisy gradient", photo, runs);
+
+    bpx::Image grid = bpx::generate_grid(1920, 1080, 24);
+    benchmark("Grid", grid, runs);
+
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <BPX/BPX.hpp>
 #include <SDL2/SDL.h>
 #include <iostream>
+#include <vector>
 
 int main()
 {
@@ -28,10 +29,11 @@ int main()
         return -1;
     }
 
-    bpx::Image bpx_surface = {
+    bpx::ImageView bpx_surface = {
         sdl_surface->pixels,
         sdl_surface->w, sdl_surface->h,
-        bpx::PixelFormat::BGRA_U8, false
+        bpx::PixelFormat::BGRA_U8,
+        static_cast<size_t>(sdl_surface->pitch)
     };
 
     // Generate xor pattern
@@ -59,6 +61,31 @@ int main()
     bpx::Image im_radial = bpx::generate_gradient_radial(1024, 1024, ramp2, 512, 512, 1024, 512);
 
     // Main program
+    // The scene is drawn through a canvas: after the first frame, only the
+    // region around the old and new positions of the cursor is redrawn and
+    // uploaded to the window
+
+    bpx::Canvas canvas(bpx_surface);
+
+    const int cursor_radius = 24;
+    int cursor_x = -cursor_radius * 2, cursor_y = -cursor_radius * 2;
+
+    const auto cursor_rect = [cursor_radius](int x, int y) {
+        return bpx::Rect{ x - cursor_radius, y - cursor_radius, cursor_radius * 2 + 1, cursor_radius * 2 + 1 };
+    };
+
+    const auto draw_scene = [&]() {
+        canvas.fill(bpx::BLACK);
+
+        canvas.draw(0, 0, 400, 300, im_xor);
+        canvas.draw(400, 0, 400, 300, im_grid);
+        canvas.draw(0, 300, 400, 300, im_linear);
+        canvas.draw(400, 300, 400, 300, im_radial);
+
+        canvas.circle(cursor_x, cursor_y, cursor_radius, bpx::Color(255, 255, 255, 128), bpx::BlendMode::ALPHA);
+    };
+
+    draw_scene();
 
     bool running = true;
 
@@ -69,16 +96,28 @@ int main()
                 running = false;
                 break;
             }
+            if (e.type == SDL_MOUSEMOTION) {
+                bpx::Region moved(cursor_rect(cursor_x, cursor_y));
+                cursor_x = e.motion.x, cursor_y = e.motion.y;
+                moved.add(cursor_rect(cursor_x, cursor_y));
+
+                canvas.set_clip(moved);
+                draw_scene();
+                canvas.reset_clip();
+            }
         }
 
-        bpx::fill(bpx_surface, bpx::BLACK);
-
-        bpx::draw(bpx_surface, 0, 0, 400, 300, im_xor);
-        bpx::draw(bpx_surface, 400, 0, 400, 300, im_grid);
-        bpx::draw(bpx_surface, 0, 300, 400, 300, im_linear);
-        bpx::draw(bpx_surface, 400, 300, 400, 300, im_radial);
+        if (canvas.damage().empty()) {
+            SDL_Delay(1);
+            continue;
+        }
 
-        SDL_UpdateWindowSurface(win);
+        std::vector<SDL_Rect> rects;
+        for (const bpx::Rect& r : canvas.damage().rects()) {
+            rects.push_back(SDL_Rect{ r.x, r.y, r.w, r.h });
+        }
+        SDL_UpdateWindowSurfaceRects(win, rects.data(), static_cast<int>(rects.size()));
+        canvas.clear_damage();
     }
 
     return 0;
@@ -22,9 +22,19 @@
 
 #include "./generation.hpp"
 #include "./algorithm.hpp"
+#include "./canvas.hpp"
 #include "./color.hpp"
+#include "./command.hpp"
+#include "./container.hpp"
+#include "./encode.hpp"
+#include "./execution.hpp"
+#include "./half.hpp"
 #include "./image.hpp"
+#include "./mipmap.hpp"
+#include "./path.hpp"
 #include "./pixel.hpp"
 #include "./ramp.hpp"
+#include "./region.hpp"
+#include "./view.hpp"
 
 #endif // BPX_HPP
@@ -20,9 +20,14 @@
 #ifndef BPX_ALGORITHM_HPP
 #define BPX_ALGORITHM_HPP
 
+#include "./execution.hpp"
 #include "./image.hpp"
+#include "./view.hpp"
 #include "./color.hpp"
+
+#include <algorithm>
 #include <cstdint>
+#include <utility>
 
 namespace bpx {
 
@@ -30,6 +35,58 @@ namespace bpx {
 
 class ColorRamp;
 
+// Helpers of the templated operations
+
+namespace detail {
+
+/*
+    Number of pixels decoded at once by the row-based loops, small enough
+    for the scratch buffer to live on the stack and stay in the L1 cache.
+*/
+constexpr int ROW_CHUNK = 256;
+
+/*
+    Clamps the rectangle (x, y, w, h) to the bounds of the image and returns
+    it as a pair of corners; an empty result has min >= max.
+*/
+inline void clip_rect(const ConstImageView& image, int x, int y, int w, int h,
+                      int* xmin, int* ymin, int* xmax, int* ymax)
+{
+    *xmin = std::clamp(x, 0, image.width());
+    *ymin = std::clamp(y, 0, image.height());
+    *xmax = std::clamp(x + w, 0, image.width());
+    *ymax = std::clamp(y + h, 0, image.height());
+
+    if (*xmin > *xmax) std::swap(*xmin, *xmax);
+    if (*ymin > *ymax) std::swap(*ymin, *ymax);
+}
+
+/*
+    Decodes the region [xmin, xmax) x [ymin, ymax) chunk by chunk, lets `func`
+    modify the colors in place and encodes them back. `func` is called as
+    func(Color* colors, int count, int x, int y) where (x, y) is the position
+    of the first pixel of the chunk. With a parallel policy, rows are split
+    into bands and `func` is called concurrently.
+*/
+template <typename Func>
+void transform_rows(const ImageView& image, int xmin, int ymin, int xmax, int ymax, Func&& func,
+                    const ExecutionPolicy& policy = {})
+{
+    parallel_rows(policy, ymin, ymax, xmax - xmin, [&](int y_begin, int y_end) {
+        Color buffer[ROW_CHUNK];
+        for (int y = y_begin; y < y_end; y++) {
+            for (int x = xmin; x < xmax; x += ROW_CHUNK) {
+                const int count = std::min(ROW_CHUNK, xmax - x);
+                image.read_row(x, y, buffer, count);
+                func(buffer, count, x, y);
+                image.write_row(x, y, buffer, count);
+            }
+        }
+    });
+}
+
+} // namespace detail
+
 /**
  * @brief Applies a mapping function to each pixel in the image.
  *
@@ -38,10 +95,11 @@ class ColorRamp;
  *
  * @param image The image to modify.
  * @param mapper A function that takes the x and y coordinates along with the current
- *        pixel color, and returns the new color to apply to that pixel.
- * @return A reference to the modified image.
+ *        pixel color, and returns the new color to apply to that pixel. With a parallel
+ *        policy it is called concurrently and must be thread-safe.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void map(Image& image, const Image::Mapper& mapper);
+void map(ImageView image, const Image::Mapper& mapper, ExecutionPolicy policy = {});
 
 /**
  * @brief Applies a mapping function to a specified rectangular region in the image.
@@ -55,10 +113,104 @@ void map(Image& image, const Image::Mapper& mapper);
  * @param width The width of the region to modify.
  * @param height The height of the region to modify.
  * @param mapper A function that takes the x and y coordinates along with the current
- *        pixel color, and returns the new color to apply to that pixel.
- * @return A reference to the modified image.
+ *        pixel color, and returns the new color to apply to that pixel. With a parallel
+ *        policy it is called concurrently and must be thread-safe.
+ * @param policy How the work is distributed over threads (sequential by default).
+ */
+void map(ImageView image, int x_start, int y_start, int width, int height, const Image::Mapper& mapper,
+         ExecutionPolicy policy = {});
+
+/**
+ * @brief Applies a mapping function to each pixel in the image, with the mapper inlined.
+ *
+ * Same as the `Image::Mapper` version, but the mapper can be any callable taking
+ * `(int x, int y, Color color)` and returning a `Color`. Its type is a template
+ * parameter, so a lambda is called directly and can be inlined in the loop instead of
+ * going through a `std::function` for every pixel.
+ *
+ * @param image The image to modify.
+ * @param mapper The callable returning the new color of each pixel. With a parallel
+ *        policy it is called concurrently and must be thread-safe.
+ * @param policy How the work is distributed over threads (sequential by default).
+ */
+template <typename Func>
+void map(ImageView image, Func&& mapper, ExecutionPolicy policy = {})
+{
+    map(image, 0, 0, image.width(), image.height(), std::forward<Func>(mapper), policy);
+}
+
+/**
+ * @brief Applies a mapping function to a rectangular region in the image, with the mapper inlined.
+ *
+ * Same as the `Image::Mapper` version, but the mapper can be any callable taking
+ * `(int x, int y, Color color)` and returning a `Color`, which is called directly.
+ *
+ * @param image The image to modify.
+ * @param x_start The x-coordinate of the top-left corner of the region to modify.
+ * @param y_start The y-coordinate of the top-left corner of the region to modify.
+ * @param width The width of the region to modify.
+ * @param height The height of the region to modify.
+ * @param mapper The callable returning the new color of each pixel. With a parallel
+ *        policy it is called concurrently and must be thread-safe.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void map(Image& image, int x_start, int y_start, int width, int height, const Image::Mapper& mapper);
+template <typename Func>
+void map(ImageView image, int x_start, int y_start, int width, int height, Func&& mapper,
+         ExecutionPolicy policy = {})
+{
+    int xmin, ymin, xmax, ymax;
+    detail::clip_rect(image, x_start, y_start, width, height, &xmin, &ymin, &xmax, &ymax);
+
+    detail::transform_rows(image, xmin, ymin, xmax, ymax, [&mapper](Color* colors, int count, int x, int y) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = mapper(x + i, y, colors[i]);
+        }
+    }, policy);
+}
+
+/**
+ * @brief Applies a function to the image one run of pixels at a time.
+ *
+ * The pixels are decoded into contiguous spans of `Color`, passed to `func` as
+ * `func(Color* colors, int count, int x, int y)` where `(x, y)` is the position of
+ * `colors[0]` and the span covers the pixels `x` to `x + count - 1` of row `y`. `func`
+ * modifies the colors in place and they are then encoded back. A span never crosses a
+ * row and holds at most a few hundred pixels, which lets simple loops over it be
+ * vectorized by the compiler.
+ *
+ * @param image The image to modify.
+ * @param func The callable processing a span. With a parallel policy it is called
+ *        concurrently and must be thread-safe.
+ * @param policy How the work is distributed over threads (sequential by default).
+ */
+template <typename Func>
+void map_rows(ImageView image, Func&& func, ExecutionPolicy policy = {})
+{
+    detail::transform_rows(image, 0, 0, image.width(), image.height(), func, policy);
+}
+
+/**
+ * @brief Applies a function to a rectangular region of the image one run of pixels at a time.
+ *
+ * Same as the full-image version, spans are limited to the region clamped to the image.
+ *
+ * @param image The image to modify.
+ * @param x_start The x-coordinate of the top-left corner of the region to modify.
+ * @param y_start The y-coordinate of the top-left corner of the region to modify.
+ * @param width The width of the region to modify.
+ * @param height The height of the region to modify.
+ * @param func The callable processing a span. With a parallel policy it is called
+ *        concurrently and must be thread-safe.
+ * @param policy How the work is distributed over threads (sequential by default).
+ */
+template <typename Func>
+void map_rows(ImageView image, int x_start, int y_start, int width, int height, Func&& func,
+              ExecutionPolicy policy = {})
+{
+    int xmin, ymin, xmax, ymax;
+    detail::clip_rect(image, x_start, y_start, width, height, &xmin, &ymin, &xmax, &ymax);
+    detail::transform_rows(image, xmin, ymin, xmax, ymax, func, policy);
+}
 
 /**
  * @brief Fills the entire image with a specified color.
@@ -68,9 +220,9 @@ void map(Image& image, int x_start, int y_start, int width, int height, const Im
  *
  * @param image The image to fill.
  * @param color The color to apply to every pixel in the image.
- * @return A reference to the modified image.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void fill(Image& image, Color color);
+void fill(ImageView image, Color color, ExecutionPolicy policy = {});
 
 /**
  * @brief Draws a single point on the image at the specified coordinates.
@@ -85,7 +237,7 @@ void fill(Image& image, Color color);
  * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void point(Image& image, int x, int y, Color color, BlendMode mode = BlendMode::REPLACE);
+void point(ImageView image, int x, int y, Color color, BlendMode mode = BlendMode::REPLACE);
 
 /**
  * @brief Draws a straight line between two points on the image using a specified color.
@@ -102,7 +254,7 @@ void point(Image& image, int x, int y, Color color, BlendMode mode = BlendMode::
  * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void line(Image& image, int x1, int y1, int x2, int y2, Color color, BlendMode mode = BlendMode::REPLACE);
+void line(ImageView image, int x1, int y1, int x2, int y2, Color color, BlendMode mode = BlendMode::REPLACE);
 
 /**
  * @brief Draws a straight line between two points on the image, applying a mapping function to each pixel.
@@ -118,13 +270,15 @@ void line(Image& image, int x1, int y1, int x2, int y2, Color color, BlendMode m
  * @param mapper A function that takes the x and y coordinates and returns the color to apply at that point.
  * @return A reference to the modified image.
  */
-void line(Image& image, int x1, int y1, int x2, int y2, const Image::Mapper& mapper);
+void line(ImageView image, int x1, int y1, int x2, int y2, const Image::Mapper& mapper);
 
 /**
  * @brief Draws a thick line between two points on the image using a specified color.
  *
  * This function draws a line from `(x1, y1)` to `(x2, y2)` with the specified thickness
  * and color, applying the specified blend mode to each pixel in the line.
+ * The line is widened across its longer axis, each row of it being written as a single span,
+ * so every pixel is blended once.
  *
  * @param image The image to modify.
  * @param x1 The x-coordinate of the starting point of the line.
@@ -136,7 +290,7 @@ void line(Image& image, int x1, int y1, int x2, int y2, const Image::Mapper& map
  * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void line(Image& image, int x1, int y1, int x2, int y2, int thick, Color color, BlendMode mode = BlendMode::REPLACE);
+void line(ImageView image, int x1, int y1, int x2, int y2, int thick, Color color, BlendMode mode = BlendMode::REPLACE);
 
 /**
  * @brief Draws a thick line between two points on the image, applying a mapping function to each pixel.
@@ -154,7 +308,7 @@ void line(Image& image, int x1, int y1, int x2, int y2, int thick, Color color,
  * @param mapper A function that takes the x and y coordinates and returns the color to apply at that point.
  * @return A reference to the modified image.
  */
-void line(Image& image, int x1, int y1, int x2, int y2, int thick, const Image::Mapper& mapper);
+void line(ImageView image, int x1, int y1, int x2, int y2, int thick, const Image::Mapper& mapper);
 
 /**
  * @brief Draws a gradient line between two points on the image, transitioning between colors from a color ramp.
@@ -173,7 +327,7 @@ void line(Image& image, int x1, int y1, int x2, int y2, int thick, const Image::
  * @param mode The blending mode to use when applying the gradient. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void line_gradient(Image& image, int x1, int y1, int x2, int y2,
+void line_gradient(ImageView image, int x1, int y1, int x2, int y2,
                    const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
 
 /**
@@ -195,7 +349,7 @@ void line_gradient(Image& image, int x1, int y1, int x2, int y2,
  * @param mode The blending mode to use when applying the gradient. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void line_gradient(Image& image, int x1, int y1, int x2, int y2, int thick,
+void line_gradient(ImageView image, int x1, int y1, int x2, int y2, int thick,
                    const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
 
 /**
@@ -214,7 +368,7 @@ void line_gradient(Image& image, int x1, int y1, int x2, int y2, int thick,
  * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void rectangle(Image& image, int x, int y, int w, int h, Color color, BlendMode mode = BlendMode::REPLACE);
+void rectangle(ImageView image, int x, int y, int w, int h, Color color, BlendMode mode = BlendMode::REPLACE);
 
 /**
  * @brief Draws a rectangle on the image using a mapping function to define each pixel's color.
@@ -231,7 +385,7 @@ void rectangle(Image& image, int x, int y, int w, int h, Color color, BlendMode
  * @param mapper A function that takes the x and y coordinates and returns the color to apply at that point.
  * @return A reference to the modified image.
  */
-void rectangle(Image& image, int x, int y, int w, int h, const Image::Mapper& mapper);
+void rectangle(ImageView image, int x, int y, int w, int h, const Image::Mapper& mapper);
 
 /**
  * @brief Draws a gradient-filled rectangle on the image with specified gradient from a color ramp.
@@ -254,7 +408,7 @@ void rectangle(Image& image, int x, int y, int w, int h, const Image::Mapper& ma
  * @param mode The blending mode to use when applying the gradient. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void rectangle_gradient_linear(Image& image, int x, int y, int w, int h,
+void rectangle_gradient_linear(ImageView image, int x, int y, int w, int h,
                                int x_start, int y_start, int x_end, int y_end,
                                const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
 
@@ -279,7 +433,7 @@ void rectangle_gradient_linear(Image& image, int x, int y, int w, int h,
  * @param mode The blending mode to use when applying the gradient. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void rectangle_gradient_radial(Image& image, int x, int y, int w, int h,
+void rectangle_gradient_radial(ImageView image, int x, int y, int w, int h,
                                int x_start, int y_start, int x_end, int y_end,
                                const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
 
@@ -299,7 +453,7 @@ void rectangle_gradient_radial(Image& image, int x, int y, int w, int h,
  * @param mode The blending mode to use when applying the outline. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void rectangle_lines(Image& image, int x, int y, int w, int h,
+void rectangle_lines(ImageView image, int x, int y, int w, int h,
                      Color color, BlendMode mode = BlendMode::REPLACE);
 
 /**
@@ -317,7 +471,7 @@ void rectangle_lines(Image& image, int x, int y, int w, int h,
  * @param mapper A function that takes the x and y coordinates and returns the color to apply at that point on the outline.
  * @return A reference to the modified image.
  */
-void rectangle_lines(Image& image, int x, int y, int w, int h, const Image::Mapper& mapper);
+void rectangle_lines(ImageView image, int x, int y, int w, int h, const Image::Mapper& mapper);
 
 /**
  * @brief Draws a thick outline of a rectangle on the image with a specified color.
@@ -326,6 +480,9 @@ void rectangle_lines(Image& image, int x, int y, int w, int h, const Image::Mapp
  * and the width `w` and height `h`. The outline is drawn with a specified thickness and color, 
  * and uses the given blend mode.
  *
+ * The edges are widened by `(thick - 1) / 2` pixels on both sides, as thick lines are, and the
+ * outline is drawn as four disjoint bands with square corners, so each pixel is blended once.
+ *
  * @param image The image to modify.
  * @param x The x-coordinate of the top-left corner of the rectangle.
  * @param y The y-coordinate of the top-left corner of the rectangle.
@@ -336,7 +493,7 @@ void rectangle_lines(Image& image, int x, int y, int w, int h, const Image::Mapp
  * @param mode The blending mode to use when applying the outline. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void rectangle_lines(Image& image, int x, int y, int w, int h, int thick,
+void rectangle_lines(ImageView image, int x, int y, int w, int h, int thick,
                      Color color, BlendMode mode = BlendMode::REPLACE);
 
 /**
@@ -346,6 +503,9 @@ void rectangle_lines(Image& image, int x, int y, int w, int h, int thick,
  * and the width `w` and height `h`. The color of each pixel along the border is determined by a custom
  * mapping function, allowing for color variations or patterns. The outline is drawn with a specified thickness.
  *
+ * The edges are widened by `(thick - 1) / 2` pixels on both sides, as thick lines are, and the
+ * outline is drawn as four disjoint bands with square corners, so each pixel is mapped once.
+ *
  * @param image The image to modify.
  * @param x The x-coordinate of the top-left corner of the rectangle.
  * @param y The y-coordinate of the top-left corner of the rectangle.
@@ -355,7 +515,7 @@ void rectangle_lines(Image& image, int x, int y, int w, int h, int thick,
  * @param mapper A function that takes the x and y coordinates and returns the color to apply at that point on the outline.
  * @return A reference to the modified image.
  */
-void rectangle_lines(Image& image, int x, int y, int w, int h, int thick, const Image::Mapper& mapper);
+void rectangle_lines(ImageView image, int x, int y, int w, int h, int thick, const Image::Mapper& mapper);
 
 /**
  * @brief Draws a filled circle on the image using a specified color.
@@ -364,6 +524,8 @@ void rectangle_lines(Image& image, int x, int y, int w, int h, int thick, const
  * filled with a specified color, and the blending mode controls how the color is applied over 
  * the existing pixels.
  *
+ * The circle is rasterized as one horizontal span per row, each pixel being blended exactly once.
+ *
  * @param image The image to modify.
  * @param cx The x-coordinate of the center of the circle.
  * @param cy The y-coordinate of the center of the circle.
@@ -372,7 +534,7 @@ void rectangle_lines(Image& image, int x, int y, int w, int h, int thick, const
  * @param mode The blending mode to use when drawing the circle. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void circle(Image& image, int cx, int cy, int radius, Color color, BlendMode mode = BlendMode::REPLACE);
+void circle(ImageView image, int cx, int cy, int radius, Color color, BlendMode mode = BlendMode::REPLACE);
 
 /**
  * @brief Draws a filled circle on the image using a mapping function to determine the color of each pixel.
@@ -385,10 +547,11 @@ void circle(Image& image, int cx, int cy, int radius, Color color, BlendMode mod
  * @param cx The x-coordinate of the center of the circle.
  * @param cy The y-coordinate of the center of the circle.
  * @param radius The radius of the circle in pixels.
- * @param mapper A function that takes x and y coordinates and returns the color to apply at that point in the circle.
+ * @param mapper A function that takes the x and y coordinates of a pixel and its current color, and returns
+ *        the color to apply at that point in the circle. It is called once per pixel.
  * @return A reference to the modified image.
  */
-void circle(Image& image, int cx, int cy, int radius, const Image::Mapper& mapper);
+void circle(ImageView image, int cx, int cy, int radius, const Image::Mapper& mapper);
 
 /**
  * @brief Draws a circle with a gradient fill on the image, transitioning between two colors.
@@ -406,7 +569,7 @@ void circle(Image& image, int cx, int cy, int radius, const Image::Mapper& mappe
  * @param mode The blending mode to use when applying the gradient. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void circle_gradient(Image& image, int cx, int cy, int radius,
+void circle_gradient(ImageView image, int cx, int cy, int radius,
                      const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
 
 /**
@@ -423,7 +586,7 @@ void circle_gradient(Image& image, int cx, int cy, int radius,
  * @param mode The blending mode to use when drawing the circle outline. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void circle_lines(Image& image, int cx, int cy, int radius, Color color,
+void circle_lines(ImageView image, int cx, int cy, int radius, Color color,
                   BlendMode mode = BlendMode::REPLACE);
 
 /**
@@ -436,10 +599,13 @@ void circle_lines(Image& image, int cx, int cy, int radius, Color color,
  * @param cx The x-coordinate of the center of the circle.
  * @param cy The y-coordinate of the center of the circle.
  * @param radius The radius of the circle in pixels.
- * @param mapper A function that takes x and y coordinates and returns the color to apply at each point along the outline.
+ * @param mapper A function that takes the x and y coordinates of a pixel and its current color, and returns
+ *        the color to apply at that point of the outline. It is called once per pixel. The coordinates
+ *        are those of the pixel in the image, as for the other mappers; they used to be the offset of
+ *        the pixel from the center `(cx, cy)`.
  * @return A reference to the modified image.
  */
-void circle_lines(Image& image, int cx, int cy, int radius, const Image::Mapper& mapper);
+void circle_lines(ImageView image, int cx, int cy, int radius, const Image::Mapper& mapper);
 
 /**
  * @brief Draws a thick circle outline on the image with a specified color.
@@ -448,6 +614,10 @@ void circle_lines(Image& image, int cx, int cy, int radius, const Image::Mapper&
  * and the given `radius`. The circle is outlined with the specified `color`, and the blending mode is applied.
  * The circle's outline is thicker than a standard single-pixel line, and the thickness is specified by the `thick` parameter.
  *
+ * The outline is the ring from the circle of radius `radius - (thick - 1) / 2` to the one of
+ * radius `radius + thick / 2`, both included, produced as one span per side of each row: it has
+ * no gaps between consecutive radii and each pixel is blended once.
+ *
  * @param image The image to modify.
  * @param cx The x-coordinate of the center of the circle.
  * @param cy The y-coordinate of the center of the circle.
@@ -457,7 +627,7 @@ void circle_lines(Image& image, int cx, int cy, int radius, const Image::Mapper&
  * @param mode The blending mode to use when drawing the circle outline. Defaults to `BlendMode::REPLACE`.
  * @return A reference to the modified image.
  */
-void circle_lines(Image& image, int cx, int cy, int radius, int thick,
+void circle_lines(ImageView image, int cx, int cy, int radius, int thick,
                   Color color, BlendMode mode = BlendMode::REPLACE);
 
 /**
@@ -467,15 +637,159 @@ void circle_lines(Image& image, int cx, int cy, int radius, int thick,
  * is determined by the provided `mapper` function. The circle is centered at `(cx, cy)` with the specified `radius`, and 
  * the thickness of the outline is controlled by the `thick` parameter.
  *
+ * The outline is the ring from the circle of radius `radius - (thick - 1) / 2` to the one of
+ * radius `radius + thick / 2`, both included, each of its pixels being mapped once.
+ *
  * @param image The image to modify.
  * @param cx The x-coordinate of the center of the circle.
  * @param cy The y-coordinate of the center of the circle.
  * @param radius The radius of the circle in pixels.
  * @param thick The thickness of the circle's outline in pixels.
- * @param mapper A function that takes x and y coordinates and returns the color to apply at each point along the outline.
+ * @param mapper A function that takes the x and y coordinates of a pixel and its current color, and returns
+ *        the color to apply at that point of the outline. It is called once per pixel. The coordinates
+ *        are those of the pixel in the image, as for the other mappers; they used to be the offset of
+ *        the pixel from the center `(cx, cy)`.
  * @return A reference to the modified image.
  */
-void circle_lines(Image& image, int cx, int cy, int radius, int thick, const Image::Mapper& mapper);
+void circle_lines(ImageView image, int cx, int cy, int radius, int thick, const Image::Mapper& mapper);
+
+/**
+ * @brief A point with sub-pixel coordinates.
+ *
+ * Anti-aliased shapes take their coordinates as floats, pixel `(x, y)` covering the square
+ * from `(x, y)` to `(x + 1, y + 1)`: its center is at `(x + 0.5, y + 0.5)`.
+ */
+struct Point
+{
+    float x;    ///< Horizontal coordinate, growing to the right.
+    float y;    ///< Vertical coordinate, growing downwards.
+};
+
+/**
+ * @brief Shapes ending the open strokes.
+ */
+enum class LineCap
+{
+    BUTT,       ///< The stroke stops at the end point.
+    SQUARE,     ///< The stroke extends past the end point by half its width.
+    ROUND,      ///< The stroke ends with a half disc centered on the end point.
+};
+
+/**
+ * @brief Shapes filling the outer side of the corners of a stroke.
+ */
+enum class LineJoin
+{
+    MITER,      ///< The outer edges are extended until they meet, within the miter limit.
+    BEVEL,      ///< The outer edges are joined by a straight cut.
+    ROUND,      ///< The corner is rounded by a disc centered on it.
+};
+
+/**
+ * @brief How anti-aliased lines are stroked.
+ */
+struct StrokeStyle
+{
+    float width = 1.0f;                 ///< Width of the stroke, in pixels.
+    LineCap cap = LineCap::BUTT;        ///< Shape of the two ends of open strokes.
+    LineJoin join = LineJoin::MITER;    ///< Shape of the corners.
+    float miter_limit = 4.0f;           ///< Longest miter, as a ratio of the width, before it is beveled.
+};
+
+/**
+ * @brief Draws an anti-aliased line of any width between two points.
+ *
+ * The line is rasterized by coverage: each pixel it overlaps is blended once, the color being
+ * weighted by the exact area of the pixel the line covers. With `BlendMode::ALPHA` the coverage
+ * scales the alpha of the color; with the other modes each pixel is mixed with its blended result
+ * in proportion to it. The line and its caps form a single convex outline, whose cost grows with
+ * its area. The thick variants of `line` are cheaper where anti-aliasing is not needed.
+ *
+ * @param image The image to modify.
+ * @param x1 The x-coordinate of the starting point of the line.
+ * @param y1 The y-coordinate of the starting point of the line.
+ * @param x2 The x-coordinate of the ending point of the line.
+ * @param y2 The y-coordinate of the ending point of the line.
+ * @param color The color of the line.
+ * @param style The width and the caps of the line.
+ * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
+ */
+void line_aa(ImageView image, float x1, float y1, float x2, float y2, Color color,
+             const StrokeStyle& style = {}, BlendMode mode = BlendMode::REPLACE);
+
+/**
+ * @brief Draws an anti-aliased stroke through a series of points.
+ *
+ * The segments are joined and the ends capped according to `style`. The whole stroke is
+ * rasterized at once: pixels where segments, joins or caps overlap are still blended once,
+ * which keeps translucent strokes even.
+ *
+ * @param image The image to modify.
+ * @param points The points the stroke goes through, in order.
+ * @param count The number of points.
+ * @param closed Whether the last point is joined back to the first, in which case there are no caps.
+ * @param color The color of the stroke.
+ * @param style The width, the caps and the joins of the stroke.
+ * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
+ */
+void polyline_aa(ImageView image, const Point* points, size_t count, bool closed, Color color,
+                 const StrokeStyle& style = {}, BlendMode mode = BlendMode::REPLACE);
+
+/**
+ * @brief Fills an anti-aliased polygon.
+ *
+ * The polygon may be concave or cross itself; the pixels are inside where it winds a non-zero
+ * number of times around them.
+ *
+ * @param image The image to modify.
+ * @param points The vertices of the polygon, the last one being joined to the first.
+ * @param count The number of vertices.
+ * @param color The color of the polygon.
+ * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
+ */
+void polygon_aa(ImageView image, const Point* points, size_t count, Color color,
+                BlendMode mode = BlendMode::REPLACE);
+
+/**
+ * @brief Draws an anti-aliased filled circle.
+ *
+ * @param image The image to modify.
+ * @param cx The x-coordinate of the center of the circle.
+ * @param cy The y-coordinate of the center of the circle.
+ * @param radius The radius of the circle, in pixels.
+ * @param color The color of the circle.
+ * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
+ */
+void circle_aa(ImageView image, float cx, float cy, float radius, Color color,
+               BlendMode mode = BlendMode::REPLACE);
+
+/**
+ * @brief Draws an anti-aliased circle outline.
+ *
+ * The outline is the ring between `radius - thick / 2` and `radius + thick / 2`, filled in a single
+ * pass.
+ *
+ * @param image The image to modify.
+ * @param cx The x-coordinate of the center of the circle.
+ * @param cy The y-coordinate of the center of the circle.
+ * @param radius The radius of the middle of the outline, in pixels.
+ * @param thick The thickness of the outline, in pixels.
+ * @param color The color of the outline.
+ * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
+ */
+void circle_lines_aa(ImageView image, float cx, float cy, float radius, float thick, Color color,
+                     BlendMode mode = BlendMode::REPLACE);
+
+/**
+ * @brief Filters used to sample an image drawn at a different size.
+ */
+enum class Filter
+{
+    NEAREST,    ///< Nearest pixel, the fastest, blocky when upscaling and aliased when downscaling.
+    BILINEAR,   ///< Linear interpolation of the 2x2 nearest pixels.
+    BICUBIC,    ///< Catmull-Rom interpolation of the 4x4 nearest pixels, sharper than bilinear.
+    BOX,        ///< Average of the covered area, the best suited to downscaling.
+};
 
 /**
  * @brief Draws a portion of one image onto another image using a specified blend mode.
@@ -491,9 +805,11 @@ void circle_lines(Image& image, int cx, int cy, int radius, int thick, const Ima
  * @param h The height of the portion to be copied from the source image.
  * @param src The source image from which the portion is copied.
  * @param mode The blending mode to use when applying the source image to the destination image.
- * @return A reference to the modified destination image.
+ * @param filter The filter used to sample the source when it is drawn at a different size.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void draw(Image& dst, int x, int y, int w, int h, Image& src, BlendMode mode = BlendMode::REPLACE);
+void draw(ImageView dst, int x, int y, int w, int h, ConstImageView src, BlendMode mode = BlendMode::REPLACE,
+          Filter filter = Filter::NEAREST, ExecutionPolicy policy = {});
 
 /**
  * @brief Draws a section of a source image onto a destination image with optional blending.
@@ -503,6 +819,22 @@ void draw(Image& dst, int x, int y, int w, int h, Image& src, BlendMode mode = B
  * The destination position and size are defined by `(x_dst, y_dst)` for the top-left corner and `(w_dst, h_dst)` for the width and height.
  * The drawing process uses the specified `BlendMode` to combine the source and destination colors.
  *
+ * The source area is scaled to the destination area with the given filter, pixel centers being
+ * aligned. Both areas may extend past their image: the mapping between them is kept and only the
+ * destination pixels lying inside `dst` whose center falls inside `src` are drawn; filters reading
+ * past the edges of the source area clamp to them. Filtered sampling is done in a single pass:
+ * source rows are filtered horizontally once, combined vertically and blended straight into the
+ * destination, without any intermediate image. Straight alpha sources are filtered with their
+ * colors weighted by alpha, which avoids dark fringes around transparent pixels.
+ *
+ * When the two areas have the same size no filtering is needed: rows are copied as raw bytes
+ * for `BlendMode::REPLACE` between identical formats, converted with `convert_pixels` between
+ * different formats, and blended in place with `blend_span` for the other modes.
+ *
+ * The source may share memory with the destination, e.g. be another part of the same image.
+ * Areas of the same size are then processed in the order reading every pixel before it is
+ * overwritten; a scaled source area overlapping the destination area is copied first.
+ *
  * @param dst The destination image to modify.
  * @param x_dst The x-coordinate of the top-left corner of the destination area.
  * @param y_dst The y-coordinate of the top-left corner of the destination area.
@@ -514,11 +846,12 @@ void draw(Image& dst, int x, int y, int w, int h, Image& src, BlendMode mode = B
  * @param w_src The width of the area to copy from the source image.
  * @param h_src The height of the area to copy from the source image.
  * @param mode The blending mode to use when drawing the image section. Defaults to `BlendMode::REPLACE`.
- * @return A reference to the modified destination image.
+ * @param filter The filter used to sample the source area when its size differs from the destination area.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void draw(Image& dst, int x_dst, int y_dst, int w_dst, int h_dst,
-          Image& src, int x_src, int y_src, int w_src, int h_src,
-          BlendMode mode = BlendMode::REPLACE);
+void draw(ImageView dst, int x_dst, int y_dst, int w_dst, int h_dst,
+          ConstImageView src, int x_src, int y_src, int w_src, int h_src,
+          BlendMode mode = BlendMode::REPLACE, Filter filter = Filter::NEAREST, ExecutionPolicy policy = {});
 
 /**
  * @brief Adjusts the saturation of the image.
@@ -529,9 +862,9 @@ void draw(Image& dst, int x_dst, int y_dst, int w_dst, int h_dst,
  *
  * @param image The image to modify.
  * @param factor The saturation factor. Values greater than 1 increase saturation, values between 0 and 1 decrease it.
- * @return A reference to the modified image.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void saturation(Image& image, float factor);
+void saturation(ImageView image, float factor, ExecutionPolicy policy = {});
 
 /**
  * @brief Adjusts the brightness of the image.
@@ -542,9 +875,9 @@ void saturation(Image& image, float factor);
  *
  * @param image The image to modify.
  * @param factor The brightness factor. Positive values increase brightness, negative values decrease it.
- * @return A reference to the modified image.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void brightness(Image& image, float factor);
+void brightness(ImageView image, float factor, ExecutionPolicy policy = {});
 
 /**
  * @brief Adjusts the contrast of the image.
@@ -555,48 +888,81 @@ void brightness(Image& image, float factor);
  *
  * @param image The image to modify.
  * @param factor The contrast factor. Values greater than 1 increase contrast, values between 0 and 1 reduce it.
- * @return A reference to the modified image.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void contrast(Image& image, float factor);
+void contrast(ImageView image, float factor, ExecutionPolicy policy = {});
 
 /**
- * @brief Adjusts the saturation of the image.
+ * @brief Sets the opacity of every pixel of the image.
  *
- * This function modifies the saturation of all pixels in the image by multiplying the color components 
- * (RGB) of each pixel by the specified `factor`. A factor greater than 1 increases saturation, while 
- * a factor less than 1 reduces it. A factor of 1 leaves the saturation unchanged.
+ * This function replaces the alpha component of all pixels in the image with the specified
+ * `alpha` value, leaving the color components unchanged.
  *
  * @param image The image to modify.
- * @param factor The saturation factor. Values greater than 1 increase saturation, values between 0 and 1 decrease it.
- * @return A reference to the modified image.
+ * @param alpha The new opacity, between 0.0 (fully transparent) and 1.0 (fully opaque).
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void saturation(Image& image, float factor);
+void opacity(ImageView image, float alpha, ExecutionPolicy policy = {});
 
 /**
- * @brief Adjusts the brightness of the image.
+ * @brief Inverts the colors of the image.
  *
- * This function modifies the brightness of all pixels in the image by adding the specified `factor` to 
- * the color components (RGB) of each pixel. Positive values of `factor` increase brightness, while negative 
- * values decrease it. A factor of 0 leaves the brightness unchanged.
+ * This function replaces the color components (RGB) of every pixel with their complement
+ * (255 - value), producing a negative of the image. The alpha component is left unchanged.
  *
  * @param image The image to modify.
- * @param factor The brightness factor. Positive values increase brightness, negative values decrease it.
- * @return A reference to the modified image.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void brightness(Image& image, float factor);
+void invert(ImageView image, ExecutionPolicy policy = {});
 
 /**
- * @brief Adjusts the contrast of the image.
+ * @brief Multiplies the color components of every pixel by its alpha.
  *
- * This function modifies the contrast of all pixels in the image. The contrast adjustment works by scaling 
- * the difference between each pixel's color value and the average color intensity of the image. A factor 
- * greater than 1 increases contrast, while values between 0 and 1 reduce it. A factor of 1 leaves the contrast unchanged.
+ * Converts straight alpha data to premultiplied alpha, each component becoming
+ * `c * a / 255` rounded to the nearest. The pixels are converted whatever the alpha
+ * convention of the view says; use the `Image` overload to also track the convention.
+ * Formats without alpha are left unchanged.
  *
- * @param image The image to modify.
- * @param factor The contrast factor. Values greater than 1 increase contrast, values between 0 and 1 reduce it.
- * @return A reference to the modified image.
+ * @param image The pixels to convert.
+ * @param policy How the work is distributed over threads (sequential by default).
  */
-void contrast(Image& image, float factor);
+void premultiply(ImageView image, ExecutionPolicy policy = {});
+
+/**
+ * @brief Converts an image to premultiplied alpha, if it is not already.
+ *
+ * Does nothing when `image.alpha_mode()` is already `AlphaMode::PREMULTIPLIED`, otherwise
+ * converts the pixels and sets the alpha mode of the image to `AlphaMode::PREMULTIPLIED`.
+ *
+ * @param image The image to convert.
+ * @param policy How the work is distributed over threads (sequential by default).
+ */
+void premultiply(Image& image, ExecutionPolicy policy = {});
+
+/**
+ * @brief Divides the color components of every pixel by its alpha.
+ *
+ * Converts premultiplied alpha data back to straight alpha, each component becoming
+ * `c * 255 / a` rounded to the nearest, or 0 for fully transparent pixels. Components
+ * greater than the alpha, which premultiplied data cannot hold, give 255. The pixels are
+ * converted whatever the alpha convention of the view says. Formats without alpha are
+ * left unchanged.
+ *
+ * @param image The pixels to convert.
+ * @param policy How the work is distributed over threads (sequential by default).
+ */
+void unpremultiply(ImageView image, ExecutionPolicy policy = {});
+
+/**
+ * @brief Converts an image to straight alpha, if it is not already.
+ *
+ * Does nothing when `image.alpha_mode()` is already `AlphaMode::STRAIGHT`, otherwise
+ * converts the pixels and sets the alpha mode of the image to `AlphaMode::STRAIGHT`.
+ *
+ * @param image The image to convert.
+ * @param policy How the work is distributed over threads (sequential by default).
+ */
+void unpremultiply(Image& image, ExecutionPolicy policy = {});
 
 /**
  * @brief Flips the image horizontally.
@@ -608,7 +974,7 @@ void contrast(Image& image, float factor);
  * @param image The image to modify.
  * @return A reference to the modified image with horizontal flip.
  */
-void flip_horizontal(Image& image);
+void flip_horizontal(ImageView image);
 
 /**
  * @brief Flips the image vertically.
@@ -620,7 +986,7 @@ void flip_horizontal(Image& image);
  * @param image The image to modify.
  * @return A reference to the modified image with vertical flip.
  */
-void flip_vertical(Image& image);
+void flip_vertical(ImageView image);
 
 /**
  * @brief Rotates the image by 90 degrees clockwise.
@@ -647,7 +1013,7 @@ void rotate_90(Image& image);
  * @param image The image to rotate.
  * @return A reference to the rotated image.
  */
-void rotate_180(Image& image);
+void rotate_180(ImageView image);
 
 /**
  * @brief Creates a copy of the given image.
@@ -659,7 +1025,7 @@ void rotate_180(Image& image);
  * @param image The image to copy.
  * @return A new image that is a copy of the original.
  */
-Image copy(const Image& image);
+Image copy(ConstImageView image);
 
 /**
  * @brief Converts the image to a new pixel format.
@@ -670,9 +1036,10 @@ Image copy(const Image& image);
  *
  * @param image The image to convert.
  * @param new_format The target pixel format for the conversion.
+ * @param policy How the work is distributed over threads (sequential by default).
  * @return A new image with the specified pixel format.
  */
-Image convert(const Image& image, PixelFormat new_format);
+Image convert(ConstImageView image, PixelFormat new_format, ExecutionPolicy policy = {});
 
 /**
  * @brief Resizes the canvas of the image without altering its content.
@@ -687,21 +1054,48 @@ Image convert(const Image& image, PixelFormat new_format);
  * @param new_h The new height of the canvas.
  * @return A new image with the resized canvas.
  */
-Image resize_canvas(const Image& image, int new_w, int new_h);
+Image resize_canvas(ConstImageView image, int new_w, int new_h);
+
+/**
+ * @brief Behavior of a resampling filter past the edges of the image.
+ */
+enum class EdgeMode
+{
+    CLAMP,      ///< The pixels of the edge are repeated.
+    REFLECT,    ///< The image is mirrored at its edges.
+    WRAP,       ///< The image repeats, as a tiling texture.
+    ZERO,       ///< Pixels past the edges are transparent black.
+};
 
 /**
  * @brief Resizes the image to the specified dimensions.
  *
  * This function resizes the entire image to the new specified width (`new_w`) and height (`new_h`).
  * The image content will be scaled to fit the new dimensions, which may result in distortion if the 
- * aspect ratio is not preserved. The scaling algorithm used can vary (e.g., nearest neighbor, bilinear, etc.).
+ * aspect ratio is not preserved.
+ *
+ * Resampling is done by stb_image_resize2 in the native data type of the format (8-bit, half
+ * or single precision floats). The packed 16-bit formats go through a float copy, their channels
+ * being expanded and quantized exactly, so that a uniform image keeps its pixels. Unlike
+ * `draw`, the filters are widened when downscaling so that every source pixel contributes.
+ * Straight alpha colors are weighted by their alpha while filtering, premultiplied ones are
+ * filtered as is. With a parallel policy, the output rows are split over the threads, with a
+ * result identical to the sequential one. `Filter::BICUBIC` resizes are not split and run on
+ * the calling thread, as the resizer computes the rows around a split wrongly with its weights.
  *
  * @param image The image to resize.
  * @param new_w The new width of the image.
  * @param new_h The new height of the image.
+ * @param filter The resampling filter (`Filter::BILINEAR` maps to a triangle filter and
+ *        `Filter::BICUBIC` to Catmull-Rom).
+ * @param edge How the filter samples past the edges of the image.
+ * @param policy How the work is distributed over threads (sequential by default).
  * @return A new image with the resized content.
+ * @throws std::invalid_argument If the new dimensions are not positive.
+ * @throws std::runtime_error If the resize fails.
  */
-Image resize(const Image& image, int new_w, int new_h);
+Image resize(ConstImageView image, int new_w, int new_h, Filter filter = Filter::BICUBIC,
+             EdgeMode edge = EdgeMode::CLAMP, ExecutionPolicy policy = {});
 
 /**
  * @brief Writes the image to a PNG file.
@@ -709,11 +1103,14 @@ Image resize(const Image& image, int new_w, int new_h);
  * This function saves the provided image to a file in PNG format. The PNG format supports lossless 
  * compression and is widely used for high-quality image storage.
  *
+ * Images of any pixel format and alpha convention are accepted, they are converted row by
+ * row to straight alpha bytes when needed. See `ImageEncoder` to encode to memory.
+ *
  * @param image The image to write to a file.
  * @param path The file path where the PNG image will be saved.
  * @return `true` if the image was successfully saved, `false` otherwise.
  */
-bool write_png(const Image& image, const std::string& path);
+bool write_png(ConstImageView image, const std::string& path);
 
 /**
  * @brief Writes the image to a BMP file.
@@ -721,11 +1118,13 @@ bool write_png(const Image& image, const std::string& path);
  * This function saves the provided image to a file in BMP format. BMP is a simple image format that 
  * typically uses uncompressed pixel data and is compatible with a wide range of image editing software.
  *
+ * Like `write_png`, any pixel format is accepted.
+ *
  * @param image The image to write to a file.
  * @param path The file path where the BMP image will be saved.
  * @return `true` if the image was successfully saved, `false` otherwise.
  */
-bool write_bmp(const Image& image, const std::string& path);
+bool write_bmp(ConstImageView image, const std::string& path);
 
 /**
  * @brief Writes the image to a TGA file.
@@ -733,11 +1132,13 @@ bool write_bmp(const Image& image, const std::string& path);
  * This function saves the provided image to a file in TGA (Targa) format. TGA supports both 
  * uncompressed and compressed pixel data, and is commonly used in computer graphics and video games.
  *
+ * Like `write_png`, any pixel format is accepted.
+ *
  * @param image The image to write to a file.
  * @param path The file path where the TGA image will be saved.
  * @return `true` if the image was successfully saved, `false` otherwise.
  */
-bool write_tga(const Image& image, const std::string& path);
+bool write_tga(ConstImageView image, const std::string& path);
 
 /**
  * @brief Writes the image to a JPG file with specified quality.
@@ -747,12 +1148,29 @@ bool write_tga(const Image& image, const std::string& path);
  * and web images. The quality parameter ranges from 0 (lowest quality, highest compression) to 100 
  * (highest quality, lowest compression).
  *
+ * Like `write_png`, any pixel format is accepted.
+ *
  * @param image The image to write to a file.
  * @param path The file path where the JPG image will be saved.
  * @param quality The quality level of the JPG image (default is 90).
  * @return `true` if the image was successfully saved, `false` otherwise.
  */
-bool write_jpg(const Image& image, const std::string& path, int quality = 90);
+bool write_jpg(ConstImageView image, const std::string& path, int quality = 90);
+
+/**
+ * @brief Writes the image to a QOI file.
+ *
+ * QOI is a lossless format encoding and decoding several times faster than PNG, usually for
+ * a somewhat larger file. RGB_U8, RGBA_U8 and BGRA_U8 images are encoded straight from their
+ * rows, padded or not, with no conversion pass.
+ *
+ * Like `write_png`, any pixel format is accepted.
+ *
+ * @param image The image to write to a file.
+ * @param path The file path where the QOI image will be saved.
+ * @return `true` if the image was successfully saved, `false` otherwise.
+ */
+bool write_qoi(ConstImageView image, const std::string& path);
 
 /**
  * @brief Adjusts the saturation of a color.
@@ -975,6 +1393,61 @@ constexpr Color lerp(Color a, Color b, float t) {
     };
 }
 
+namespace detail {
+
+/*
+    Rounds x / 255 to the nearest integer without dividing, exact for every
+    x in [0, 255 * 255], which covers the product of two channels.
+*/
+constexpr int div255(int x) noexcept {
+    return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+/*
+    Rounds n / d to the nearest integer, halves rounding up, 0 when d is 0.
+*/
+constexpr int div_round(int n, int d) noexcept {
+    return d ? (n + (d >> 1)) / d : 0;
+}
+
+} // namespace detail
+
+/**
+ * @brief Multiplies the color components of a color by its alpha.
+ *
+ * @param color A color with straight alpha.
+ * @return The premultiplied color, each component being `c * a / 255` rounded to the nearest.
+ */
+constexpr Color premultiply(Color color) noexcept {
+    return {
+        static_cast<uint8_t>(detail::div255(color.r * color.a)),
+        static_cast<uint8_t>(detail::div255(color.g * color.a)),
+        static_cast<uint8_t>(detail::div255(color.b * color.a)),
+        color.a
+    };
+}
+
+/**
+ * @brief Divides the color components of a premultiplied color by its alpha.
+ *
+ * Components greater than the alpha are treated as equal to it, giving 255.
+ *
+ * @param color A color with premultiplied alpha.
+ * @return The straight alpha color, each component being `c * 255 / a` rounded to the
+ *         nearest, or a blank color if the alpha is 0.
+ */
+constexpr Color unpremultiply(Color color) noexcept {
+    constexpr auto divide = [](int c, int a) -> uint8_t {
+        return static_cast<uint8_t>(detail::div_round(std::min(c, a) * 255, a));
+    };
+    return {
+        divide(color.r, color.a),
+        divide(color.g, color.a),
+        divide(color.b, color.a),
+        color.a
+    };
+}
+
 /**
  * @brief Blends two colors based on a specified blend mode.
  *
@@ -996,6 +1469,12 @@ constexpr Color lerp(Color a, Color b, float t) {
  * - `EXCLUSION`: A variation of `DIFFERENCE` with less contrast.
  * - `DODGE`: Brightens the destination color based on the source.
  * - `BURN`: Darkens the destination color based on the source.
+ * - `PREMULTIPLIED_ALPHA`: "Over" compositing of premultiplied colors, `src + dst * (1 - src.a)`.
+ *
+ * Every mode is computed with integer arithmetic on the 8-bit channels, and products
+ * are brought back to [0, 255] with exact rounding of the division by 255. This is the
+ * reference of `blend_span`, which gives identical results for whole runs of pixels.
+ * Except for `REPLACE`, `ALPHA` and `PREMULTIPLIED_ALPHA`, the alpha of the destination is kept.
  *
  * @param dst The destination color to be blended.
  * @param src The source color to blend with the destination color.
@@ -1003,23 +1482,32 @@ constexpr Color lerp(Color a, Color b, float t) {
  * @return The resulting blended color.
  */
 constexpr Color blend(Color dst, Color src, BlendMode mode) noexcept {
+    using detail::div255;
+    using detail::div_round;
     constexpr auto clamp_ubyte = [](int value) -> uint8_t {
         return static_cast<uint8_t>(std::max(0, std::min(255, value)));
     };
+    constexpr auto dodge = [](int d, int s) -> uint8_t {
+        return (s == 255) ? 255 : static_cast<uint8_t>(std::min(255, div_round(d * 255, 255 - s)));
+    };
+    constexpr auto burn = [](int d, int s) -> uint8_t {
+        return (s == 0) ? 0 : static_cast<uint8_t>(255 - std::min(255, div_round((255 - d) * 255, s)));
+    };
     switch (mode) {
         case BlendMode::REPLACE:
             return src;
 
         case BlendMode::ALPHA: {
-            float src_alpha = src.a / 255.0f;
-            float dst_alpha = dst.a / 255.0f * (1.0f - src_alpha);
-            float out_alpha = src_alpha + dst_alpha;
+            // Straight alpha "over": the weight of the destination is its alpha
+            // scaled by the transparency of the source
+            const int dst_weight = div255(dst.a * (255 - src.a));
+            const int out_alpha = src.a + dst_weight;
 
             return {
-                clamp_ubyte(static_cast<int>((src.r * src_alpha + dst.r * dst_alpha) / out_alpha)),
-                clamp_ubyte(static_cast<int>((src.g * src_alpha + dst.g * dst_alpha) / out_alpha)),
-                clamp_ubyte(static_cast<int>((src.b * src_alpha + dst.b * dst_alpha) / out_alpha)),
-                clamp_ubyte(static_cast<int>(out_alpha * 255))
+                static_cast<uint8_t>(div_round(src.r * src.a + dst.r * dst_weight, out_alpha)),
+                static_cast<uint8_t>(div_round(src.g * src.a + dst.g * dst_weight, out_alpha)),
+                static_cast<uint8_t>(div_round(src.b * src.a + dst.b * dst_weight, out_alpha)),
+                static_cast<uint8_t>(out_alpha)
             };
         }
 
@@ -1041,17 +1529,17 @@ constexpr Color blend(Color dst, Color src, BlendMode mode) noexcept {
 
         case BlendMode::MUL:
             return {
-                clamp_ubyte((dst.r * src.r) / 255),
-                clamp_ubyte((dst.g * src.g) / 255),
-                clamp_ubyte((dst.b * src.b) / 255),
+                static_cast<uint8_t>(div255(dst.r * src.r)),
+                static_cast<uint8_t>(div255(dst.g * src.g)),
+                static_cast<uint8_t>(div255(dst.b * src.b)),
                 dst.a
             };
 
         case BlendMode::SCREEN:
             return {
-                clamp_ubyte(255 - ((255 - dst.r) * (255 - src.r) / 255)),
-                clamp_ubyte(255 - ((255 - dst.g) * (255 - src.g) / 255)),
-                clamp_ubyte(255 - ((255 - dst.b) * (255 - src.b) / 255)),
+                static_cast<uint8_t>(255 - div255((255 - dst.r) * (255 - src.r))),
+                static_cast<uint8_t>(255 - div255((255 - dst.g) * (255 - src.g))),
+                static_cast<uint8_t>(255 - div255((255 - dst.b) * (255 - src.b))),
                 dst.a
             };
 
@@ -1073,40 +1561,103 @@ constexpr Color blend(Color dst, Color src, BlendMode mode) noexcept {
 
         case BlendMode::DIFFERENCE:
             return {
-                clamp_ubyte(std::abs(dst.r - src.r)),
-                clamp_ubyte(std::abs(dst.g - src.g)),
-                clamp_ubyte(std::abs(dst.b - src.b)),
+                static_cast<uint8_t>(std::abs(dst.r - src.r)),
+                static_cast<uint8_t>(std::abs(dst.g - src.g)),
+                static_cast<uint8_t>(std::abs(dst.b - src.b)),
                 dst.a
             };
 
         case BlendMode::EXCLUSION:
+            // d + s - 2ds/255, written as a sum of two non-negative products
             return {
-                clamp_ubyte(dst.r + src.r - 2 * dst.r * src.r / 255),
-                clamp_ubyte(dst.g + src.g - 2 * dst.g * src.g / 255),
-                clamp_ubyte(dst.b + src.b - 2 * dst.b * src.b / 255),
+                static_cast<uint8_t>(div255(dst.r * (255 - src.r) + src.r * (255 - dst.r))),
+                static_cast<uint8_t>(div255(dst.g * (255 - src.g) + src.g * (255 - dst.g))),
+                static_cast<uint8_t>(div255(dst.b * (255 - src.b) + src.b * (255 - dst.b))),
                 dst.a
             };
 
         case BlendMode::DODGE:
             return {
-                clamp_ubyte((src.r == 255) ? 255 : std::min(255, (dst.r * 255) / (255 - src.r))),
-                clamp_ubyte((src.g == 255) ? 255 : std::min(255, (dst.g * 255) / (255 - src.g))),
-                clamp_ubyte((src.b == 255) ? 255 : std::min(255, (dst.b * 255) / (255 - src.b))),
+                dodge(dst.r, src.r),
+                dodge(dst.g, src.g),
+                dodge(dst.b, src.b),
                 dst.a
             };
 
         case BlendMode::BURN:
             return {
-                clamp_ubyte((src.r == 0) ? 0 : std::max(0, 255 - (255 - dst.r) * 255 / src.r)),
-                clamp_ubyte((src.g == 0) ? 0 : std::max(0, 255 - (255 - dst.g) * 255 / src.g)),
-                clamp_ubyte((src.b == 0) ? 0 : std::max(0, 255 - (255 - dst.b) * 255 / src.b)),
+                burn(dst.r, src.r),
+                burn(dst.g, src.g),
+                burn(dst.b, src.b),
                 dst.a
             };
+
+        case BlendMode::PREMULTIPLIED_ALPHA: {
+            // Premultiplied "over": every component, alpha included, is the source plus
+            // the destination scaled by the transparency of the source
+            const int inv_alpha = 255 - src.a;
+            return {
+                clamp_ubyte(src.r + div255(dst.r * inv_alpha)),
+                clamp_ubyte(src.g + div255(dst.g * inv_alpha)),
+                clamp_ubyte(src.b + div255(dst.b * inv_alpha)),
+                clamp_ubyte(src.a + div255(dst.a * inv_alpha))
+            };
+        }
     }
 
     return dst;
 }
 
+/**
+ * @brief Blends a run of source colors over a run of destination colors.
+ *
+ * Computes `dst[i] = blend(dst[i], src[i], mode)` for every `i` in [0, count), with the
+ * mode resolved once for the whole run and a loop specialized for each mode. The common
+ * modes on x86 (SSE2, SSE4.1, AVX2) and ARM (NEON) are vectorized with 8-bit fixed-point
+ * arithmetic, selected at runtime for the CPU. The results are identical to `blend`.
+ *
+ * @param dst The colors to blend into, at least `count` elements long.
+ * @param src The colors to blend, at least `count` elements long.
+ * @param count The number of colors to blend.
+ * @param mode The blend mode to use.
+ */
+void blend_span(Color* dst, const Color* src, size_t count, BlendMode mode);
+
+/**
+ * @brief Blends a single source color over a run of destination colors.
+ *
+ * Same as the other overload with every source color equal to `src`, which is the case
+ * when filling shapes with a solid color.
+ *
+ * @param dst The colors to blend into, at least `count` elements long.
+ * @param src The color to blend.
+ * @param count The number of colors to blend.
+ * @param mode The blend mode to use.
+ */
+void blend_span(Color* dst, Color src, size_t count, BlendMode mode);
+
+/**
+ * @brief Premultiplies a run of colors by their alpha, in place.
+ *
+ * Computes `colors[i] = premultiply(colors[i])` for every `i` in [0, count), vectorized
+ * like `blend_span` with identical results.
+ *
+ * @param colors The colors to convert, at least `count` elements long.
+ * @param count The number of colors to convert.
+ */
+void premultiply_span(Color* colors, size_t count);
+
+/**
+ * @brief Converts a run of premultiplied colors back to straight alpha, in place.
+ *
+ * Computes `colors[i] = unpremultiply(colors[i])` for every `i` in [0, count), vectorized
+ * like `blend_span` with identical results. Runs of opaque colors are left untouched.
+ *
+ * @param colors The colors to convert, at least `count` elements long.
+ * @param count The number of colors to convert.
+ */
+void unpremultiply_span(Color* colors, size_t count);
+
 } // bpx
 
 #endif // BPX_ALGORITHM_HPP
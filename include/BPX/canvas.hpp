@@ -0,0 +1,387 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_CANVAS_HPP
+#define BPX_CANVAS_HPP
+
+#include "algorithm.hpp"
+#include "color.hpp"
+#include "execution.hpp"
+#include "image.hpp"
+#include "region.hpp"
+#include "view.hpp"
+
+#include <utility>
+
+namespace bpx {
+
+class ColorRamp;
+
+/**
+ * @class Canvas
+ * @brief A drawing target tracking the pixels it changes, with an optional clip region.
+ *
+ * The drawing functions take the same arguments as those of `algorithm.hpp`, without the image,
+ * which is the target of the canvas. Each of them adds the bounding box of the pixels it may
+ * write (within the target and the clip) to the damage of the canvas, so that presenting a frame
+ * only needs to upload the rectangles of `damage`, before calling `clear_damage`. The functions
+ * changing every pixel (`map`, `map_rows`, the color adjustments, `premultiply`, `unpremultiply`,
+ * the flips and `rotate_180`) are wrapped too, their bounds being the whole target or the given
+ * rectangle. Pixels changed by other means, e.g. the anti-aliased shapes drawn on `target` or
+ * `rotate_90` and `resize_canvas`, which change the size of an image, are reported with
+ * `invalidate`.
+ *
+ * Setting a clip region restricts every drawing to its pixels, e.g. to redraw a whole scene only
+ * where it changed. Clipping only masks the pixels written: shapes are traced as on the whole
+ * target, so the clipped pixels come out exactly as when drawing without clip. Likewise, a flip
+ * or rotation within a clip gives the pixels of the clip the values they would take if the whole
+ * target were flipped. A source drawn with `draw` must not share memory with the target when the
+ * clip has several rectangles.
+ */
+class Canvas
+{
+public:
+    /**
+     * @brief Creates a canvas drawing on an image, without damage or clip.
+     */
+    explicit Canvas(ImageView target);
+
+    /**
+     * @brief Returns the image the canvas draws on.
+     */
+    const ImageView& target() const noexcept {
+        return m_target;
+    }
+
+    /**
+     * @brief Returns the pixels changed since the damage was last cleared, within the target.
+     */
+    const Region& damage() const noexcept {
+        return m_damage;
+    }
+
+    /**
+     * @brief Forgets the damage, typically once the changed pixels have been presented.
+     */
+    void clear_damage() noexcept {
+        m_damage.clear();
+    }
+
+    /**
+     * @brief Adds a rectangle to the damage, for pixels changed without the canvas.
+     */
+    void invalidate(const Rect& rect);
+
+    /**
+     * @brief Restricts the following drawings to the pixels of a region.
+     */
+    void set_clip(const Region& region);
+
+    /**
+     * @brief Restricts the following drawings to the pixels of a rectangle.
+     */
+    void set_clip(const Rect& rect);
+
+    /**
+     * @brief Lets the following drawings write anywhere on the target.
+     */
+    void reset_clip() noexcept;
+
+    /**
+     * @brief Checks whether a clip region is set.
+     */
+    bool clipped() const noexcept {
+        return m_clipped;
+    }
+
+    /**
+     * @brief Returns the clip region, meaningful when `clipped` is true.
+     */
+    const Region& clip() const noexcept {
+        return m_clip;
+    }
+
+    /**
+     * @brief Draws like `fill`, within the clip.
+     */
+    void fill(Color color, ExecutionPolicy policy = {});
+
+    /**
+     * @brief Draws like `point`.
+     */
+    void point(int x, int y, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `line` with a color.
+     */
+    void line(int x1, int y1, int x2, int y2, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `line` with a mapper.
+     */
+    void line(int x1, int y1, int x2, int y2, const Image::Mapper& mapper);
+
+    /**
+     * @brief Draws like the thick `line` with a color.
+     */
+    void line(int x1, int y1, int x2, int y2, int thick, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like the thick `line` with a mapper.
+     */
+    void line(int x1, int y1, int x2, int y2, int thick, const Image::Mapper& mapper);
+
+    /**
+     * @brief Draws like `line_gradient`.
+     */
+    void line_gradient(int x1, int y1, int x2, int y2, const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like the thick `line_gradient`.
+     */
+    void line_gradient(int x1, int y1, int x2, int y2, int thick,
+                       const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `rectangle` with a color.
+     */
+    void rectangle(int x, int y, int w, int h, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `rectangle` with a mapper.
+     */
+    void rectangle(int x, int y, int w, int h, const Image::Mapper& mapper);
+
+    /**
+     * @brief Draws like `rectangle_gradient_linear`.
+     */
+    void rectangle_gradient_linear(int x, int y, int w, int h, int x_start, int y_start, int x_end, int y_end,
+                                   const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `rectangle_gradient_radial`.
+     */
+    void rectangle_gradient_radial(int x, int y, int w, int h, int x_start, int y_start, int x_end, int y_end,
+                                   const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `rectangle_lines` with a color.
+     */
+    void rectangle_lines(int x, int y, int w, int h, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `rectangle_lines` with a mapper.
+     */
+    void rectangle_lines(int x, int y, int w, int h, const Image::Mapper& mapper);
+
+    /**
+     * @brief Draws like the thick `rectangle_lines` with a color.
+     */
+    void rectangle_lines(int x, int y, int w, int h, int thick, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like the thick `rectangle_lines` with a mapper.
+     */
+    void rectangle_lines(int x, int y, int w, int h, int thick, const Image::Mapper& mapper);
+
+    /**
+     * @brief Draws like `circle` with a color.
+     */
+    void circle(int cx, int cy, int radius, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `circle` with a mapper.
+     */
+    void circle(int cx, int cy, int radius, const Image::Mapper& mapper);
+
+    /**
+     * @brief Draws like `circle_gradient`.
+     */
+    void circle_gradient(int cx, int cy, int radius, const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `circle_lines` with a color.
+     */
+    void circle_lines(int cx, int cy, int radius, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like `circle_lines` with a mapper.
+     */
+    void circle_lines(int cx, int cy, int radius, const Image::Mapper& mapper);
+
+    /**
+     * @brief Draws like the thick `circle_lines` with a color.
+     */
+    void circle_lines(int cx, int cy, int radius, int thick, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Draws like the thick `circle_lines` with a mapper.
+     */
+    void circle_lines(int cx, int cy, int radius, int thick, const Image::Mapper& mapper);
+
+    /**
+     * @brief Draws like `draw` of a whole source image.
+     */
+    void draw(int x, int y, int w, int h, ConstImageView src, BlendMode mode = BlendMode::REPLACE,
+              Filter filter = Filter::NEAREST, ExecutionPolicy policy = {});
+
+    /**
+     * @brief Draws like `draw` of a region of a source image.
+     */
+    void draw(int x_dst, int y_dst, int w_dst, int h_dst, ConstImageView src, int x_src, int y_src,
+              int w_src, int h_src, BlendMode mode = BlendMode::REPLACE, Filter filter = Filter::NEAREST,
+              ExecutionPolicy policy = {});
+
+    /**
+     * @brief Maps the pixels like `map`, within the clip.
+     */
+    template <typename Func>
+    void map(Func&& mapper, ExecutionPolicy policy = {}) {
+        map(0, 0, m_target.width(), m_target.height(), std::forward<Func>(mapper), policy);
+    }
+
+    /**
+     * @brief Maps the pixels of a rectangle like `map`, within the clip.
+     */
+    template <typename Func>
+    void map(int x, int y, int w, int h, Func&& mapper, ExecutionPolicy policy = {}) {
+        paint(region_bounds(x, y, w, h), [&](const Rect& part) {
+            bpx::map(m_target, part.x, part.y, part.w, part.h, mapper, policy);
+        });
+    }
+
+    /**
+     * @brief Processes the pixels like `map_rows`, within the clip.
+     */
+    template <typename Func>
+    void map_rows(Func&& func, ExecutionPolicy policy = {}) {
+        map_rows(0, 0, m_target.width(), m_target.height(), std::forward<Func>(func), policy);
+    }
+
+    /**
+     * @brief Processes the pixels of a rectangle like `map_rows`, within the clip.
+     */
+    template <typename Func>
+    void map_rows(int x, int y, int w, int h, Func&& func, ExecutionPolicy policy = {}) {
+        paint(region_bounds(x, y, w, h), [&](const Rect& part) {
+            bpx::map_rows(m_target, part.x, part.y, part.w, part.h, func, policy);
+        });
+    }
+
+    /**
+     * @brief Adjusts the pixels like `saturation`, within the clip.
+     */
+    void saturation(float factor, ExecutionPolicy policy = {});
+
+    /**
+     * @brief Adjusts the pixels like `brightness`, within the clip.
+     */
+    void brightness(float factor, ExecutionPolicy policy = {});
+
+    /**
+     * @brief Adjusts the pixels like `contrast`, within the clip.
+     */
+    void contrast(float factor, ExecutionPolicy policy = {});
+
+    /**
+     * @brief Sets the opacity of the pixels like `opacity`, within the clip.
+     */
+    void opacity(float alpha, ExecutionPolicy policy = {});
+
+    /**
+     * @brief Inverts the pixels like `invert`, within the clip.
+     */
+    void invert(ExecutionPolicy policy = {});
+
+    /**
+     * @brief Converts the pixels like `premultiply`, within the clip.
+     */
+    void premultiply(ExecutionPolicy policy = {});
+
+    /**
+     * @brief Converts the pixels like `unpremultiply`, within the clip.
+     */
+    void unpremultiply(ExecutionPolicy policy = {});
+
+    /**
+     * @brief Flips the target like `flip_horizontal`, writing only within the clip.
+     */
+    void flip_horizontal();
+
+    /**
+     * @brief Flips the target like `flip_vertical`, writing only within the clip.
+     */
+    void flip_vertical();
+
+    /**
+     * @brief Rotates the target like `rotate_180`, writing only within the clip.
+     */
+    void rotate_180();
+
+private:
+    /**
+     * @brief Bounds of a rectangle whose size may be negative, as `map` takes it.
+     */
+    static Rect region_bounds(int x, int y, int w, int h) noexcept {
+        return Rect{ w < 0 ? x + w : x, h < 0 ? y + h : y, w < 0 ? -w : w, h < 0 ? -h : h };
+    }
+
+    /**
+     * @brief Calls `func` with every part of the bounds inside the target and the clip,
+     *        adding the parts to the damage. The parts are disjoint.
+     */
+    template <typename Func>
+    void paint(const Rect& bounds, Func&& func);
+
+    /**
+     * @brief Moves the pixels of the target with `func`. Within a clip, they are moved on a
+     *        copy of the target and only those inside the clip are written back.
+     */
+    void move_pixels(void (*func)(ImageView));
+
+    ImageView m_target;     ///< Image drawn on.
+    Region m_damage;        ///< Pixels changed since the damage was cleared.
+    Region m_clip;          ///< Pixels the drawings are restricted to, when `m_clipped` is set.
+    bool m_clipped;         ///< Whether the drawings are clipped.
+};
+
+template <typename Func>
+void Canvas::paint(const Rect& bounds, Func&& func)
+{
+    const Rect area = intersection(bounds, Rect{ 0, 0, m_target.width(), m_target.height() });
+    if (area.empty()) {
+        return;
+    }
+    if (!m_clipped) {
+        m_damage.add(area);
+        func(area);
+        return;
+    }
+    for (const Rect& rect : m_clip.rects()) {
+        const Rect part = intersection(area, rect);
+        if (!part.empty()) {
+            m_damage.add(part);
+            func(part);
+        }
+    }
+}
+
+} // namespace bpx
+
+#endif // BPX_CANVAS_HPP
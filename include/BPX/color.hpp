@@ -106,7 +106,14 @@ enum class BlendMode
      * BURN: Darkens the base color based on the source color.
      * Often used to add depth and shadow effects.
      */
-    BURN
+    BURN,
+
+    /**
+     * PREMULTIPLIED_ALPHA: Composites the source over the base color, both being
+     * premultiplied by their alpha. Unlike ALPHA, this needs no division and keeps
+     * the result premultiplied, so that compositing chains can stay premultiplied.
+     */
+    PREMULTIPLIED_ALPHA
 };
 
 /**
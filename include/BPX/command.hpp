@@ -0,0 +1,250 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_COMMAND_HPP
+#define BPX_COMMAND_HPP
+
+#include "algorithm.hpp"
+#include "color.hpp"
+#include "execution.hpp"
+#include "image.hpp"
+#include "region.hpp"
+#include "view.hpp"
+
+#include <cstddef>
+#include <memory>
+
+namespace bpx {
+
+class ColorRamp;
+
+namespace detail {
+struct CommandData;
+} // namespace detail
+
+/**
+ * @class CommandList
+ * @brief Records drawing commands, then replays them tile by tile, possibly on several threads.
+ *
+ * The recording functions take the same arguments as the drawing functions of `algorithm.hpp`
+ * (points, lines, rectangles, circles, their outlines and gradients, and `draw`), without the
+ * image, which is given to `execute`. Executing the list cuts the image into tiles of
+ * `TILE_SIZE` x `TILE_SIZE` pixels, bins every command into the tiles its bounding box overlaps,
+ * and replays the tiles independently: each tile runs its commands in the order they were
+ * recorded, restricted to its pixels, while the tile stays in cache. Every pixel thus receives
+ * the same writes in the same order as when drawing immediately, and the result is identical to
+ * calling the drawing functions one after another, whatever the number of threads.
+ *
+ * Mappers are copied into the list; with a parallel policy they are called concurrently and must
+ * be thread-safe. Ramps and source images are only referenced and must stay valid until the list
+ * is executed, and the sources must not share memory with the image the list is executed on.
+ *
+ * `clear` keeps the storage of the list, so that recording the same number of commands for
+ * every frame does not allocate once the list has grown. A list must not be recorded or executed
+ * by several threads at once.
+ */
+class CommandList
+{
+public:
+    /**
+     * @brief Width and height of the tiles the image is cut into, in pixels.
+     */
+    static constexpr int TILE_SIZE = 64;
+
+    CommandList();
+    ~CommandList();
+
+    CommandList(const CommandList&) = delete;
+    CommandList& operator=(const CommandList&) = delete;
+
+    CommandList(CommandList&&) noexcept;
+    CommandList& operator=(CommandList&&) noexcept;
+
+    /**
+     * @brief Removes all the commands, keeping the storage.
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief Checks whether the list holds no command.
+     */
+    bool empty() const noexcept;
+
+    /**
+     * @brief Returns the number of commands recorded.
+     */
+    size_t size() const noexcept;
+
+    /**
+     * @brief Records `point`.
+     */
+    void point(int x, int y, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `line` with a color.
+     */
+    void line(int x1, int y1, int x2, int y2, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `line` with a mapper.
+     */
+    void line(int x1, int y1, int x2, int y2, const Image::Mapper& mapper);
+
+    /**
+     * @brief Records the thick `line` with a color.
+     */
+    void line(int x1, int y1, int x2, int y2, int thick, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records the thick `line` with a mapper.
+     */
+    void line(int x1, int y1, int x2, int y2, int thick, const Image::Mapper& mapper);
+
+    /**
+     * @brief Records `line_gradient`.
+     */
+    void line_gradient(int x1, int y1, int x2, int y2, const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records the thick `line_gradient`.
+     */
+    void line_gradient(int x1, int y1, int x2, int y2, int thick,
+                       const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `rectangle` with a color.
+     */
+    void rectangle(int x, int y, int w, int h, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `rectangle` with a mapper.
+     */
+    void rectangle(int x, int y, int w, int h, const Image::Mapper& mapper);
+
+    /**
+     * @brief Records `rectangle_gradient_linear`.
+     */
+    void rectangle_gradient_linear(int x, int y, int w, int h, int x_start, int y_start, int x_end, int y_end,
+                                   const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `rectangle_gradient_radial`.
+     */
+    void rectangle_gradient_radial(int x, int y, int w, int h, int x_start, int y_start, int x_end, int y_end,
+                                   const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `rectangle_lines` with a color.
+     */
+    void rectangle_lines(int x, int y, int w, int h, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `rectangle_lines` with a mapper.
+     */
+    void rectangle_lines(int x, int y, int w, int h, const Image::Mapper& mapper);
+
+    /**
+     * @brief Records the thick `rectangle_lines` with a color.
+     */
+    void rectangle_lines(int x, int y, int w, int h, int thick, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records the thick `rectangle_lines` with a mapper.
+     */
+    void rectangle_lines(int x, int y, int w, int h, int thick, const Image::Mapper& mapper);
+
+    /**
+     * @brief Records `circle` with a color.
+     */
+    void circle(int cx, int cy, int radius, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `circle` with a mapper.
+     */
+    void circle(int cx, int cy, int radius, const Image::Mapper& mapper);
+
+    /**
+     * @brief Records `circle_gradient`.
+     */
+    void circle_gradient(int cx, int cy, int radius, const ColorRamp& ramp, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `circle_lines` with a color.
+     */
+    void circle_lines(int cx, int cy, int radius, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records `circle_lines` with a mapper.
+     */
+    void circle_lines(int cx, int cy, int radius, const Image::Mapper& mapper);
+
+    /**
+     * @brief Records the thick `circle_lines` with a color.
+     */
+    void circle_lines(int cx, int cy, int radius, int thick, Color color, BlendMode mode = BlendMode::REPLACE);
+
+    /**
+     * @brief Records the thick `circle_lines` with a mapper.
+     */
+    void circle_lines(int cx, int cy, int radius, int thick, const Image::Mapper& mapper);
+
+    /**
+     * @brief Records `draw` of a whole source image.
+     */
+    void draw(int x, int y, int w, int h, ConstImageView src, BlendMode mode = BlendMode::REPLACE,
+              Filter filter = Filter::NEAREST);
+
+    /**
+     * @brief Records `draw` of a region of a source image.
+     */
+    void draw(int x_dst, int y_dst, int w_dst, int h_dst, ConstImageView src, int x_src, int y_src,
+              int w_src, int h_src, BlendMode mode = BlendMode::REPLACE, Filter filter = Filter::NEAREST);
+
+    /**
+     * @brief Draws the recorded commands on an image.
+     *
+     * The commands are kept and can be executed again, on the same image or another one. The
+     * tile bins are kept as well, so that executing on an image of the same size again does
+     * not reallocate them.
+     *
+     * @param image The image to draw on.
+     * @param policy How the tiles are distributed over threads (sequential by default).
+     */
+    void execute(ImageView image, ExecutionPolicy policy = {});
+
+    /**
+     * @brief Draws the recorded commands on the pixels of a region of an image only.
+     *
+     * Only the tiles overlapping the region are replayed, clipped to it, and the pixels of the
+     * region come out as when executing on the whole image. Typically redraws a recorded scene
+     * where a `Canvas` or the application reported damage.
+     *
+     * @param image The image to draw on.
+     * @param region The pixels to draw.
+     * @param policy How the tiles are distributed over threads (sequential by default).
+     */
+    void execute(ImageView image, const Region& region, ExecutionPolicy policy = {});
+
+private:
+    std::unique_ptr<detail::CommandData> m_data;    ///< Commands, their resources and the tile bins.
+};
+
+} // namespace bpx
+
+#endif // BPX_COMMAND_HPP
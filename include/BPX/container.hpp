@@ -0,0 +1,240 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_CONTAINER_HPP
+#define BPX_CONTAINER_HPP
+
+#include "encode.hpp"
+#include "image.hpp"
+#include "mipmap.hpp"
+#include "pixel.hpp"
+#include "view.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bpx {
+
+/**
+ * @brief Alignment (in bytes) of the pixels of every level stored in a container file.
+ */
+constexpr size_t CONTAINER_ALIGNMENT = 64;
+
+/**
+ * @class ContainerWriter
+ * @brief Collects images and mipmap chains to store them in a BPX container file.
+ *
+ * A container holds raw pixel rows in the native format of each image, ready to be used
+ * as is once mapped in memory by `MappedContainer`: there is nothing to decode. Each
+ * image has one or more levels (a mipmap chain), every level starting at an offset aligned
+ * to `CONTAINER_ALIGNMENT` with tightly packed rows. Several images can share one file,
+ * for example the pages of an atlas.
+ *
+ * The writer only references the pixels, which must stay valid until `write` is called.
+ * Containers use the byte order of the machine writing them and are rejected by machines
+ * of the other byte order.
+ */
+class ContainerWriter
+{
+public:
+    /**
+     * @brief Adds an image with a single level.
+     *
+     * @param image The pixels to store.
+     * @return The index of the image in the container.
+     * @throws std::invalid_argument If the image is empty.
+     */
+    size_t add(ConstImageView image);
+
+    /**
+     * @brief Adds an image with every level of a mipmap chain.
+     *
+     * @param chain The levels to store.
+     * @return The index of the image in the container.
+     * @throws std::invalid_argument If the chain has no level.
+     */
+    size_t add(const MipChain& chain);
+
+    /**
+     * @brief Gets the number of images added so far.
+     */
+    size_t size() const noexcept {
+        return m_entries.size();
+    }
+
+    /**
+     * @brief Writes the container to a file.
+     *
+     * @param path The file path where the container will be saved.
+     * @return `true` if the container was successfully saved, `false` otherwise.
+     */
+    bool write(const std::string& path) const;
+
+    /**
+     * @brief Streams the container to a writer.
+     *
+     * @param writer The callback receiving the file content.
+     * @return `true` if the container was successfully written, `false` otherwise.
+     */
+    bool write(const ImageWriter& writer) const;
+
+private:
+    struct Entry {
+        PixelFormat format;
+        AlphaMode alpha;
+        std::vector<ConstImageView> levels;
+    };
+
+    std::vector<Entry> m_entries;
+};
+
+/**
+ * @class MappedContainer
+ * @brief A BPX container file mapped in memory, giving access to its images without copy.
+ *
+ * Opening a container maps the file and validates its header and the placement of every
+ * level, without reading the pixels: they are paged in by the system when first touched,
+ * so opening is almost free and loading costs only the page faults of the pixels used.
+ *
+ * The mapping is private: pixels can be modified through `image` or the mutable views,
+ * the modified pages being copied on write and never written back to the file. The views
+ * and images handed out point into the mapping and must not outlive the container.
+ */
+class MappedContainer
+{
+public:
+    /**
+     * @brief Creates an empty container, holding no image.
+     */
+    MappedContainer() = default;
+
+    /**
+     * @brief Maps a container file.
+     *
+     * @param path The path of the container file.
+     * @throws std::runtime_error If the file cannot be mapped or is not a valid container.
+     */
+    explicit MappedContainer(const std::string& path);
+
+    /**
+     * @brief Maps a container file, without throwing on failure.
+     *
+     * @param path The path of the container file.
+     * @param error Receives the reason of the failure, may be nullptr.
+     * @return The mapped container, empty on failure.
+     */
+    static MappedContainer open(const std::string& path, std::string* error);
+
+    /**
+     * @brief Unmaps the file.
+     */
+    ~MappedContainer();
+
+    MappedContainer(const MappedContainer&) = delete;
+    MappedContainer& operator=(const MappedContainer&) = delete;
+
+    MappedContainer(MappedContainer&& other) noexcept;
+    MappedContainer& operator=(MappedContainer&& other) noexcept;
+
+    /**
+     * @brief Gets the number of images in the container.
+     */
+    size_t size() const noexcept {
+        return m_images.size();
+    }
+
+    /**
+     * @brief Checks whether the container holds no image (not mapped, or an empty file).
+     */
+    bool empty() const noexcept {
+        return m_images.empty();
+    }
+
+    /**
+     * @brief Gets the pixel format of an image.
+     *
+     * @throws std::out_of_range If the image does not exist.
+     */
+    PixelFormat format(size_t index) const;
+
+    /**
+     * @brief Gets the number of levels of an image, 1 unless it was stored from a mipmap chain.
+     *
+     * @throws std::out_of_range If the image does not exist.
+     */
+    int level_count(size_t index) const;
+
+    /**
+     * @brief Gets a read-only view over a level of an image.
+     *
+     * @param index The index of the image.
+     * @param level The index of the level, 0 being the full resolution.
+     * @throws std::out_of_range If the image or the level does not exist.
+     */
+    ConstImageView view(size_t index, int level = 0) const;
+
+    /**
+     * @brief Gets a view over a level of an image, whose modifications stay in memory.
+     *
+     * @param index The index of the image.
+     * @param level The index of the level, 0 being the full resolution.
+     * @throws std::out_of_range If the image or the level does not exist.
+     */
+    ImageView view(size_t index, int level = 0);
+
+    /**
+     * @brief Gets a level of an image as a non-owning `Image` over the mapping.
+     *
+     * @param index The index of the image.
+     * @param level The index of the level, 0 being the full resolution.
+     * @return An image using the mapped pixels, which must not outlive the container.
+     * @throws std::out_of_range If the image or the level does not exist.
+     */
+    Image image(size_t index, int level = 0);
+
+private:
+    struct Level {
+        int width;
+        int height;
+        size_t pitch;
+        size_t offset;
+    };
+
+    struct Entry {
+        PixelFormat format;
+        AlphaMode alpha;
+        size_t first_level;
+        int level_count;
+    };
+
+    const Level& find(size_t index, int level) const;
+    void unmap() noexcept;
+
+private:
+    void* m_data = nullptr;         ///< Start of the mapping.
+    size_t m_size = 0;              ///< Size of the mapping in bytes.
+    std::vector<Entry> m_images;    ///< Images, in file order.
+    std::vector<Level> m_levels;    ///< Levels of every image, consecutive per image.
+};
+
+} // namespace bpx
+
+#endif // BPX_CONTAINER_HPP
@@ -0,0 +1,241 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_ENCODE_HPP
+#define BPX_ENCODE_HPP
+
+#include "color.hpp"
+#include "execution.hpp"
+#include "pixel.hpp"
+#include "view.hpp"
+
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bpx {
+
+namespace detail {
+struct PngState;
+} // namespace detail
+
+/**
+ * @brief File formats the images can be encoded to.
+ */
+enum class EncodeFormat
+{
+    PNG,        ///< Lossless, deflate compressed.
+    BMP,        ///< Uncompressed.
+    TGA,        ///< Run-length compressed.
+    JPG,        ///< Lossy, the alpha channel is dropped.
+    QOI,        ///< Lossless, much faster than PNG to encode and decode, usually a bit larger.
+};
+
+/**
+ * @brief Filters applied to the rows of a PNG image before compression.
+ */
+enum class PngFilter
+{
+    NONE,       ///< Bytes as is.
+    SUB,        ///< Difference with the pixel on the left.
+    UP,         ///< Difference with the pixel above.
+    AVERAGE,    ///< Difference with the average of the pixels on the left and above.
+    PAETH,      ///< Difference with the Paeth predictor of the left, above and upper left pixels.
+    ADAPTIVE,   ///< Per row, the filter giving the smallest sum of absolute differences.
+};
+
+/**
+ * @brief Settings of the PNG encoder.
+ */
+struct PngOptions
+{
+    int compression_level = 6;              ///< From 0 (stored, fastest) to 9 (smallest, slowest).
+    PngFilter filter = PngFilter::ADAPTIVE; ///< Row filter, `ADAPTIVE` picks one per row.
+};
+
+/**
+ * @brief Callback receiving encoded image data, to stream it to sockets, archives, etc.
+ *
+ * `write` is called many times per image with consecutive chunks of the encoded data.
+ * The chunks are only valid during the call.
+ */
+struct ImageWriter
+{
+    std::function<void(const void* data, size_t size)> write;   ///< Consumes the next `size` encoded bytes.
+};
+
+/**
+ * @class ImageEncoder
+ * @brief Encodes images to memory or to a writer, reusing its buffers between calls.
+ *
+ * Images of any pixel format are accepted: the formats the encoders do not take as is
+ * (BGR orders, packed 16-bit, half and single precision floats, premultiplied alpha)
+ * are converted row by row into a staging buffer kept by the encoder. The filtered rows
+ * and deflate tables of the PNG encoder are kept too, so once an encoder has seen an
+ * image of a given size, encoding images of that size again sequentially allocates
+ * nothing. Together with an output vector whose capacity is kept between calls, a loop
+ * encoding frames is allocation free.
+ *
+ * An encoder must not be used by several threads at once, use one encoder per thread.
+ */
+class ImageEncoder
+{
+public:
+    ImageEncoder();
+    ~ImageEncoder();
+
+    ImageEncoder(const ImageEncoder&) = delete;
+    ImageEncoder& operator=(const ImageEncoder&) = delete;
+
+    ImageEncoder(ImageEncoder&&) noexcept;
+    ImageEncoder& operator=(ImageEncoder&&) noexcept;
+
+    /**
+     * @brief Encodes an image into a memory buffer.
+     *
+     * `out` is cleared then filled with the encoded file, its capacity is kept so that
+     * passing the same vector again avoids reallocating it.
+     *
+     * @param image The image to encode.
+     * @param format The file format to encode to.
+     * @param out The vector receiving the encoded file.
+     * @param quality The quality of JPG encoding, from 1 to 100 (ignored by other formats).
+     * @return `true` if the image was successfully encoded, `false` otherwise (`out` is then empty).
+     */
+    bool encode(ConstImageView image, EncodeFormat format, std::vector<uint8_t>& out, int quality = 90);
+
+    /**
+     * @brief Encodes an image and streams it to a writer.
+     *
+     * Exceptions thrown by the writer are propagated, the encoder remaining usable.
+     *
+     * @param image The image to encode.
+     * @param format The file format to encode to.
+     * @param writer The callback receiving the encoded data.
+     * @param quality The quality of JPG encoding, from 1 to 100 (ignored by other formats).
+     * @return `true` if the image was successfully encoded, `false` otherwise.
+     */
+    bool encode(ConstImageView image, EncodeFormat format, const ImageWriter& writer, int quality = 90);
+
+    /**
+     * @brief Encodes an image as PNG into a memory buffer, possibly on several threads.
+     *
+     * The filtered rows are cut into segments of 256 KiB deflated independently, each
+     * segment seeing the 32 KiB before it as history, and are stored in one IDAT chunk
+     * each. The segments do not depend on the number of threads, so the output is the
+     * same whatever the policy. `encode` with `EncodeFormat::PNG` uses the default options.
+     *
+     * @param image The image to encode.
+     * @param out The vector receiving the encoded file, cleared first.
+     * @param options The compression level and row filter.
+     * @param policy How the filtering and compression are distributed over threads.
+     * @return `true` if the image was successfully encoded, `false` otherwise (`out` is then empty).
+     */
+    bool encode_png(ConstImageView image, std::vector<uint8_t>& out,
+                    const PngOptions& options = {}, ExecutionPolicy policy = {});
+
+    /**
+     * @brief Encodes an image as PNG and streams it to a writer, possibly on several threads.
+     *
+     * The writer is only called from the calling thread, once the segments it receives
+     * are compressed.
+     *
+     * @param image The image to encode.
+     * @param writer The callback receiving the encoded data.
+     * @param options The compression level and row filter.
+     * @param policy How the filtering and compression are distributed over threads.
+     * @return `true` if the image was successfully encoded, `false` otherwise.
+     */
+    bool encode_png(ConstImageView image, const ImageWriter& writer,
+                    const PngOptions& options = {}, ExecutionPolicy policy = {});
+
+private:
+    using Sink = void (*)(void* context, const void* data, size_t size);
+
+    const uint8_t* prepare(ConstImageView image, PixelFormat target, bool contiguous,
+                           ExecutionPolicy policy, size_t* stride);
+    bool encode_with(ConstImageView image, EncodeFormat format, Sink sink, void* context, int quality);
+    bool encode_png_with(ConstImageView image, const PngOptions& options, ExecutionPolicy policy,
+                         Sink sink, void* context);
+
+private:
+    std::unique_ptr<detail::PngState> m_png;        ///< Buffers of the PNG encoder.
+    std::vector<uint8_t> m_staging;                 ///< Image converted to a format the encoders take.
+};
+
+/**
+ * @brief Encodes an image into a memory buffer.
+ *
+ * Same as `ImageEncoder::encode` with a temporary encoder. Prefer keeping an
+ * `ImageEncoder` around when encoding many images.
+ *
+ * @param image The image to encode.
+ * @param format The file format to encode to.
+ * @param out The vector receiving the encoded file.
+ * @param quality The quality of JPG encoding, from 1 to 100 (ignored by other formats).
+ * @return `true` if the image was successfully encoded, `false` otherwise.
+ */
+bool encode_image(ConstImageView image, EncodeFormat format, std::vector<uint8_t>& out, int quality = 90);
+
+/**
+ * @brief Encodes an image and streams it to a writer.
+ *
+ * Same as `ImageEncoder::encode` with a temporary encoder. Prefer keeping an
+ * `ImageEncoder` around when encoding many images.
+ *
+ * @param image The image to encode.
+ * @param format The file format to encode to.
+ * @param writer The callback receiving the encoded data.
+ * @param quality The quality of JPG encoding, from 1 to 100 (ignored by other formats).
+ * @return `true` if the image was successfully encoded, `false` otherwise.
+ */
+bool encode_image(ConstImageView image, EncodeFormat format, const ImageWriter& writer, int quality = 90);
+
+/**
+ * @brief Encodes an image as PNG into a memory buffer, possibly on several threads.
+ *
+ * Same as `ImageEncoder::encode_png` with a temporary encoder.
+ *
+ * @param image The image to encode.
+ * @param out The vector receiving the encoded file.
+ * @param options The compression level and row filter.
+ * @param policy How the filtering and compression are distributed over threads.
+ * @return `true` if the image was successfully encoded, `false` otherwise.
+ */
+bool encode_png(ConstImageView image, std::vector<uint8_t>& out,
+                const PngOptions& options = {}, ExecutionPolicy policy = {});
+
+/**
+ * @brief Writes the image to a PNG file with the given settings, possibly on several threads.
+ *
+ * @param image The image to write to a file.
+ * @param path The file path where the PNG image will be saved.
+ * @param options The compression level and row filter.
+ * @param policy How the filtering and compression are distributed over threads.
+ * @return `true` if the image was successfully saved, `false` otherwise.
+ */
+bool write_png(ConstImageView image, const std::string& path, const PngOptions& options,
+               ExecutionPolicy policy = {});
+
+} // namespace bpx
+
+#endif // BPX_ENCODE_HPP
@@ -0,0 +1,205 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_EXECUTION_HPP
+#define BPX_EXECUTION_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <mutex>
+
+namespace bpx {
+
+/**
+ * @class ThreadPool
+ * @brief A work-stealing pool of threads used to run image operations in parallel.
+ *
+ * Each worker owns a queue of tasks, pops its own tasks from the back and steals from the
+ * front of the other queues when it runs out, which keeps every thread busy even when some
+ * parts of an image are more expensive than others. The thread calling `parallel_for`
+ * takes part in the work instead of sleeping, so nested parallel calls cannot deadlock.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief Creates a pool with the given level of concurrency.
+     *
+     * The calling thread always takes part in the work, so `threads - 1` worker threads
+     * are started; a pool created with a concurrency of 1 runs everything inline.
+     *
+     * @param threads The number of threads working together, including the caller.
+     *                0 uses the number of hardware threads.
+     */
+    explicit ThreadPool(unsigned threads = 0);
+
+    /**
+     * @brief Waits for the queued tasks to complete and joins the worker threads.
+     */
+    ~ThreadPool();
+
+    // Deleted copy and move, the workers keep a pointer to the pool.
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Returns the level of concurrency of the pool, the caller included.
+     */
+    unsigned concurrency() const noexcept {
+        return static_cast<unsigned>(m_threads.size()) + 1;
+    }
+
+    /**
+     * @brief Runs `body` over the range [begin, end) split into chunks of `grain` elements.
+     *
+     * `body` is called as body(chunk_begin, chunk_end), concurrently from several threads,
+     * and this function returns once every chunk has been processed. If a call throws,
+     * the first exception is rethrown here after the remaining chunks have completed.
+     *
+     * @param begin The first index of the range.
+     * @param end One past the last index of the range.
+     * @param grain The number of indices per chunk, at least 1.
+     * @param body The function processing a chunk.
+     */
+    void parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+    /**
+     * @brief Returns the shared pool used by `Execution::PARALLEL`.
+     *
+     * The pool is created on first use, with one thread per hardware thread.
+     */
+    static ThreadPool& global();
+
+private:
+    struct Queue;
+    using Task = std::function<void()>;
+
+    void submit(Task task);
+    bool take(size_t first, Task* task);
+    void worker(size_t index);
+
+private:
+    std::vector<std::unique_ptr<Queue>> m_queues;   ///< One queue per worker.
+    std::vector<std::thread> m_threads;             ///< The worker threads.
+    std::mutex m_mutex;                             ///< Protects the sleep/wake-up of the workers.
+    std::condition_variable m_wake;                 ///< Signaled when tasks are queued or on shutdown.
+    std::atomic<size_t> m_pending;                  ///< Number of queued tasks not yet taken.
+    std::atomic<size_t> m_next;                     ///< Round-robin index of the next queue to push to.
+    bool m_stop;                                    ///< Set when the pool is destroyed.
+};
+
+/**
+ * @brief Enumeration of the ways an operation can be executed.
+ */
+enum class Execution
+{
+    SEQUENTIAL,     ///< Runs on the calling thread only.
+    PARALLEL,       ///< Splits the work over the global thread pool.
+};
+
+/**
+ * @class ExecutionPolicy
+ * @brief Describes how an image operation distributes its work.
+ *
+ * A policy is implicitly constructible from an `Execution` value or from a `ThreadPool`,
+ * so operations accepting one can be called as `fill(image, RED, Execution::PARALLEL)`
+ * or `fill(image, RED, my_pool)`. The work is split into bands of rows, each pixel being
+ * computed independently of the split, so the result is identical whatever the number of
+ * threads. Functions called by the operation (such as a `Mapper`) may then be called
+ * concurrently and must be thread-safe.
+ */
+class ExecutionPolicy
+{
+public:
+    /**
+     * @brief Constructs a policy from an execution mode, sequential by default.
+     */
+    constexpr ExecutionPolicy(Execution execution = Execution::SEQUENTIAL) noexcept
+        : m_pool(nullptr), m_parallel(execution == Execution::PARALLEL)
+    { }
+
+    /**
+     * @brief Constructs a policy running the work on a user-supplied pool.
+     */
+    constexpr ExecutionPolicy(ThreadPool& pool) noexcept
+        : m_pool(&pool), m_parallel(true)
+    { }
+
+    /**
+     * @brief Returns the pool to run the work on, or `nullptr` for sequential execution.
+     */
+    ThreadPool* pool() const {
+        return m_parallel ? (m_pool ? m_pool : &ThreadPool::global()) : nullptr;
+    }
+
+private:
+    ThreadPool* m_pool;     ///< The user-supplied pool, if any.
+    bool m_parallel;        ///< Whether the work is distributed at all.
+};
+
+namespace detail {
+
+/*
+    Bands cover at least this many pixels so that the cost of a task stays
+    negligible, and there are a few bands per thread so that stealing can
+    even out the load.
+*/
+constexpr int MIN_BAND_PIXELS = 16384;
+constexpr int BANDS_PER_THREAD = 4;
+
+/**
+ * @brief Calls func(y_begin, y_end) over bands covering the rows [ymin, ymax).
+ *
+ * Every operation built on it computes each pixel independently of the band it
+ * belongs to, which is what makes the results identical for any number of threads.
+ *
+ * @param policy How the bands are distributed.
+ * @param ymin The first row.
+ * @param ymax One past the last row.
+ * @param width The number of pixels processed per row, used to size the bands.
+ * @param func The function processing a band.
+ */
+template <typename Func>
+void parallel_rows(const ExecutionPolicy& policy, int ymin, int ymax, int width, Func&& func)
+{
+    ThreadPool* pool = policy.pool();
+    const int rows = ymax - ymin;
+
+    if (pool == nullptr || pool->concurrency() == 1 || rows <= 1) {
+        if (rows > 0) func(ymin, ymax);
+        return;
+    }
+
+    const int min_rows = (MIN_BAND_PIXELS + width - 1) / std::max(1, width);
+    const int bands = static_cast<int>(pool->concurrency()) * BANDS_PER_THREAD;
+    const int grain = std::max(min_rows, (rows + bands - 1) / bands);
+
+    pool->parallel_for(ymin, ymax, grain, func);
+}
+
+} // namespace detail
+
+} // namespace bpx
+
+#endif // BPX_EXECUTION_HPP
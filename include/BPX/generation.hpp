@@ -23,6 +23,7 @@
 #include "pixel.hpp"
 #include "image.hpp"
 #include "ramp.hpp"
+#include "execution.hpp"
 
 namespace bpx {
 
@@ -35,9 +36,11 @@ namespace bpx {
  * @param width The width of the gradient image in pixels.
  * @param ramp The `ColorRamp` object defining the colors to interpolate across the gradient.
  * @param format The desired pixel format for the image (default is `PixelFormat::RGBA_U8`).
+ * @param policy How the work is distributed over threads (sequential by default).
  * @return An `Image` object containing the generated gradient.
  */
-Image generate_gradient_linear_1d(int width, const ColorRamp& ramp, PixelFormat format = PixelFormat::RGBA_U8);
+Image generate_gradient_linear_1d(int width, const ColorRamp& ramp, PixelFormat format = PixelFormat::RGBA_U8,
+                                  ExecutionPolicy policy = {});
 
 /**
  * @brief Generates a 2D linear gradient image between two points.
@@ -54,11 +57,13 @@ Image generate_gradient_linear_1d(int width, const ColorRamp& ramp, PixelFormat
  * @param x_end The x-coordinate of the gradient's ending point.
  * @param y_end The y-coordinate of the gradient's ending point.
  * @param format The desired pixel format for the image (default is `PixelFormat::RGBA_U8`).
+ * @param policy How the work is distributed over threads (sequential by default).
  * @return An `Image` object containing the generated 2D linear gradient.
  */
 Image generate_gradient_linear(int width, int height, const ColorRamp& ramp,
                                   int x_start, int y_start, int x_end, int y_end,
-                                  PixelFormat format = PixelFormat::RGBA_U8);
+                                  PixelFormat format = PixelFormat::RGBA_U8,
+                                  ExecutionPolicy policy = {});
 
 /**
  * @brief Generates a 2D radial gradient image between two points.
@@ -75,11 +80,13 @@ Image generate_gradient_linear(int width, int height, const ColorRamp& ramp,
  * @param x_end The x-coordinate of the gradient's outer edge.
  * @param y_end The y-coordinate of the gradient's outer edge.
  * @param format The desired pixel format for the image (default is `PixelFormat::RGBA_U8`).
+ * @param policy How the work is distributed over threads (sequential by default).
  * @return An `Image` object containing the generated 2D radial gradient.
  */
 Image generate_gradient_radial(int width, int height, const ColorRamp& ramp,
                                   int x_start, int y_start, int x_end, int y_end,
-                                  PixelFormat format = PixelFormat::RGBA_U8);
+                                  PixelFormat format = PixelFormat::RGBA_U8,
+                                  ExecutionPolicy policy = {});
 
 /**
  * @brief Generate a checkerboard pattern image.
@@ -95,11 +102,13 @@ Image generate_gradient_radial(int width, int height, const ColorRamp& ramp,
  * @param color1 The color of the first set of squares (default is black).
  * @param color2 The color of the second set of squares (default is white).
  * @param format The pixel format for the image (default is RGBA_U8).
+ * @param policy How the work is distributed over threads (sequential by default).
  * @return The generated image with the checkerboard pattern.
  */
 Image generate_checkerboard(int width, int height, int square_w, int square_h,
                             const Color& color1 = BLACK, const Color& color2 = WHITE,
-                            PixelFormat format = PixelFormat::RGBA_U8);
+                            PixelFormat format = PixelFormat::RGBA_U8,
+                            ExecutionPolicy policy = {});
 
 /**
  * @brief Generate a striped pattern image.
@@ -117,11 +126,13 @@ Image generate_checkerboard(int width, int height, int square_w, int square_h,
  * @param vertical A boolean value to specify the orientation of stripes.
  *                If true, the stripes are vertical, otherwise, they are horizontal (default is true).
  * @param format The pixel format for the image (default is RGBA_U8).
+ * @param policy How the work is distributed over threads (sequential by default).
  * @return The generated image with the striped pattern.
  */
 Image generate_stripes(int width, int height, int stripe_width,
                        const Color& color1 = BLACK, const Color& color2 = WHITE,
-                       bool vertical = true, PixelFormat format = PixelFormat::RGBA_U8);
+                       bool vertical = true, PixelFormat format = PixelFormat::RGBA_U8,
+                       ExecutionPolicy policy = {});
 
 /**
  * @brief Generate a grid pattern image.
@@ -136,11 +147,13 @@ Image generate_stripes(int width, int height, int stripe_width,
  * @param line_color The color of the grid lines (default is white).
  * @param fill_color The color of the background cells (default is black).
  * @param format The pixel format for the image (default is RGBA_U8).
+ * @param policy How the work is distributed over threads (sequential by default).
  * @return The generated image with the grid pattern.
  */
 Image generate_grid(int width, int height, int cell_size,
                     const Color& line_color = WHITE, const Color& fill_color = BLACK,
-                    PixelFormat format = PixelFormat::RGBA_U8);
+                    PixelFormat format = PixelFormat::RGBA_U8,
+                    ExecutionPolicy policy = {});
 
 /**
  * @brief Generate a polka dots pattern image.
@@ -156,11 +169,13 @@ Image generate_grid(int width, int height, int cell_size,
  * @param dot_color The color of the dots (default is white).
  * @param background_color The background color (default is black).
  * @param format The pixel format for the image (default is RGBA_U8).
+ * @param policy How the work is distributed over threads (sequential by default).
  * @return The generated image with the polka dots pattern.
  */
 Image generate_polka_dots(int width, int height, int dot_radius, int spacing,
                           const Color& dot_color = WHITE, const Color& background_color = BLACK,
-                          PixelFormat format = PixelFormat::RGBA_U8);
+                          PixelFormat format = PixelFormat::RGBA_U8,
+                          ExecutionPolicy policy = {});
 
 } // namespace bpx
 
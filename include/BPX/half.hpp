@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_HALF_HPP
+#define BPX_HALF_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bpx {
+
+/**
+ * @brief Converts a half-precision (IEEE 754 binary16) value to single precision.
+ *
+ * The conversion is exact for every input, including subnormals, infinities and NaNs
+ * (signaling NaNs are returned quiet, with their payload preserved).
+ *
+ * @param value The half-precision value, as its bit pattern.
+ * @return The same value as a `float`.
+ */
+float half_to_float(uint16_t value) noexcept;
+
+/**
+ * @brief Converts a single-precision value to half precision (IEEE 754 binary16).
+ *
+ * The value is rounded to the nearest representable half, ties to even, which is the
+ * rounding performed by the hardware conversion instructions. Values too large for a
+ * half become infinities, values too small become subnormals or zero.
+ *
+ * @param value The value to convert.
+ * @return The bit pattern of the nearest half-precision value.
+ */
+uint16_t float_to_half(float value) noexcept;
+
+/**
+ * @brief Converts a buffer of half-precision values to single precision.
+ *
+ * Produces the same results as `half_to_float(uint16_t)` applied to each element, using
+ * the F16C instructions when the CPU supports them (or NEON on AArch64) and a table-driven
+ * scalar loop otherwise. Rows and whole images can be converted in a single call.
+ *
+ * @param src The half-precision values, as bit patterns.
+ * @param dst The array receiving the values, at least `count` elements long.
+ * @param count The number of values to convert.
+ */
+void half_to_float(const uint16_t* src, float* dst, size_t count) noexcept;
+
+/**
+ * @brief Converts a buffer of single-precision values to half precision.
+ *
+ * Produces the same results as `float_to_half(float)` applied to each element, using
+ * the F16C instructions when the CPU supports them (or NEON on AArch64) and a table-driven
+ * scalar loop otherwise. Rows and whole images can be converted in a single call.
+ *
+ * @param src The values to convert.
+ * @param dst The array receiving the half-precision bit patterns, at least `count` elements long.
+ * @param count The number of values to convert.
+ */
+void float_to_half(const float* src, uint16_t* dst, size_t count) noexcept;
+
+} // namespace bpx
+
+#endif // BPX_HALF_HPP
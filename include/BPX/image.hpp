@@ -28,6 +28,118 @@
 
 namespace bpx {
 
+/**
+ * @brief Decodes contiguous pixels of a given format into colors.
+ *
+ * Converts `count` pixels stored in `format` at `src` into `Color` values. The format
+ * is dispatched once for the whole run and each format has its own specialized loop,
+ * so this is the preferred way to read many pixels at once.
+ *
+ * @param format The pixel format of the source data.
+ * @param src Pointer to the first pixel to decode.
+ * @param dst The array receiving the colors, at least `count` elements long.
+ * @param count The number of pixels to decode.
+ */
+void decode_pixels(PixelFormat format, const void* src, Color* dst, size_t count);
+
+/**
+ * @brief Encodes colors into contiguous pixels of a given format.
+ *
+ * Converts `count` `Color` values into pixels stored in `format` at `dst`. The format
+ * is dispatched once for the whole run and each format has its own specialized loop,
+ * so this is the preferred way to write many pixels at once.
+ *
+ * @param format The pixel format of the destination data.
+ * @param src The colors to encode, at least `count` elements long.
+ * @param dst Pointer to the first pixel to write.
+ * @param count The number of pixels to encode.
+ */
+void encode_pixels(PixelFormat format, const Color* src, void* dst, size_t count);
+
+/**
+ * @brief Converts contiguous pixels from one format to another.
+ *
+ * Converts `count` pixels stored in `src_format` at `src` into `dst_format` at `dst`.
+ * The result is identical to decoding the pixels with `decode_pixels` and encoding them
+ * with `encode_pixels`, but common pairs (channel swizzles between byte formats, byte to
+ * float, packed 16-bit formats) use vectorized kernels selected at runtime for the CPU,
+ * and byte formats are shuffled directly without going through `Color`. Identical
+ * formats are copied as is.
+ *
+ * @param src_format The pixel format of the source data.
+ * @param src Pointer to the first pixel to convert.
+ * @param dst_format The pixel format of the destination data.
+ * @param dst Pointer to the first pixel to write, must not overlap `src`.
+ * @param count The number of pixels to convert.
+ */
+void convert_pixels(PixelFormat src_format, const void* src, PixelFormat dst_format, void* dst, size_t count);
+
+/**
+ * @brief Options applied when decoding an image.
+ *
+ * The options are given to each decode call instead of being set globally, so images
+ * can be decoded on several threads at once with different options.
+ */
+struct DecodeOptions
+{
+    /**
+     * @brief Whether to flip the image vertically upon loading.
+     *
+     * Useful for graphics APIs like OpenGL, where the first row of a texture is the bottom one.
+     */
+    bool flip_vertically = false;
+
+    /**
+     * @brief Whether to decode into `format` rather than into the layout stored in the file.
+     *
+     * When false, the image gets the 8-bit format matching the channels of the file
+     * (`L_U8`, `LA_U8`, `RGB_U8` or `RGBA_U8`).
+     */
+    bool convert = false;
+
+    /**
+     * @brief The format of the decoded image when `convert` is set.
+     *
+     * Channels are added or dropped by the decoder itself. For half and single precision
+     * float formats, 16-bit files (PNG, PSD, PNM) and HDR files are decoded at full precision
+     * directly into the pixels of the image, 8-bit files being widened. Other formats go
+     * through the 8-bit decoder and are converted once the image is decoded.
+     */
+    PixelFormat format = PixelFormat::RGBA_U8;
+
+    /**
+     * @brief Whether 16-bit and HDR files keep their precision when `convert` is not set.
+     *
+     * Such files are then decoded to the `_F32` format matching their channels, while 8-bit
+     * files still give 8-bit formats. When false, every file is decoded to 8 bits.
+     */
+    bool high_precision = false;
+};
+
+/**
+ * @brief Callbacks reading encoded image data from a user stream.
+ *
+ * Used to decode images from sources that are not in memory nor in a file, such as
+ * sockets or archive entries, without buffering the whole encoded data first.
+ */
+struct ImageReader
+{
+    /**
+     * @brief Reads up to `size` bytes into `buffer` and returns the number of bytes read.
+     */
+    std::function<int(char* buffer, int size)> read;
+
+    /**
+     * @brief Skips `count` bytes, or goes back `-count` bytes if `count` is negative.
+     */
+    std::function<void(int count)> skip;
+
+    /**
+     * @brief Returns true once the end of the stream is reached.
+     */
+    std::function<bool()> eof;
+};
+
 /**
  * @class Image
  * @brief A class that represents an image with pixel data.
@@ -68,6 +180,72 @@ public:
      */
     explicit Image(const std::string& file_path, bool flip_vertically = false);
 
+    /**
+     * @brief Loads an image from a file with the given decode options.
+     *
+     * Same as the constructor above, the options being specific to this call, which makes
+     * it safe to load images on several threads at once.
+     *
+     * @param file_path Path to the image file to be loaded.
+     * @param options How the image is decoded.
+     * @throws std::runtime_error If the file cannot be loaded or decoded.
+     */
+    Image(const std::string& file_path, const DecodeOptions& options);
+
+    /**
+     * @brief Decodes an image from encoded data in memory.
+     *
+     * Supports the same formats as the file constructor. The encoded data is read in
+     * place, it is not copied and only needs to stay valid during the call.
+     *
+     * @param data Pointer to the encoded image.
+     * @param size Size of the encoded image in bytes.
+     * @param options How the image is decoded.
+     * @return The decoded image.
+     * @throws std::runtime_error If the data cannot be decoded.
+     */
+    static Image load_from_memory(const void* data, size_t size, const DecodeOptions& options = {});
+
+    /**
+     * @brief Decodes an image from encoded data in memory, without throwing on failure.
+     *
+     * Same as the throwing overload, except that a failure returns an empty image (see
+     * `empty()`) and stores the reason in `error` when it is not null.
+     *
+     * @param data Pointer to the encoded image.
+     * @param size Size of the encoded image in bytes.
+     * @param error Receives the reason of a failure, may be null.
+     * @param options How the image is decoded.
+     * @return The decoded image, or an empty image on failure.
+     */
+    static Image load_from_memory(const void* data, size_t size, std::string* error, const DecodeOptions& options = {});
+
+    /**
+     * @brief Decodes an image read from user callbacks.
+     *
+     * Supports the same formats as the file constructor. The data is pulled from the
+     * callbacks as the decoder needs it.
+     *
+     * @param reader The callbacks providing the encoded image.
+     * @param options How the image is decoded.
+     * @return The decoded image.
+     * @throws std::runtime_error If the data cannot be decoded.
+     */
+    static Image load_from_callbacks(const ImageReader& reader, const DecodeOptions& options = {});
+
+    /**
+     * @brief Decodes an image read from user callbacks, without throwing on failure.
+     *
+     * Same as the throwing overload, except that a failure returns an empty image (see
+     * `empty()`) and stores the reason in `error` when it is not null.
+     *
+     * @param reader The callbacks providing the encoded image.
+     * @param error Receives the reason of a failure, may be null.
+     * @param options How the image is decoded.
+     * @return The decoded image, or an empty image on failure.
+     */
+    static Image load_from_callbacks(const ImageReader& reader, std::string* error, const DecodeOptions& options = {});
+
     /**
      * @brief Constructs a solid-colored image.
      *
@@ -188,6 +366,36 @@ public:
         return set_unsafe(y * m_w + x, color);
     }
 
+    /**
+     * @brief Reads a horizontal run of pixels into an array of colors (unsafe).
+     *
+     * Decodes `count` consecutive pixels of row `y`, starting at column `x`. The pixel
+     * format is resolved once for the whole run, which makes this considerably faster
+     * than calling `get_unsafe` for each pixel. It is the caller's responsibility to
+     * ensure the run lies within the image.
+     *
+     * @param x The x-coordinate of the first pixel of the run.
+     * @param y The y-coordinate of the row.
+     * @param dst The array receiving the colors, at least `count` elements long.
+     * @param count The number of pixels to read.
+     */
+    void read_row(int x, int y, Color* dst, int count) const;
+
+    /**
+     * @brief Writes an array of colors to a horizontal run of pixels (unsafe).
+     *
+     * Encodes `count` colors into consecutive pixels of row `y`, starting at column `x`.
+     * The pixel format is resolved once for the whole run, which makes this considerably
+     * faster than calling `set_unsafe` for each pixel. It is the caller's responsibility
+     * to ensure the run lies within the image.
+     *
+     * @param x The x-coordinate of the first pixel of the run.
+     * @param y The y-coordinate of the row.
+     * @param src The colors to write, at least `count` elements long.
+     * @param count The number of pixels to write.
+     */
+    void write_row(int x, int y, const Color* src, int count);
+
     /**
      * @brief Gets the color of a pixel at a specific offset.
      *
@@ -256,6 +464,15 @@ public:
         return *this;
     }
 
+    /**
+     * @brief Checks whether the image has no pixel data, as returned by a failed load.
+     *
+     * @return True if the image holds no pixels.
+     */
+    bool empty() const {
+        return m_pixels == nullptr;
+    }
+
     /**
      * @brief Gets the width of the image.
      *
@@ -322,6 +539,28 @@ public:
         return m_format;
     }
 
+    /**
+     * @brief Gets the alpha convention of the pixel data.
+     *
+     * @return `AlphaMode::PREMULTIPLIED` if the color channels are multiplied by the alpha,
+     *         `AlphaMode::STRAIGHT` otherwise (the default for new and loaded images).
+     */
+    AlphaMode alpha_mode() const {
+        return m_alpha;
+    }
+
+    /**
+     * @brief Sets the alpha convention of the pixel data without touching the pixels.
+     *
+     * Use this to declare how externally provided data is stored. To convert the pixels
+     * from one convention to the other, use `bpx::premultiply` or `bpx::unpremultiply`.
+     *
+     * @param mode The alpha convention of the current pixel data.
+     */
+    void set_alpha_mode(AlphaMode mode) {
+        m_alpha = mode;
+    }
+
     /**
      * @brief Gets the raw pixel data (const version).
      *
@@ -345,8 +584,64 @@ private:
     PixelFormat m_format;   ///< The pixel format of the image.
     int m_w, m_h;           ///< Width and height of the image.
     bool m_owned;           ///< Flag indicating if the image owns the pixel data.
+    AlphaMode m_alpha = AlphaMode::STRAIGHT;  ///< Alpha convention of the pixel data.
 };
 
+/**
+ * @brief Properties of an encoded image, read from its header.
+ */
+struct ImageInfo
+{
+    int width = 0;              ///< Width of the image in pixels, 0 if the probe failed.
+    int height = 0;             ///< Height of the image in pixels.
+    int channels = 0;           ///< Number of channels stored in the file (1 to 4).
+    int bits_per_channel = 0;   ///< 8, 16, or 32 for HDR images decoded as floats.
+    bool hdr = false;           ///< Whether the file holds high dynamic range (float) data.
+};
+
+/**
+ * @brief Reads the dimensions and the channel layout of an image file without decoding it.
+ *
+ * Only the header of the file is parsed, the file being read unbuffered so that just the
+ * bytes needed by the parser are read. Supports the same formats as `Image`.
+ *
+ * @param file_path Path to the image file.
+ * @return The properties of the image.
+ * @throws std::runtime_error If the file cannot be opened or is not a supported image.
+ */
+ImageInfo probe(const std::string& file_path);
+
+/**
+ * @brief Reads the properties of an image file, without throwing on failure.
+ *
+ * @param file_path Path to the image file.
+ * @param error Receives the reason of a failure, may be null.
+ * @return The properties of the image, with a width of 0 on failure.
+ */
+ImageInfo probe(const std::string& file_path, std::string* error);
+
+/**
+ * @brief Reads the dimensions and the channel layout of an encoded image in memory.
+ *
+ * Only the header is parsed, the data being read in place.
+ *
+ * @param data Pointer to the encoded image.
+ * @param size Size of the encoded image in bytes.
+ * @return The properties of the image.
+ * @throws std::runtime_error If the data is not a supported image.
+ */
+ImageInfo probe(const void* data, size_t size);
+
+/**
+ * @brief Reads the properties of an encoded image in memory, without throwing on failure.
+ *
+ * @param data Pointer to the encoded image.
+ * @param size Size of the encoded image in bytes.
+ * @param error Receives the reason of a failure, may be null.
+ * @return The properties of the image, with a width of 0 on failure.
+ */
+ImageInfo probe(const void* data, size_t size, std::string* error);
+
 } // namespace bpx
 
 #endif // BPX_IMAGE_HPP
\ No newline at end of file
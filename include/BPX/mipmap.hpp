@@ -0,0 +1,218 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_MIPMAP_HPP
+#define BPX_MIPMAP_HPP
+
+#include "pixel.hpp"
+#include "view.hpp"
+#include "execution.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace bpx {
+
+/**
+ * @brief Filters used to reduce one mipmap level into the next.
+ */
+enum class MipFilter
+{
+    BOX,        ///< Average of the covered pixels (2x2 for even sizes), the fastest.
+    KAISER,     ///< Kaiser windowed sinc, sharper levels with less aliasing.
+};
+
+/**
+ * @brief Alignment (in bytes) of the offset of every level of a `MipChain`.
+ *
+ * The offsets are also multiples of the pixel size, which satisfies the offset
+ * requirements of buffer to texture copies in OpenGL, Vulkan and Direct3D.
+ */
+constexpr size_t MIP_LEVEL_ALIGNMENT = 16;
+
+/**
+ * @brief Placement of one level in the memory of a `MipChain`.
+ */
+struct MipLevel
+{
+    int width;          ///< Width of the level in pixels.
+    int height;         ///< Height of the level in pixels.
+    size_t offset;      ///< Offset of the first pixel from the start of the chain, in bytes.
+    size_t size;        ///< Size of the level in bytes, rows are tightly packed.
+};
+
+/**
+ * @class MipChain
+ * @brief A chain of mipmap levels stored in a single allocation.
+ *
+ * Level 0 is the full resolution image and each following level halves the dimensions
+ * of the previous one (rounding down, never below 1). The rows of every level are tightly
+ * packed and each level starts at an offset aligned to `MIP_LEVEL_ALIGNMENT`, so the whole
+ * chain can be uploaded with a single staging copy and one copy region per level.
+ */
+class MipChain
+{
+public:
+    /**
+     * @brief Creates an empty chain without any level.
+     */
+    MipChain() = default;
+
+    /**
+     * @brief Allocates an uninitialized chain of `levels` levels for the given base size.
+     *
+     * @param w The width of level 0.
+     * @param h The height of level 0.
+     * @param format The pixel format of every level.
+     * @param levels The number of levels, 0 for the full chain down to 1x1. It is limited
+     *        to the length of the full chain.
+     * @throws std::invalid_argument If the dimensions are not positive or `levels` is negative.
+     */
+    MipChain(int w, int h, PixelFormat format, int levels = 0);
+
+    MipChain(const MipChain&) = delete;
+    MipChain& operator=(const MipChain&) = delete;
+
+    MipChain(MipChain&&) noexcept = default;
+    MipChain& operator=(MipChain&&) noexcept = default;
+
+    /**
+     * @brief Gets the pixel format shared by every level.
+     */
+    PixelFormat format() const noexcept {
+        return m_format;
+    }
+
+    /**
+     * @brief Gets the alpha convention of the levels.
+     */
+    AlphaMode alpha_mode() const noexcept {
+        return m_alpha;
+    }
+
+    /**
+     * @brief Sets the alpha convention of the levels, without changing the pixels.
+     */
+    void set_alpha_mode(AlphaMode alpha) noexcept {
+        m_alpha = alpha;
+    }
+
+    /**
+     * @brief Gets the number of levels of the chain.
+     */
+    int level_count() const noexcept {
+        return static_cast<int>(m_levels.size());
+    }
+
+    /**
+     * @brief Gets the dimensions and the placement of a level.
+     *
+     * @param index The index of the level, 0 being the full resolution.
+     * @throws std::out_of_range If the level does not exist.
+     */
+    const MipLevel& level(int index) const;
+
+    /**
+     * @brief Gets a view over the pixels of a level.
+     *
+     * @param index The index of the level, 0 being the full resolution.
+     * @throws std::out_of_range If the level does not exist.
+     */
+    ImageView view(int index);
+
+    /**
+     * @brief Gets a read-only view over the pixels of a level.
+     *
+     * @param index The index of the level, 0 being the full resolution.
+     * @throws std::out_of_range If the level does not exist.
+     */
+    ConstImageView view(int index) const;
+
+    /**
+     * @brief Gets the memory holding every level.
+     */
+    void* data() noexcept {
+        return m_data.get();
+    }
+
+    /**
+     * @brief Gets the memory holding every level.
+     */
+    const void* data() const noexcept {
+        return m_data.get();
+    }
+
+    /**
+     * @brief Gets the size of the memory holding every level, in bytes.
+     */
+    size_t size() const noexcept {
+        return m_size;
+    }
+
+private:
+    std::unique_ptr<uint8_t[]> m_data;
+    std::vector<MipLevel> m_levels;
+    size_t m_size = 0;
+    PixelFormat m_format = PixelFormat::RGBA_U8;
+    AlphaMode m_alpha = AlphaMode::STRAIGHT;
+};
+
+/**
+ * @brief Gets the number of levels of a full mipmap chain, down to 1x1.
+ *
+ * @param w The width of level 0.
+ * @param h The height of level 0.
+ * @return floor(log2(max(w, h))) + 1, or 0 if a dimension is not positive.
+ */
+int mip_level_count(int w, int h) noexcept;
+
+/**
+ * @brief Generates the mipmap chain of an image.
+ *
+ * Level 0 is a copy of the image and each following level is reduced from the previous
+ * one, so the full resolution is only read once. Sizes that are not a power of two are
+ * handled by filtering over the exact footprint of each pixel (three taps instead of two
+ * along an odd dimension for the box filter). Out of bounds samples of the Kaiser filter
+ * are clamped to the edges.
+ *
+ * The levels keep the pixel format of the image. 8-bit formats reduced with the box filter
+ * and without gamma correction use integer SIMD kernels (the average of 2x2 pixels rounded
+ * to nearest). Every other case is filtered in single precision floats.
+ *
+ * Channels are filtered independently, including straight alpha colors: premultiply the
+ * image first (see `premultiply`) to keep transparent colors from bleeding into the levels.
+ * The alpha convention of the image is kept by the chain.
+ *
+ * @param image The image to build the chain from.
+ * @param filter The filter used to reduce the levels.
+ * @param levels The number of levels, 0 for the full chain down to 1x1.
+ * @param gamma_correct Whether the color channels are decoded from sRGB and filtered in linear
+ *        light. The alpha channel is always linear.
+ * @param policy How the work is distributed over threads (sequential by default).
+ * @return The chain holding every level.
+ * @throws std::invalid_argument If the image is empty or `levels` is negative.
+ */
+MipChain generate_mipmaps(ConstImageView image, MipFilter filter = MipFilter::BOX, int levels = 0,
+                          bool gamma_correct = false, ExecutionPolicy policy = {});
+
+} // namespace bpx
+
+#endif // BPX_MIPMAP_HPP
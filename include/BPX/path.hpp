@@ -0,0 +1,354 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_PATH_HPP
+#define BPX_PATH_HPP
+
+#include "algorithm.hpp"
+#include "color.hpp"
+#include "image.hpp"
+#include "view.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace bpx {
+
+class ColorRamp;
+
+namespace detail {
+class Rasterizer;
+struct ScratchAccess;
+} // namespace detail
+
+/**
+ * @brief Rules deciding which parts of a shape whose outlines overlap are inside it.
+ */
+enum class FillRule
+{
+    NON_ZERO,   ///< Inside where the outlines wind a non-zero number of times around the point.
+    EVEN_ODD,   ///< Inside where a ray from the point crosses the outlines an odd number of times.
+};
+
+/**
+ * @brief How shapes are filled.
+ */
+struct FillStyle
+{
+    FillRule rule = FillRule::NON_ZERO;     ///< Rule telling the inside of the shape.
+    bool antialias = true;                  ///< Weights the edge pixels by their coverage, otherwise samples their center.
+};
+
+/**
+ * @class Path
+ * @brief An outline made of straight and curved segments, to be filled or stroked.
+ *
+ * A path holds any number of contours, each started by `move_to` and made of lines and
+ * quadratic or cubic Bezier curves. Curves are flattened into lines when added, finely
+ * enough to stay within a tenth of a pixel of the exact curve, so that drawing a path
+ * again does not repeat the work. Contours are closed implicitly when the path is filled;
+ * `close` matters to strokes, which join the ends of closed contours instead of capping them.
+ *
+ * `clear` keeps the storage of the path, a path rebuilt for every frame does not allocate
+ * once it has grown to its largest shape.
+ */
+class Path
+{
+public:
+    /**
+     * @brief Range of the points of a contour, as flattened lines.
+     */
+    struct Contour
+    {
+        size_t begin;   ///< Index of the first point of the contour.
+        size_t end;     ///< Index past the last point of the contour.
+        bool closed;    ///< Whether `close` was called on the contour.
+    };
+
+    /**
+     * @brief Starts a new contour at the given point.
+     * @param x The x-coordinate of the point.
+     * @param y The y-coordinate of the point.
+     * @return A reference to the path.
+     */
+    Path& move_to(float x, float y);
+
+    /**
+     * @brief Adds a line from the current point to the given point.
+     *
+     * Without a current point, the line starts a new contour at the given point.
+     *
+     * @param x The x-coordinate of the end of the line.
+     * @param y The y-coordinate of the end of the line.
+     * @return A reference to the path.
+     */
+    Path& line_to(float x, float y);
+
+    /**
+     * @brief Adds a quadratic Bezier curve from the current point to the given point.
+     * @param cx The x-coordinate of the control point.
+     * @param cy The y-coordinate of the control point.
+     * @param x The x-coordinate of the end of the curve.
+     * @param y The y-coordinate of the end of the curve.
+     * @return A reference to the path.
+     */
+    Path& quad_to(float cx, float cy, float x, float y);
+
+    /**
+     * @brief Adds a cubic Bezier curve from the current point to the given point.
+     * @param c1x The x-coordinate of the first control point.
+     * @param c1y The y-coordinate of the first control point.
+     * @param c2x The x-coordinate of the second control point.
+     * @param c2y The y-coordinate of the second control point.
+     * @param x The x-coordinate of the end of the curve.
+     * @param y The y-coordinate of the end of the curve.
+     * @return A reference to the path.
+     */
+    Path& cubic_to(float c1x, float c1y, float c2x, float c2y, float x, float y);
+
+    /**
+     * @brief Closes the current contour, the next segment starting a new one at its first point.
+     * @return A reference to the path.
+     */
+    Path& close();
+
+    /**
+     * @brief Removes all the contours, keeping the storage.
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief Checks whether the path has no contour.
+     * @return `true` if nothing was added since the path was created or cleared.
+     */
+    bool empty() const noexcept { return m_contours.empty(); }
+
+    /**
+     * @brief The points of all the contours, curves being flattened.
+     * @return The points, indexed by the contours.
+     */
+    const std::vector<Point>& points() const noexcept { return m_points; }
+
+    /**
+     * @brief The contours of the path, in the order they were started.
+     * @return The ranges of points of the contours.
+     */
+    const std::vector<Contour>& contours() const noexcept { return m_contours; }
+
+private:
+    void ensure_current(float x, float y);
+
+private:
+    std::vector<Point> m_points;        ///< Points of all the contours, one after another.
+    std::vector<Contour> m_contours;    ///< Contours, the last one being extended.
+    Point m_start{};                    ///< First point of the last contour, the current point once it is closed.
+    bool m_open = false;                ///< Whether the last contour can be extended.
+};
+
+/**
+ * @class ScratchArena
+ * @brief Buffers of the rasterizer kept between fills.
+ *
+ * Filling or stroking a shape needs an edge table and a few row buffers sized after
+ * the shape and the image. Without an arena they are allocated for each call; passing
+ * the same arena to every call instead keeps them, so that once it has seen the largest
+ * shape, drawing allocates nothing.
+ *
+ * An arena must not be used by several threads at once, use one arena per thread.
+ */
+class ScratchArena
+{
+public:
+    ScratchArena();
+    ~ScratchArena();
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    ScratchArena(ScratchArena&&) noexcept;
+    ScratchArena& operator=(ScratchArena&&) noexcept;
+
+private:
+    friend struct detail::ScratchAccess;
+
+    std::unique_ptr<detail::Rasterizer> m_rasterizer;   ///< Edge table and row buffers.
+};
+
+/**
+ * @brief Fills a polygon with a color.
+ *
+ * The polygon may be concave or cross itself, `style` telling its inside. Anti-aliased
+ * pixels are weighted by the exact area of them it covers, as for `polygon_aa`; aliased
+ * ones are filled when their center is inside. Each pixel is blended once. Polygons found
+ * to be convex take a faster path when aliased.
+ *
+ * @param image The image to modify.
+ * @param points The vertices of the polygon, the last one being joined to the first.
+ * @param count The number of vertices.
+ * @param color The color of the polygon.
+ * @param style The fill rule and anti-aliasing.
+ * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
+ * @param scratch Buffers to reuse, `nullptr` to allocate them for this call.
+ */
+void fill_polygon(ImageView image, const Point* points, size_t count, Color color, const FillStyle& style = {},
+                  BlendMode mode = BlendMode::REPLACE, ScratchArena* scratch = nullptr);
+
+/**
+ * @brief Fills a polygon with the colors returned by a mapper.
+ *
+ * The mapper is called for each pixel the polygon covers, with its current color. Anti-aliased
+ * pixels are mixed with the color returned in proportion to their coverage.
+ *
+ * @param image The image to modify.
+ * @param points The vertices of the polygon, the last one being joined to the first.
+ * @param count The number of vertices.
+ * @param mapper The function giving the new color of each pixel.
+ * @param style The fill rule and anti-aliasing.
+ * @param scratch Buffers to reuse, `nullptr` to allocate them for this call.
+ */
+void fill_polygon(ImageView image, const Point* points, size_t count, const Image::Mapper& mapper,
+                  const FillStyle& style = {}, ScratchArena* scratch = nullptr);
+
+/**
+ * @brief Fills a polygon with a linear gradient from a color ramp.
+ *
+ * The ramp goes from `start` to `end`, pixels beyond them taking the colors of its ends.
+ * Colors are taken at the center of the pixels.
+ *
+ * @param image The image to modify.
+ * @param points The vertices of the polygon, the last one being joined to the first.
+ * @param count The number of vertices.
+ * @param start The point of the gradient at position 0 of the ramp.
+ * @param end The point of the gradient at position 1 of the ramp.
+ * @param ramp The `ColorRamp` that defines the color transitions along the gradient.
+ * @param style The fill rule and anti-aliasing.
+ * @param mode The blending mode to use when applying the gradient. Defaults to `BlendMode::REPLACE`.
+ * @param scratch Buffers to reuse, `nullptr` to allocate them for this call.
+ */
+void fill_polygon_gradient_linear(ImageView image, const Point* points, size_t count, Point start, Point end,
+                                  const ColorRamp& ramp, const FillStyle& style = {},
+                                  BlendMode mode = BlendMode::REPLACE, ScratchArena* scratch = nullptr);
+
+/**
+ * @brief Fills a polygon with a radial gradient from a color ramp.
+ *
+ * The ramp goes from `center`, at position 0, to the circle through `end`, pixels beyond it
+ * taking the last color. Colors are taken at the center of the pixels.
+ *
+ * @param image The image to modify.
+ * @param points The vertices of the polygon, the last one being joined to the first.
+ * @param count The number of vertices.
+ * @param center The center of the gradient.
+ * @param end A point on the circle at position 1 of the ramp.
+ * @param ramp The `ColorRamp` that defines the color transitions along the radius.
+ * @param style The fill rule and anti-aliasing.
+ * @param mode The blending mode to use when applying the gradient. Defaults to `BlendMode::REPLACE`.
+ * @param scratch Buffers to reuse, `nullptr` to allocate them for this call.
+ */
+void fill_polygon_gradient_radial(ImageView image, const Point* points, size_t count, Point center, Point end,
+                                  const ColorRamp& ramp, const FillStyle& style = {},
+                                  BlendMode mode = BlendMode::REPLACE, ScratchArena* scratch = nullptr);
+
+/**
+ * @brief Fills a path with a color.
+ *
+ * All the contours are filled at once, each being closed implicitly: where they overlap,
+ * `style` tells whether the pixels are inside, which cuts holes with `FillRule::EVEN_ODD`
+ * or with contours wound the other way. See `fill_polygon`.
+ *
+ * @param image The image to modify.
+ * @param path The contours to fill.
+ * @param color The color of the path.
+ * @param style The fill rule and anti-aliasing.
+ * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
+ * @param scratch Buffers to reuse, `nullptr` to allocate them for this call.
+ */
+void fill_path(ImageView image, const Path& path, Color color, const FillStyle& style = {},
+               BlendMode mode = BlendMode::REPLACE, ScratchArena* scratch = nullptr);
+
+/**
+ * @brief Fills a path with the colors returned by a mapper.
+ *
+ * See `fill_path` and the mapper version of `fill_polygon`.
+ *
+ * @param image The image to modify.
+ * @param path The contours to fill.
+ * @param mapper The function giving the new color of each pixel.
+ * @param style The fill rule and anti-aliasing.
+ * @param scratch Buffers to reuse, `nullptr` to allocate them for this call.
+ */
+void fill_path(ImageView image, const Path& path, const Image::Mapper& mapper,
+               const FillStyle& style = {}, ScratchArena* scratch = nullptr);
+
+/**
+ * @brief Fills a path with a linear gradient from a color ramp.
+ *
+ * See `fill_path` and `fill_polygon_gradient_linear`.
+ *
+ * @param image The image to modify.
+ * @param path The contours to fill.
+ * @param start The point of the gradient at position 0 of the ramp.
+ * @param end The point of the gradient at position 1 of the ramp.
+ * @param ramp The `ColorRamp` that defines the color transitions along the gradient.
+ * @param style The fill rule and anti-aliasing.
+ * @param mode The blending mode to use when applying the gradient. Defaults to `BlendMode::REPLACE`.
+ * @param scratch Buffers to reuse, `nullptr` to allocate them for this call.
+ */
+void fill_path_gradient_linear(ImageView image, const Path& path, Point start, Point end,
+                               const ColorRamp& ramp, const FillStyle& style = {},
+                               BlendMode mode = BlendMode::REPLACE, ScratchArena* scratch = nullptr);
+
+/**
+ * @brief Fills a path with a radial gradient from a color ramp.
+ *
+ * See `fill_path` and `fill_polygon_gradient_radial`.
+ *
+ * @param image The image to modify.
+ * @param path The contours to fill.
+ * @param center The center of the gradient.
+ * @param end A point on the circle at position 1 of the ramp.
+ * @param ramp The `ColorRamp` that defines the color transitions along the radius.
+ * @param style The fill rule and anti-aliasing.
+ * @param mode The blending mode to use when applying the gradient. Defaults to `BlendMode::REPLACE`.
+ * @param scratch Buffers to reuse, `nullptr` to allocate them for this call.
+ */
+void fill_path_gradient_radial(ImageView image, const Path& path, Point center, Point end,
+                               const ColorRamp& ramp, const FillStyle& style = {},
+                               BlendMode mode = BlendMode::REPLACE, ScratchArena* scratch = nullptr);
+
+/**
+ * @brief Strokes the contours of a path, anti-aliased.
+ *
+ * Closed contours are joined all around, open ones are capped at both ends. All the contours
+ * are rasterized at once, each pixel being blended once, as for `polyline_aa`.
+ *
+ * @param image The image to modify.
+ * @param path The contours to stroke.
+ * @param color The color of the stroke.
+ * @param style The width, the caps and the joins of the stroke.
+ * @param mode The blending mode to use when applying the color. Defaults to `BlendMode::REPLACE`.
+ * @param scratch Buffers to reuse, `nullptr` to allocate them for this call.
+ */
+void stroke_path(ImageView image, const Path& path, Color color, const StrokeStyle& style = {},
+                 BlendMode mode = BlendMode::REPLACE, ScratchArena* scratch = nullptr);
+
+} // namespace bpx
+
+#endif // BPX_PATH_HPP
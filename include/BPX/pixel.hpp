@@ -83,6 +83,23 @@ enum class PixelFormat
     BGRA_F32,       ///< BGRA format with 32-bit floating-point values (per channel).
 };
 
+/**
+ * @brief Convention used to store the color channels of pixels with an alpha channel.
+ *
+ * With straight alpha, the color channels hold the color as is and the alpha only says how
+ * opaque it is. With premultiplied alpha, the color channels are already multiplied by the
+ * alpha (a half-transparent red is stored as (128, 0, 0, 128)), which makes compositing
+ * cheaper and filtering correct, at the cost of precision for the most transparent pixels.
+ *
+ * The convention does not change how pixels are encoded, it only tells how they must be
+ * interpreted. Formats without alpha are the same under both conventions.
+ */
+enum class AlphaMode
+{
+    STRAIGHT,       ///< Color channels are independent of the alpha (default).
+    PREMULTIPLIED,  ///< Color channels are multiplied by the alpha.
+};
+
 /**
  * @brief Calculates the size (in bytes) of a single pixel for a given pixel format.
  *
@@ -103,7 +120,15 @@ constexpr size_t pixel_size(PixelFormat format) noexcept {
 
         case PixelFormat::L_F16:
         case PixelFormat::LA_U8:
-            return 2;               ///< Luminance (16-bit floating-point) or Luminance + Alpha with 8-bit values.
+        case PixelFormat::RGB_565:
+        case PixelFormat::BGR_565:
+        case PixelFormat::RGBA_5551:
+        case PixelFormat::BGRA_5551:
+        case PixelFormat::RGBA_4444:
+        case PixelFormat::BGRA_4444:
+            return 2;               /*< Luminance (16-bit floating-point), Luminance + Alpha with 8-bit values,
+                                     *  or packed RGB/RGBA formats with 4-6 bits per channel.
+                                     */
 
         case PixelFormat::RGB_U8:
         case PixelFormat::BGR_U8:
@@ -111,10 +136,10 @@ constexpr size_t pixel_size(PixelFormat format) noexcept {
 
         case PixelFormat::L_F32:
         case PixelFormat::LA_F16:
-        case PixelFormat::RGB_565:
-        case PixelFormat::BGR_565:
+        case PixelFormat::RGBA_U8:
+        case PixelFormat::BGRA_U8:
             return 4;               /*< Luminance (32-bit floating-point), Luminance + Alpha (16-bit),
-                                     *  or RGB/BGR formats with 5-6 bits per channel.
+                                     *  or RGBA/BGRA formats with unsigned 8-bit values.
                                      */
 
         case PixelFormat::RGB_F16:
@@ -122,29 +147,19 @@ constexpr size_t pixel_size(PixelFormat format) noexcept {
             return 6;               ///< RGB or BGR format with 16-bit floating-point values (per channel).
 
         case PixelFormat::LA_F32:
-            return 8;               ///< Luminance + Alpha format with 32-bit floating-point values (per channel).
+        case PixelFormat::RGBA_F16:
+        case PixelFormat::BGRA_F16:
+            return 8;               /*< Luminance + Alpha format with 32-bit floating-point values,
+                                     *  or RGBA/BGRA format with 16-bit floating-point values (per channel).
+                                     */
 
         case PixelFormat::RGB_F32:
         case PixelFormat::BGR_F32:
             return 12;              ///< RGB or BGR format with 32-bit floating-point values (per channel).
 
-        case PixelFormat::RGBA_5551:
-        case PixelFormat::BGRA_5551:
-        case PixelFormat::RGBA_4444:
-        case PixelFormat::BGRA_4444:
-            return 16;              ///< Packed RGBA/BGRA formats with 5/4 bits for each channel.
-
-        case PixelFormat::RGBA_U8:
-        case PixelFormat::BGRA_U8:
-            return 32;              ///< RGBA/BGRA format with unsigned 8-bit values (per channel).
-
-        case PixelFormat::RGBA_F16:
-        case PixelFormat::BGRA_F16:
-            return 64;              ///< RGBA/BGRA format with 16-bit floating-point values (per channel).
-
         case PixelFormat::RGBA_F32:
         case PixelFormat::BGRA_F32:
-            return 128;             ///< RGBA/BGRA format with 32-bit floating-point values (per channel).
+            return 16;              ///< RGBA/BGRA format with 32-bit floating-point values (per channel).
 
     }
 
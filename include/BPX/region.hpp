@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_REGION_HPP
+#define BPX_REGION_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace bpx {
+
+/**
+ * @brief A rectangle of pixels, from `(x, y)` included to `(x + w, y + h)` excluded.
+ */
+struct Rect
+{
+    int x = 0;      ///< Left column.
+    int y = 0;      ///< Top row.
+    int w = 0;      ///< Width, the rectangle is empty when it is not positive.
+    int h = 0;      ///< Height, the rectangle is empty when it is not positive.
+
+    /**
+     * @brief Checks whether the rectangle covers no pixel.
+     */
+    bool empty() const noexcept {
+        return w <= 0 || h <= 0;
+    }
+};
+
+/**
+ * @brief Returns the pixels common to two rectangles, an empty rectangle if there are none.
+ */
+Rect intersection(const Rect& a, const Rect& b) noexcept;
+
+/**
+ * @class Region
+ * @brief A set of pixels stored as a few disjoint rectangles, e.g. the damaged area of a frame.
+ *
+ * Adding a rectangle merges it with those it overlaps, and with those whose common bounding box
+ * covers no more pixels than the two of them (such as neighbours sharing a whole edge), so the
+ * rectangles never overlap and every pixel of the region is listed once: they can be redrawn or
+ * uploaded one after another. Past `max_rects` rectangles, the two whose merging adds the fewest
+ * pixels are merged, which bounds the number of uploads at the cost of some undamaged pixels.
+ */
+class Region
+{
+public:
+    /**
+     * @brief Creates an empty region.
+     *
+     * @param max_rects The number of rectangles past which the closest ones are merged (at least 1).
+     */
+    explicit Region(int max_rects = 16);
+
+    /**
+     * @brief Creates a region made of one rectangle.
+     */
+    Region(const Rect& rect, int max_rects = 16);
+
+    /**
+     * @brief Adds the pixels of a rectangle, ignored when empty.
+     */
+    void add(const Rect& rect);
+
+    /**
+     * @brief Adds the pixels of another region.
+     */
+    void add(const Region& region);
+
+    /**
+     * @brief Removes all the pixels, keeping the storage.
+     */
+    void clear() noexcept {
+        m_rects.clear();
+    }
+
+    /**
+     * @brief Checks whether the region covers no pixel.
+     */
+    bool empty() const noexcept {
+        return m_rects.empty();
+    }
+
+    /**
+     * @brief Returns the disjoint rectangles of the region, in no particular order.
+     */
+    const std::vector<Rect>& rects() const noexcept {
+        return m_rects;
+    }
+
+    /**
+     * @brief Returns the smallest rectangle containing the region, empty if the region is.
+     */
+    Rect bounds() const noexcept;
+
+    /**
+     * @brief Returns the number of pixels of the region.
+     */
+    int64_t area() const noexcept;
+
+    /**
+     * @brief Checks whether the region has pixels in common with a rectangle.
+     */
+    bool intersects(const Rect& rect) const noexcept;
+
+    /**
+     * @brief Keeps only the pixels of the region inside a rectangle, e.g. those of an image.
+     */
+    void intersect(const Rect& rect);
+
+private:
+    std::vector<Rect> m_rects;  ///< Disjoint, non-empty rectangles.
+    int m_max_rects;            ///< Number of rectangles past which they are merged.
+};
+
+} // namespace bpx
+
+#endif // BPX_REGION_HPP
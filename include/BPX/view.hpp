@@ -0,0 +1,378 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_VIEW_HPP
+#define BPX_VIEW_HPP
+
+#include "./image.hpp"
+
+#include <cstdint>
+#include <cstddef>
+#include <tuple>
+
+namespace bpx {
+
+/**
+ * @class ConstImageView
+ * @brief A non-owning, read-only window over pixel data with an explicit row stride.
+ *
+ * A view references pixels that live elsewhere: in an `Image`, in a region of a larger
+ * image such as a texture atlas, or in an external buffer whose rows are padded (an
+ * SDL surface, a mapped staging buffer with aligned rows, etc.). Consecutive pixels of
+ * a row are contiguous, while rows are `pitch()` bytes apart, which may be more than
+ * `width() * pixel_size(format())`.
+ *
+ * Views are cheap to copy and never free the memory they reference, which must stay
+ * valid for as long as the view is used.
+ */
+class ConstImageView
+{
+public:
+    /**
+     * @brief Creates a view over the whole content of an image.
+     *
+     * @param image The image to view.
+     */
+    ConstImageView(const Image& image)
+        : ConstImageView(image.data(), image.width(), image.height(), image.format(), image.pitch(), image.alpha_mode())
+    { }
+
+    /**
+     * @brief Creates a view over an external buffer.
+     *
+     * @param pixels Pointer to the first pixel of the first row.
+     * @param w Width of the view in pixels.
+     * @param h Height of the view in pixels.
+     * @param format Pixel format of the data.
+     * @param pitch Number of bytes between the start of two consecutive rows, 0 for
+     *        tightly packed rows (`w * pixel_size(format)`).
+     * @param alpha Alpha convention of the data.
+     * @throws std::invalid_argument If the dimensions are negative or if the pitch is
+     *         smaller than a row of pixels.
+     */
+    ConstImageView(const void* pixels, int w, int h, PixelFormat format, size_t pitch = 0,
+                   AlphaMode alpha = AlphaMode::STRAIGHT);
+
+    /**
+     * @brief Creates a view over a rectangular region of this view, sharing its pixels.
+     *
+     * @param x The x-coordinate of the top-left corner of the region.
+     * @param y The y-coordinate of the top-left corner of the region.
+     * @param w The width of the region.
+     * @param h The height of the region.
+     * @return A view of the region, with the same pitch as this view.
+     * @throws std::out_of_range If the region is not entirely inside this view.
+     */
+    ConstImageView sub(int x, int y, int w, int h) const;
+
+    /**
+     * @brief Gets the color of a pixel at specific coordinates (unsafe).
+     *
+     * It is the caller's responsibility to ensure the coordinates are valid.
+     *
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @return The color of the pixel at the specified coordinates.
+     */
+    Color get_unsafe(int x, int y) const;
+
+    /**
+     * @brief Gets the color of a pixel at specific coordinates.
+     *
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @return The color of the pixel, or a blank color if the coordinates are outside the view.
+     */
+    Color get(int x, int y) const {
+        if (x >= 0 && x < width() && y >= 0 && y < height()) {
+            return get_unsafe(x, y);
+        }
+        return {};
+    }
+
+    /**
+     * @brief Reads a horizontal run of pixels into an array of colors (unsafe).
+     *
+     * Same as `Image::read_row`, it is the caller's responsibility to ensure the run
+     * lies within the view.
+     *
+     * @param x The x-coordinate of the first pixel of the run.
+     * @param y The y-coordinate of the row.
+     * @param dst The array receiving the colors, at least `count` elements long.
+     * @param count The number of pixels to read.
+     */
+    void read_row(int x, int y, Color* dst, int count) const;
+
+    /**
+     * @brief Gets the width of the view.
+     *
+     * @return The width of the view in pixels.
+     */
+    int width() const {
+        return m_w;
+    }
+
+    /**
+     * @brief Gets the height of the view.
+     *
+     * @return The height of the view in pixels.
+     */
+    int height() const {
+        return m_h;
+    }
+
+    /**
+     * @brief Gets the dimensions (width and height) of the view.
+     *
+     * @return A tuple containing the width and height of the view.
+     */
+    std::tuple<int, int> dimensions() const {
+        return { m_w, m_h };
+    }
+
+    /**
+     * @brief Gets the total number of pixels in the view.
+     *
+     * @return The total number of pixels (width * height).
+     */
+    size_t size() const {
+        return static_cast<size_t>(m_w) * m_h;
+    }
+
+    /**
+     * @brief Gets the pitch (stride) of the view.
+     *
+     * @return The number of bytes between the start of two consecutive rows.
+     */
+    size_t pitch() const {
+        return m_pitch;
+    }
+
+    /**
+     * @brief Gets the number of bytes occupied by the pixels of one row.
+     *
+     * @return The width of the view multiplied by the size of a pixel.
+     */
+    size_t row_size() const {
+        return m_w * pixel_size(m_format);
+    }
+
+    /**
+     * @brief Tells whether the rows follow each other without padding.
+     *
+     * When it is the case the whole view can be processed as a single run of pixels.
+     *
+     * @return `true` if the pitch equals the size of a row.
+     */
+    bool is_contiguous() const {
+        return m_pitch == row_size() || m_h <= 1;
+    }
+
+    /**
+     * @brief Gets the pixel format of the view.
+     *
+     * @return The pixel format of the referenced data.
+     */
+    PixelFormat format() const {
+        return m_format;
+    }
+
+    /**
+     * @brief Gets the alpha convention of the view.
+     *
+     * @return The alpha convention of the referenced data, taken from the image for a
+     *         view of an image.
+     */
+    AlphaMode alpha_mode() const {
+        return m_alpha;
+    }
+
+    /**
+     * @brief Gets the address of the top-left pixel of the view.
+     *
+     * @return A pointer to the first pixel of the first row.
+     */
+    const void* data() const {
+        return m_pixels;
+    }
+
+    /**
+     * @brief Gets the address of the first pixel of a row.
+     *
+     * @param y The index of the row.
+     * @return A pointer to the first pixel of row `y`.
+     */
+    const void* row(int y) const {
+        return m_pixels + static_cast<ptrdiff_t>(y) * m_pitch;
+    }
+
+    /**
+     * @brief Gets the address of a pixel.
+     *
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @return A pointer to the pixel at `(x, y)`.
+     */
+    const void* pixel(int x, int y) const {
+        return m_pixels + static_cast<ptrdiff_t>(y) * m_pitch + x * pixel_size(m_format);
+    }
+
+protected:
+    uint8_t* m_pixels;      ///< Pointer to the top-left pixel of the view.
+    PixelFormat m_format;   ///< The pixel format of the referenced data.
+    int m_w, m_h;           ///< Width and height of the view.
+    size_t m_pitch;         ///< Number of bytes between two consecutive rows.
+    AlphaMode m_alpha;      ///< Alpha convention of the referenced data.
+};
+
+/**
+ * @class ImageView
+ * @brief A non-owning, writable window over pixel data with an explicit row stride.
+ *
+ * Same as `ConstImageView`, but the referenced pixels can be modified. Every function
+ * of `algorithm.hpp` that modifies an image in place accepts an `ImageView`, and an
+ * `Image` converts to it implicitly, so a region of an image or a padded external
+ * buffer can be processed in place without any copy.
+ *
+ * The constness of a view applies to the view itself, not to the pixels it references,
+ * which remain writable through a `const ImageView`.
+ */
+class ImageView : public ConstImageView
+{
+public:
+    /**
+     * @brief Creates a view over the whole content of an image.
+     *
+     * @param image The image to view.
+     */
+    ImageView(Image& image)
+        : ConstImageView(image)
+    { }
+
+    /**
+     * @brief Creates a view over an external buffer.
+     *
+     * @param pixels Pointer to the first pixel of the first row.
+     * @param w Width of the view in pixels.
+     * @param h Height of the view in pixels.
+     * @param format Pixel format of the data.
+     * @param pitch Number of bytes between the start of two consecutive rows, 0 for
+     *        tightly packed rows (`w * pixel_size(format)`).
+     * @param alpha Alpha convention of the data.
+     * @throws std::invalid_argument If the dimensions are negative or if the pitch is
+     *         smaller than a row of pixels.
+     */
+    ImageView(void* pixels, int w, int h, PixelFormat format, size_t pitch = 0,
+              AlphaMode alpha = AlphaMode::STRAIGHT)
+        : ConstImageView(pixels, w, h, format, pitch, alpha)
+    { }
+
+    /**
+     * @brief Creates a view over a rectangular region of this view, sharing its pixels.
+     *
+     * @param x The x-coordinate of the top-left corner of the region.
+     * @param y The y-coordinate of the top-left corner of the region.
+     * @param w The width of the region.
+     * @param h The height of the region.
+     * @return A view of the region, with the same pitch as this view.
+     * @throws std::out_of_range If the region is not entirely inside this view.
+     */
+    ImageView sub(int x, int y, int w, int h) const {
+        return ImageView(ConstImageView::sub(x, y, w, h));
+    }
+
+    /**
+     * @brief Sets the color of a pixel at specific coordinates (unsafe).
+     *
+     * It is the caller's responsibility to ensure the coordinates are valid.
+     *
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @param color The color to set the pixel to.
+     */
+    void set_unsafe(int x, int y, Color color) const;
+
+    /**
+     * @brief Sets the color of a pixel at specific coordinates.
+     *
+     * Coordinates outside the view are ignored.
+     *
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @param color The color to set the pixel to.
+     */
+    void set(int x, int y, Color color) const {
+        if (x >= 0 && x < width() && y >= 0 && y < height()) {
+            set_unsafe(x, y, color);
+        }
+    }
+
+    /**
+     * @brief Writes an array of colors to a horizontal run of pixels (unsafe).
+     *
+     * Same as `Image::write_row`, it is the caller's responsibility to ensure the run
+     * lies within the view.
+     *
+     * @param x The x-coordinate of the first pixel of the run.
+     * @param y The y-coordinate of the row.
+     * @param src The colors to write, at least `count` elements long.
+     * @param count The number of pixels to write.
+     */
+    void write_row(int x, int y, const Color* src, int count) const;
+
+    /**
+     * @brief Gets the address of the top-left pixel of the view.
+     *
+     * @return A pointer to the first pixel of the first row.
+     */
+    void* data() const {
+        return m_pixels;
+    }
+
+    /**
+     * @brief Gets the address of the first pixel of a row.
+     *
+     * @param y The index of the row.
+     * @return A pointer to the first pixel of row `y`.
+     */
+    void* row(int y) const {
+        return m_pixels + static_cast<ptrdiff_t>(y) * m_pitch;
+    }
+
+    /**
+     * @brief Gets the address of a pixel.
+     *
+     * @param x The x-coordinate of the pixel.
+     * @param y The y-coordinate of the pixel.
+     * @return A pointer to the pixel at `(x, y)`.
+     */
+    void* pixel(int x, int y) const {
+        return m_pixels + static_cast<ptrdiff_t>(y) * m_pitch + x * pixel_size(m_format);
+    }
+
+private:
+    // Only used to rebuild a writable view from a region of a writable view
+    explicit ImageView(const ConstImageView& view)
+        : ConstImageView(view)
+    { }
+};
+
+} // namespace bpx
+
+#endif // BPX_VIEW_HPP
@@ -19,11 +19,21 @@
 
 #include "BPX/algorithm.hpp"
 #include "BPX/ramp.hpp"
+#include "BPX/half.hpp"
+
+#include "./clip.hpp"
+#include "./filter.hpp"
+#include "./packed.hpp"
+#include "./raster.hpp"
+#include "./stroke.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <stdexcept>
 #include <utility>
 #include <cstring>
+#include <cstdlib>
+#include <vector>
 
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 
@@ -32,265 +42,6 @@
 
 #include <stb_image_resize2.h>
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-
-#define STBIW_MALLOC(sz)         std::malloc(sz)
-#define STBIW_REALLOC(p,newsz)   std::realloc(p,newsz)
-#define STBIW_FREE(p)            std::free(p)
-
-#include <stb_image_write.h>
-
-/* Macros */
-
-#define PF_LINE_TRAVEL(PIXEL_CODE)                                                          \
-    if (clip_line(&x1, &y1, &x2, &y2, 0, 0, image.width() - 1, image.height() - 1) == 0) {  \
-        return;                                                                             \
-    }                                                                                       \
-    int_fast8_t y_longer = 0;                                                               \
-    int short_len = y2 - y1;                                                                \
-    int long_len = x2 - x1;                                                                 \
-    /*                                                                                      \
-        Determine if the line is more vertical than horizontal                              \
-    */                                                                                      \
-    if (abs(short_len) > abs(long_len)) {                                                   \
-        std::swap(short_len, long_len);                                                     \
-        y_longer = 1;                                                                       \
-    }                                                                                       \
-    /*                                                                                      \
-        Initialize variables for drawing loop                                               \
-    */                                                                                      \
-    int end = long_len;                                                                     \
-    int_fast8_t sign = 1;                                                                   \
-    /*                                                                                      \
-        Adjust direction increment based on long_len sign                                   \
-    */                                                                                      \
-    if (long_len < 0) {                                                                     \
-        long_len = -long_len;                                                               \
-        sign = -1;                                                                          \
-    }                                                                                       \
-    /*                                                                                      \
-        Calculate fixed-point increment for shorter length                                  \
-    */                                                                                      \
-    int dec = (long_len == 0) ? 0 : (short_len << 16) / long_len;                           \
-    /*                                                                                      \
-        Travel the line pixel by pixel                                                      \
-    */                                                                                      \
-    if (y_longer) {                                                                         \
-        /*                                                                                  \
-            If line is more vertical, iterate over y-axis                                   \
-        */                                                                                  \
-        for (int i = 0, j = 0; i != end; i += sign, j += dec) {                             \
-            int x = x1 + (j >> 16), y = y1 + i;                                             \
-            size_t offset = y * image.width() + x;                                          \
-            PIXEL_CODE                                                                      \
-        }                                                                                   \
-    } else {                                                                                \
-        /*                                                                                  \
-            If line is more horizontal, iterate over x-axis                                 \
-        */                                                                                  \
-        for (int i = 0, j = 0; i != end; i += sign, j += dec) {                             \
-            int x = x1 + i, y = y1 + (j >> 16);                                             \
-            size_t offset = y * image.width() + x;                                          \
-            PIXEL_CODE                                                                      \
-        }                                                                                   \
-    }
-
-#define PF_LINE_THICK_TRAVEL(LINE_CODE)                                                     \
-    /*                                                                                      \
-        Calculate differences in x and y coordinates                                        \
-    */                                                                                      \
-    int dx = x2 - x1;                                                                       \
-    int dy = y2 - y1;                                                                       \
-    /*                                                                                      \
-        Draw the main line between (x1, y1) and (x2, y2)                                    \
-    */                                                                                      \
-    LINE_CODE                                                                               \
-    /*                                                                                      \
-        Determine if the line is more horizontal or vertical                                \
-    */                                                                                      \
-    if (dx != 0 && abs(dy/dx) < 1) {                                                        \
-        int y1_copy = y1;                                                                   \
-        int y2_copy = y2;                                                                   \
-        /*                                                                                  \
-            Line is more horizontal                                                         \
-            Calculate half the width of the line                                            \
-        */                                                                                  \
-        int wy = (thick - 1) * sqrtf((float)(dx*dx + dy*dy)) / (2*abs(dx));                 \
-        /*                                                                                  \
-            Draw additional lines above and below the main line                             \
-        */                                                                                  \
-        for (int i = 1; i <= wy; ++i) {                                                     \
-            y1 = y1_copy - i;                                                               \
-            y2 = y2_copy - i;                                                               \
-            {                                                                               \
-                LINE_CODE                                                                   \
-            }                                                                               \
-            y1 = y1_copy + i;                                                               \
-            y2 = y2_copy + i;                                                               \
-            {                                                                               \
-                LINE_CODE                                                                   \
-            }                                                                               \
-        }                                                                                   \
-    } else if (dy != 0) {                                                                   \
-        int x1_copy = x1;                                                                   \
-        int x2_copy = x2;                                                                   \
-        /*                                                                                  \
-            Line is more vertical or perfectly horizontal                                   \
-            Calculate half the width of the line                                            \
-        */                                                                                  \
-        int wx = (thick - 1) * sqrtf((float)(dx*dx + dy*dy)) / (2*abs(dy));                 \
-        /*                                                                                  \
-            Draw additional lines to the left and right of the main line                    \
-        */                                                                                  \
-        for (int i = 1; i <= wx; ++i) {                                                     \
-            x1 = x1_copy - i;                                                               \
-            x2 = x2_copy - i;                                                               \
-            {                                                                               \
-                LINE_CODE                                                                   \
-            }                                                                               \
-            x1 = x1_copy + i;                                                               \
-            x2 = x2_copy + i;                                                               \
-            {                                                                               \
-                LINE_CODE                                                                   \
-            }                                                                               \
-        }                                                                                   \
-    }
-
-#define PF_CIRCLE_TRAVEL(PIXEL_CODE)                                                        \
-    int x = 0;                                                                              \
-    int y = radius;                                                                         \
-    int d = 3 - 2 * radius;                                                                 \
-    while (y >= x) {                                                                        \
-        for (int i = cx - x; i <= cx + x; ++i) {                                            \
-            if (i >= 0 && i < image.width()) {                                              \
-                if (cy + y >= 0 && cy + y < image.height()) {                               \
-                    size_t offset = (cy + y) * image.width() + i;                           \
-                    PIXEL_CODE                                                              \
-                }                                                                           \
-                if (cy - y >= 0 && cy - y < image.height()) {                               \
-                    size_t offset = (cy - y) * image.width() + i;                           \
-                    PIXEL_CODE                                                              \
-                }                                                                           \
-            }                                                                               \
-        }                                                                                   \
-        for (int i = cx - y; i <= cx + y; ++i) {                                            \
-            if (i >= 0 && i < image.width()) {                                              \
-                if (cy + x >= 0 && cy + x < image.height()) {                               \
-                    size_t offset = (cy + x) * image.width() + i;                           \
-                    PIXEL_CODE                                                              \
-                }                                                                           \
-                if (cy - x >= 0 && cy - x < image.height()) {                               \
-                    size_t offset = (cy - x) * image.width() + i;                           \
-                    PIXEL_CODE                                                              \
-                }                                                                           \
-            }                                                                               \
-        }                                                                                   \
-        ++x;                                                                                \
-        if (d > 0) {                                                                        \
-            --y;                                                                            \
-            d = d + 4 * (x - y) + 10;                                                       \
-        } else {                                                                            \
-            d = d + 4 * x + 6;                                                              \
-        }                                                                                   \
-    }
-
-#define PF_CIRCLE_TRAVEL_EX(PC_A, PC_B, PC_C, PC_D)                                         \
-    int x = 0;                                                                              \
-    int y = radius;                                                                         \
-    int d = 3 - 2 * radius;                                                                 \
-    while (y >= x) {                                                                        \
-        for (int i = cx - x; i <= cx + x; ++i) {                                            \
-            if (i >= 0 && i < image.width()) {                                              \
-                if (cy + y >= 0 && cy + y < image.height()) {                               \
-                    size_t offset = (cy + y) * image.width() + i;                           \
-                    PC_A                                                                    \
-                }                                                                           \
-                if (cy - y >= 0 && cy - y < image.height()) {                               \
-                    size_t offset = (cy - y) * image.width() + i;                           \
-                    PC_B                                                                    \
-                }                                                                           \
-            }                                                                               \
-        }                                                                                   \
-        for (int i = cx - y; i <= cx + y; ++i) {                                            \
-            if (i >= 0 && i < image.width()) {                                              \
-                if (cy + x >= 0 && cy + x < image.height()) {                               \
-                    size_t offset = (cy + x) * image.width() + i;                           \
-                    PC_C                                                                    \
-                }                                                                           \
-                if (cy - x >= 0 && cy - x < image.height()) {                               \
-                    size_t offset = (cy - x) * image.width() + i;                           \
-                    PC_D                                                                    \
-                }                                                                           \
-            }                                                                               \
-        }                                                                                   \
-        ++x;                                                                                \
-        if (d > 0) {                                                                        \
-            --y;                                                                            \
-            d = d + 4 * (x - y) + 10;                                                       \
-        } else {                                                                            \
-            d = d + 4 * x + 6;                                                              \
-        }                                                                                   \
-    }
-
-#define PF_CIRCLE_LINE_TRAVEL(PIXEL_CODE)                                                   \
-    int x = 0;                                                                              \
-    int y = radius;                                                                         \
-    int d = 3 - 2 * radius;                                                                 \
-    while (y >= x) {                                                                        \
-        int px1 = cx + x, px2 = cx - x;                                                     \
-        int py1 = cy + y, py2 = cy - y;                                                     \
-        int px3 = cx + y, px4 = cx - y;                                                     \
-        int py3 = cy + x, py4 = cy - x;                                                     \
-        if (px1 >= 0 && px1 < image.width()) {                                              \
-            if (py1 >= 0 && py1 < image.height()) {                                         \
-                size_t offset = py1 * image.width() + px1;                                  \
-                PIXEL_CODE                                                                  \
-            }                                                                               \
-            if (py2 >= 0 && py2 < image.height()) {                                         \
-                size_t offset = py2 * image.width() + px1;                                  \
-                PIXEL_CODE                                                                  \
-            }                                                                               \
-        }                                                                                   \
-        if (px2 >= 0 && px2 < image.width()) {                                              \
-            if (py1 >= 0 && py1 < image.height()) {                                         \
-                size_t offset = py1 * image.width() + px2;                                  \
-                PIXEL_CODE                                                                  \
-            }                                                                               \
-            if (py2 >= 0 && py2 < image.height()) {                                         \
-                size_t offset = py2 * image.width() + px2;                                  \
-                PIXEL_CODE                                                                  \
-            }                                                                               \
-        }                                                                                   \
-        if (px3 >= 0 && px3 < image.width()) {                                              \
-            if (py3 >= 0 && py3 < image.height()) {                                         \
-                size_t offset = py3 * image.width() + px3;                                  \
-                PIXEL_CODE                                                                  \
-            }                                                                               \
-            if (py4 >= 0 && py4 < image.height()) {                                         \
-                size_t offset = py4 * image.width() + px3;                                  \
-                PIXEL_CODE                                                                  \
-            }                                                                               \
-        }                                                                                   \
-        if (px4 >= 0 && px4 < image.width()) {                                              \
-            if (py3 >= 0 && py3 < image.height()) {                                         \
-                size_t offset = py3 * image.width() + px4;                                  \
-                PIXEL_CODE                                                                  \
-            }                                                                               \
-            if (py4 >= 0 && py4 < image.height()) {                                         \
-                size_t offset = py4 * image.width() + px4;                                  \
-                PIXEL_CODE                                                                  \
-            }                                                                               \
-        }                                                                                   \
-        ++x;                                                                                \
-        if (d > 0) {                                                                        \
-            --y;                                                                            \
-            d = d + 4 * (x - y) + 10;                                                       \
-        } else {                                                                            \
-            d = d + 4 * x + 6;                                                              \
-        }                                                                                   \
-    }
-
-
 /* Internal */
 
 namespace {
@@ -314,6 +65,13 @@ uint_fast8_t encode_point(int x, int y, int xmin, int ymin, int xmax, int ymax)
     return code;
 }
 
+/*
+    Cohen-Sutherland clipping of the line from (x1, y1) to (x2, y2). Every
+    intersection is computed from the first end point given, so that the
+    rounding of a previous intersection does not move the next one off the
+    line: the clipped end points stay on the segment, within the bounds of
+    the original ones.
+*/
 int_fast8_t clip_line(int* x1, int* y1, int* x2, int* y2, int xmin, int ymin, int xmax, int ymax)
 {
     int_fast8_t accept = 0;  // Initialize accept flag to false
@@ -321,8 +79,9 @@ int_fast8_t clip_line(int* x1, int* y1, int* x2, int* y2, int xmin, int ymin, in
     uint8_t code1 = encode_point(*x1, *y1, xmin, ymin, xmax, ymax);
     uint8_t code2 = encode_point(*x2, *y2, xmin, ymin, xmax, ymax);
 
-    int dx = *x2 - *x1;
-    int dy = *y2 - *y1;
+    const int x0 = *x1, y0 = *y1;
+    const int64_t dx = *x2 - *x1;
+    const int64_t dy = *y2 - *y1;
 
     // Loop until the line is accepted or rejected
     for (;;) {
@@ -338,19 +97,20 @@ int_fast8_t clip_line(int* x1, int* y1, int* x2, int* y2, int xmin, int ymin, in
 
         // Determine which point to clip
         uint8_t code_out = code1 ? code1 : code2;
-        int x = *x1, y = *y1;
+        int x = (code_out == code1) ? *x1 : *x2;
+        int y = (code_out == code1) ? *y1 : *y2;
 
         if (code_out & CLIP_LEFT) {
-            if (dx) y += dy * (xmin - x) / dx;
+            if (dx) y = y0 + static_cast<int>(dy * (xmin - x0) / dx);
             x = xmin;
         } else if (code_out & CLIP_RIGHT) {
-            if (dx) y += dy * (xmax - x) / dx;
+            if (dx) y = y0 + static_cast<int>(dy * (xmax - x0) / dx);
             x = xmax;
         } else if (code_out & CLIP_BOTTOM) {
-            if (dy) x += dx * (ymax - y) / dy;
+            if (dy) x = x0 + static_cast<int>(dx * (ymax - y0) / dy);
             y = ymax;
         } else /* code_out & CLIP_TOP */ {
-            if (dy) x += dx * (ymin - y) / dy;
+            if (dy) x = x0 + static_cast<int>(dx * (ymin - y0) / dy);
             y = ymin;
         }
 
@@ -366,615 +126,1397 @@ int_fast8_t clip_line(int* x1, int* y1, int* x2, int* y2, int xmin, int ymin, in
     return accept;
 }
 
-} // namespace anonymous
+/*
+    Restricts the corners given by `clip_rect` to the clip, returns false if
+    nothing is left.
+*/
+bool clip_to(const bpx::detail::Clip& clip, int* xmin, int* ymin, int* xmax, int* ymax)
+{
+    *xmin = std::max(*xmin, clip.x0);
+    *ymin = std::max(*ymin, clip.y0);
+    *xmax = std::min(*xmax, clip.x1);
+    *ymax = std::min(*ymax, clip.y1);
+    return *xmin < *xmax && *ymin < *ymax;
+}
 
+/*
+    Run of pixels [x0, x1) of row y drawn by a line. Pixel x0 is at step k
+    of the `length` steps of the line, the next ones dk steps further.
+*/
+struct LineRun
+{
+    int y;
+    int x0, x1;
+    int k, dk;
+    int length;
+};
 
-/* Implementation */
+/*
+    Pixels added on each side of a line `thick` pixels wide, across its
+    longer axis, for its width to be measured perpendicular to it.
+*/
+int line_half_width(int dx, int dy, int thick)
+{
+    const int across = std::abs(dy) < std::abs(dx) ? std::abs(dx) : std::abs(dy);
+    if (across == 0) {
+        return 0;
+    }
+    return static_cast<int>((thick - 1) * std::sqrt(static_cast<float>(dx * dx + dy * dy)) / (2 * across));
+}
 
-namespace bpx {
+/*
+    Calls func(run) for the runs of the line from (x1, y1) to (x2, y2),
+    widened by `half` pixels on each side across its longer axis, each
+    pixel inside the clip being produced once.
+
+    The line is stepped along its longer axis with a 16.16 fixed-point
+    increment of the shorter one, the last point being left out. A line
+    closer to vertical (or diagonal) steps one row at a time, its runs
+    being the pixels [x - half, x + half] of each step. A line closer to
+    horizontal stays on a row for several steps: the rows it passes are
+    walked in order, each taking the steps whose row is at most `half`
+    away, which are consecutive.
+*/
+template <typename Func>
+void line_runs(const bpx::ImageView& image, const bpx::detail::Clip& clip,
+               int x1, int y1, int x2, int y2, int half, Func&& func)
+{
+    // Clipped to the image widened by the pixels added around the line
+    if (clip_line(&x1, &y1, &x2, &y2, -half, -half, image.width() - 1 + half, image.height() - 1 + half) == 0) {
+        return;
+    }
+
+    const bool across_x = std::abs(y2 - y1) >= std::abs(x2 - x1);
+    const bool y_longer = std::abs(y2 - y1) > std::abs(x2 - x1);
+    const int short_len = y_longer ? x2 - x1 : y2 - y1;
+    int long_len = y_longer ? y2 - y1 : x2 - x1;
+    int sign = 1;
+    if (long_len < 0) {
+        long_len = -long_len;
+        sign = -1;
+    }
+    const int dec = (long_len == 0) ? 0 : short_len * (1 << 16) / long_len;
+
+    // Steps [k_begin, k_end) inside the clip along the longer axis, widened
+    // when the runs extend along it
+    const int start = y_longer ? y1 : x1;
+    const int pad = (across_x && !y_longer) ? half : 0;
+    const int lo = (y_longer ? clip.y0 : clip.x0) - pad;
+    const int hi = (y_longer ? clip.y1 : clip.x1) + pad;
+    const int k_begin = std::max(0, sign > 0 ? lo - start : start - hi + 1);
+    const int k_end = std::min(long_len, sign > 0 ? hi - start : start - lo + 1);
+    if (k_begin >= k_end) {
+        return;
+    }
+
+    if (across_x) {
+        for (int k = k_begin; k < k_end; k++) {
+            const int i = k * sign, j = (k * dec) >> 16;
+            const int x = y_longer ? x1 + j : x1 + i;
+            const int y = y_longer ? y1 + i : y1 + j;
+            if (y < clip.y0 || y >= clip.y1) continue;
+            const int x0 = std::max(x - half, clip.x0);
+            const int x_end = std::min(x + half + 1, clip.x1);
+            if (x0 < x_end) {
+                func(LineRun{ y, x0, x_end, k, 0, long_len });
+            }
+        }
+        return;
+    }
+
+    // Rows v from the first one, counted in the direction the line goes
+    const int dir = dec < 0 ? -1 : 1;
+    const auto row = [dec, dir](int k) { return dir * ((k * dec) >> 16); };
+
+    int ka = k_begin, kb = k_begin;
+    const int v_end = row(k_end - 1) + half;
+    for (int v = row(k_begin) - half; v <= v_end; v++) {
+        while (ka < k_end && row(ka) < v - half) ka++;
+        while (kb < k_end && row(kb) <= v + half) kb++;
+        const int y = y1 + dir * v;
+        if (ka >= kb || y < clip.y0 || y >= clip.y1) continue;
+        if (sign > 0) {
+            func(LineRun{ y, x1 + ka, x1 + kb, ka, 1, long_len });
+        } else {
+            func(LineRun{ y, x1 - kb + 1, x1 - ka + 1, kb - 1, -1, long_len });
+        }
+    }
+}
+
+using bpx::detail::ROW_CHUNK;
+using bpx::detail::clip_rect;
 
-void map(Image& image, const Image::Mapper& mapper)
+/*
+    Blends the colors of a run of a gradient line, the ramp going from the
+    first point of the line to the last one.
+*/
+void line_gradient_run(const bpx::ImageView& image, const LineRun& run, const bpx::ColorRamp& ramp,
+                       bpx::BlendMode mode)
 {
-    for (int y = 0; y < image.height(); y++) {
-        for (int x = 0; x < image.width(); x++) {
-            size_t offset = y * image.width() + x;
-            Color color = mapper(x, y, image.get_unsafe(offset));
-            image.set_unsafe(offset, color);
+    bpx::Color colors[ROW_CHUNK];
+    for (int x = run.x0; x < run.x1; x += ROW_CHUNK) {
+        const int count = std::min(ROW_CHUNK, run.x1 - x);
+        const int k = run.k + (x - run.x0) * run.dk;
+        for (int i = 0; i < count; i++) {
+            colors[i] = ramp.get(static_cast<float>(k + i * run.dk) / run.length);
         }
+        bpx::detail::blend_colors(image, x, run.y, colors, count, mode);
     }
 }
+using bpx::detail::transform_rows;
+
+/*
+    Same as `transform_rows` but the previous content is not decoded, `func`
+    only produces the colors to write.
+*/
+template <typename Func>
+void generate_rows(const bpx::ImageView& image, int xmin, int ymin, int xmax, int ymax, Func&& func,
+                   const bpx::ExecutionPolicy& policy = {})
+{
+    bpx::detail::parallel_rows(policy, ymin, ymax, xmax - xmin, [&](int y_begin, int y_end) {
+        bpx::Color buffer[ROW_CHUNK];
+        for (int y = y_begin; y < y_end; y++) {
+            for (int x = xmin; x < xmax; x += ROW_CHUNK) {
+                const int count = std::min(ROW_CHUNK, xmax - x);
+                func(buffer, count, x, y);
+                image.write_row(x, y, buffer, count);
+            }
+        }
+    });
+}
+
+/*
+    Creates an image whose pixels are left uninitialized, for the
+    operations that overwrite every pixel anyway.
+*/
+bpx::Image allocate(int w, int h, bpx::PixelFormat format)
+{
+    void* pixels = std::malloc(static_cast<size_t>(w) * h * bpx::pixel_size(format));
+    if (pixels == nullptr) {
+        throw std::bad_alloc();
+    }
+    return bpx::Image(pixels, w, h, format, true);
+}
+
+/*
+    Applies a conversion between alpha conventions to every pixel with an
+    alpha channel. 8-bit RGBA and BGRA rows are passed in place to `span`,
+    which treats the color channels alike whatever their order, and the
+    other formats are decoded to `Color` first. Float formats are instead
+    handled by `scale`, called on the components of one pixel in single
+    precision, so that values outside of [0, 1] survive the conversion.
+*/
+template <typename SpanFunc, typename ScaleFunc>
+void transform_alpha(const bpx::ImageView& image, SpanFunc&& span, ScaleFunc&& scale,
+                     const bpx::ExecutionPolicy& policy)
+{
+    using bpx::PixelFormat;
+
+    const int w = image.width(), h = image.height();
+    const int comp = static_cast<int>(bpx::pixel_comp(image.format()));
+    if (comp != 2 && comp != 4) {
+        return;
+    }
+
+    switch (image.format()) {
+
+        case PixelFormat::RGBA_U8:
+        case PixelFormat::BGRA_U8:
+            bpx::detail::parallel_rows(policy, 0, h, w, [&](int y_begin, int y_end) {
+                for (int y = y_begin; y < y_end; y++) {
+                    span(static_cast<bpx::Color*>(image.row(y)), w);
+                }
+            });
+            break;
+
+        case PixelFormat::LA_F32:
+        case PixelFormat::RGBA_F32:
+        case PixelFormat::BGRA_F32:
+            bpx::detail::parallel_rows(policy, 0, h, w, [&](int y_begin, int y_end) {
+                for (int y = y_begin; y < y_end; y++) {
+                    float* pixels = static_cast<float*>(image.row(y));
+                    for (int x = 0; x < w; x++) {
+                        scale(pixels + x * comp, comp);
+                    }
+                }
+            });
+            break;
+
+        case PixelFormat::LA_F16:
+        case PixelFormat::RGBA_F16:
+        case PixelFormat::BGRA_F16:
+            bpx::detail::parallel_rows(policy, 0, h, w, [&](int y_begin, int y_end) {
+                float buffer[ROW_CHUNK * 4];
+                for (int y = y_begin; y < y_end; y++) {
+                    for (int x = 0; x < w; x += ROW_CHUNK) {
+                        const int count = std::min(ROW_CHUNK, w - x);
+                        uint16_t* pixels = static_cast<uint16_t*>(image.pixel(x, y));
+                        bpx::half_to_float(pixels, buffer, count * comp);
+                        for (int i = 0; i < count; i++) {
+                            scale(buffer + i * comp, comp);
+                        }
+                        bpx::float_to_half(buffer, pixels, count * comp);
+                    }
+                }
+            });
+            break;
+
+        default:
+            transform_rows(image, 0, 0, w, h, [&](bpx::Color* colors, int count, int, int) {
+                span(colors, count);
+            }, policy);
+            break;
+    }
+}
+
+/*
+    Clips one axis of a draw, where the destination range [pos, pos + size)
+    samples the source range [src_pos, src_pos + src_size) with
+    src(t) = src_pos + t * src_size / size for t in [0, size). Gives the
+    destination range [*begin, *end) of the pixels that lie inside the
+    destination (of length `limit`) and sample a pixel inside the source
+    (of length `src_limit`). Returns false if it is empty.
+*/
+bool clip_draw_axis(int pos, int size, int src_pos, int src_size, int limit, int src_limit,
+                    int* begin, int* end)
+{
+    const auto ceil_div = [](int64_t n, int64_t d) {
+        return (n + d - 1) / d;
+    };
+
+    int64_t t_begin = std::max(0, -pos);
+    int64_t t_end = std::min(size, limit - pos);
+
+    if (src_pos < 0) {
+        t_begin = std::max(t_begin, ceil_div(-static_cast<int64_t>(src_pos) * size, src_size));
+    }
+    if (src_pos + src_size > src_limit) {
+        t_end = std::min(t_end, ceil_div(std::max<int64_t>(0, src_limit - src_pos) * size, src_size));
+    }
+
+    *begin = pos + static_cast<int>(t_begin);
+    *end = pos + static_cast<int>(t_end);
+
+    return t_begin < t_end;
+}
+
+/*
+    Draws the w x h pixels of `src` at (sx, sy) to `dst` at (dx, dy), both
+    regions being already clipped. REPLACE copies the rows as raw bytes, or
+    converts them when the formats differ. The other modes blend the rows
+    in place when the destination is 8-bit RGBA or BGRA, whose channels are
+    then treated alike as long as the source is in the same byte order, and
+    decode the destination otherwise.
+
+    When both regions share memory, rows and runs are processed sequentially,
+    in the order that reads every source pixel before it is overwritten.
+*/
+void draw_unscaled(const bpx::ImageView& dst, int dx, int dy, const bpx::ConstImageView& src, int sx, int sy,
+                   int w, int h, bpx::BlendMode mode, const bpx::ExecutionPolicy& policy)
+{
+    using bpx::PixelFormat;
+
+    const PixelFormat src_format = src.format();
+    const PixelFormat dst_format = dst.format();
+    const size_t src_bpp = bpx::pixel_size(src_format);
+    const size_t dst_bpp = bpx::pixel_size(dst_format);
+
+    const uint8_t* src_first = static_cast<const uint8_t*>(src.pixel(sx, sy));
+    const uint8_t* src_last = static_cast<const uint8_t*>(src.pixel(sx, sy + h - 1)) + w * src_bpp;
+    const uint8_t* dst_first = static_cast<const uint8_t*>(dst.pixel(dx, dy));
+    const uint8_t* dst_last = static_cast<const uint8_t*>(dst.pixel(dx, dy + h - 1)) + w * dst_bpp;
+    const bool overlap = src_first < dst_last && dst_first < src_last;
+    const bool backward = overlap && dst_first > src_first;
+
+    const auto for_each_row = [&](auto&& func) {
+        if (!overlap) {
+            bpx::detail::parallel_rows(policy, 0, h, w, [&](int j_begin, int j_end) {
+                for (int j = j_begin; j < j_end; j++) func(j);
+            });
+        } else if (backward) {
+            for (int j = h - 1; j >= 0; j--) func(j);
+        } else {
+            for (int j = 0; j < h; j++) func(j);
+        }
+    };
+
+    const auto for_each_chunk = [&](auto&& func) {
+        const int last = ((w - 1) / ROW_CHUNK) * ROW_CHUNK;
+        for (int i = 0; i <= last; i += ROW_CHUNK) {
+            const int x = backward ? last - i : i;
+            func(x, std::min(ROW_CHUNK, w - x));
+        }
+    };
+
+    if (mode == bpx::BlendMode::REPLACE) {
+        if (src_format == dst_format) {
+            for_each_row([&](int j) {
+                std::memmove(dst.pixel(dx, dy + j), src.pixel(sx, sy + j), w * src_bpp);
+            });
+        } else {
+            for_each_row([&](int j) {
+                bpx::convert_pixels(src_format, src.pixel(sx, sy + j), dst_format, dst.pixel(dx, dy + j), w);
+            });
+        }
+        return;
+    }
+
+    if (dst_format == PixelFormat::RGBA_U8 || dst_format == PixelFormat::BGRA_U8) {
+        const bool same_format = (src_format == dst_format);
+        for_each_row([&](int j) {
+            bpx::Color* colors = static_cast<bpx::Color*>(dst.pixel(dx, dy + j));
+            const uint8_t* pixels = static_cast<const uint8_t*>(src.pixel(sx, sy + j));
+            if (same_format && !overlap) {
+                bpx::blend_span(colors, reinterpret_cast<const bpx::Color*>(pixels), w, mode);
+                return;
+            }
+            for_each_chunk([&](int x, int count) {
+                bpx::Color buffer[ROW_CHUNK];
+                bpx::convert_pixels(src_format, pixels + x * src_bpp, dst_format, buffer, count);
+                bpx::blend_span(colors + x, buffer, count, mode);
+            });
+        });
+        return;
+    }
+
+    for_each_row([&](int j) {
+        for_each_chunk([&](int x, int count) {
+            bpx::Color colors[ROW_CHUNK], buffer[ROW_CHUNK];
+            src.read_row(sx + x, sy + j, buffer, count);
+            dst.read_row(dx + x, dy + j, colors, count);
+            bpx::blend_span(colors, buffer, count, mode);
+            dst.write_row(dx + x, dy + j, colors, count);
+        });
+    });
+}
+
+/*
+    Draws `src` resampled with separable filter weights to the destination
+    pixels starting at (dx, dy), one row per vertical weight. The source is
+    read from (sx, sy), `src_w` pixels wide, which the column indices are
+    relative to. Each band of rows keeps the horizontally filtered source
+    rows needed by its current destination row, so that every source row
+    is decoded and filtered once per band however many rows sample it.
+*/
+void draw_filtered(const bpx::ImageView& dst, int dx, int dy, const bpx::ConstImageView& src, int sx, int sy,
+                   int src_w, const bpx::detail::FilterWeights& columns, const bpx::detail::FilterWeights& rows,
+                   bpx::BlendMode mode, const bpx::ExecutionPolicy& policy)
+{
+    const int w = static_cast<int>(columns.indices.size() / columns.taps);
+    const int h = static_cast<int>(rows.indices.size() / rows.taps);
+    const int taps = rows.taps;
+
+    const size_t comp = bpx::pixel_comp(src.format());
+    const bool weight_alpha = src.alpha_mode() == bpx::AlphaMode::STRAIGHT && (comp == 2 || comp == 4);
+
+    bpx::detail::parallel_rows(policy, 0, h, w, [&](int j_begin, int j_end) {
+        std::vector<bpx::Color> src_row(src_w), colors(w);
+        std::vector<int32_t> filtered(static_cast<size_t>(taps) * w * 4);
+        std::vector<int> filtered_y(taps, -1);
+        std::vector<const int32_t*> inputs(taps);
+
+        for (int j = j_begin; j < j_end; j++) {
+            const int* indices = rows.indices.data() + static_cast<size_t>(j) * taps;
+
+            for (int k = 0; k < taps; k++) {
+                int slot = static_cast<int>(std::find(filtered_y.begin(), filtered_y.end(), indices[k]) - filtered_y.begin());
+                if (slot == taps) {
+                    // Reuse a slot holding a row that this destination row does not need
+                    slot = 0;
+                    while (std::find(indices, indices + taps, filtered_y[slot]) != indices + taps) {
+                        slot++;
+                    }
+                    src.read_row(sx, sy + indices[k], src_row.data(), src_w);
+                    if (weight_alpha) {
+                        bpx::premultiply_span(src_row.data(), src_w);
+                    }
+                    bpx::detail::filter_horizontal(src_row.data(), columns, filtered.data() + static_cast<size_t>(slot) * w * 4);
+                    filtered_y[slot] = indices[k];
+                }
+                inputs[k] = filtered.data() + static_cast<size_t>(slot) * w * 4;
+            }
+
+            bpx::detail::filter_vertical(inputs.data(), rows.weights.data() + static_cast<size_t>(j) * taps, taps, colors.data(), w);
+            if (weight_alpha) {
+                bpx::unpremultiply_span(colors.data(), w);
+            }
+
+            if (mode == bpx::BlendMode::REPLACE) {
+                dst.write_row(dx, dy + j, colors.data(), w);
+            } else if (dst.format() == bpx::PixelFormat::RGBA_U8) {
+                bpx::blend_span(static_cast<bpx::Color*>(dst.pixel(dx, dy + j)), colors.data(), w, mode);
+            } else {
+                for (int x = 0; x < w; x += ROW_CHUNK) {
+                    const int count = std::min(ROW_CHUNK, w - x);
+                    bpx::Color buffer[ROW_CHUNK];
+                    dst.read_row(dx + x, dy + j, buffer, count);
+                    bpx::blend_span(buffer, colors.data() + x, count, mode);
+                    dst.write_row(dx + x, dy + j, buffer, count);
+                }
+            }
+        }
+    });
+}
 
-void map(Image& image, int x_start, int y_start, int width, int height, const Image::Mapper& mapper)
+/*
+    Resizes an image of a packed format through 32-bit floats, its channels
+    being expanded and quantized exactly: going through 8-bit colors would
+    lose a step of the 5-bit channels even when nothing is filtered.
+*/
+bpx::Image resize_packed(const bpx::ConstImageView& image, int new_w, int new_h, bpx::Filter filter,
+                         bpx::EdgeMode edge, const bpx::ExecutionPolicy& policy)
 {
-    x_start = std::clamp(x_start, 0, image.width());
-    y_start = std::clamp(y_start, 0, image.height());
+    using bpx::PixelFormat;
+
+    const bpx::detail::PackedLayout packed = bpx::detail::packed_layout(image.format());
+    const int comp = packed.bits[3] ? 4 : 3;
+
+    bpx::Image expanded = allocate(image.width(), image.height(), comp == 4 ? PixelFormat::RGBA_F32 : PixelFormat::RGB_F32);
+    expanded.set_alpha_mode(image.alpha_mode());
+    const bpx::ImageView wide(expanded);
+    bpx::detail::parallel_rows(policy, 0, image.height(), image.width(), [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; y++) {
+            bpx::detail::expand_packed(packed, static_cast<const uint16_t*>(image.row(y)),
+                                       static_cast<float*>(wide.row(y)), image.width(), comp);
+        }
+    });
 
-    int x_end = std::min(x_start + width, image.width());
-    int y_end = std::min(y_start + height, image.height());
+    const bpx::Image resized = bpx::resize(expanded, new_w, new_h, filter, edge, policy);
+    const bpx::ConstImageView src(resized);
 
-    for (int y = y_start; y < y_end; y++) {
-        for (int x = x_start; x < x_end; x++) {
-            size_t offset = y * image.width() + x;
-            Color color = mapper(x, y, image.get_unsafe(offset));
-            image.set_unsafe(offset, color);
+    bpx::Image result = allocate(new_w, new_h, image.format());
+    result.set_alpha_mode(image.alpha_mode());
+    const bpx::ImageView dst(result);
+    bpx::detail::parallel_rows(policy, 0, new_h, new_w, [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; y++) {
+            bpx::detail::quantize_packed(packed, static_cast<const float*>(src.row(y)),
+                                         static_cast<uint16_t*>(dst.row(y)), new_w, comp);
         }
+    });
+
+    return result;
+}
+
+/*
+    Gives the channel layout and the data type of a format for the resizer.
+    Straight alpha is weighted by the resizer itself, premultiplied alpha
+    layouts are filtered as is. Returns false for the packed formats.
+*/
+bool resize_layout(bpx::PixelFormat format, bpx::AlphaMode alpha, stbir_pixel_layout* layout, stbir_datatype* type)
+{
+    using bpx::PixelFormat;
+
+    const bool premultiplied = (alpha == bpx::AlphaMode::PREMULTIPLIED);
+
+    switch (format) {
+        case PixelFormat::L_U8:
+        case PixelFormat::L_F16:
+        case PixelFormat::L_F32:
+            *layout = STBIR_1CHANNEL;
+            break;
+        case PixelFormat::LA_U8:
+        case PixelFormat::LA_F16:
+        case PixelFormat::LA_F32:
+            *layout = premultiplied ? STBIR_RA_PM : STBIR_RA;
+            break;
+        case PixelFormat::RGB_U8:
+        case PixelFormat::RGB_F16:
+        case PixelFormat::RGB_F32:
+            *layout = STBIR_RGB;
+            break;
+        case PixelFormat::BGR_U8:
+        case PixelFormat::BGR_F16:
+        case PixelFormat::BGR_F32:
+            *layout = STBIR_BGR;
+            break;
+        case PixelFormat::RGBA_U8:
+        case PixelFormat::RGBA_F16:
+        case PixelFormat::RGBA_F32:
+            *layout = premultiplied ? STBIR_RGBA_PM : STBIR_RGBA;
+            break;
+        case PixelFormat::BGRA_U8:
+        case PixelFormat::BGRA_F16:
+        case PixelFormat::BGRA_F32:
+            *layout = premultiplied ? STBIR_BGRA_PM : STBIR_BGRA;
+            break;
+        default:
+            return false;
     }
+
+    switch (format) {
+        case PixelFormat::L_F16:
+        case PixelFormat::LA_F16:
+        case PixelFormat::RGB_F16:
+        case PixelFormat::BGR_F16:
+        case PixelFormat::RGBA_F16:
+        case PixelFormat::BGRA_F16:
+            *type = STBIR_TYPE_HALF_FLOAT;
+            break;
+        case PixelFormat::L_F32:
+        case PixelFormat::LA_F32:
+        case PixelFormat::RGB_F32:
+        case PixelFormat::BGR_F32:
+        case PixelFormat::RGBA_F32:
+        case PixelFormat::BGRA_F32:
+            *type = STBIR_TYPE_FLOAT;
+            break;
+        default:
+            *type = STBIR_TYPE_UINT8;
+            break;
+    }
+
+    return true;
 }
 
-void fill(Image& image, Color color)
+stbir_filter resize_filter(bpx::Filter filter)
 {
-    const size_t size = image.size();
-    for (size_t i = 0; i < size; i++) {
-        image.set_unsafe(i, color);
+    switch (filter) {
+        case bpx::Filter::NEAREST:  return STBIR_FILTER_POINT_SAMPLE;
+        case bpx::Filter::BILINEAR: return STBIR_FILTER_TRIANGLE;
+        case bpx::Filter::BICUBIC:  return STBIR_FILTER_CATMULLROM;
+        case bpx::Filter::BOX:      return STBIR_FILTER_BOX;
     }
+    return STBIR_FILTER_DEFAULT;
 }
 
-void point(Image& image, int x, int y, Color color, BlendMode mode)
+} // namespace anonymous
+
+
+/* Implementation */
+
+namespace bpx {
+
+void map(ImageView image, const Image::Mapper& mapper, ExecutionPolicy policy)
 {
-    image.set(x, y, blend(image.get(x, y), color, mode));
+    map(image, 0, 0, image.width(), image.height(), mapper, policy);
 }
 
-void line(Image& image, int x1, int y1, int x2, int y2, Color color, BlendMode mode)
+void map(ImageView image, int x_start, int y_start, int width, int height, const Image::Mapper& mapper,
+         ExecutionPolicy policy)
 {
-    PF_LINE_TRAVEL({
-        image.set_unsafe(offset, blend(image.get_unsafe(offset), color, mode));
-    })
+    int xmin, ymin, xmax, ymax;
+    clip_rect(image, x_start, y_start, width, height, &xmin, &ymin, &xmax, &ymax);
+
+    transform_rows(image, xmin, ymin, xmax, ymax, [&](Color* colors, int count, int x, int y) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = mapper(x + i, y, colors[i]);
+        }
+    }, policy);
 }
 
-void line(Image& image, int x1, int y1, int x2, int y2, const Image::Mapper& mapper)
+void fill(ImageView image, Color color, ExecutionPolicy policy)
 {
-    PF_LINE_TRAVEL({
-        image.set_unsafe(offset, mapper(x, y, image.get_unsafe(offset)));
+    if (image.width() <= 0 || image.height() <= 0) {
+        return;
+    }
+
+    // Encode the first row, then replicate its bytes over the other rows
+
+    Color buffer[ROW_CHUNK];
+    std::fill_n(buffer, ROW_CHUNK, color);
+
+    for (int x = 0; x < image.width(); x += ROW_CHUNK) {
+        image.write_row(x, 0, buffer, std::min(ROW_CHUNK, image.width() - x));
+    }
+
+    const size_t row_size = image.row_size();
+    const void* first_row = image.row(0);
+
+    detail::parallel_rows(policy, 1, image.height(), image.width(), [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; y++) {
+            std::memcpy(image.row(y), first_row, row_size);
+        }
     });
 }
 
-void line(Image& image, int x1, int y1, int x2, int y2, int thick, Color color, BlendMode mode)
+/* Clipped drawing */
+
+namespace detail {
+
+void point(const ImageView& image, const Clip& clip, int x, int y, Color color, BlendMode mode)
 {
-    PF_LINE_THICK_TRAVEL({
-        line(image, x1, y1, x2, y2, color, mode);
+    if (x >= clip.x0 && x < clip.x1 && y >= clip.y0 && y < clip.y1) {
+        image.set_unsafe(x, y, blend(image.get_unsafe(x, y), color, mode));
+    }
+}
+
+void line(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, Color color, BlendMode mode)
+{
+    const SolidSpan span(image, color, mode);
+    line_runs(image, clip, x1, y1, x2, y2, 0, [&](const LineRun& run) {
+        span(run.y, run.x0, run.x1);
+    });
+}
+
+void line(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, const Image::Mapper& mapper)
+{
+    line_runs(image, clip, x1, y1, x2, y2, 0, [&](const LineRun& run) {
+        map_span(image, run.y, run.x0, run.x1, mapper);
     });
 }
 
-void line(Image& image, int x1, int y1, int x2, int y2, int thick, const Image::Mapper& mapper)
+void line(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, int thick,
+          Color color, BlendMode mode)
 {
-    PF_LINE_THICK_TRAVEL({
-        line(image, x1, y1, x2, y2, mapper);
+    const SolidSpan span(image, color, mode);
+    line_runs(image, clip, x1, y1, x2, y2, line_half_width(x2 - x1, y2 - y1, thick), [&](const LineRun& run) {
+        span(run.y, run.x0, run.x1);
     });
 }
 
-void line_gradient(Image& image, int x1, int y1, int x2, int y2, const ColorRamp& ramp, BlendMode mode)
+void line(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, int thick,
+          const Image::Mapper& mapper)
 {
-    PF_LINE_TRAVEL({
-        image.set_unsafe(offset, blend(image.get_unsafe(offset), ramp.get(static_cast<float>(i) / end), mode));
+    line_runs(image, clip, x1, y1, x2, y2, line_half_width(x2 - x1, y2 - y1, thick), [&](const LineRun& run) {
+        map_span(image, run.y, run.x0, run.x1, mapper);
     });
 }
 
-void line_gradient(Image& image, int x1, int y1, int x2, int y2, int thick, const ColorRamp& ramp, BlendMode mode)
+void line_gradient(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2,
+                   const ColorRamp& ramp, BlendMode mode)
 {
-    PF_LINE_THICK_TRAVEL({
-        line_gradient(image, x1, y1, x2, y2, ramp, mode);
+    line_runs(image, clip, x1, y1, x2, y2, 0, [&](const LineRun& run) {
+        line_gradient_run(image, run, ramp, mode);
     });
 }
 
-void rectangle(Image& image, int x, int y, int w, int h, Color color, BlendMode mode)
+void line_gradient(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, int thick,
+                   const ColorRamp& ramp, BlendMode mode)
 {
-    int xmin = std::clamp(x, 0, image.width() - 1);
-    int ymin = std::clamp(y, 0, image.height() - 1);
-    int xmax = std::clamp(x + w, 0, image.width() - 1);
-    int ymax = std::clamp(y + h, 0, image.height() - 1);
+    line_runs(image, clip, x1, y1, x2, y2, line_half_width(x2 - x1, y2 - y1, thick), [&](const LineRun& run) {
+        line_gradient_run(image, run, ramp, mode);
+    });
+}
 
-    if (xmin > xmax) std::swap(xmin, xmax);
-    if (ymin > ymax) std::swap(ymin, ymax);
+void rectangle(const ImageView& image, const Clip& clip, int x, int y, int w, int h, Color color, BlendMode mode)
+{
+    int xmin, ymin, xmax, ymax;
+    clip_rect(image, x, y, w, h, &xmin, &ymin, &xmax, &ymax);
+    if (!clip_to(clip, &xmin, &ymin, &xmax, &ymax)) {
+        return;
+    }
 
-    for (y = ymin; y < ymax; y++) {
-        for (x = xmin; x < xmax; x++) {
-            image.set_unsafe(x, y, blend(image.get_unsafe(x, y), color, mode));
-        }
+    const SolidSpan span(image, color, mode);
+    for (int row = ymin; row < ymax; row++) {
+        span(row, xmin, xmax);
     }
 }
 
-void rectangle(Image& image, int x, int y, int w, int h, const Image::Mapper& mapper)
+void rectangle(const ImageView& image, const Clip& clip, int x, int y, int w, int h, const Image::Mapper& mapper)
 {
-    int xmin = std::clamp(x, 0, image.width() - 1);
-    int ymin = std::clamp(y, 0, image.height() - 1);
-    int xmax = std::clamp(x + w, 0, image.width() - 1);
-    int ymax = std::clamp(y + h, 0, image.height() - 1);
-
-    if (xmin > xmax) std::swap(xmin, xmax);
-    if (ymin > ymax) std::swap(ymin, ymax);
+    int xmin, ymin, xmax, ymax;
+    clip_rect(image, x, y, w, h, &xmin, &ymin, &xmax, &ymax);
+    if (!clip_to(clip, &xmin, &ymin, &xmax, &ymax)) {
+        return;
+    }
 
-    for (y = ymin; y < ymax; y++) {
-        for (x = xmin; x < xmax; x++) {
-            image.set_unsafe(x, y, mapper(x, y, image.get_unsafe(x, y)));
+    transform_rows(image, xmin, ymin, xmax, ymax, [&](Color* colors, int count, int x, int y) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = mapper(x + i, y, colors[i]);
         }
-    }
+    });
 }
 
-void rectangle_gradient_linear(Image& image, int x, int y, int w, int h,
+void rectangle_gradient_linear(const ImageView& image, const Clip& clip, int x, int y, int w, int h,
                                int x_start, int y_start, int x_end, int y_end,
                                const ColorRamp& ramp, BlendMode mode)
 {
-    int xmin = std::clamp(x, 0, image.width() - 1);
-    int ymin = std::clamp(y, 0, image.height() - 1);
-    int xmax = std::clamp(x + w, 0, image.width() - 1);
-    int ymax = std::clamp(y + h, 0, image.height() - 1);
-
-    if (xmin > xmax) std::swap(xmin, xmax);
-    if (ymin > ymax) std::swap(ymin, ymax);
+    int xmin, ymin, xmax, ymax;
+    clip_rect(image, x, y, w, h, &xmin, &ymin, &xmax, &ymax);
+    if (!clip_to(clip, &xmin, &ymin, &xmax, &ymax)) {
+        return;
+    }
 
     float dx = x_end - x_start;
     float dy = y_end - y_start;
     float max_distance = std::sqrt(dx * dx + dy * dy);
 
-    for (y = ymin; y < ymax; y++) {
-        for (x = xmin; x < xmax; x++) {
-            float current_dx = x - x_start;
+    transform_rows(image, xmin, ymin, xmax, ymax, [&](Color* colors, int count, int x, int y) {
+        Color gradient[ROW_CHUNK];
+        for (int i = 0; i < count; i++) {
+            float current_dx = x + i - x_start;
             float current_dy = y - y_start;
             float distance = (current_dx * dx + current_dy * dy) / max_distance;
             float t = std::clamp(distance / max_distance, 0.0f, 1.0f);
-            image.set_unsafe(x, y, ramp.get(t));
+            gradient[i] = ramp.get(t);
         }
-    }
+        blend_span(colors, gradient, count, mode);
+    });
 }
 
-void rectangle_gradient_radial(Image& image, int x, int y, int w, int h,
+void rectangle_gradient_radial(const ImageView& image, const Clip& clip, int x, int y, int w, int h,
                                int x_start, int y_start, int x_end, int y_end,
                                const ColorRamp& ramp, BlendMode mode)
 {
-    int xmin = std::clamp(x, 0, image.width() - 1);
-    int ymin = std::clamp(y, 0, image.height() - 1);
-    int xmax = std::clamp(x + w, 0, image.width() - 1);
-    int ymax = std::clamp(y + h, 0, image.height() - 1);
-
-    if (xmin > xmax) std::swap(xmin, xmax);
-    if (ymin > ymax) std::swap(ymin, ymax);
+    int xmin, ymin, xmax, ymax;
+    clip_rect(image, x, y, w, h, &xmin, &ymin, &xmax, &ymax);
+    if (!clip_to(clip, &xmin, &ymin, &xmax, &ymax)) {
+        return;
+    }
 
     float max_distance = std::sqrt(
         (x_end - x_start) * (x_end - x_start) + 
         (y_end - y_start) * (y_end - y_start)
     );
 
-    for (y = ymin; y < ymax; y++) {
-        for (x = xmin; x < xmax; x++) {
-            float dx = x - x_start;
+    transform_rows(image, xmin, ymin, xmax, ymax, [&](Color* colors, int count, int x, int y) {
+        Color gradient[ROW_CHUNK];
+        for (int i = 0; i < count; i++) {
+            float dx = x + i - x_start;
             float dy = y - y_start;
             float distance = std::sqrt(dx * dx + dy * dy);
             float t = std::clamp(distance / max_distance, 0.0f, 1.0f);
-            image.set_unsafe(x, y, ramp.get(t));
+            gradient[i] = ramp.get(t);
         }
-    }
+        blend_span(colors, gradient, count, mode);
+    });
 }
 
-void rectangle_lines(Image& image, int x, int y, int w, int h, Color color, BlendMode mode)
+void circle(const ImageView& image, const Clip& clip, int cx, int cy, int radius, Color color, BlendMode mode)
 {
-    line(image, x, y, x + w, y, color, mode);
-    line(image, x + w, y, x + w, y + h, color, mode);
-    line(image, x + w, y + h, x, y + h, color, mode);
-    line(image, x, y + h, x, y, color, mode);
+    const SolidSpan span(image, color, mode);
+    circle_spans(cx, cy, radius, clip.x0, clip.y0, clip.x1, clip.y1, span);
 }
 
-void rectangle_lines(Image& image, int x, int y, int w, int h, const Image::Mapper& mapper)
+void circle(const ImageView& image, const Clip& clip, int cx, int cy, int radius, const Image::Mapper& mapper)
 {
-    line(image, x, y, x + w, y, mapper);
-    line(image, x + w, y, x + w, y + h, mapper);
-    line(image, x + w, y + h, x, y + h, mapper);
-    line(image, x, y + h, x, y, mapper);
+    circle_spans(cx, cy, radius, clip.x0, clip.y0, clip.x1, clip.y1, [&](int y, int x0, int x1) {
+        map_span(image, y, x0, x1, mapper);
+    });
 }
 
-void rectangle_lines(Image& image, int x, int y, int w, int h, int thick, Color color, BlendMode mode)
+void circle_gradient(const ImageView& image, const Clip& clip, int cx, int cy, int radius,
+                     const ColorRamp& ramp, BlendMode mode)
 {
-    line(image, x, y, x + w, y, thick, color, mode);
-    line(image, x + w, y, x + w, y + h, thick, color, mode);
-    line(image, x + w, y + h, x, y + h, thick, color, mode);
-    line(image, x, y + h, x, y, thick, color, mode);
+    const float inv_radius = (radius > 0) ? 1.0f / radius : 0.0f;
+
+    circle_spans(cx, cy, radius, clip.x0, clip.y0, clip.x1, clip.y1, [&](int y, int x0, int x1) {
+        const float dy = static_cast<float>(y - cy);
+        Color colors[ROW_CHUNK];
+        for (int x = x0; x < x1; x += ROW_CHUNK) {
+            const int count = std::min(ROW_CHUNK, x1 - x);
+            for (int i = 0; i < count; i++) {
+                const float dx = static_cast<float>(x + i - cx);
+                colors[i] = ramp.get(std::min(std::sqrt(dx * dx + dy * dy) * inv_radius, 1.0f));
+            }
+            blend_colors(image, x, y, colors, count, mode);
+        }
+    });
 }
 
-void rectangle_lines(Image& image, int x, int y, int w, int h, int thick, const Image::Mapper& mapper)
+void circle_lines(const ImageView& image, const Clip& clip, int cx, int cy, int radius,
+                  Color color, BlendMode mode)
 {
-    line(image, x, y, x + w, y, thick, mapper);
-    line(image, x + w, y, x + w, y + h, thick, mapper);
-    line(image, x + w, y + h, x, y + h, thick, mapper);
-    line(image, x, y + h, x, y, thick, mapper);
+    const SolidSpan span(image, color, mode);
+    circle_outline_spans(cx, cy, radius, clip.x0, clip.y0, clip.x1, clip.y1, span);
 }
 
-void circle(Image& image, int cx, int cy, int radius, Color color, BlendMode mode)
+void circle_lines(const ImageView& image, const Clip& clip, int cx, int cy, int radius,
+                  const Image::Mapper& mapper)
 {
-    PF_CIRCLE_TRAVEL({
-        image.set_unsafe(offset, blend(image.get_unsafe(offset), color, mode));
-    })
+    circle_outline_spans(cx, cy, radius, clip.x0, clip.y0, clip.x1, clip.y1, [&](int y, int x0, int x1) {
+        map_span(image, y, x0, x1, mapper);
+    });
 }
 
-void circle(Image& image, int cx, int cy, int radius, const Image::Mapper& mapper)
+void circle_lines(const ImageView& image, const Clip& clip, int cx, int cy, int radius, int thick,
+                  Color color, BlendMode mode)
 {
-    PF_CIRCLE_TRAVEL({
-        image.set_unsafe(offset, mapper(x, y, image.get_unsafe(offset)));
-    })
+    const SolidSpan span(image, color, mode);
+    ring_spans(cx, cy, radius + ring_outside(thick), radius - ring_inside(thick),
+               clip.x0, clip.y0, clip.x1, clip.y1, span);
 }
 
-void circle_gradient(Image& image, int cx, int cy, int radius, Color c1, Color c2, BlendMode mode)
+void circle_lines(const ImageView& image, const Clip& clip, int cx, int cy, int radius, int thick,
+                  const Image::Mapper& mapper)
 {
-    PF_CIRCLE_TRAVEL_EX(
-        { image.set_unsafe(offset, blend(image.get_unsafe(offset), lerp(c1, c2, sqrtf((i - cx) * (i - cx) + (cy + y - cy) * (cy + y - cy)) / radius), mode)); },
-        { image.set_unsafe(offset, blend(image.get_unsafe(offset), lerp(c1, c2, sqrtf((i - cx) * (i - cx) + (cy - y - cy) * (cy - y - cy)) / radius), mode)); },
-        { image.set_unsafe(offset, blend(image.get_unsafe(offset), lerp(c1, c2, sqrtf((i - cx) * (i - cx) + (cy + x - cy) * (cy + x - cy)) / radius), mode)); },
-        { image.set_unsafe(offset, blend(image.get_unsafe(offset), lerp(c1, c2, sqrtf((i - cx) * (i - cx) + (cy - x - cy) * (cy - x - cy)) / radius), mode)); }
-    );
+    ring_spans(cx, cy, radius + ring_outside(thick), radius - ring_inside(thick),
+               clip.x0, clip.y0, clip.x1, clip.y1, [&](int y, int x0, int x1) {
+        map_span(image, y, x0, x1, mapper);
+    });
 }
 
-void circle_lines(Image& image, int cx, int cy, int radius, Color color, BlendMode mode)
+void rectangle_lines(const ImageView& image, const Clip& clip, int x, int y, int w, int h, int thick,
+                     Color color, BlendMode mode)
 {
-    PF_CIRCLE_LINE_TRAVEL({
-        image.set_unsafe(offset, blend(image.get_unsafe(offset), color, mode));
-    });
+    const SolidSpan span(image, color, mode);
+    rect_outline_spans(std::min(x, x + w), std::min(y, y + h), std::max(x, x + w), std::max(y, y + h),
+                       rect_outline_half(thick), clip.x0, clip.y0, clip.x1, clip.y1, span);
 }
 
-void circle_lines(Image& image, int cx, int cy, int radius, const Image::Mapper& mapper)
+void rectangle_lines(const ImageView& image, const Clip& clip, int x, int y, int w, int h, int thick,
+                     const Image::Mapper& mapper)
 {
-    PF_CIRCLE_LINE_TRAVEL({
-        image.set_unsafe(offset, mapper(x, y, image.get_unsafe(offset)));
+    rect_outline_spans(std::min(x, x + w), std::min(y, y + h), std::max(x, x + w), std::max(y, y + h),
+                       rect_outline_half(thick), clip.x0, clip.y0, clip.x1, clip.y1, [&](int y, int x0, int x1) {
+        map_span(image, y, x0, x1, mapper);
     });
 }
 
-void circle_lines(Image& image, int cx, int cy, int radius, int thick, Color color, BlendMode mode)
+void draw(const ImageView& dst, const Clip& clip, int x_dst, int y_dst, int w_dst, int h_dst,
+          const ConstImageView& src, int x_src, int y_src, int w_src, int h_src,
+          BlendMode mode, Filter filter, const ExecutionPolicy& policy)
 {
-    int ht = thick/2;
-    for (int i = -ht; i <= ht; ++i) {
-        circle_lines(image, cx, cy, radius + i, color, mode);
+    if (w_dst <= 0 || h_dst <= 0 || w_src <= 0 || h_src <= 0) {
+        return;
+    }
+
+    // Clip once: only the destination pixels inside `dst` that sample a pixel inside `src` are drawn
+
+    int x_begin, x_end, y_begin, y_end;
+    if (!clip_draw_axis(x_dst, w_dst, x_src, w_src, dst.width(), src.width(), &x_begin, &x_end) ||
+        !clip_draw_axis(y_dst, h_dst, y_src, h_src, dst.height(), src.height(), &y_begin, &y_end) ||
+        !clip_to(clip, &x_begin, &y_begin, &x_end, &y_end)) {
+        return;
+    }
+
+    if (w_dst == w_src && h_dst == h_src) {
+        draw_unscaled(dst, x_begin, y_begin, src, x_begin - x_dst + x_src, y_begin - y_dst + y_src,
+                      x_end - x_begin, y_end - y_begin, mode, policy);
+        return;
+    }
+
+    // A scaled source is read over several destination rows, so pixels it shares with the
+    // destination would be read after being drawn over: the source area is copied first
+
+    const int src_x_lo = std::max(x_src, 0), src_x_hi = std::min(x_src + w_src, src.width());
+    const int src_y_lo = std::max(y_src, 0), src_y_hi = std::min(y_src + h_src, src.height());
+
+    const uint8_t* src_first = static_cast<const uint8_t*>(src.pixel(src_x_lo, src_y_lo));
+    const uint8_t* src_last = static_cast<const uint8_t*>(src.pixel(src_x_hi - 1, src_y_hi - 1)) + pixel_size(src.format());
+    const uint8_t* dst_first = static_cast<const uint8_t*>(dst.pixel(x_begin, y_begin));
+    const uint8_t* dst_last = static_cast<const uint8_t*>(dst.pixel(x_end - 1, y_end - 1)) + pixel_size(dst.format());
+    if (src_first < dst_last && dst_first < src_last) {
+        const Image area = bpx::copy(src.sub(src_x_lo, src_y_lo, src_x_hi - src_x_lo, src_y_hi - src_y_lo));
+        draw(dst, clip, x_dst, y_dst, w_dst, h_dst, area, x_src - src_x_lo, y_src - src_y_lo, w_src, h_src,
+             mode, filter, policy);
+        return;
+    }
+
+    if (filter != Filter::NEAREST) {
+        const FilterWeights columns = compute_filter_weights(
+            filter, x_dst, w_dst, x_src, w_src, x_begin, x_end, src_x_lo, src_x_hi);
+        const FilterWeights rows = compute_filter_weights(
+            filter, y_dst, h_dst, y_src, h_src, y_begin, y_end, src_y_lo, src_y_hi);
+        draw_filtered(dst, x_begin, y_begin, src, src_x_lo, src_y_lo, src_x_hi - src_x_lo,
+                      columns, rows, mode, policy);
+        return;
     }
+
+    // Nearest neighbor: the source column of every destination column is computed once,
+    // and each source row is decoded once for all the destination rows sampling it
+
+    std::vector<int> columns(x_end - x_begin);
+    for (int x = x_begin; x < x_end; x++) {
+        columns[x - x_begin] = x_src + static_cast<int>(static_cast<int64_t>(x - x_dst) * w_src / w_dst);
+    }
+
+    const int src_x_begin = columns.front();
+    const int src_w = columns.back() - src_x_begin + 1;
+
+    parallel_rows(policy, y_begin, y_end, x_end - x_begin, [&](int band_begin, int band_end) {
+        std::vector<Color> src_row(src_w);
+        int last_src_y = -1;
+
+        const auto sample = [&](Color* samples, int count, int x, int y) {
+            const int src_y = y_src + static_cast<int>(static_cast<int64_t>(y - y_dst) * h_src / h_dst);
+            if (src_y != last_src_y) {
+                src.read_row(src_x_begin, src_y, src_row.data(), src_w);
+                last_src_y = src_y;
+            }
+            const int* src_x = columns.data() + (x - x_begin);
+            for (int i = 0; i < count; i++) {
+                samples[i] = src_row[src_x[i] - src_x_begin];
+            }
+        };
+
+        if (mode == BlendMode::REPLACE) {
+            generate_rows(dst, x_begin, band_begin, x_end, band_end, sample);
+            return;
+        }
+
+        transform_rows(dst, x_begin, band_begin, x_end, band_end, [&](Color* colors, int count, int x, int y) {
+            Color samples[ROW_CHUNK];
+            sample(samples, count, x, y);
+            blend_span(colors, samples, count, mode);
+        });
+    });
 }
 
-void circle_lines(Image& image, int cx, int cy, int radius, int thick, const Image::Mapper& mapper)
+} // namespace detail
+
+/* Drawing */
+
+void point(ImageView image, int x, int y, Color color, BlendMode mode)
 {
-    int ht = thick/2;
-    for (int i = -ht; i <= ht; ++i) {
-        circle_lines(image, cx, cy, radius + i, mapper);
-    }
+    detail::point(image, detail::whole(image), x, y, color, mode);
 }
 
-void draw(Image& dst, int x, int y, int w, int h, Image& src, BlendMode mode)
+void line(ImageView image, int x1, int y1, int x2, int y2, Color color, BlendMode mode)
 {
-    draw(dst, x, y, w, h, src, 0, 0, src.width(), src.height(), mode);
+    detail::line(image, detail::whole(image), x1, y1, x2, y2, color, mode);
 }
 
-void draw(Image& dst, int x_dst, int y_dst, int w_dst, int h_dst,
-          Image& src, int x_src, int y_src, int w_src, int h_src,
-          BlendMode mode)
+void line(ImageView image, int x1, int y1, int x2, int y2, const Image::Mapper& mapper)
 {
-    // Clamp destination coordinates and size
-    x_dst = std::clamp(x_dst, 0, dst.width() - 1);
-    y_dst = std::clamp(y_dst, 0, dst.height() - 1);
-    w_dst = std::clamp(w_dst, 0, dst.width() - x_dst);
-    h_dst = std::clamp(h_dst, 0, dst.height() - y_dst);
+    detail::line(image, detail::whole(image), x1, y1, x2, y2, mapper);
+}
 
-    // Clamp source coordinates and size
-    w_src = std::clamp(w_src, 0, src.width() - x_src);
-    h_src = std::clamp(h_src, 0, src.height() - y_src);
+void line(ImageView image, int x1, int y1, int x2, int y2, int thick, Color color, BlendMode mode)
+{
+    detail::line(image, detail::whole(image), x1, y1, x2, y2, thick, color, mode);
+}
 
-    const float scale_x = static_cast<float>(w_src) / w_dst;
-    const float scale_y = static_cast<float>(h_src) / h_dst;
+void line(ImageView image, int x1, int y1, int x2, int y2, int thick, const Image::Mapper& mapper)
+{
+    detail::line(image, detail::whole(image), x1, y1, x2, y2, thick, mapper);
+}
 
-    // Iterate through the destination image pixels
-    for (int y = 0; y < h_dst; y++) {
-        const int src_y = y_src + static_cast<int>(y * scale_y);
-        const int dst_y = y_dst + y;
+void line_gradient(ImageView image, int x1, int y1, int x2, int y2, const ColorRamp& ramp, BlendMode mode)
+{
+    detail::line_gradient(image, detail::whole(image), x1, y1, x2, y2, ramp, mode);
+}
 
-        for (int x = 0; x < w_dst; x++) {
-            const int src_x = x_src + static_cast<int>(x * scale_x);
-            const int dst_x = x_dst + x;
+void line_gradient(ImageView image, int x1, int y1, int x2, int y2, int thick, const ColorRamp& ramp, BlendMode mode)
+{
+    detail::line_gradient(image, detail::whole(image), x1, y1, x2, y2, thick, ramp, mode);
+}
 
-            // Ensure the source pixel coordinates are within bounds
-            if (src_x >= 0 && src_x < src.width() && src_y >= 0 && src_y < src.height() &&
-                dst_x >= 0 && dst_x < dst.width() && dst_y >= 0 && dst_y < dst.height()) {
+void rectangle(ImageView image, int x, int y, int w, int h, Color color, BlendMode mode)
+{
+    detail::rectangle(image, detail::whole(image), x, y, w, h, color, mode);
+}
 
-                Color col_src = src.get_unsafe(src_x, src_y);
-                Color col_dst = dst.get_unsafe(dst_x, dst_y);
-                dst.set_unsafe(dst_x, dst_y, blend(col_dst, col_src, mode));
-            }
-        }
-    }
+void rectangle(ImageView image, int x, int y, int w, int h, const Image::Mapper& mapper)
+{
+    detail::rectangle(image, detail::whole(image), x, y, w, h, mapper);
 }
 
-void saturation(Image& image, float factor)
+void rectangle_gradient_linear(ImageView image, int x, int y, int w, int h,
+                               int x_start, int y_start, int x_end, int y_end,
+                               const ColorRamp& ramp, BlendMode mode)
 {
-    const size_t size = image.size();
-    for (size_t i = 0; i < size; i++) {
-        Color color = image.get_unsafe(i);
-        image.set_unsafe(i, bpx::saturation(color, factor));
-    }
+    detail::rectangle_gradient_linear(image, detail::whole(image), x, y, w, h,
+                                      x_start, y_start, x_end, y_end, ramp, mode);
 }
 
-void brightness(Image& image, float factor)
+void rectangle_gradient_radial(ImageView image, int x, int y, int w, int h,
+                               int x_start, int y_start, int x_end, int y_end,
+                               const ColorRamp& ramp, BlendMode mode)
 {
-    const size_t size = image.size();
-    for (size_t i = 0; i < size; i++) {
-        Color color = image.get_unsafe(i);
-        image.set_unsafe(i, bpx::brightness(color, factor));
-    }
+    detail::rectangle_gradient_radial(image, detail::whole(image), x, y, w, h,
+                                      x_start, y_start, x_end, y_end, ramp, mode);
 }
 
-void contrast(Image& image, float factor)
+void rectangle_lines(ImageView image, int x, int y, int w, int h, Color color, BlendMode mode)
 {
-    const size_t size = image.size();
-    for (size_t i = 0; i < size; i++) {
-        Color color = image.get_unsafe(i);
-        image.set_unsafe(i, bpx::contrast(color, factor));
-    }
+    detail::rectangle_lines(image, detail::whole(image), x, y, w, h, 1, color, mode);
 }
 
-void opacity(Image& image, float alpha)
+void rectangle_lines(ImageView image, int x, int y, int w, int h, const Image::Mapper& mapper)
 {
-    const size_t size = image.size();
-    for (size_t i = 0; i < size; i++) {
-        Color color = image.get_unsafe(i);
-        image.set_unsafe(i, bpx::alpha(color, alpha));
-    }
+    detail::rectangle_lines(image, detail::whole(image), x, y, w, h, 1, mapper);
 }
 
-void invert(Image& image)
+void rectangle_lines(ImageView image, int x, int y, int w, int h, int thick, Color color, BlendMode mode)
 {
-    const size_t size = image.size();
-    for (size_t i = 0; i < size; i++) {
-        Color color = image.get_unsafe(i);
-        image.set_unsafe(i, bpx::invert(color));
-    }
+    detail::rectangle_lines(image, detail::whole(image), x, y, w, h, thick, color, mode);
 }
 
-void flip_horizontal(Image& image)
+void rectangle_lines(ImageView image, int x, int y, int w, int h, int thick, const Image::Mapper& mapper)
 {
-    size_t pitch = image.pitch();
-    std::vector<uint8_t> row_buffer(pitch);
-    for (int y = 0; y < image.height(); y++) {
-        std::memcpy(row_buffer.data(), (uint8_t*)image.data() + y * pitch, pitch);
-        for (int x = 0; x < image.width(); x++) {
-            size_t src_offset = y * image.width() + x;
-            size_t dst_offset = y * image.width() + (image.width() - x - 1);
-            if (src_offset != dst_offset) {
-                Color src_color = image.get_unsafe(src_offset);
-                image.set_unsafe(dst_offset, src_color);
-            }
-        }
-    }
+    detail::rectangle_lines(image, detail::whole(image), x, y, w, h, thick, mapper);
 }
 
-void flip_vertical(Image& image)
+void circle(ImageView image, int cx, int cy, int radius, Color color, BlendMode mode)
 {
-    size_t pitch = image.pitch();
-    for (int y = 0; y < image.height() / 2; y++) {
-        for (int x = 0; x < image.width(); x++) {
-            size_t top_offset = y * image.width() + x;
-            size_t bottom_offset = (image.height() - y - 1) * image.width() + x;
-            Color top_color = image.get_unsafe(top_offset);
-            Color bottom_color = image.get_unsafe(bottom_offset);
-            image.set_unsafe(top_offset, bottom_color);
-            image.set_unsafe(bottom_offset, top_color);
-        }
+    detail::circle(image, detail::whole(image), cx, cy, radius, color, mode);
+}
+
+void circle(ImageView image, int cx, int cy, int radius, const Image::Mapper& mapper)
+{
+    detail::circle(image, detail::whole(image), cx, cy, radius, mapper);
+}
+
+void circle_gradient(ImageView image, int cx, int cy, int radius, const ColorRamp& ramp, BlendMode mode)
+{
+    detail::circle_gradient(image, detail::whole(image), cx, cy, radius, ramp, mode);
+}
+
+void circle_lines(ImageView image, int cx, int cy, int radius, Color color, BlendMode mode)
+{
+    detail::circle_lines(image, detail::whole(image), cx, cy, radius, color, mode);
+}
+
+void circle_lines(ImageView image, int cx, int cy, int radius, const Image::Mapper& mapper)
+{
+    detail::circle_lines(image, detail::whole(image), cx, cy, radius, mapper);
+}
+
+void circle_lines(ImageView image, int cx, int cy, int radius, int thick, Color color, BlendMode mode)
+{
+    detail::circle_lines(image, detail::whole(image), cx, cy, radius, thick, color, mode);
+}
+
+void circle_lines(ImageView image, int cx, int cy, int radius, int thick, const Image::Mapper& mapper)
+{
+    detail::circle_lines(image, detail::whole(image), cx, cy, radius, thick, mapper);
+}
+
+void line_aa(ImageView image, float x1, float y1, float x2, float y2, Color color,
+             const StrokeStyle& style, BlendMode mode)
+{
+    // A single convex outline, swept without looking for overlaps
+    detail::Rasterizer rasterizer;
+    rasterizer.reset(0, 0, image.width(), image.height());
+    detail::add_line_stroke(rasterizer, Point{ x1, y1 }, Point{ x2, y2 }, style);
+    detail::fill_coverage(rasterizer, image, color, mode, false, true, true);
+}
+
+void polyline_aa(ImageView image, const Point* points, size_t count, bool closed, Color color,
+                 const StrokeStyle& style, BlendMode mode)
+{
+    detail::Rasterizer rasterizer;
+    rasterizer.reset(0, 0, image.width(), image.height());
+    detail::add_stroke(rasterizer, points, count, closed, style);
+    detail::fill_coverage(rasterizer, image, color, mode);
+}
+
+void polygon_aa(ImageView image, const Point* points, size_t count, Color color, BlendMode mode)
+{
+    detail::Rasterizer rasterizer;
+    rasterizer.reset(0, 0, image.width(), image.height());
+    rasterizer.add_polygon(points, count);
+    detail::fill_coverage(rasterizer, image, color, mode);
+}
+
+void circle_aa(ImageView image, float cx, float cy, float radius, Color color, BlendMode mode)
+{
+    detail::Rasterizer rasterizer;
+    rasterizer.reset(0, 0, image.width(), image.height());
+    detail::add_circle(rasterizer, cx, cy, radius);
+    detail::fill_coverage(rasterizer, image, color, mode, false, true, true);
+}
+
+void circle_lines_aa(ImageView image, float cx, float cy, float radius, float thick, Color color,
+                     BlendMode mode)
+{
+    const float half = 0.5f * thick;
+    if (!(half > 0.0f)) {
+        return;
     }
+
+    // The inner circle, wound the other way, cuts the hole out of the outer one
+    detail::Rasterizer rasterizer;
+    rasterizer.reset(0, 0, image.width(), image.height());
+    detail::add_circle(rasterizer, cx, cy, radius + half);
+    detail::add_circle(rasterizer, cx, cy, radius - half, true);
+    detail::fill_coverage(rasterizer, image, color, mode);
 }
 
-void rotate_90(Image& image)
+void draw(ImageView dst, int x, int y, int w, int h, ConstImageView src, BlendMode mode, Filter filter,
+          ExecutionPolicy policy)
 {
-    // Check if the image is square
-    if (image.width() == image.height()) {
-        int n = image.width();
-        
-        // Rotate in place in a quarter turn (90 degrees) for a square image
-        for (int layer = 0; layer < n / 2; layer++) {
-            int first = layer;
-            int last = n - 1 - layer;
+    draw(dst, x, y, w, h, src, 0, 0, src.width(), src.height(), mode, filter, policy);
+}
+
+void draw(ImageView dst, int x_dst, int y_dst, int w_dst, int h_dst,
+          ConstImageView src, int x_src, int y_src, int w_src, int h_src,
+          BlendMode mode, Filter filter, ExecutionPolicy policy)
+{
+    detail::draw(dst, detail::whole(dst), x_dst, y_dst, w_dst, h_dst,
+                 src, x_src, y_src, w_src, h_src, mode, filter, policy);
+}
 
-            for (int i = first; i < last; i++) {
-                int offset = i - first;
+void saturation(ImageView image, float factor, ExecutionPolicy policy)
+{
+    transform_rows(image, 0, 0, image.width(), image.height(), [factor](Color* colors, int count, int, int) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = bpx::saturation(colors[i], factor);
+        }
+    }, policy);
+}
 
-                // Save top left corner pixel
-                Color top = image.get_unsafe(first, i);
+void brightness(ImageView image, float factor, ExecutionPolicy policy)
+{
+    transform_rows(image, 0, 0, image.width(), image.height(), [factor](Color* colors, int count, int, int) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = bpx::brightness(colors[i], factor);
+        }
+    }, policy);
+}
 
-                // Move pixel from bottom left to top left
-                image.set_unsafe(first, i, image.get_unsafe(last - offset, first));
+void contrast(ImageView image, float factor, ExecutionPolicy policy)
+{
+    transform_rows(image, 0, 0, image.width(), image.height(), [factor](Color* colors, int count, int, int) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = bpx::contrast(colors[i], factor);
+        }
+    }, policy);
+}
 
-                // Move pixel from bottom right corner to bottom left corner
-                image.set_unsafe(last - offset, first, image.get_unsafe(last, last - offset));
+void opacity(ImageView image, float alpha, ExecutionPolicy policy)
+{
+    transform_rows(image, 0, 0, image.width(), image.height(), [alpha](Color* colors, int count, int, int) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = bpx::alpha(colors[i], alpha);
+        }
+    }, policy);
+}
 
-                // Move pixel from top right corner to bottom right corner
-                image.set_unsafe(last, last - offset, image.get_unsafe(i, last));
+void invert(ImageView image, ExecutionPolicy policy)
+{
+    transform_rows(image, 0, 0, image.width(), image.height(), [](Color* colors, int count, int, int) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = bpx::invert(colors[i]);
+        }
+    }, policy);
+}
 
-                // Put the saved pixel (top) at the upper right corner
-                image.set_unsafe(i, last, top);
-            }
+void premultiply(ImageView image, ExecutionPolicy policy)
+{
+    transform_alpha(image, premultiply_span, [](float* pixel, int comp) {
+        const float alpha = pixel[comp - 1];
+        for (int c = 0; c < comp - 1; c++) {
+            pixel[c] *= alpha;
         }
+    }, policy);
+}
+
+void premultiply(Image& image, ExecutionPolicy policy)
+{
+    if (image.alpha_mode() == AlphaMode::PREMULTIPLIED) {
+        return;
     }
-    else {
-        uint8_t* new_data = (uint8_t*)std::malloc(image.data_size());
-        if (new_data == nullptr) {
-            throw std::bad_alloc();
-        }
-        for (int y = 0; y < image.height(); y++) {
-            for (int x = 0; x < image.width(); x++) {
-                size_t src_offset = y * image.width() + x;
-                size_t dst_offset = (image.width() - 1 - x) * image.height() + y;
-                Color color = image.get_unsafe(src_offset);
-                new_data[dst_offset] = color;
-            }
+    premultiply(ImageView(image), policy);
+    image.set_alpha_mode(AlphaMode::PREMULTIPLIED);
+}
+
+void unpremultiply(ImageView image, ExecutionPolicy policy)
+{
+    transform_alpha(image, unpremultiply_span, [](float* pixel, int comp) {
+        const float alpha = pixel[comp - 1];
+        for (int c = 0; c < comp - 1; c++) {
+            pixel[c] = (alpha > 0.0f) ? pixel[c] / alpha : 0.0f;
         }
-        image = {
-            new_data, image.height(), image.width(),
-            image.format(), true
-        };
+    }, policy);
+}
+
+void unpremultiply(Image& image, ExecutionPolicy policy)
+{
+    if (image.alpha_mode() == AlphaMode::STRAIGHT) {
+        return;
     }
+    unpremultiply(ImageView(image), policy);
+    image.set_alpha_mode(AlphaMode::STRAIGHT);
 }
 
-void rotate_180(Image& image)
+void flip_horizontal(ImageView image)
 {
+    // Mirroring does not depend on the content, pixels are swapped as raw bytes
+    const size_t bpp = pixel_size(image.format());
+    uint8_t tmp[16];
+
     for (int y = 0; y < image.height(); y++) {
-        for (int x = 0; x < image.width(); x++) {
-            size_t src_offset = y * image.width() + x;
-            size_t dst_offset = (image.height() - 1 - y) * image.width() + (image.width() - 1 - x);
-            if (src_offset != dst_offset) {
-                Color color = image.get_unsafe(src_offset);
-                image.set_unsafe(dst_offset, color);
-            }
+        uint8_t* row = static_cast<uint8_t*>(image.row(y));
+        for (int l = 0, r = image.width() - 1; l < r; l++, r--) {
+            std::memcpy(tmp, row + l * bpp, bpp);
+            std::memcpy(row + l * bpp, row + r * bpp, bpp);
+            std::memcpy(row + r * bpp, tmp, bpp);
+        }
+    }
+}
+
+void flip_vertical(ImageView image)
+{
+    const size_t row_size = image.row_size();
+    std::vector<uint8_t> row_buffer(row_size);
+
+    for (int top = 0, bottom = image.height() - 1; top < bottom; top++, bottom--) {
+        std::memcpy(row_buffer.data(), image.row(top), row_size);
+        std::memcpy(image.row(top), image.row(bottom), row_size);
+        std::memcpy(image.row(bottom), row_buffer.data(), row_size);
+    }
+}
+
+void rotate_90(Image& image)
+{
+    const size_t bpp = pixel_size(image.format());
+    const int w = image.width(), h = image.height();
+    const uint8_t* src = static_cast<const uint8_t*>(image.data());
+
+    uint8_t* new_data = (uint8_t*)std::malloc(image.data_size());
+    if (new_data == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    // The first column of the source (read bottom-up) becomes the first row
+    for (int y = 0; y < h; y++) {
+        const uint8_t* src_row = src + y * image.pitch();
+        for (int x = 0; x < w; x++) {
+            std::memcpy(new_data + (x * h + (h - 1 - y)) * bpp, src_row + x * bpp, bpp);
         }
     }
+
+    if (image.width() == image.height()) {
+        // Keep the original buffer, the image may not own it
+        std::memcpy(image.data(), new_data, image.data_size());
+        std::free(new_data);
+        return;
+    }
+
+    const AlphaMode alpha = image.alpha_mode();
+    image = Image(new_data, h, w, image.format(), true);
+    image.set_alpha_mode(alpha);
 }
 
-Image copy(const Image& image)
+void rotate_180(ImageView image)
 {
-    return Image(image.data(), image.width(), image.height(), image.format());
+    flip_vertical(image);
+    flip_horizontal(image);
 }
 
-Image convert(const Image& image, PixelFormat new_format)
+Image copy(ConstImageView image)
 {
-    Image new_image(image.width(), image.height(), BLANK, new_format);
+    if (image.is_contiguous()) {
+        Image new_image(image.data(), image.width(), image.height(), image.format());
+        new_image.set_alpha_mode(image.alpha_mode());
+        return new_image;
+    }
+
+    Image new_image = allocate(image.width(), image.height(), image.format());
+    new_image.set_alpha_mode(image.alpha_mode());
 
-    const size_t size = image.size();
-    for (size_t i = 0; i < size; i++) {
-        Color src_color = image.get_unsafe(i);
-        new_image.set_unsafe(i, src_color);
+    const size_t row_size = image.row_size();
+    for (int y = 0; y < image.height(); y++) {
+        std::memcpy(static_cast<uint8_t*>(new_image.data()) + y * row_size, image.row(y), row_size);
     }
 
     return new_image;
 }
 
-Image resize_canvas(const Image& image, int new_w, int new_h, bool centered)
+Image convert(ConstImageView image, PixelFormat new_format, ExecutionPolicy policy)
+{
+    // Every pixel is written by the conversion, so the storage is not pre-filled
+    Image new_image = allocate(image.width(), image.height(), new_format);
+    new_image.set_alpha_mode(image.alpha_mode());
+    const ImageView dst(new_image);
+
+    detail::parallel_rows(policy, 0, image.height(), image.width(), [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; y++) {
+            convert_pixels(image.format(), image.row(y), new_format, dst.row(y), image.width());
+        }
+    });
+
+    return new_image;
+}
+
+Image resize_canvas(ConstImageView image, int new_w, int new_h)
 {
     if (new_w <= 0 || new_h <= 0) {
         throw std::invalid_argument("The new dimensions must be positive");
     }
 
     Image new_image(new_w, new_h, BLANK, image.format());
+    new_image.set_alpha_mode(image.alpha_mode());
+
+    // The content is centered, rows are copied as raw bytes
+    const int offset_x = (new_w - image.width()) / 2;
+    const int offset_y = (new_h - image.height()) / 2;
 
-    int offset_x = 0;
-    int offset_y = 0;
+    const int x_begin = std::max(0, -offset_x);
+    const int x_end = std::min(image.width(), new_w - offset_x);
+    const int y_begin = std::max(0, -offset_y);
+    const int y_end = std::min(image.height(), new_h - offset_y);
 
-    if (centered) {
-        offset_x = (new_w - image.width()) / 2;
-        offset_y = (new_h - image.height()) / 2;
+    if (x_begin >= x_end) {
+        return new_image;
     }
 
-    for (int y = 0; y < image.height(); y++) {
-        for (int x = 0; x < image.width(); x++) {
-            int new_x = x + offset_x;
-            int new_y = y + offset_y;
-            if (new_x >= 0 && new_x < new_w && new_y >= 0 && new_y < new_h) {
-                new_image.set_unsafe(new_x, new_y, image.get_unsafe(x, y));
-            }
-        }
+    const size_t bpp = pixel_size(image.format());
+    const size_t row_size = (x_end - x_begin) * bpp;
+
+    for (int y = y_begin; y < y_end; y++) {
+        const uint8_t* src = static_cast<const uint8_t*>(image.pixel(x_begin, y));
+        uint8_t* dst = static_cast<uint8_t*>(new_image.data()) + (y + offset_y) * new_image.pitch() + (x_begin + offset_x) * bpp;
+        std::memcpy(dst, src, row_size);
     }
 
     return new_image;
 }
 
-Image resize(const Image& image, int new_w, int new_h)
+Image resize(ConstImageView image, int new_w, int new_h, Filter filter, EdgeMode edge, ExecutionPolicy policy)
 {
-    int comp = -1;
-    bool is_float = false;
-    switch (image.format()) {
+    if (new_w <= 0 || new_h <= 0) {
+        throw std::invalid_argument("The new dimensions must be positive");
+    }
 
-        case PixelFormat::L_U8:
-            comp = STBIR_1CHANNEL;
-            break;
-        case PixelFormat::LA_U8:
-            comp = STBIR_2CHANNEL;
-            break;
-        case PixelFormat::RGB_U8:
-            comp = STBIR_RGB;
-            break;
-        case PixelFormat::BGR_U8:
-            comp = STBIR_BGR;
-            break;
-        case PixelFormat::RGBA_U8:
-            comp = STBIR_RGBA;
-            break;
-        case PixelFormat::BGRA_U8:
-            comp = STBIR_BGRA;
-            break;
-
-        case PixelFormat::L_F32:
-            comp = STBIR_1CHANNEL;
-            is_float = true;
-            break;
-        case PixelFormat::LA_F32:
-            comp = STBIR_2CHANNEL;
-            is_float = true;
-            break;
-        case PixelFormat::RGB_F32:
-            comp = STBIR_RGB;
-            is_float = true;
-            break;
-        case PixelFormat::BGR_F32:
-            comp = STBIR_BGR;
-            is_float = true;
-            break;
-        case PixelFormat::RGBA_F32:
-            comp = STBIR_RGBA;
-            is_float = true;
-            break;
-        case PixelFormat::BGRA_F32:
-            comp = STBIR_BGRA;
-            is_float = true;
-            break;
+    stbir_pixel_layout layout;
+    stbir_datatype type;
 
+    // Packed formats have no counterpart in the resizer, a float copy is resized and packed back
+    switch (image.format()) {
+        case PixelFormat::RGB_565:
+        case PixelFormat::BGR_565:
+        case PixelFormat::RGBA_5551:
+        case PixelFormat::BGRA_5551:
+        case PixelFormat::RGBA_4444:
+        case PixelFormat::BGRA_4444:
+            return resize_packed(image, new_w, new_h, filter, edge, policy);
         default:
+            if (!resize_layout(image.format(), image.alpha_mode(), &layout, &type)) {
+                throw std::runtime_error("Unsupported data type for resizing");
+            }
             break;
     }
 
-    if (comp == -1) {
-        throw std::runtime_error("Unsupported data type for resizing");
+    Image new_image = allocate(new_w, new_h, image.format());
+    new_image.set_alpha_mode(image.alpha_mode());
+
+    STBIR_RESIZE resize;
+    stbir_resize_init(&resize, image.data(), image.width(), image.height(), static_cast<int>(image.pitch()),
+                      new_image.data(), new_w, new_h, 0, layout, type);
+
+    const stbir_filter stbir_filter = resize_filter(filter);
+    const stbir_edge stbir_edge = static_cast<::stbir_edge>(edge);
+    stbir_set_filters(&resize, stbir_filter, stbir_filter);
+    stbir_set_edgemodes(&resize, stbir_edge, stbir_edge);
+
+    /*
+        One split of the output rows per thread, each split being big enough to be
+        worth a task. The Catmull-Rom weights make the first input row of an output
+        row go back at some rows, which the resizer does not expect at the start of
+        a split: the rows around a boundary are computed from the wrong input rows.
+        Bicubic resizes therefore run as a single split.
+    */
+    ThreadPool* pool = policy.pool();
+    const int64_t max_splits = std::max<int64_t>(1, static_cast<int64_t>(new_w) * new_h / detail::MIN_BAND_PIXELS);
+    const bool splittable = (pool != nullptr && filter != Filter::BICUBIC);
+    const int wanted = splittable ? static_cast<int>(std::min<int64_t>(pool->concurrency(), max_splits)) : 1;
+
+    const int splits = stbir_build_samplers_with_splits(&resize, wanted);
+    if (splits == 0) {
+        throw std::runtime_error("Failed to resize the image");
     }
 
-    void *new_data = nullptr;
-
-    if (is_float) {
-        new_data = stbir_resize_float_linear(
-            static_cast<const float*>(image.data()),
-            image.width(), image.height(), 0,
-            static_cast<float*>(new_data),
-            new_w, new_h, 0,
-            STBIR_1CHANNEL
-        );
+    std::atomic<bool> failed(false);
+    if (pool == nullptr || splits == 1) {
+        failed = !stbir_resize_extended_split(&resize, 0, splits);
     } else {
-        new_data = stbir_resize_uint8_linear(
-            static_cast<const uint8_t*>(image.data()),
-            image.width(), image.height(), 0,
-            static_cast<uint8_t*>(new_data),
-            new_w, new_h, 0,
-            STBIR_1CHANNEL
-        );
-    }
-
-    return {
-        new_data, new_w, new_h,
-        image.format(), true
-    };
-}
-
-bool write_png(const Image& image, const std::string& path)
-{
-    int result = stbi_write_png(path.c_str(), image.width(), image.height(),
-                                pixel_comp(image.format()), image.data(),
-                                image.pitch());
-    return result != 0;
-}
+        pool->parallel_for(0, splits, 1, [&](int split_begin, int split_end) {
+            if (!stbir_resize_extended_split(&resize, split_begin, split_end - split_begin)) {
+                failed = true;
+            }
+        });
+    }
 
-bool write_bmp(const Image& image, const std::string& path)
-{
-    int result = stbi_write_bmp(path.c_str(), image.width(), image.height(),
-                                pixel_comp(image.format()), image.data());
-    return result != 0;
-}
+    stbir_free_samplers(&resize);
 
-bool write_tga(const Image& image, const std::string& path)
-{
-    int result = stbi_write_tga(path.c_str(), image.width(), image.height(),
-                                pixel_comp(image.format()), image.data());
-    return result != 0;
-}
+    if (failed) {
+        throw std::runtime_error("Failed to resize the image");
+    }
 
-bool write_jpg(const Image& image, const std::string& path, int quality)
-{
-    int result = stbi_write_jpg(path.c_str(), image.width(), image.height(),
-                                pixel_comp(image.format()), image.data(),
-                                quality);
-    return result != 0;
+    return new_image;
 }
 
 } // namespace bpx
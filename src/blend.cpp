@@ -0,0 +1,795 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/algorithm.hpp"
+
+#include "./cpu.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+/*
+    Span blending.
+
+    Every kernel computes exactly what `bpx::blend` computes for one pixel:
+    products of channels are divided by 255 with `div255`, which vectorizes
+    as two shifts and two additions on 16-bit lanes, and the division by the
+    output alpha of `BlendMode::ALPHA` is a multiplication by a reciprocal
+    from a table, exact for every numerator the blend can produce (checked
+    exhaustively). The alpha of the destination is kept by every mode except
+    REPLACE and ALPHA, which lets the modes working channel by channel treat
+    a pixel as four identical lanes and put the alpha back afterwards.
+
+    A uniform source (filling with a solid color) is passed with a step of
+    0 and is broadcast once to a whole vector.
+
+    PREMULTIPLIED_ALPHA treats the four channels alike, alpha included, and
+    needs no division at all. The conversions between straight and
+    premultiplied alpha live here too: premultiplying is a div255 of the
+    product by the alpha, unpremultiplying uses the reciprocal table.
+*/
+
+namespace {
+
+using bpx::Color;
+using bpx::BlendMode;
+
+/* Reciprocals */
+
+/*
+    RECIPROCAL[d] = ceil(2^24 / d), so that ((n + d / 2) * RECIPROCAL[d]) >> 24
+    equals div_round(n, d) for every n in [0, 255 * d] without overflowing 32
+    bits. RECIPROCAL[0] is 0, which gives the 0 of div_round for a zero alpha.
+*/
+struct Reciprocals
+{
+    uint32_t values[256];
+
+    Reciprocals()
+    {
+        values[0] = 0;
+        for (uint32_t d = 1; d < 256; d++) {
+            values[d] = static_cast<uint32_t>(((uint64_t(1) << 24) + d - 1) / d);
+        }
+    }
+};
+
+const uint32_t* reciprocals()
+{
+    static const Reciprocals r;
+    return r.values;
+}
+
+/* Scalar kernels */
+
+template <BlendMode M>
+void blend_scalar(Color* dst, const Color* src, size_t step, size_t count)
+{
+    for (size_t i = 0; i < count; i++, src += step) {
+        dst[i] = bpx::blend(dst[i], *src, M);
+    }
+}
+
+void premultiply_scalar(Color* colors, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        colors[i] = bpx::premultiply(colors[i]);
+    }
+}
+
+void unpremultiply_scalar(Color* colors, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        colors[i] = bpx::unpremultiply(colors[i]);
+    }
+}
+
+inline uint32_t load_u32(const Color* color)
+{
+    uint32_t v;
+    std::memcpy(&v, color, sizeof(v));
+    return v;
+}
+
+/*
+    Gives the color of a uniform source. A streamed source is not read, as
+    the kernels pass it on once consumed and it may point past its end.
+*/
+inline uint32_t load_uniform(const Color* src, size_t step)
+{
+    return step ? 0 : load_u32(src);
+}
+
+/* x86 kernels */
+
+#if defined(BPX_ARCH_X86)
+
+BPX_TARGET("sse2")
+inline __m128i div255_sse2(__m128i x)
+{
+    const __m128i t = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Mode working on 16-bit lanes holding the 8-bit channels of two pixels
+template <BlendMode M>
+BPX_TARGET("sse2")
+inline __m128i blend_epu16_sse2(__m128i d, __m128i s)
+{
+    const __m128i c255 = _mm_set1_epi16(255);
+    switch (M) {
+        case BlendMode::MUL:
+            return div255_sse2(_mm_mullo_epi16(d, s));
+        case BlendMode::SCREEN:
+            return _mm_sub_epi16(c255, div255_sse2(_mm_mullo_epi16(_mm_sub_epi16(c255, d), _mm_sub_epi16(c255, s))));
+        default: // EXCLUSION
+            return div255_sse2(_mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(c255, s)),
+                                             _mm_mullo_epi16(s, _mm_sub_epi16(c255, d))));
+    }
+}
+
+// Every mode but REPLACE, ALPHA, DODGE and BURN, on four pixels
+template <BlendMode M>
+BPX_TARGET("sse2")
+inline __m128i blend4_sse2(__m128i d, __m128i s)
+{
+    __m128i r;
+    switch (M) {
+        case BlendMode::ADD:        r = _mm_adds_epu8(d, s); break;
+        case BlendMode::SUB:        r = _mm_subs_epu8(d, s); break;
+        case BlendMode::DARKEN:     r = _mm_min_epu8(d, s); break;
+        case BlendMode::LIGHTEN:    r = _mm_max_epu8(d, s); break;
+        case BlendMode::DIFFERENCE: r = _mm_or_si128(_mm_subs_epu8(d, s), _mm_subs_epu8(s, d)); break;
+        default: {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i lo = blend_epu16_sse2<M>(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+            const __m128i hi = blend_epu16_sse2<M>(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+            r = _mm_packus_epi16(lo, hi);
+            break;
+        }
+    }
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+    return _mm_or_si128(_mm_andnot_si128(alpha, r), _mm_and_si128(alpha, d));
+}
+
+template <BlendMode M>
+BPX_TARGET("sse2")
+void blend_sse2(Color* dst, const Color* src, size_t step, size_t count)
+{
+    const __m128i uniform = _mm_set1_epi32(static_cast<int>(load_uniform(src, step)));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i s = step ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) : uniform;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blend4_sse2<M>(d, s));
+    }
+
+    blend_scalar<M>(dst + i, src + i * step, step, count - i);
+}
+
+// Broadcasts the alpha of each pixel to its four 16-bit lanes
+BPX_TARGET("sse2")
+inline __m128i broadcast_alpha_sse2(__m128i v)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// Straight alpha "over" of two pixels held in 16-bit lanes
+BPX_TARGET("sse4.1")
+inline __m128i alpha_epu16_sse41(__m128i d, __m128i s, const uint32_t* rcp)
+{
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i sa = broadcast_alpha_sse2(s);
+    const __m128i da = broadcast_alpha_sse2(d);
+    const __m128i dw = div255_sse2(_mm_mullo_epi16(da, _mm_sub_epi16(c255, sa)));
+    const __m128i oa = _mm_add_epi16(sa, dw);
+    const __m128i num = _mm_add_epi16(_mm_mullo_epi16(s, sa), _mm_mullo_epi16(d, dw));
+
+    __m128i c;
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(oa, c255)) == 0xFFFF) {
+        // Opaque result, the division by the output alpha is a division by 255
+        c = div255_sse2(num);
+    } else {
+        const __m128i n = _mm_add_epi16(num, _mm_srli_epi16(oa, 1));
+        const __m128i r0 = _mm_set1_epi32(static_cast<int>(rcp[_mm_extract_epi16(oa, 0)]));
+        const __m128i r1 = _mm_set1_epi32(static_cast<int>(rcp[_mm_extract_epi16(oa, 4)]));
+        const __m128i q0 = _mm_srli_epi32(_mm_mullo_epi32(_mm_cvtepu16_epi32(n), r0), 24);
+        const __m128i q1 = _mm_srli_epi32(_mm_mullo_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(n, 8)), r1), 24);
+        c = _mm_packus_epi32(q0, q1);
+    }
+
+    return _mm_blend_epi16(c, oa, 0x88);
+}
+
+// Premultiplied "over" of two pixels held in 16-bit lanes, before saturation
+BPX_TARGET("sse2")
+inline __m128i premultiplied_epu16_sse2(__m128i d, __m128i s)
+{
+    const __m128i inv_alpha = _mm_sub_epi16(_mm_set1_epi16(255), broadcast_alpha_sse2(s));
+    return div255_sse2(_mm_mullo_epi16(d, inv_alpha));
+}
+
+BPX_TARGET("sse2")
+void blend_premultiplied_sse2(Color* dst, const Color* src, size_t step, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i uniform = _mm_set1_epi32(static_cast<int>(load_uniform(src, step)));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i s = step ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) : uniform;
+        const __m128i lo = premultiplied_epu16_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+        const __m128i hi = premultiplied_epu16_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_adds_epu8(s, _mm_packus_epi16(lo, hi)));
+    }
+
+    blend_scalar<BlendMode::PREMULTIPLIED_ALPHA>(dst + i, src + i * step, step, count - i);
+}
+
+// Multiplies the color lanes by the alpha and the alpha lane by 255, which div255 gives back
+BPX_TARGET("sse2")
+inline __m128i premultiply_epu16_sse2(__m128i c)
+{
+    const __m128i factor = _mm_or_si128(broadcast_alpha_sse2(c), _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0));
+    return div255_sse2(_mm_mullo_epi16(c, factor));
+}
+
+BPX_TARGET("sse2")
+void premultiply_sse2(Color* colors, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(colors + i));
+        const __m128i lo = premultiply_epu16_sse2(_mm_unpacklo_epi8(c, zero));
+        const __m128i hi = premultiply_epu16_sse2(_mm_unpackhi_epi8(c, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(colors + i), _mm_packus_epi16(lo, hi));
+    }
+
+    premultiply_scalar(colors + i, count - i);
+}
+
+// Unpremultiplies one pixel held in 32-bit lanes, the alpha lane is fixed by the caller
+BPX_TARGET("sse4.1")
+inline __m128i unpremultiply_epi32_sse41(__m128i c, const uint32_t* rcp)
+{
+    const __m128i alpha = _mm_shuffle_epi32(c, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i num = _mm_add_epi32(_mm_mullo_epi32(_mm_min_epi32(c, alpha), _mm_set1_epi32(255)),
+                                      _mm_srli_epi32(alpha, 1));
+    const __m128i r = _mm_set1_epi32(static_cast<int>(rcp[_mm_extract_epi32(alpha, 0)]));
+    return _mm_srli_epi32(_mm_mullo_epi32(num, r), 24);
+}
+
+BPX_TARGET("sse4.1")
+void unpremultiply_sse41(Color* colors, size_t count)
+{
+    const uint32_t* rcp = reciprocals();
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(colors + i));
+        if (_mm_testc_si128(c, alpha)) {
+            continue; // Opaque pixels are unchanged
+        }
+        const __m128i p0 = unpremultiply_epi32_sse41(_mm_cvtepu8_epi32(c), rcp);
+        const __m128i p1 = unpremultiply_epi32_sse41(_mm_cvtepu8_epi32(_mm_srli_si128(c, 4)), rcp);
+        const __m128i p2 = unpremultiply_epi32_sse41(_mm_cvtepu8_epi32(_mm_srli_si128(c, 8)), rcp);
+        const __m128i p3 = unpremultiply_epi32_sse41(_mm_cvtepu8_epi32(_mm_srli_si128(c, 12)), rcp);
+        const __m128i r = _mm_packus_epi16(_mm_packus_epi32(p0, p1), _mm_packus_epi32(p2, p3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(colors + i), _mm_blendv_epi8(r, c, alpha));
+    }
+
+    unpremultiply_scalar(colors + i, count - i);
+}
+
+BPX_TARGET("sse4.1")
+void blend_alpha_sse41(Color* dst, const Color* src, size_t step, size_t count)
+{
+    const uint32_t* rcp = reciprocals();
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i uniform = _mm_set1_epi32(static_cast<int>(load_uniform(src, step)));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        const __m128i s = step ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) : uniform;
+        const __m128i lo = alpha_epu16_sse41(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), rcp);
+        const __m128i hi = alpha_epu16_sse41(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), rcp);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+
+    blend_scalar<BlendMode::ALPHA>(dst + i, src + i * step, step, count - i);
+}
+
+BPX_TARGET("avx2")
+inline __m256i div255_avx2(__m256i x)
+{
+    const __m256i t = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+template <BlendMode M>
+BPX_TARGET("avx2")
+inline __m256i blend_epu16_avx2(__m256i d, __m256i s)
+{
+    const __m256i c255 = _mm256_set1_epi16(255);
+    switch (M) {
+        case BlendMode::MUL:
+            return div255_avx2(_mm256_mullo_epi16(d, s));
+        case BlendMode::SCREEN:
+            return _mm256_sub_epi16(c255, div255_avx2(_mm256_mullo_epi16(_mm256_sub_epi16(c255, d), _mm256_sub_epi16(c255, s))));
+        default: // EXCLUSION
+            return div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(c255, s)),
+                                                _mm256_mullo_epi16(s, _mm256_sub_epi16(c255, d))));
+    }
+}
+
+template <BlendMode M>
+BPX_TARGET("avx2")
+inline __m256i blend8_avx2(__m256i d, __m256i s)
+{
+    __m256i r;
+    switch (M) {
+        case BlendMode::ADD:        r = _mm256_adds_epu8(d, s); break;
+        case BlendMode::SUB:        r = _mm256_subs_epu8(d, s); break;
+        case BlendMode::DARKEN:     r = _mm256_min_epu8(d, s); break;
+        case BlendMode::LIGHTEN:    r = _mm256_max_epu8(d, s); break;
+        case BlendMode::DIFFERENCE: r = _mm256_or_si256(_mm256_subs_epu8(d, s), _mm256_subs_epu8(s, d)); break;
+        default: {
+            // The unpacks and the pack work within 128-bit lanes, so the order is kept
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i lo = blend_epu16_avx2<M>(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+            const __m256i hi = blend_epu16_avx2<M>(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+            r = _mm256_packus_epi16(lo, hi);
+            break;
+        }
+    }
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+    return _mm256_blendv_epi8(r, d, alpha);
+}
+
+template <BlendMode M>
+BPX_TARGET("avx2")
+void blend_avx2(Color* dst, const Color* src, size_t step, size_t count)
+{
+    const __m256i uniform = _mm256_set1_epi32(static_cast<int>(load_uniform(src, step)));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        const __m256i s = step ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)) : uniform;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), blend8_avx2<M>(d, s));
+    }
+
+    blend_sse2<M>(dst + i, src + i * step, step, count - i);
+}
+
+BPX_TARGET("avx2")
+inline __m256i broadcast_alpha_avx2(__m256i v)
+{
+    return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+BPX_TARGET("avx2")
+inline __m256i alpha_epu16_avx2(__m256i d, __m256i s, const uint32_t* rcp)
+{
+    const __m256i c255 = _mm256_set1_epi16(255);
+    const __m256i sa = broadcast_alpha_avx2(s);
+    const __m256i da = broadcast_alpha_avx2(d);
+    const __m256i dw = div255_avx2(_mm256_mullo_epi16(da, _mm256_sub_epi16(c255, sa)));
+    const __m256i oa = _mm256_add_epi16(sa, dw);
+    const __m256i num = _mm256_add_epi16(_mm256_mullo_epi16(s, sa), _mm256_mullo_epi16(d, dw));
+
+    __m256i c;
+    if (static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(oa, c255))) == 0xFFFFFFFF) {
+        c = div255_avx2(num);
+    } else {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i n = _mm256_add_epi16(num, _mm256_srli_epi16(oa, 1));
+        const __m256i r0 = _mm256_i32gather_epi32(reinterpret_cast<const int*>(rcp), _mm256_unpacklo_epi16(oa, zero), 4);
+        const __m256i r1 = _mm256_i32gather_epi32(reinterpret_cast<const int*>(rcp), _mm256_unpackhi_epi16(oa, zero), 4);
+        const __m256i q0 = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_unpacklo_epi16(n, zero), r0), 24);
+        const __m256i q1 = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_unpackhi_epi16(n, zero), r1), 24);
+        c = _mm256_packus_epi32(q0, q1);
+    }
+
+    return _mm256_blend_epi16(c, oa, 0x88);
+}
+
+BPX_TARGET("avx2")
+void blend_alpha_avx2(Color* dst, const Color* src, size_t step, size_t count)
+{
+    const uint32_t* rcp = reciprocals();
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i uniform = _mm256_set1_epi32(static_cast<int>(load_uniform(src, step)));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        const __m256i s = step ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)) : uniform;
+        const __m256i lo = alpha_epu16_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero), rcp);
+        const __m256i hi = alpha_epu16_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero), rcp);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+
+    blend_alpha_sse41(dst + i, src + i * step, step, count - i);
+}
+
+BPX_TARGET("avx2")
+inline __m256i premultiplied_epu16_avx2(__m256i d, __m256i s)
+{
+    const __m256i inv_alpha = _mm256_sub_epi16(_mm256_set1_epi16(255), broadcast_alpha_avx2(s));
+    return div255_avx2(_mm256_mullo_epi16(d, inv_alpha));
+}
+
+BPX_TARGET("avx2")
+void blend_premultiplied_avx2(Color* dst, const Color* src, size_t step, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i uniform = _mm256_set1_epi32(static_cast<int>(load_uniform(src, step)));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+        const __m256i s = step ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)) : uniform;
+        const __m256i lo = premultiplied_epu16_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+        const __m256i hi = premultiplied_epu16_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_adds_epu8(s, _mm256_packus_epi16(lo, hi)));
+    }
+
+    blend_premultiplied_sse2(dst + i, src + i * step, step, count - i);
+}
+
+BPX_TARGET("avx2")
+inline __m256i premultiply_epu16_avx2(__m256i c)
+{
+    const __m256i factor = _mm256_or_si256(broadcast_alpha_avx2(c),
+                                           _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0));
+    return div255_avx2(_mm256_mullo_epi16(c, factor));
+}
+
+BPX_TARGET("avx2")
+void premultiply_avx2(Color* colors, size_t count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colors + i));
+        const __m256i lo = premultiply_epu16_avx2(_mm256_unpacklo_epi8(c, zero));
+        const __m256i hi = premultiply_epu16_avx2(_mm256_unpackhi_epi8(c, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(colors + i), _mm256_packus_epi16(lo, hi));
+    }
+
+    premultiply_sse2(colors + i, count - i);
+}
+
+// Unpremultiplies two pixels held in 32-bit lanes, the alpha lanes are fixed by the caller
+BPX_TARGET("avx2")
+inline __m256i unpremultiply_epi32_avx2(__m256i c, const uint32_t* rcp)
+{
+    const __m256i alpha = _mm256_shuffle_epi32(c, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m256i num = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_min_epi32(c, alpha), _mm256_set1_epi32(255)),
+                                         _mm256_srli_epi32(alpha, 1));
+    const __m256i r = _mm256_i32gather_epi32(reinterpret_cast<const int*>(rcp), alpha, 4);
+    return _mm256_srli_epi32(_mm256_mullo_epi32(num, r), 24);
+}
+
+BPX_TARGET("avx2")
+void unpremultiply_avx2(Color* colors, size_t count)
+{
+    const uint32_t* rcp = reciprocals();
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colors + i));
+        if (_mm256_testc_si256(c, alpha)) {
+            continue; // Opaque pixels are unchanged
+        }
+        const __m128i lo = _mm256_castsi256_si128(c);
+        const __m128i hi = _mm256_extracti128_si256(c, 1);
+        const __m256i p0 = unpremultiply_epi32_avx2(_mm256_cvtepu8_epi32(lo), rcp);
+        const __m256i p1 = unpremultiply_epi32_avx2(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)), rcp);
+        const __m256i p2 = unpremultiply_epi32_avx2(_mm256_cvtepu8_epi32(hi), rcp);
+        const __m256i p3 = unpremultiply_epi32_avx2(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)), rcp);
+        // The packs interleave the 128-bit lanes, the permutation puts the pixels back in order
+        const __m256i r = _mm256_permutevar8x32_epi32(
+            _mm256_packus_epi16(_mm256_packus_epi32(p0, p1), _mm256_packus_epi32(p2, p3)),
+            _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(colors + i), _mm256_blendv_epi8(r, c, alpha));
+    }
+
+    unpremultiply_sse41(colors + i, count - i);
+}
+
+#endif // BPX_ARCH_X86
+
+/* NEON kernels */
+
+#if defined(BPX_ARCH_NEON) && defined(__aarch64__)
+
+#define BPX_NEON_KERNELS
+
+// div255 of the 16-bit products, narrowed: (x + ((x + 128) >> 8) + 128) >> 8
+inline uint8x8_t div255_neon(uint16x8_t x)
+{
+    return vraddhn_u16(x, vrshrq_n_u16(x, 8));
+}
+
+template <BlendMode M>
+inline uint8x16_t blend4_neon(uint8x16_t d, uint8x16_t s)
+{
+    uint8x16_t r;
+    switch (M) {
+        case BlendMode::ADD:        r = vqaddq_u8(d, s); break;
+        case BlendMode::SUB:        r = vqsubq_u8(d, s); break;
+        case BlendMode::DARKEN:     r = vminq_u8(d, s); break;
+        case BlendMode::LIGHTEN:    r = vmaxq_u8(d, s); break;
+        case BlendMode::DIFFERENCE: r = vabdq_u8(d, s); break;
+        case BlendMode::MUL:
+            r = vcombine_u8(div255_neon(vmull_u8(vget_low_u8(d), vget_low_u8(s))),
+                            div255_neon(vmull_u8(vget_high_u8(d), vget_high_u8(s))));
+            break;
+        case BlendMode::SCREEN: {
+            const uint8x16_t nd = vmvnq_u8(d), ns = vmvnq_u8(s);
+            r = vmvnq_u8(vcombine_u8(div255_neon(vmull_u8(vget_low_u8(nd), vget_low_u8(ns))),
+                                     div255_neon(vmull_u8(vget_high_u8(nd), vget_high_u8(ns)))));
+            break;
+        }
+        default: { // EXCLUSION
+            const uint8x16_t nd = vmvnq_u8(d), ns = vmvnq_u8(s);
+            const uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(d), vget_low_u8(ns)), vget_low_u8(s), vget_low_u8(nd));
+            const uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(d), vget_high_u8(ns)), vget_high_u8(s), vget_high_u8(nd));
+            r = vcombine_u8(div255_neon(lo), div255_neon(hi));
+            break;
+        }
+    }
+    const uint8x16_t alpha = vreinterpretq_u8_u32(vdupq_n_u32(0xFF000000));
+    return vbslq_u8(alpha, d, r);
+}
+
+template <BlendMode M>
+void blend_neon(Color* dst, const Color* src, size_t step, size_t count)
+{
+    const uint8x16_t uniform = vreinterpretq_u8_u32(vdupq_n_u32(load_uniform(src, step)));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint8x16_t d = vld1q_u8(reinterpret_cast<const uint8_t*>(dst + i));
+        const uint8x16_t s = step ? vld1q_u8(reinterpret_cast<const uint8_t*>(src + i)) : uniform;
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), blend4_neon<M>(d, s));
+    }
+
+    blend_scalar<M>(dst + i, src + i * step, step, count - i);
+}
+
+inline uint16x8_t mul_lo(uint8x16_t a, uint8x16_t b) { return vmull_u8(vget_low_u8(a), vget_low_u8(b)); }
+inline uint16x8_t mul_hi(uint8x16_t a, uint8x16_t b) { return vmull_u8(vget_high_u8(a), vget_high_u8(b)); }
+
+// Only the common case of an opaque result is vectorized, the others need a division per pixel
+void blend_alpha_neon(Color* dst, const Color* src, size_t step, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x4_t d = vld4q_u8(reinterpret_cast<const uint8_t*>(dst + i));
+        const uint8x16x4_t s = step ? vld4q_u8(reinterpret_cast<const uint8_t*>(src + i))
+                                    : uint8x16x4_t{{ vdupq_n_u8(src->r), vdupq_n_u8(src->g),
+                                                     vdupq_n_u8(src->b), vdupq_n_u8(src->a) }};
+        const uint8x16_t sa = s.val[3];
+        const uint8x16_t nsa = vmvnq_u8(sa);
+        const uint8x16_t dw = vcombine_u8(div255_neon(mul_lo(d.val[3], nsa)), div255_neon(mul_hi(d.val[3], nsa)));
+        const uint8x16_t oa = vaddq_u8(sa, dw);
+
+        if (vminvq_u8(oa) != 255) {
+            blend_scalar<BlendMode::ALPHA>(dst + i, src + i * step, step, 16);
+            continue;
+        }
+
+        uint8x16x4_t r;
+        for (int c = 0; c < 3; c++) {
+            const uint16x8_t lo = vmlal_u8(mul_lo(s.val[c], sa), vget_low_u8(d.val[c]), vget_low_u8(dw));
+            const uint16x8_t hi = vmlal_u8(mul_hi(s.val[c], sa), vget_high_u8(d.val[c]), vget_high_u8(dw));
+            r.val[c] = vcombine_u8(div255_neon(lo), div255_neon(hi));
+        }
+        r.val[3] = oa;
+        vst4q_u8(reinterpret_cast<uint8_t*>(dst + i), r);
+    }
+
+    blend_scalar<BlendMode::ALPHA>(dst + i, src + i * step, step, count - i);
+}
+
+// Broadcasts the alpha of each pixel to its four bytes
+inline uint8x16_t broadcast_alpha_neon(uint8x16_t v)
+{
+    static const uint8_t indices[16] = { 3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15 };
+    return vqtbl1q_u8(v, vld1q_u8(indices));
+}
+
+void blend_premultiplied_neon(Color* dst, const Color* src, size_t step, size_t count)
+{
+    const uint8x16_t uniform = vreinterpretq_u8_u32(vdupq_n_u32(load_uniform(src, step)));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint8x16_t d = vld1q_u8(reinterpret_cast<const uint8_t*>(dst + i));
+        const uint8x16_t s = step ? vld1q_u8(reinterpret_cast<const uint8_t*>(src + i)) : uniform;
+        const uint8x16_t inv_alpha = vmvnq_u8(broadcast_alpha_neon(s));
+        const uint8x16_t scaled = vcombine_u8(div255_neon(mul_lo(d, inv_alpha)), div255_neon(mul_hi(d, inv_alpha)));
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + i), vqaddq_u8(s, scaled));
+    }
+
+    blend_scalar<BlendMode::PREMULTIPLIED_ALPHA>(dst + i, src + i * step, step, count - i);
+}
+
+void premultiply_neon(Color* colors, size_t count)
+{
+    const uint8x16_t alpha = vreinterpretq_u8_u32(vdupq_n_u32(0xFF000000));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint8x16_t c = vld1q_u8(reinterpret_cast<const uint8_t*>(colors + i));
+        const uint8x16_t factor = vorrq_u8(broadcast_alpha_neon(c), alpha);
+        vst1q_u8(reinterpret_cast<uint8_t*>(colors + i),
+                 vcombine_u8(div255_neon(mul_lo(c, factor)), div255_neon(mul_hi(c, factor))));
+    }
+
+    premultiply_scalar(colors + i, count - i);
+}
+
+// Only runs of opaque pixels are skipped, the others need a division per pixel
+void unpremultiply_neon(Color* colors, size_t count)
+{
+    const uint8x16_t alpha = vreinterpretq_u8_u32(vdupq_n_u32(0xFF000000));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint8x16_t c = vld1q_u8(reinterpret_cast<const uint8_t*>(colors + i));
+        if (vminvq_u8(vorrq_u8(c, vmvnq_u8(alpha))) != 255) {
+            unpremultiply_scalar(colors + i, 4);
+        }
+    }
+
+    unpremultiply_scalar(colors + i, count - i);
+}
+
+#endif // BPX_ARCH_NEON && __aarch64__
+
+/* Kernel dispatch */
+
+using BlendFunc = void(*)(Color*, const Color*, size_t, size_t);
+
+// One kernel per blend mode, REPLACE is handled by copies
+struct BlendKernels
+{
+    BlendFunc modes[13] = {
+        nullptr,
+        blend_scalar<BlendMode::ALPHA>,
+        blend_scalar<BlendMode::ADD>,
+        blend_scalar<BlendMode::SUB>,
+        blend_scalar<BlendMode::MUL>,
+        blend_scalar<BlendMode::SCREEN>,
+        blend_scalar<BlendMode::DARKEN>,
+        blend_scalar<BlendMode::LIGHTEN>,
+        blend_scalar<BlendMode::DIFFERENCE>,
+        blend_scalar<BlendMode::EXCLUSION>,
+        blend_scalar<BlendMode::DODGE>,
+        blend_scalar<BlendMode::BURN>,
+        blend_scalar<BlendMode::PREMULTIPLIED_ALPHA>,
+    };
+
+    void (*premultiply)(Color*, size_t) = premultiply_scalar;
+    void (*unpremultiply)(Color*, size_t) = unpremultiply_scalar;
+};
+
+#define PF_BLEND_KERNELS(KERNEL)                                            \
+    k.modes[int(BlendMode::ADD)] = KERNEL<BlendMode::ADD>;                  \
+    k.modes[int(BlendMode::SUB)] = KERNEL<BlendMode::SUB>;                  \
+    k.modes[int(BlendMode::MUL)] = KERNEL<BlendMode::MUL>;                  \
+    k.modes[int(BlendMode::SCREEN)] = KERNEL<BlendMode::SCREEN>;            \
+    k.modes[int(BlendMode::DARKEN)] = KERNEL<BlendMode::DARKEN>;            \
+    k.modes[int(BlendMode::LIGHTEN)] = KERNEL<BlendMode::LIGHTEN>;          \
+    k.modes[int(BlendMode::DIFFERENCE)] = KERNEL<BlendMode::DIFFERENCE>;    \
+    k.modes[int(BlendMode::EXCLUSION)] = KERNEL<BlendMode::EXCLUSION>;
+
+const BlendKernels& blend_kernels()
+{
+    static const BlendKernels kernels = [] {
+        BlendKernels k;
+        const bpx::detail::CpuFeatures& cpu = bpx::detail::cpu_features();
+        (void)cpu;
+#if defined(BPX_ARCH_X86)
+        if (cpu.sse2) {
+            PF_BLEND_KERNELS(blend_sse2)
+            k.modes[int(BlendMode::PREMULTIPLIED_ALPHA)] = blend_premultiplied_sse2;
+            k.premultiply = premultiply_sse2;
+        }
+        if (cpu.sse41) {
+            k.modes[int(BlendMode::ALPHA)] = blend_alpha_sse41;
+            k.unpremultiply = unpremultiply_sse41;
+        }
+        if (cpu.avx2) {
+            PF_BLEND_KERNELS(blend_avx2)
+            k.modes[int(BlendMode::ALPHA)] = blend_alpha_avx2;
+            k.modes[int(BlendMode::PREMULTIPLIED_ALPHA)] = blend_premultiplied_avx2;
+            k.premultiply = premultiply_avx2;
+            k.unpremultiply = unpremultiply_avx2;
+        }
+#elif defined(BPX_NEON_KERNELS)
+        if (cpu.neon) {
+            PF_BLEND_KERNELS(blend_neon)
+            k.modes[int(BlendMode::ALPHA)] = blend_alpha_neon;
+            k.modes[int(BlendMode::PREMULTIPLIED_ALPHA)] = blend_premultiplied_neon;
+            k.premultiply = premultiply_neon;
+            k.unpremultiply = unpremultiply_neon;
+        }
+#endif
+        return k;
+    }();
+    return kernels;
+}
+
+} // namespace anonymous
+
+
+/* Public API */
+
+namespace bpx {
+
+void blend_span(Color* dst, const Color* src, size_t count, BlendMode mode)
+{
+    if (count == 0) {
+        return;
+    }
+    if (mode == BlendMode::REPLACE) {
+        std::memmove(dst, src, count * sizeof(Color));
+        return;
+    }
+    blend_kernels().modes[static_cast<int>(mode)](dst, src, 1, count);
+}
+
+void blend_span(Color* dst, Color src, size_t count, BlendMode mode)
+{
+    if (count == 0) {
+        return;
+    }
+    if (mode == BlendMode::REPLACE) {
+        std::fill_n(dst, count, src);
+        return;
+    }
+    blend_kernels().modes[static_cast<int>(mode)](dst, &src, 0, count);
+}
+
+void premultiply_span(Color* colors, size_t count)
+{
+    blend_kernels().premultiply(colors, count);
+}
+
+void unpremultiply_span(Color* colors, size_t count)
+{
+    blend_kernels().unpremultiply(colors, count);
+}
+
+} // namespace bpx
@@ -0,0 +1,304 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/canvas.hpp"
+
+#include "./clip.hpp"
+
+namespace {
+
+using bpx::Rect;
+using bpx::detail::Clip;
+
+Rect to_rect(const Clip& clip)
+{
+    return Rect{ clip.x0, clip.y0, clip.x1 - clip.x0, clip.y1 - clip.y0 };
+}
+
+Clip to_clip(const Rect& rect)
+{
+    return Clip{ rect.x, rect.y, rect.x + rect.w, rect.y + rect.h };
+}
+
+} // namespace
+
+namespace bpx {
+
+namespace d = detail;
+
+Canvas::Canvas(ImageView target)
+    : m_target(target), m_clipped(false)
+{ }
+
+void Canvas::invalidate(const Rect& rect)
+{
+    m_damage.add(intersection(rect, Rect{ 0, 0, m_target.width(), m_target.height() }));
+}
+
+void Canvas::set_clip(const Region& region)
+{
+    m_clip = region;
+    m_clipped = true;
+}
+
+void Canvas::set_clip(const Rect& rect)
+{
+    m_clip.clear();
+    m_clip.add(rect);
+    m_clipped = true;
+}
+
+void Canvas::reset_clip() noexcept
+{
+    m_clip.clear();
+    m_clipped = false;
+}
+
+/*
+    Draws CALL with `clip` set to every part of BOUNDS to paint.
+*/
+#define PF_PAINT(BOUNDS, CALL)                                                              \
+    paint(to_rect(BOUNDS), [&](const Rect& part) { const Clip clip = to_clip(part); CALL; })
+
+void Canvas::fill(Color color, ExecutionPolicy policy)
+{
+    PF_PAINT(d::whole(m_target),
+              bpx::fill(m_target.sub(clip.x0, clip.y0, clip.x1 - clip.x0, clip.y1 - clip.y0), color, policy));
+}
+
+void Canvas::point(int x, int y, Color color, BlendMode mode)
+{
+    PF_PAINT((Clip{ x, y, x + 1, y + 1 }), d::point(m_target, clip, x, y, color, mode));
+}
+
+void Canvas::line(int x1, int y1, int x2, int y2, Color color, BlendMode mode)
+{
+    PF_PAINT(d::span_bounds(x1, y1, x2, y2, 0), d::line(m_target, clip, x1, y1, x2, y2, color, mode));
+}
+
+void Canvas::line(int x1, int y1, int x2, int y2, const Image::Mapper& mapper)
+{
+    PF_PAINT(d::span_bounds(x1, y1, x2, y2, 0), d::line(m_target, clip, x1, y1, x2, y2, mapper));
+}
+
+void Canvas::line(int x1, int y1, int x2, int y2, int thick, Color color, BlendMode mode)
+{
+    PF_PAINT(d::span_bounds(x1, y1, x2, y2, d::thick_pad(thick)),
+              d::line(m_target, clip, x1, y1, x2, y2, thick, color, mode));
+}
+
+void Canvas::line(int x1, int y1, int x2, int y2, int thick, const Image::Mapper& mapper)
+{
+    PF_PAINT(d::span_bounds(x1, y1, x2, y2, d::thick_pad(thick)),
+              d::line(m_target, clip, x1, y1, x2, y2, thick, mapper));
+}
+
+void Canvas::line_gradient(int x1, int y1, int x2, int y2, const ColorRamp& ramp, BlendMode mode)
+{
+    PF_PAINT(d::span_bounds(x1, y1, x2, y2, 0), d::line_gradient(m_target, clip, x1, y1, x2, y2, ramp, mode));
+}
+
+void Canvas::line_gradient(int x1, int y1, int x2, int y2, int thick, const ColorRamp& ramp, BlendMode mode)
+{
+    PF_PAINT(d::span_bounds(x1, y1, x2, y2, d::thick_pad(thick)),
+              d::line_gradient(m_target, clip, x1, y1, x2, y2, thick, ramp, mode));
+}
+
+void Canvas::rectangle(int x, int y, int w, int h, Color color, BlendMode mode)
+{
+    PF_PAINT(d::rect_bounds(x, y, w, h), d::rectangle(m_target, clip, x, y, w, h, color, mode));
+}
+
+void Canvas::rectangle(int x, int y, int w, int h, const Image::Mapper& mapper)
+{
+    PF_PAINT(d::rect_bounds(x, y, w, h), d::rectangle(m_target, clip, x, y, w, h, mapper));
+}
+
+void Canvas::rectangle_gradient_linear(int x, int y, int w, int h, int x_start, int y_start, int x_end, int y_end,
+                                       const ColorRamp& ramp, BlendMode mode)
+{
+    PF_PAINT(d::rect_bounds(x, y, w, h),
+              d::rectangle_gradient_linear(m_target, clip, x, y, w, h, x_start, y_start, x_end, y_end, ramp, mode));
+}
+
+void Canvas::rectangle_gradient_radial(int x, int y, int w, int h, int x_start, int y_start, int x_end, int y_end,
+                                       const ColorRamp& ramp, BlendMode mode)
+{
+    PF_PAINT(d::rect_bounds(x, y, w, h),
+              d::rectangle_gradient_radial(m_target, clip, x, y, w, h, x_start, y_start, x_end, y_end, ramp, mode));
+}
+
+void Canvas::rectangle_lines(int x, int y, int w, int h, Color color, BlendMode mode)
+{
+    rectangle_lines(x, y, w, h, 1, color, mode);
+}
+
+void Canvas::rectangle_lines(int x, int y, int w, int h, const Image::Mapper& mapper)
+{
+    rectangle_lines(x, y, w, h, 1, mapper);
+}
+
+void Canvas::rectangle_lines(int x, int y, int w, int h, int thick, Color color, BlendMode mode)
+{
+    PF_PAINT(d::rect_outline_bounds(x, y, w, h, thick),
+              d::rectangle_lines(m_target, clip, x, y, w, h, thick, color, mode));
+}
+
+void Canvas::rectangle_lines(int x, int y, int w, int h, int thick, const Image::Mapper& mapper)
+{
+    PF_PAINT(d::rect_outline_bounds(x, y, w, h, thick),
+              d::rectangle_lines(m_target, clip, x, y, w, h, thick, mapper));
+}
+
+void Canvas::circle(int cx, int cy, int radius, Color color, BlendMode mode)
+{
+    PF_PAINT(d::circle_bounds(cx, cy, radius), d::circle(m_target, clip, cx, cy, radius, color, mode));
+}
+
+void Canvas::circle(int cx, int cy, int radius, const Image::Mapper& mapper)
+{
+    PF_PAINT(d::circle_bounds(cx, cy, radius), d::circle(m_target, clip, cx, cy, radius, mapper));
+}
+
+void Canvas::circle_gradient(int cx, int cy, int radius, const ColorRamp& ramp, BlendMode mode)
+{
+    PF_PAINT(d::circle_bounds(cx, cy, radius), d::circle_gradient(m_target, clip, cx, cy, radius, ramp, mode));
+}
+
+void Canvas::circle_lines(int cx, int cy, int radius, Color color, BlendMode mode)
+{
+    PF_PAINT(d::circle_bounds(cx, cy, radius), d::circle_lines(m_target, clip, cx, cy, radius, color, mode));
+}
+
+void Canvas::circle_lines(int cx, int cy, int radius, const Image::Mapper& mapper)
+{
+    PF_PAINT(d::circle_bounds(cx, cy, radius), d::circle_lines(m_target, clip, cx, cy, radius, mapper));
+}
+
+void Canvas::circle_lines(int cx, int cy, int radius, int thick, Color color, BlendMode mode)
+{
+    PF_PAINT(d::circle_bounds(cx, cy, radius, thick),
+              d::circle_lines(m_target, clip, cx, cy, radius, thick, color, mode));
+}
+
+void Canvas::circle_lines(int cx, int cy, int radius, int thick, const Image::Mapper& mapper)
+{
+    PF_PAINT(d::circle_bounds(cx, cy, radius, thick),
+              d::circle_lines(m_target, clip, cx, cy, radius, thick, mapper));
+}
+
+void Canvas::saturation(float factor, ExecutionPolicy policy)
+{
+    paint(to_rect(d::whole(m_target)), [&](const Rect& part) {
+        bpx::saturation(m_target.sub(part.x, part.y, part.w, part.h), factor, policy);
+    });
+}
+
+void Canvas::brightness(float factor, ExecutionPolicy policy)
+{
+    paint(to_rect(d::whole(m_target)), [&](const Rect& part) {
+        bpx::brightness(m_target.sub(part.x, part.y, part.w, part.h), factor, policy);
+    });
+}
+
+void Canvas::contrast(float factor, ExecutionPolicy policy)
+{
+    paint(to_rect(d::whole(m_target)), [&](const Rect& part) {
+        bpx::contrast(m_target.sub(part.x, part.y, part.w, part.h), factor, policy);
+    });
+}
+
+void Canvas::opacity(float alpha, ExecutionPolicy policy)
+{
+    paint(to_rect(d::whole(m_target)), [&](const Rect& part) {
+        bpx::opacity(m_target.sub(part.x, part.y, part.w, part.h), alpha, policy);
+    });
+}
+
+void Canvas::invert(ExecutionPolicy policy)
+{
+    paint(to_rect(d::whole(m_target)), [&](const Rect& part) {
+        bpx::invert(m_target.sub(part.x, part.y, part.w, part.h), policy);
+    });
+}
+
+void Canvas::premultiply(ExecutionPolicy policy)
+{
+    paint(to_rect(d::whole(m_target)), [&](const Rect& part) {
+        bpx::premultiply(m_target.sub(part.x, part.y, part.w, part.h), policy);
+    });
+}
+
+void Canvas::unpremultiply(ExecutionPolicy policy)
+{
+    paint(to_rect(d::whole(m_target)), [&](const Rect& part) {
+        bpx::unpremultiply(m_target.sub(part.x, part.y, part.w, part.h), policy);
+    });
+}
+
+void Canvas::flip_horizontal()
+{
+    move_pixels(&bpx::flip_horizontal);
+}
+
+void Canvas::flip_vertical()
+{
+    move_pixels(&bpx::flip_vertical);
+}
+
+void Canvas::rotate_180()
+{
+    move_pixels(&bpx::rotate_180);
+}
+
+void Canvas::move_pixels(void (*func)(ImageView))
+{
+    if (!m_clipped) {
+        paint(to_rect(d::whole(m_target)), [&](const Rect&) { func(m_target); });
+        return;
+    }
+
+    /* The pixels written come from anywhere in the target, so they are
+       moved on a copy, read back only within the clip */
+
+    Image moved = copy(m_target);
+    func(moved);
+    paint(to_rect(d::whole(m_target)), [&](const Rect& part) {
+        bpx::draw(m_target, part.x, part.y, part.w, part.h, moved, part.x, part.y, part.w, part.h);
+    });
+}
+
+void Canvas::draw(int x, int y, int w, int h, ConstImageView src, BlendMode mode, Filter filter,
+                  ExecutionPolicy policy)
+{
+    draw(x, y, w, h, src, 0, 0, src.width(), src.height(), mode, filter, policy);
+}
+
+void Canvas::draw(int x_dst, int y_dst, int w_dst, int h_dst, ConstImageView src, int x_src, int y_src,
+                  int w_src, int h_src, BlendMode mode, Filter filter, ExecutionPolicy policy)
+{
+    if (w_dst <= 0 || h_dst <= 0 || w_src <= 0 || h_src <= 0) {
+        return;
+    }
+    PF_PAINT((Clip{ x_dst, y_dst, x_dst + w_dst, y_dst + h_dst }),
+              d::draw(m_target, clip, x_dst, y_dst, w_dst, h_dst, src, x_src, y_src, w_src, h_src,
+                      mode, filter, policy));
+}
+
+} // namespace bpx
@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_CLIP_HPP
+#define BPX_CLIP_HPP
+
+/*
+    Internal header, not installed.
+
+    Drawing primitives restricted to a clip rectangle of the image. The clip
+    only masks the pixels written: shapes are traced exactly as when drawn
+    on the whole image (lines are still clipped to the image to find their
+    end points, gradients and samples are positioned on the image), so that
+    drawing a shape once per rectangle of a partition of the image writes
+    the same pixels with the same values as drawing it once, each pixel
+    being written in the same order. The public functions draw with the
+    whole image as clip; command lists replay their commands tile by tile.
+*/
+
+#include "BPX/algorithm.hpp"
+
+#include <algorithm>
+
+namespace bpx { namespace detail {
+
+/*
+    The pixels [x0, x1) x [y0, y1), inside the image.
+*/
+struct Clip
+{
+    int x0, y0;
+    int x1, y1;
+};
+
+inline Clip whole(const ConstImageView& image)
+{
+    return Clip{ 0, 0, image.width(), image.height() };
+}
+
+/*
+    Bounds of the pixels between two points, included, grown by `pad` on
+    every side. The bounds below are those of the pixels the primitives may
+    write, not clipped to any image: command lists bin their commands with
+    them, canvases record them as damage.
+*/
+inline Clip span_bounds(int x1, int y1, int x2, int y2, int pad)
+{
+    return Clip{ std::min(x1, x2) - pad, std::min(y1, y2) - pad,
+                 std::max(x1, x2) + 1 + pad, std::max(y1, y2) + 1 + pad };
+}
+
+/*
+    The extra lines of a thick line are offset by at most (thick - 1) / sqrt(2)
+    pixels across its longer axis.
+*/
+inline int thick_pad(int thick)
+{
+    return std::max(thick, 0);
+}
+
+/*
+    Bounds of the pixels of a rectangle whose size may be negative.
+*/
+inline Clip rect_bounds(int x, int y, int w, int h)
+{
+    return Clip{ std::min(x, x + w), std::min(y, y + h), std::max(x, x + w), std::max(y, y + h) };
+}
+
+/*
+    A thick circle outline is the ring from the outline of radius
+    `radius - ring_inside(thick)` to the one of `radius + ring_outside(thick)`,
+    `thick` pixels wide. A thick rectangle outline extends rect_outline_half(thick)
+    pixels on both sides of its edges, as a thick line does.
+*/
+inline int ring_inside(int thick)
+{
+    return std::max(thick - 1, 0) / 2;
+}
+
+inline int ring_outside(int thick)
+{
+    return std::max(thick, 1) / 2;
+}
+
+inline int rect_outline_half(int thick)
+{
+    return std::max(thick - 1, 0) / 2;
+}
+
+/*
+    Bounds of the outline of a rectangle whose size may be negative, its
+    corners being the pixels (x, y) and (x + w, y + h).
+*/
+inline Clip rect_outline_bounds(int x, int y, int w, int h, int thick)
+{
+    return span_bounds(x, y, x + w, y + h, rect_outline_half(thick));
+}
+
+/*
+    Bounds of a circle and of its outline, empty for negative radii.
+*/
+inline Clip circle_bounds(int cx, int cy, int radius)
+{
+    return Clip{ cx - radius, cy - radius, cx + radius + 1, cy + radius + 1 };
+}
+
+inline Clip circle_bounds(int cx, int cy, int radius, int thick)
+{
+    return circle_bounds(cx, cy, radius + ring_outside(thick));
+}
+
+void point(const ImageView& image, const Clip& clip, int x, int y, Color color, BlendMode mode);
+
+void line(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, Color color, BlendMode mode);
+void line(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, const Image::Mapper& mapper);
+void line(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, int thick,
+          Color color, BlendMode mode);
+void line(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, int thick,
+          const Image::Mapper& mapper);
+void line_gradient(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2,
+                   const ColorRamp& ramp, BlendMode mode);
+void line_gradient(const ImageView& image, const Clip& clip, int x1, int y1, int x2, int y2, int thick,
+                   const ColorRamp& ramp, BlendMode mode);
+
+void rectangle(const ImageView& image, const Clip& clip, int x, int y, int w, int h, Color color, BlendMode mode);
+void rectangle(const ImageView& image, const Clip& clip, int x, int y, int w, int h, const Image::Mapper& mapper);
+void rectangle_gradient_linear(const ImageView& image, const Clip& clip, int x, int y, int w, int h,
+                               int x_start, int y_start, int x_end, int y_end,
+                               const ColorRamp& ramp, BlendMode mode);
+void rectangle_gradient_radial(const ImageView& image, const Clip& clip, int x, int y, int w, int h,
+                               int x_start, int y_start, int x_end, int y_end,
+                               const ColorRamp& ramp, BlendMode mode);
+void rectangle_lines(const ImageView& image, const Clip& clip, int x, int y, int w, int h, int thick,
+                     Color color, BlendMode mode);
+void rectangle_lines(const ImageView& image, const Clip& clip, int x, int y, int w, int h, int thick,
+                     const Image::Mapper& mapper);
+
+void circle(const ImageView& image, const Clip& clip, int cx, int cy, int radius, Color color, BlendMode mode);
+void circle(const ImageView& image, const Clip& clip, int cx, int cy, int radius, const Image::Mapper& mapper);
+void circle_gradient(const ImageView& image, const Clip& clip, int cx, int cy, int radius,
+                     const ColorRamp& ramp, BlendMode mode);
+void circle_lines(const ImageView& image, const Clip& clip, int cx, int cy, int radius,
+                  Color color, BlendMode mode);
+void circle_lines(const ImageView& image, const Clip& clip, int cx, int cy, int radius,
+                  const Image::Mapper& mapper);
+void circle_lines(const ImageView& image, const Clip& clip, int cx, int cy, int radius, int thick,
+                  Color color, BlendMode mode);
+void circle_lines(const ImageView& image, const Clip& clip, int cx, int cy, int radius, int thick,
+                  const Image::Mapper& mapper);
+
+/*
+    A source sharing memory with the destination is only read in the order
+    of `draw` within each clip: drawing over several clips then reads the
+    pixels already written by the previous ones.
+*/
+void draw(const ImageView& dst, const Clip& clip, int x_dst, int y_dst, int w_dst, int h_dst,
+          const ConstImageView& src, int x_src, int y_src, int w_src, int h_src,
+          BlendMode mode, Filter filter, const ExecutionPolicy& policy);
+
+}} // namespace bpx::detail
+
+#endif // BPX_CLIP_HPP
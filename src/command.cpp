@@ -0,0 +1,495 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/command.hpp"
+#include "BPX/ramp.hpp"
+
+#include "./clip.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace bpx { namespace detail {
+
+/*
+    A recorded primitive. The meaning of `args` follows the arguments of
+    the drawing function, `resource` indexes the mapper, the ramp or the
+    source of the command.
+*/
+struct Command
+{
+    enum Type : uint8_t
+    {
+        POINT,
+        LINE, LINE_MAPPER, LINE_THICK, LINE_THICK_MAPPER,
+        LINE_GRADIENT, LINE_GRADIENT_THICK,
+        RECTANGLE, RECTANGLE_MAPPER, RECTANGLE_GRADIENT_LINEAR, RECTANGLE_GRADIENT_RADIAL,
+        RECTANGLE_LINES, RECTANGLE_LINES_MAPPER,
+        CIRCLE, CIRCLE_MAPPER, CIRCLE_GRADIENT,
+        CIRCLE_LINES, CIRCLE_LINES_MAPPER, CIRCLE_LINES_THICK, CIRCLE_LINES_THICK_MAPPER,
+        DRAW,
+    };
+
+    Type type;
+    BlendMode mode;
+    Filter filter;
+    Color color;
+    int args[8];
+    uint32_t resource;
+    Clip bounds;        // Pixels the command may write, not clipped to any image
+};
+
+struct CommandData
+{
+    std::vector<Command> commands;
+    std::vector<Image::Mapper> mappers;
+    std::vector<const ColorRamp*> ramps;
+    std::vector<ConstImageView> sources;
+
+    // Commands of each tile, in order: those of tile t are
+    // bins[bin_offsets[t]] to bins[bin_offsets[t + 1] - 1]
+    std::vector<uint32_t> bin_offsets;
+    std::vector<uint32_t> bins;
+};
+
+}} // namespace bpx::detail
+
+namespace {
+
+using bpx::BlendMode;
+using bpx::Color;
+using bpx::ColorRamp;
+using bpx::ConstImageView;
+using bpx::Filter;
+using bpx::Rect;
+using bpx::detail::Clip;
+using bpx::detail::circle_bounds;
+using bpx::detail::rect_bounds;
+using bpx::detail::rect_outline_bounds;
+using bpx::detail::span_bounds;
+using bpx::detail::thick_pad;
+using bpx::detail::Command;
+using bpx::detail::CommandData;
+
+using Mapper = bpx::Image::Mapper;
+
+constexpr int TILE_SIZE = bpx::CommandList::TILE_SIZE;
+
+/*
+    Appends a command, `args` being the arguments of its drawing function.
+*/
+void record(CommandData& data, Command::Type type, const Clip& bounds, std::initializer_list<int> args,
+            BlendMode mode = BlendMode::REPLACE, Color color = {}, uint32_t resource = 0,
+            Filter filter = Filter::NEAREST)
+{
+    Command command{};
+    command.type = type;
+    command.mode = mode;
+    command.filter = filter;
+    command.color = color;
+    std::copy(args.begin(), args.end(), command.args);
+    command.resource = resource;
+    command.bounds = bounds;
+    data.commands.push_back(command);
+}
+
+/*
+    Stores the resource of a command, returns its index.
+*/
+uint32_t add(CommandData& data, const Mapper& mapper)
+{
+    data.mappers.push_back(mapper);
+    return static_cast<uint32_t>(data.mappers.size() - 1);
+}
+
+uint32_t add(CommandData& data, const ColorRamp& ramp)
+{
+    data.ramps.push_back(&ramp);
+    return static_cast<uint32_t>(data.ramps.size() - 1);
+}
+
+uint32_t add(CommandData& data, const ConstImageView& source)
+{
+    data.sources.push_back(source);
+    return static_cast<uint32_t>(data.sources.size() - 1);
+}
+
+/*
+    Replays a command over the pixels of the clip.
+*/
+void replay(const CommandData& data, const Command& c, const bpx::ImageView& image, const Clip& clip)
+{
+    namespace d = bpx::detail;
+    const int* a = c.args;
+
+    switch (c.type) {
+    case Command::POINT:
+        d::point(image, clip, a[0], a[1], c.color, c.mode);
+        break;
+    case Command::LINE:
+        d::line(image, clip, a[0], a[1], a[2], a[3], c.color, c.mode);
+        break;
+    case Command::LINE_MAPPER:
+        d::line(image, clip, a[0], a[1], a[2], a[3], data.mappers[c.resource]);
+        break;
+    case Command::LINE_THICK:
+        d::line(image, clip, a[0], a[1], a[2], a[3], a[4], c.color, c.mode);
+        break;
+    case Command::LINE_THICK_MAPPER:
+        d::line(image, clip, a[0], a[1], a[2], a[3], a[4], data.mappers[c.resource]);
+        break;
+    case Command::LINE_GRADIENT:
+        d::line_gradient(image, clip, a[0], a[1], a[2], a[3], *data.ramps[c.resource], c.mode);
+        break;
+    case Command::LINE_GRADIENT_THICK:
+        d::line_gradient(image, clip, a[0], a[1], a[2], a[3], a[4], *data.ramps[c.resource], c.mode);
+        break;
+    case Command::RECTANGLE:
+        d::rectangle(image, clip, a[0], a[1], a[2], a[3], c.color, c.mode);
+        break;
+    case Command::RECTANGLE_MAPPER:
+        d::rectangle(image, clip, a[0], a[1], a[2], a[3], data.mappers[c.resource]);
+        break;
+    case Command::RECTANGLE_GRADIENT_LINEAR:
+        d::rectangle_gradient_linear(image, clip, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
+                                     *data.ramps[c.resource], c.mode);
+        break;
+    case Command::RECTANGLE_GRADIENT_RADIAL:
+        d::rectangle_gradient_radial(image, clip, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
+                                     *data.ramps[c.resource], c.mode);
+        break;
+    case Command::RECTANGLE_LINES:
+        d::rectangle_lines(image, clip, a[0], a[1], a[2], a[3], a[4], c.color, c.mode);
+        break;
+    case Command::RECTANGLE_LINES_MAPPER:
+        d::rectangle_lines(image, clip, a[0], a[1], a[2], a[3], a[4], data.mappers[c.resource]);
+        break;
+    case Command::CIRCLE:
+        d::circle(image, clip, a[0], a[1], a[2], c.color, c.mode);
+        break;
+    case Command::CIRCLE_MAPPER:
+        d::circle(image, clip, a[0], a[1], a[2], data.mappers[c.resource]);
+        break;
+    case Command::CIRCLE_GRADIENT:
+        d::circle_gradient(image, clip, a[0], a[1], a[2], *data.ramps[c.resource], c.mode);
+        break;
+    case Command::CIRCLE_LINES:
+        d::circle_lines(image, clip, a[0], a[1], a[2], c.color, c.mode);
+        break;
+    case Command::CIRCLE_LINES_MAPPER:
+        d::circle_lines(image, clip, a[0], a[1], a[2], data.mappers[c.resource]);
+        break;
+    case Command::CIRCLE_LINES_THICK:
+        d::circle_lines(image, clip, a[0], a[1], a[2], a[3], c.color, c.mode);
+        break;
+    case Command::CIRCLE_LINES_THICK_MAPPER:
+        d::circle_lines(image, clip, a[0], a[1], a[2], a[3], data.mappers[c.resource]);
+        break;
+    case Command::DRAW:
+        d::draw(image, clip, a[0], a[1], a[2], a[3], data.sources[c.resource], a[4], a[5], a[6], a[7],
+                c.mode, c.filter, bpx::Execution::SEQUENTIAL);
+        break;
+    }
+}
+
+/*
+    Bins the commands into the tiles of the image, then replays the tiles
+    over the pixels of the given disjoint rectangles.
+*/
+void execute_tiles(CommandData& data, const bpx::ImageView& image, const Rect* rects, size_t rect_count,
+                   const bpx::ExecutionPolicy& policy)
+{
+    if (data.commands.empty() || rect_count == 0 || image.width() <= 0 || image.height() <= 0) {
+        return;
+    }
+
+    const int tiles_x = (image.width() + TILE_SIZE - 1) / TILE_SIZE;
+    const int tiles_y = (image.height() + TILE_SIZE - 1) / TILE_SIZE;
+    const int tile_count = tiles_x * tiles_y;
+
+    // Bins the commands in two passes: counts those of every tile, then fills
+    // the bins in recording order, which is the order each tile replays them
+
+    const auto tile_range = [&](const Clip& b, int* tx0, int* ty0, int* tx1, int* ty1) {
+        const int x0 = std::max(b.x0, 0), y0 = std::max(b.y0, 0);
+        const int x1 = std::min(b.x1, image.width()), y1 = std::min(b.y1, image.height());
+        if (x0 >= x1 || y0 >= y1) {
+            return false;
+        }
+        *tx0 = x0 / TILE_SIZE, *ty0 = y0 / TILE_SIZE;
+        *tx1 = (x1 - 1) / TILE_SIZE + 1, *ty1 = (y1 - 1) / TILE_SIZE + 1;
+        return true;
+    };
+
+    data.bin_offsets.assign(tile_count + 1, 0);
+    for (const Command& command : data.commands) {
+        int tx0, ty0, tx1, ty1;
+        if (tile_range(command.bounds, &tx0, &ty0, &tx1, &ty1)) {
+            for (int ty = ty0; ty < ty1; ty++) {
+                for (int tx = tx0; tx < tx1; tx++) {
+                    data.bin_offsets[ty * tiles_x + tx + 1]++;
+                }
+            }
+        }
+    }
+    for (int t = 0; t < tile_count; t++) {
+        data.bin_offsets[t + 1] += data.bin_offsets[t];
+    }
+
+    data.bins.resize(data.bin_offsets[tile_count]);
+    std::vector<uint32_t>& cursor = data.bin_offsets;   // Shifted back by one tile once filled
+    for (uint32_t i = 0; i < data.commands.size(); i++) {
+        int tx0, ty0, tx1, ty1;
+        if (tile_range(data.commands[i].bounds, &tx0, &ty0, &tx1, &ty1)) {
+            for (int ty = ty0; ty < ty1; ty++) {
+                for (int tx = tx0; tx < tx1; tx++) {
+                    data.bins[cursor[ty * tiles_x + tx]++] = i;
+                }
+            }
+        }
+    }
+    for (int t = tile_count; t > 0; t--) {
+        cursor[t] = cursor[t - 1];
+    }
+    cursor[0] = 0;
+
+    // Every tile replays its commands once per rectangle of the region it
+    // overlaps, those being disjoint, skipping the commands outside of it
+
+    const auto run_tiles = [&](int begin, int end) {
+        for (int t = begin; t < end; t++) {
+            const int x0 = (t % tiles_x) * TILE_SIZE;
+            const int y0 = (t / tiles_x) * TILE_SIZE;
+            const Rect tile{ x0, y0, std::min(TILE_SIZE, image.width() - x0),
+                             std::min(TILE_SIZE, image.height() - y0) };
+            for (size_t r = 0; r < rect_count; r++) {
+                const Rect part = bpx::intersection(tile, rects[r]);
+                if (part.empty()) {
+                    continue;
+                }
+                const Clip clip{ part.x, part.y, part.x + part.w, part.y + part.h };
+                for (uint32_t b = data.bin_offsets[t]; b < data.bin_offsets[t + 1]; b++) {
+                    const Command& command = data.commands[data.bins[b]];
+                    if (command.bounds.x0 < clip.x1 && clip.x0 < command.bounds.x1
+                        && command.bounds.y0 < clip.y1 && clip.y0 < command.bounds.y1) {
+                        replay(data, command, image, clip);
+                    }
+                }
+            }
+        }
+    };
+
+    bpx::ThreadPool* pool = policy.pool();
+    if (pool == nullptr || pool->concurrency() == 1 || tile_count == 1) {
+        run_tiles(0, tile_count);
+        return;
+    }
+    pool->parallel_for(0, tile_count, 1, run_tiles);
+}
+
+} // namespace
+
+namespace bpx {
+
+CommandList::CommandList()
+    : m_data(std::make_unique<detail::CommandData>())
+{ }
+
+CommandList::~CommandList() = default;
+CommandList::CommandList(CommandList&&) noexcept = default;
+CommandList& CommandList::operator=(CommandList&&) noexcept = default;
+
+void CommandList::clear() noexcept
+{
+    m_data->commands.clear();
+    m_data->mappers.clear();
+    m_data->ramps.clear();
+    m_data->sources.clear();
+}
+
+bool CommandList::empty() const noexcept
+{
+    return m_data->commands.empty();
+}
+
+size_t CommandList::size() const noexcept
+{
+    return m_data->commands.size();
+}
+
+/* Recording */
+
+void CommandList::point(int x, int y, Color color, BlendMode mode)
+{
+    record(*m_data, Command::POINT, Clip{ x, y, x + 1, y + 1 }, { x, y }, mode, color);
+}
+
+void CommandList::line(int x1, int y1, int x2, int y2, Color color, BlendMode mode)
+{
+    record(*m_data, Command::LINE, span_bounds(x1, y1, x2, y2, 0), { x1, y1, x2, y2 }, mode, color);
+}
+
+void CommandList::line(int x1, int y1, int x2, int y2, const Image::Mapper& mapper)
+{
+    record(*m_data, Command::LINE_MAPPER, span_bounds(x1, y1, x2, y2, 0), { x1, y1, x2, y2 },
+           BlendMode::REPLACE, {}, add(*m_data, mapper));
+}
+
+void CommandList::line(int x1, int y1, int x2, int y2, int thick, Color color, BlendMode mode)
+{
+    record(*m_data, Command::LINE_THICK, span_bounds(x1, y1, x2, y2, thick_pad(thick)),
+           { x1, y1, x2, y2, thick }, mode, color);
+}
+
+void CommandList::line(int x1, int y1, int x2, int y2, int thick, const Image::Mapper& mapper)
+{
+    record(*m_data, Command::LINE_THICK_MAPPER, span_bounds(x1, y1, x2, y2, thick_pad(thick)),
+           { x1, y1, x2, y2, thick }, BlendMode::REPLACE, {}, add(*m_data, mapper));
+}
+
+void CommandList::line_gradient(int x1, int y1, int x2, int y2, const ColorRamp& ramp, BlendMode mode)
+{
+    record(*m_data, Command::LINE_GRADIENT, span_bounds(x1, y1, x2, y2, 0), { x1, y1, x2, y2 },
+           mode, {}, add(*m_data, ramp));
+}
+
+void CommandList::line_gradient(int x1, int y1, int x2, int y2, int thick, const ColorRamp& ramp, BlendMode mode)
+{
+    record(*m_data, Command::LINE_GRADIENT_THICK, span_bounds(x1, y1, x2, y2, thick_pad(thick)),
+           { x1, y1, x2, y2, thick }, mode, {}, add(*m_data, ramp));
+}
+
+void CommandList::rectangle(int x, int y, int w, int h, Color color, BlendMode mode)
+{
+    record(*m_data, Command::RECTANGLE, rect_bounds(x, y, w, h), { x, y, w, h }, mode, color);
+}
+
+void CommandList::rectangle(int x, int y, int w, int h, const Image::Mapper& mapper)
+{
+    record(*m_data, Command::RECTANGLE_MAPPER, rect_bounds(x, y, w, h), { x, y, w, h },
+           BlendMode::REPLACE, {}, add(*m_data, mapper));
+}
+
+void CommandList::rectangle_gradient_linear(int x, int y, int w, int h, int x_start, int y_start, int x_end, int y_end,
+                                            const ColorRamp& ramp, BlendMode mode)
+{
+    record(*m_data, Command::RECTANGLE_GRADIENT_LINEAR, rect_bounds(x, y, w, h),
+           { x, y, w, h, x_start, y_start, x_end, y_end }, mode, {}, add(*m_data, ramp));
+}
+
+void CommandList::rectangle_gradient_radial(int x, int y, int w, int h, int x_start, int y_start, int x_end, int y_end,
+                                            const ColorRamp& ramp, BlendMode mode)
+{
+    record(*m_data, Command::RECTANGLE_GRADIENT_RADIAL, rect_bounds(x, y, w, h),
+           { x, y, w, h, x_start, y_start, x_end, y_end }, mode, {}, add(*m_data, ramp));
+}
+
+void CommandList::rectangle_lines(int x, int y, int w, int h, Color color, BlendMode mode)
+{
+    rectangle_lines(x, y, w, h, 1, color, mode);
+}
+
+void CommandList::rectangle_lines(int x, int y, int w, int h, const Image::Mapper& mapper)
+{
+    rectangle_lines(x, y, w, h, 1, mapper);
+}
+
+void CommandList::rectangle_lines(int x, int y, int w, int h, int thick, Color color, BlendMode mode)
+{
+    record(*m_data, Command::RECTANGLE_LINES, rect_outline_bounds(x, y, w, h, thick), { x, y, w, h, thick },
+           mode, color);
+}
+
+void CommandList::rectangle_lines(int x, int y, int w, int h, int thick, const Image::Mapper& mapper)
+{
+    record(*m_data, Command::RECTANGLE_LINES_MAPPER, rect_outline_bounds(x, y, w, h, thick), { x, y, w, h, thick },
+           BlendMode::REPLACE, {}, add(*m_data, mapper));
+}
+
+void CommandList::circle(int cx, int cy, int radius, Color color, BlendMode mode)
+{
+    record(*m_data, Command::CIRCLE, circle_bounds(cx, cy, radius), { cx, cy, radius }, mode, color);
+}
+
+void CommandList::circle(int cx, int cy, int radius, const Image::Mapper& mapper)
+{
+    record(*m_data, Command::CIRCLE_MAPPER, circle_bounds(cx, cy, radius), { cx, cy, radius },
+           BlendMode::REPLACE, {}, add(*m_data, mapper));
+}
+
+void CommandList::circle_gradient(int cx, int cy, int radius, const ColorRamp& ramp, BlendMode mode)
+{
+    record(*m_data, Command::CIRCLE_GRADIENT, circle_bounds(cx, cy, radius), { cx, cy, radius },
+           mode, {}, add(*m_data, ramp));
+}
+
+void CommandList::circle_lines(int cx, int cy, int radius, Color color, BlendMode mode)
+{
+    record(*m_data, Command::CIRCLE_LINES, circle_bounds(cx, cy, radius), { cx, cy, radius }, mode, color);
+}
+
+void CommandList::circle_lines(int cx, int cy, int radius, const Image::Mapper& mapper)
+{
+    record(*m_data, Command::CIRCLE_LINES_MAPPER, circle_bounds(cx, cy, radius), { cx, cy, radius },
+           BlendMode::REPLACE, {}, add(*m_data, mapper));
+}
+
+void CommandList::circle_lines(int cx, int cy, int radius, int thick, Color color, BlendMode mode)
+{
+    record(*m_data, Command::CIRCLE_LINES_THICK, circle_bounds(cx, cy, radius, thick),
+           { cx, cy, radius, thick }, mode, color);
+}
+
+void CommandList::circle_lines(int cx, int cy, int radius, int thick, const Image::Mapper& mapper)
+{
+    record(*m_data, Command::CIRCLE_LINES_THICK_MAPPER, circle_bounds(cx, cy, radius, thick),
+           { cx, cy, radius, thick }, BlendMode::REPLACE, {}, add(*m_data, mapper));
+}
+
+void CommandList::draw(int x, int y, int w, int h, ConstImageView src, BlendMode mode, Filter filter)
+{
+    draw(x, y, w, h, src, 0, 0, src.width(), src.height(), mode, filter);
+}
+
+void CommandList::draw(int x_dst, int y_dst, int w_dst, int h_dst, ConstImageView src, int x_src, int y_src,
+                       int w_src, int h_src, BlendMode mode, Filter filter)
+{
+    if (w_dst <= 0 || h_dst <= 0 || w_src <= 0 || h_src <= 0) {
+        return;
+    }
+    record(*m_data, Command::DRAW, Clip{ x_dst, y_dst, x_dst + w_dst, y_dst + h_dst },
+           { x_dst, y_dst, w_dst, h_dst, x_src, y_src, w_src, h_src }, mode, {}, add(*m_data, src), filter);
+}
+
+/* Execution */
+
+void CommandList::execute(ImageView image, ExecutionPolicy policy)
+{
+    const Rect whole{ 0, 0, image.width(), image.height() };
+    execute_tiles(*m_data, image, &whole, 1, policy);
+}
+
+void CommandList::execute(ImageView image, const Region& region, ExecutionPolicy policy)
+{
+    execute_tiles(*m_data, image, region.rects().data(), region.rects().size(), policy);
+}
+
+} // namespace bpx
@@ -0,0 +1,517 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/container.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#   ifndef WIN32_LEAN_AND_MEAN
+#       define WIN32_LEAN_AND_MEAN
+#   endif
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+/*
+    File layout, every field in the byte order of the writer:
+
+        header      magic (8 bytes), version, byte order mark, image count,
+                    level count (u32 each), file size (u64)
+        images      per image: format, alpha mode, first level, level count (u32 each)
+        levels      per level: width, height (u32 each), pitch, offset (u64 each)
+        pixels      rows of each level, starting at its offset
+
+    The byte order mark is read back as 0x01020304 only on machines of the
+    byte order of the writer, since the pixels themselves are stored as is.
+*/
+
+namespace {
+
+constexpr uint8_t MAGIC[8] = { 0x89, 'B', 'P', 'X', '\r', '\n', 0x1A, '\n' };
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+constexpr size_t HEADER_SIZE = 32;
+constexpr size_t IMAGE_RECORD_SIZE = 16;
+constexpr size_t LEVEL_RECORD_SIZE = 24;
+
+constexpr uint32_t MAX_FORMAT = static_cast<uint32_t>(bpx::PixelFormat::BGRA_F32);
+
+size_t align_up(size_t value)
+{
+    return (value + bpx::CONTAINER_ALIGNMENT - 1) / bpx::CONTAINER_ALIGNMENT * bpx::CONTAINER_ALIGNMENT;
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& out, T value)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+/* Mapping */
+
+struct Mapping
+{
+    void* data = nullptr;
+    size_t size = 0;
+};
+
+#if defined(_WIN32)
+
+bool map_file(const std::string& path, Mapping* mapping, std::string* error)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        *error = "can't open";
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(HEADER_SIZE)) {
+        CloseHandle(file);
+        *error = "file too small";
+        return false;
+    }
+
+    // Copy on write pages, the view keeps the mapping object alive once its handle is closed
+    HANDLE object = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (object == nullptr) {
+        *error = "can't map";
+        return false;
+    }
+
+    void* data = MapViewOfFile(object, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(object);
+    if (data == nullptr) {
+        *error = "can't map";
+        return false;
+    }
+
+    mapping->data = data;
+    mapping->size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void unmap_file(void* data, size_t)
+{
+    UnmapViewOfFile(data);
+}
+
+#else
+
+bool map_file(const std::string& path, Mapping* mapping, std::string* error)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        *error = "can't open";
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(HEADER_SIZE)) {
+        ::close(fd);
+        *error = "file too small";
+        return false;
+    }
+
+    // Private mapping: writes go to copies of the pages, never to the file
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        *error = "can't map";
+        return false;
+    }
+
+    mapping->data = data;
+    mapping->size = size;
+    return true;
+}
+
+void unmap_file(void* data, size_t size)
+{
+    ::munmap(data, size);
+}
+
+#endif
+
+} // namespace anonymous
+
+namespace bpx {
+
+/* ContainerWriter */
+
+size_t ContainerWriter::add(ConstImageView image)
+{
+    if (image.data() == nullptr || image.width() <= 0 || image.height() <= 0) {
+        throw std::invalid_argument("Cannot add an empty image to a container");
+    }
+
+    m_entries.push_back({ image.format(), image.alpha_mode(), { image } });
+    return m_entries.size() - 1;
+}
+
+size_t ContainerWriter::add(const MipChain& chain)
+{
+    if (chain.level_count() == 0) {
+        throw std::invalid_argument("Cannot add an empty mipmap chain to a container");
+    }
+
+    Entry entry = { chain.format(), chain.alpha_mode(), {} };
+    for (int i = 0; i < chain.level_count(); i++) {
+        entry.levels.push_back(chain.view(i));
+    }
+    m_entries.push_back(std::move(entry));
+    return m_entries.size() - 1;
+}
+
+bool ContainerWriter::write(const std::string& path) const
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    ImageWriter writer;
+    writer.write = [file](const void* data, size_t size) {
+        std::fwrite(data, 1, size, file);
+    };
+
+    bool result = write(writer);
+    result = !std::ferror(file) && result;
+    return (std::fclose(file) == 0) && result;
+}
+
+bool ContainerWriter::write(const ImageWriter& writer) const
+{
+    size_t level_count = 0;
+    for (const Entry& entry : m_entries) {
+        level_count += entry.levels.size();
+    }
+
+    // Placement of the pixels, each level aligned after the records
+    const size_t records_end = HEADER_SIZE + IMAGE_RECORD_SIZE * m_entries.size() + LEVEL_RECORD_SIZE * level_count;
+    size_t file_size = records_end;
+    std::vector<size_t> offsets;
+    offsets.reserve(level_count);
+    for (const Entry& entry : m_entries) {
+        for (const ConstImageView& level : entry.levels) {
+            const size_t offset = align_up(file_size);
+            offsets.push_back(offset);
+            file_size = offset + static_cast<size_t>(level.width()) * pixel_size(entry.format) * level.height();
+        }
+    }
+
+    std::vector<uint8_t> header;
+    header.reserve(records_end);
+    header.insert(header.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    put<uint32_t>(header, VERSION);
+    put<uint32_t>(header, BYTE_ORDER_MARK);
+    put<uint32_t>(header, static_cast<uint32_t>(m_entries.size()));
+    put<uint32_t>(header, static_cast<uint32_t>(level_count));
+    put<uint64_t>(header, file_size);
+
+    uint32_t first_level = 0;
+    for (const Entry& entry : m_entries) {
+        put<uint32_t>(header, static_cast<uint32_t>(entry.format));
+        put<uint32_t>(header, static_cast<uint32_t>(entry.alpha));
+        put<uint32_t>(header, first_level);
+        put<uint32_t>(header, static_cast<uint32_t>(entry.levels.size()));
+        first_level += static_cast<uint32_t>(entry.levels.size());
+    }
+
+    size_t index = 0;
+    for (const Entry& entry : m_entries) {
+        for (const ConstImageView& level : entry.levels) {
+            put<uint32_t>(header, static_cast<uint32_t>(level.width()));
+            put<uint32_t>(header, static_cast<uint32_t>(level.height()));
+            put<uint64_t>(header, static_cast<uint64_t>(level.width()) * pixel_size(entry.format));
+            put<uint64_t>(header, offsets[index++]);
+        }
+    }
+
+    writer.write(header.data(), header.size());
+
+    // Rows are written as is, with zeros filling the gaps up to each offset
+    static const uint8_t ZEROS[CONTAINER_ALIGNMENT] = {};
+    size_t position = records_end;
+    index = 0;
+    for (const Entry& entry : m_entries) {
+        for (const ConstImageView& level : entry.levels) {
+            const size_t offset = offsets[index++];
+            if (offset > position) {
+                writer.write(ZEROS, offset - position);
+            }
+            const size_t row_size = static_cast<size_t>(level.width()) * pixel_size(entry.format);
+            if (level.is_contiguous()) {
+                writer.write(level.data(), row_size * level.height());
+            } else {
+                for (int y = 0; y < level.height(); y++) {
+                    writer.write(level.row(y), row_size);
+                }
+            }
+            position = offset + row_size * level.height();
+        }
+    }
+
+    return true;
+}
+
+/* MappedContainer */
+
+MappedContainer::MappedContainer(const std::string& path)
+{
+    std::string error;
+    *this = open(path, &error);
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+MappedContainer MappedContainer::open(const std::string& path, std::string* error)
+{
+    MappedContainer container;
+    std::string reason;
+
+    auto fail = [&](const char* what) {
+        if (error) *error = "Fail to open container " + path + " (" + what + ")";
+        return MappedContainer();
+    };
+
+    Mapping mapping;
+    if (!map_file(path, &mapping, &reason)) {
+        return fail(reason.c_str());
+    }
+    container.m_data = mapping.data;
+    container.m_size = mapping.size;
+
+    const uint8_t* data = static_cast<const uint8_t*>(mapping.data);
+    const size_t size = mapping.size;
+
+    if (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+        return fail("not a BPX container");
+    }
+    if (get<uint32_t>(data + 8) != VERSION) {
+        return fail("unsupported version");
+    }
+    if (get<uint32_t>(data + 12) != BYTE_ORDER_MARK) {
+        return fail("written with the other byte order");
+    }
+
+    const size_t image_count = get<uint32_t>(data + 16);
+    const size_t level_count = get<uint32_t>(data + 20);
+    if (get<uint64_t>(data + 24) != size) {
+        return fail("truncated file");
+    }
+
+    if (image_count > size / IMAGE_RECORD_SIZE || level_count > size / LEVEL_RECORD_SIZE) {
+        return fail("truncated header");
+    }
+    const size_t records_end = HEADER_SIZE + IMAGE_RECORD_SIZE * image_count + LEVEL_RECORD_SIZE * level_count;
+    if (records_end > size) {
+        return fail("truncated header");
+    }
+
+    const uint8_t* image_records = data + HEADER_SIZE;
+    const uint8_t* level_records = image_records + IMAGE_RECORD_SIZE * image_count;
+
+    container.m_images.reserve(image_count);
+    for (size_t i = 0; i < image_count; i++) {
+        const uint8_t* record = image_records + IMAGE_RECORD_SIZE * i;
+        const uint32_t format = get<uint32_t>(record);
+        const uint32_t alpha = get<uint32_t>(record + 4);
+        const size_t first = get<uint32_t>(record + 8);
+        const size_t count = get<uint32_t>(record + 12);
+
+        if (format > MAX_FORMAT) {
+            return fail("invalid pixel format");
+        }
+        if (alpha > static_cast<uint32_t>(AlphaMode::PREMULTIPLIED)) {
+            return fail("invalid alpha mode");
+        }
+        if (count == 0 || first > level_count || count > level_count - first) {
+            return fail("invalid level range");
+        }
+        container.m_images.push_back({ static_cast<PixelFormat>(format), static_cast<AlphaMode>(alpha),
+                                       first, static_cast<int>(count) });
+    }
+
+    container.m_levels.reserve(level_count);
+    for (size_t i = 0; i < level_count; i++) {
+        const uint8_t* record = level_records + LEVEL_RECORD_SIZE * i;
+        container.m_levels.push_back({
+            static_cast<int>(std::min<uint32_t>(get<uint32_t>(record), INT_MAX)),
+            static_cast<int>(std::min<uint32_t>(get<uint32_t>(record + 4), INT_MAX)),
+            static_cast<size_t>(get<uint64_t>(record + 8)),
+            static_cast<size_t>(get<uint64_t>(record + 16))
+        });
+    }
+
+    // Every level must lie after the records, aligned, within the file
+    for (const Entry& image : container.m_images) {
+        const size_t pixel = pixel_size(image.format);
+        for (int l = 0; l < image.level_count; l++) {
+            const Level& level = container.m_levels[image.first_level + l];
+            if (level.width <= 0 || level.height <= 0) {
+                return fail("invalid dimensions");
+            }
+            const size_t row_size = static_cast<size_t>(level.width) * pixel;
+            if (level.pitch < row_size || level.pitch % pixel != 0) {
+                return fail("invalid pitch");
+            }
+            if (level.offset < records_end || level.offset % CONTAINER_ALIGNMENT != 0 || level.offset > size) {
+                return fail("invalid offset");
+            }
+            const size_t available = size - level.offset;
+            if (row_size > available || static_cast<size_t>(level.height - 1) > (available - row_size) / level.pitch) {
+                return fail("pixels out of the file");
+            }
+        }
+    }
+
+    if (error) error->clear();
+    return container;
+}
+
+MappedContainer::~MappedContainer()
+{
+    unmap();
+}
+
+MappedContainer::MappedContainer(MappedContainer&& other) noexcept
+    : m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_images(std::move(other.m_images))
+    , m_levels(std::move(other.m_levels))
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_images.clear();
+    other.m_levels.clear();
+}
+
+MappedContainer& MappedContainer::operator=(MappedContainer&& other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_images = std::move(other.m_images);
+        m_levels = std::move(other.m_levels);
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_images.clear();
+        other.m_levels.clear();
+    }
+    return *this;
+}
+
+void MappedContainer::unmap() noexcept
+{
+    if (m_data != nullptr) {
+        unmap_file(m_data, m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+    m_images.clear();
+    m_levels.clear();
+}
+
+PixelFormat MappedContainer::format(size_t index) const
+{
+    if (index >= m_images.size()) {
+        throw std::out_of_range("Container image index out of range");
+    }
+    return m_images[index].format;
+}
+
+int MappedContainer::level_count(size_t index) const
+{
+    if (index >= m_images.size()) {
+        throw std::out_of_range("Container image index out of range");
+    }
+    return m_images[index].level_count;
+}
+
+const MappedContainer::Level& MappedContainer::find(size_t index, int level) const
+{
+    if (index >= m_images.size()) {
+        throw std::out_of_range("Container image index out of range");
+    }
+    const Entry& image = m_images[index];
+    if (level < 0 || level >= image.level_count) {
+        throw std::out_of_range("Container level index out of range");
+    }
+    return m_levels[image.first_level + level];
+}
+
+ConstImageView MappedContainer::view(size_t index, int level) const
+{
+    const Level& l = find(index, level);
+    return ConstImageView(static_cast<const uint8_t*>(m_data) + l.offset, l.width, l.height,
+                          m_images[index].format, l.pitch, m_images[index].alpha);
+}
+
+ImageView MappedContainer::view(size_t index, int level)
+{
+    const Level& l = find(index, level);
+    return ImageView(static_cast<uint8_t*>(m_data) + l.offset, l.width, l.height,
+                     m_images[index].format, l.pitch, m_images[index].alpha);
+}
+
+Image MappedContainer::image(size_t index, int level)
+{
+    const Level& l = find(index, level);
+    const PixelFormat format = m_images[index].format;
+    if (l.pitch != static_cast<size_t>(l.width) * pixel_size(format)) {
+        throw std::runtime_error("Container level has padded rows, use a view instead");
+    }
+
+    Image image(static_cast<uint8_t*>(m_data) + l.offset, l.width, l.height, format, false);
+    image.set_alpha_mode(m_images[index].alpha);
+    return image;
+}
+
+} // namespace bpx
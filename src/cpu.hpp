@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you
+ *   wrote the original software. If you use this software in a product, an acknowledgment
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_CPU_HPP
+#define BPX_CPU_HPP
+
+/*
+    Internal header, not installed.
+
+    Runtime detection of the SIMD extensions used by the kernels of the library.
+    On x86 the kernels are compiled with per-function target attributes, so the
+    library itself can be built for the baseline ISA and still pick the widest
+    implementation available on the machine it runs on. On ARM, NEON is a
+    compile-time property of the target.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define BPX_ARCH_X86
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#   define BPX_ARCH_NEON
+#endif
+
+#if defined(BPX_ARCH_X86)
+#   if defined(__GNUC__) || defined(__clang__)
+#       include <cpuid.h>
+#       define BPX_TARGET(features) __attribute__((target(features)))
+#   else
+#       include <intrin.h>
+#       define BPX_TARGET(features)
+#   endif
+#   include <immintrin.h>
+#elif defined(BPX_ARCH_NEON)
+#   include <arm_neon.h>
+#endif
+
+namespace bpx { namespace detail {
+
+struct CpuFeatures
+{
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool avx2 = false;
+    bool f16c = false;
+    bool neon = false;
+};
+
+/**
+ * @brief Returns the SIMD extensions supported by the running CPU.
+ *
+ * The detection is performed once, on the first call.
+ */
+inline const CpuFeatures& cpu_features()
+{
+    static const CpuFeatures features = [] {
+        CpuFeatures f;
+#if defined(BPX_ARCH_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        f.sse2 = __builtin_cpu_supports("sse2");
+        f.ssse3 = __builtin_cpu_supports("ssse3");
+        f.sse41 = __builtin_cpu_supports("sse4.1");
+        f.avx2 = __builtin_cpu_supports("avx2");
+        // F16C has no `__builtin_cpu_supports` name on older compilers, it is
+        // reported in bit 29 of ECX for leaf 1 and requires OS support for AVX
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+        f.f16c = __builtin_cpu_supports("avx") && (ecx & (1u << 29));
+#elif defined(BPX_ARCH_X86)
+        int info[4];
+        __cpuid(info, 0);
+        const int max_leaf = info[0];
+        __cpuid(info, 1);
+        const bool os_avx = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+        f.sse2 = (info[3] & (1 << 26)) != 0;
+        f.ssse3 = (info[2] & (1 << 9)) != 0;
+        f.sse41 = (info[2] & (1 << 19)) != 0;
+        f.f16c = os_avx && (info[2] & (1 << 28)) && (info[2] & (1 << 29));
+        if (max_leaf >= 7) {
+            __cpuidex(info, 7, 0);
+            f.avx2 = os_avx && (info[1] & (1 << 5));
+        }
+#elif defined(BPX_ARCH_NEON)
+        f.neon = true;
+#endif
+        return f;
+    }();
+    return features;
+}
+
+}} // namespace bpx::detail
+
+#endif // BPX_CPU_HPP
@@ -0,0 +1,799 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "./deflate.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+/* Constants */
+
+namespace {
+
+constexpr int WINDOW_SIZE = 32768;
+constexpr int WINDOW_MASK = WINDOW_SIZE - 1;
+
+constexpr int HASH_BITS = 15;
+constexpr int HASH_SIZE = 1 << HASH_BITS;
+
+constexpr int MIN_MATCH = 3;
+constexpr int MAX_MATCH = 258;
+
+// Matches of 3 bytes this far back cost more bits than the literals they replace
+constexpr int TOO_FAR = 4096;
+
+// Symbols per block, a new set of Huffman codes is computed for each block
+constexpr size_t BLOCK_SYMBOLS = 16384;
+
+constexpr size_t MAX_STORED = 65535;
+
+constexpr int LITLEN_CODES = 286;
+constexpr int DIST_CODES = 30;
+constexpr int CODELEN_CODES = 19;
+constexpr int END_OF_BLOCK = 256;
+
+constexpr int LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+constexpr int LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+constexpr int DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+constexpr int DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+constexpr uint8_t CODELEN_ORDER[CODELEN_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/*
+    Match finder parameters of each level, as in zlib: the search stops after
+    `max_chain` candidates or on a match of `nice_length`, and is shortened
+    when the previous match already reaches `good_length`. Levels 1 to 3 take
+    the first match found (greedy), the other levels look one byte ahead for
+    a longer match (lazy) unless the current one reaches `max_lazy`.
+*/
+struct LevelParams
+{
+    int good_length;
+    int max_lazy;       // Greedy levels: longest match whose positions are all hashed
+    int nice_length;
+    int max_chain;
+    bool lazy;
+};
+
+constexpr LevelParams LEVELS[10] = {
+    {  0,   0,   0,    0, false },
+    {  4,   4,   8,    4, false },
+    {  4,   5,  16,    8, false },
+    {  4,   6,  32,   32, false },
+    {  4,   4,  16,   16, true },
+    {  8,  16,  32,   32, true },
+    {  8,  16, 128,  128, true },
+    {  8,  32, 128,  256, true },
+    { 32, 128, 258, 1024, true },
+    { 32, 258, 258, 4096, true },
+};
+
+/*
+    Code of each match length, and of each distance (directly up to 256,
+    by 128 wide buckets above since those codes have at least 7 extra bits).
+*/
+struct CodeTables
+{
+    uint8_t length_code[MAX_MATCH + 1];
+    uint8_t dist_code_low[257];
+    uint8_t dist_code_high[256];
+
+    CodeTables() {
+        for (int i = 0; i < 28; i++) {
+            for (int l = LENGTH_BASE[i]; l < LENGTH_BASE[i] + (1 << LENGTH_EXTRA[i]); l++) {
+                length_code[l] = static_cast<uint8_t>(i);
+            }
+        }
+        length_code[MAX_MATCH] = 28;
+
+        for (int i = 0; i < DIST_CODES; i++) {
+            for (int d = DIST_BASE[i]; d < DIST_BASE[i] + (1 << DIST_EXTRA[i]); d++) {
+                if (d <= 256) dist_code_low[d] = static_cast<uint8_t>(i);
+                else dist_code_high[(d - 1) >> 7] = static_cast<uint8_t>(i);
+            }
+        }
+    }
+
+    int dist_code(int dist) const {
+        return dist <= 256 ? dist_code_low[dist] : dist_code_high[(dist - 1) >> 7];
+    }
+};
+
+const CodeTables& code_tables()
+{
+    static const CodeTables tables;
+    return tables;
+}
+
+/* Bit output */
+
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t>& out)
+        : m_out(out)
+    { }
+
+    // Deflate packs values from the least significant bit, at most 16 bits at a time here
+    void put(uint32_t value, int count) {
+        m_bits |= static_cast<uint64_t>(value) << m_count;
+        m_count += count;
+        if (m_count >= 32) {
+            const uint8_t bytes[4] = {
+                static_cast<uint8_t>(m_bits), static_cast<uint8_t>(m_bits >> 8),
+                static_cast<uint8_t>(m_bits >> 16), static_cast<uint8_t>(m_bits >> 24)
+            };
+            m_out.insert(m_out.end(), bytes, bytes + 4);
+            m_bits >>= 32;
+            m_count -= 32;
+        }
+    }
+
+    // Pads the last byte with zero bits
+    void align() {
+        while (m_count > 0) {
+            m_out.push_back(static_cast<uint8_t>(m_bits));
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+        m_bits = 0;
+        m_count = 0;
+    }
+
+    void put_bytes(const uint8_t* data, size_t size) {
+        m_out.insert(m_out.end(), data, data + size);
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    uint64_t m_bits = 0;
+    int m_count = 0;
+};
+
+/* Huffman codes */
+
+/*
+    Computes the code lengths of an optimal prefix code limited to `max_bits`
+    for the given symbol frequencies. Codes that would exceed the limit are
+    shortened and the lengths of the least frequent symbols rebalanced until
+    the code is complete again. A code is always given at least two symbols
+    so that decoders see a complete tree.
+*/
+void build_lengths(const uint32_t* freq, int n, int max_bits, uint8_t* lengths)
+{
+    std::fill(lengths, lengths + n, uint8_t(0));
+
+    int syms[LITLEN_CODES];
+    int used = 0;
+    for (int i = 0; i < n; i++) {
+        if (freq[i] != 0) syms[used++] = i;
+    }
+
+    if (used < 2) {
+        const int first = (used == 1) ? syms[0] : 0;
+        lengths[first] = 1;
+        lengths[first == 0 ? 1 : 0] = 1;
+        return;
+    }
+
+    // Huffman tree: leaves are [0, used) sorted by weight, internal nodes are appended in
+    // creation order, which is also by weight, so the two lightest nodes are always at the
+    // front of either list
+    std::sort(syms, syms + used, [freq](int a, int b) {
+        return freq[a] != freq[b] ? freq[a] < freq[b] : a < b;
+    });
+
+    uint32_t weight[2 * LITLEN_CODES];
+    int parent[2 * LITLEN_CODES];
+    for (int i = 0; i < used; i++) {
+        weight[i] = freq[syms[i]];
+    }
+
+    int leaf = 0, inner = used, nodes = used;
+    auto take = [&]() {
+        if (leaf < used && (inner >= nodes || weight[leaf] <= weight[inner])) return leaf++;
+        return inner++;
+    };
+    while (nodes < 2 * used - 1) {
+        const int a = take();
+        const int b = take();
+        weight[nodes] = weight[a] + weight[b];
+        parent[a] = parent[b] = nodes;
+        nodes++;
+    }
+
+    // Parents are created after their children, so depths resolve from the root down
+    int depth[2 * LITLEN_CODES];
+    depth[nodes - 1] = 0;
+    for (int i = nodes - 2; i >= 0; i--) {
+        depth[i] = depth[parent[i]] + 1;
+    }
+
+    int bl_count[LITLEN_CODES + 1] = {};
+    for (int i = 0; i < used; i++) {
+        bl_count[std::min(depth[i], max_bits)]++;
+    }
+
+    // Kraft sum of the clamped lengths, brought back to exactly 1 by moving leaves deeper
+    uint32_t total = 0;
+    for (int len = 1; len <= max_bits; len++) {
+        total += static_cast<uint32_t>(bl_count[len]) << (max_bits - len);
+    }
+    while (total > (1u << max_bits)) {
+        bl_count[max_bits]--;
+        for (int len = max_bits - 1; len > 0; len--) {
+            if (bl_count[len] != 0) {
+                bl_count[len]--;
+                bl_count[len + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    // The most frequent symbols, at the end of the leaves, get the shortest codes
+    int next = used - 1;
+    for (int len = 1; len <= max_bits; len++) {
+        for (int k = 0; k < bl_count[len]; k++) {
+            lengths[syms[next--]] = static_cast<uint8_t>(len);
+        }
+    }
+}
+
+/*
+    Canonical codes of the given lengths, bit reversed since Huffman codes
+    are the only values deflate stores from their most significant bit.
+*/
+void build_codes(const uint8_t* lengths, int n, uint16_t* codes)
+{
+    int bl_count[16] = {};
+    for (int i = 0; i < n; i++) {
+        bl_count[lengths[i]]++;
+    }
+    bl_count[0] = 0;
+
+    int next_code[16] = {};
+    int code = 0;
+    for (int len = 1; len < 16; len++) {
+        code = (code + bl_count[len - 1]) << 1;
+        next_code[len] = code;
+    }
+
+    for (int i = 0; i < n; i++) {
+        const int len = lengths[i];
+        uint32_t value = len ? static_cast<uint32_t>(next_code[len]++) : 0;
+        uint32_t reversed = 0;
+        for (int b = 0; b < len; b++) {
+            reversed = (reversed << 1) | (value & 1);
+            value >>= 1;
+        }
+        codes[i] = static_cast<uint16_t>(reversed);
+    }
+}
+
+struct FixedCodes
+{
+    uint8_t litlen_lengths[288];
+    uint8_t dist_lengths[32];
+    uint16_t litlen[288];
+    uint16_t dist[32];
+
+    FixedCodes() {
+        for (int i = 0; i < 288; i++) {
+            litlen_lengths[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+        }
+        std::fill(dist_lengths, dist_lengths + 32, uint8_t(5));
+        build_codes(litlen_lengths, 288, litlen);
+        build_codes(dist_lengths, 32, dist);
+    }
+};
+
+const FixedCodes& fixed_codes()
+{
+    static const FixedCodes codes;
+    return codes;
+}
+
+/* Blocks */
+
+using Symbol = bpx::detail::DeflateSymbol;
+
+void write_stored(BitWriter& bits, const uint8_t* data, size_t size, bool final)
+{
+    do {
+        const size_t n = std::min(size, MAX_STORED);
+        const bool end = (n == size);
+        bits.put((final && end) ? 1 : 0, 1);
+        bits.put(0, 2);
+        bits.align();
+        const uint8_t header[4] = {
+            static_cast<uint8_t>(n), static_cast<uint8_t>(n >> 8),
+            static_cast<uint8_t>(~n), static_cast<uint8_t>(~n >> 8)
+        };
+        bits.put_bytes(header, 4);
+        bits.put_bytes(data, n);
+        data += n;
+        size -= n;
+    } while (size > 0);
+}
+
+void write_symbols(BitWriter& bits, const Symbol* symbols, size_t count,
+                   const uint8_t* litlen_lengths, const uint16_t* litlen_codes,
+                   const uint8_t* dist_lengths, const uint16_t* dist_codes)
+{
+    const CodeTables& tables = code_tables();
+
+    for (size_t i = 0; i < count; i++) {
+        const Symbol s = symbols[i];
+        if (s.dist == 0) {
+            bits.put(litlen_codes[s.length], litlen_lengths[s.length]);
+            continue;
+        }
+        const int lc = tables.length_code[s.length];
+        bits.put(litlen_codes[257 + lc], litlen_lengths[257 + lc]);
+        if (LENGTH_EXTRA[lc]) bits.put(s.length - LENGTH_BASE[lc], LENGTH_EXTRA[lc]);
+
+        const int dc = tables.dist_code(s.dist);
+        bits.put(dist_codes[dc], dist_lengths[dc]);
+        if (DIST_EXTRA[dc]) bits.put(s.dist - DIST_BASE[dc], DIST_EXTRA[dc]);
+    }
+    bits.put(litlen_codes[END_OF_BLOCK], litlen_lengths[END_OF_BLOCK]);
+}
+
+/*
+    Writes a block with whichever of dynamic codes, fixed codes or stored
+    bytes is the smallest. `raw` is the input the symbols encode.
+*/
+void write_block(BitWriter& bits, const Symbol* symbols, size_t count,
+                 const uint8_t* raw, size_t raw_size, bool final)
+{
+    const CodeTables& tables = code_tables();
+
+    uint32_t litlen_freq[LITLEN_CODES] = {};
+    uint32_t dist_freq[DIST_CODES] = {};
+    uint64_t extra_bits = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const Symbol s = symbols[i];
+        if (s.dist == 0) {
+            litlen_freq[s.length]++;
+            continue;
+        }
+        const int lc = tables.length_code[s.length];
+        const int dc = tables.dist_code(s.dist);
+        litlen_freq[257 + lc]++;
+        dist_freq[dc]++;
+        extra_bits += LENGTH_EXTRA[lc] + DIST_EXTRA[dc];
+    }
+    litlen_freq[END_OF_BLOCK] = 1;
+
+    // Dynamic codes
+    uint8_t lengths[LITLEN_CODES + DIST_CODES];
+    uint8_t* litlen_lengths = lengths;
+    uint8_t* dist_lengths = lengths + LITLEN_CODES;
+    build_lengths(litlen_freq, LITLEN_CODES, 15, litlen_lengths);
+    build_lengths(dist_freq, DIST_CODES, 15, dist_lengths);
+
+    int hlit = LITLEN_CODES;
+    while (hlit > 257 && litlen_lengths[hlit - 1] == 0) hlit--;
+    int hdist = DIST_CODES;
+    while (hdist > 1 && dist_lengths[hdist - 1] == 0) hdist--;
+
+    // Run-length encoding of the code lengths, with codes 16 (repeat), 17 and 18 (zeros)
+    uint8_t sequence[LITLEN_CODES + DIST_CODES];
+    std::copy(litlen_lengths, litlen_lengths + hlit, sequence);
+    std::copy(dist_lengths, dist_lengths + hdist, sequence + hlit);
+    const int seq_size = hlit + hdist;
+
+    uint8_t rle_symbols[LITLEN_CODES + DIST_CODES];
+    uint8_t rle_extra[LITLEN_CODES + DIST_CODES];
+    int rle_count = 0;
+    uint32_t codelen_freq[CODELEN_CODES] = {};
+
+    auto emit = [&](int symbol, int extra) {
+        rle_symbols[rle_count] = static_cast<uint8_t>(symbol);
+        rle_extra[rle_count] = static_cast<uint8_t>(extra);
+        rle_count++;
+        codelen_freq[symbol]++;
+    };
+
+    for (int i = 0; i < seq_size; ) {
+        const int value = sequence[i];
+        int run = 1;
+        while (i + run < seq_size && sequence[i + run] == value) run++;
+        i += run;
+
+        if (value == 0) {
+            while (run >= 11) {
+                const int r = std::min(run, 138);
+                emit(18, r - 11);
+                run -= r;
+            }
+            if (run >= 3) {
+                emit(17, run - 3);
+                run = 0;
+            }
+        } else {
+            emit(value, 0);
+            run--;
+            while (run >= 3) {
+                const int r = std::min(run, 6);
+                emit(16, r - 3);
+                run -= r;
+            }
+        }
+        while (run-- > 0) {
+            emit(value, 0);
+        }
+    }
+
+    uint8_t codelen_lengths[CODELEN_CODES];
+    build_lengths(codelen_freq, CODELEN_CODES, 7, codelen_lengths);
+
+    int hclen = CODELEN_CODES;
+    while (hclen > 4 && codelen_lengths[CODELEN_ORDER[hclen - 1]] == 0) hclen--;
+
+    uint64_t dynamic_bits = 3 + 5 + 5 + 4 + 3 * hclen + extra_bits;
+    for (int i = 0; i < CODELEN_CODES; i++) {
+        dynamic_bits += static_cast<uint64_t>(codelen_freq[i]) * codelen_lengths[i];
+    }
+    dynamic_bits += 2 * codelen_freq[16] + 3 * codelen_freq[17] + 7 * codelen_freq[18];
+    for (int i = 0; i < LITLEN_CODES; i++) {
+        dynamic_bits += static_cast<uint64_t>(litlen_freq[i]) * litlen_lengths[i];
+    }
+    for (int i = 0; i < DIST_CODES; i++) {
+        dynamic_bits += static_cast<uint64_t>(dist_freq[i]) * dist_lengths[i];
+    }
+
+    // Fixed codes
+    const FixedCodes& fixed = fixed_codes();
+    uint64_t fixed_bits = 3 + extra_bits;
+    for (int i = 0; i < LITLEN_CODES; i++) {
+        fixed_bits += static_cast<uint64_t>(litlen_freq[i]) * fixed.litlen_lengths[i];
+    }
+    for (int i = 0; i < DIST_CODES; i++) {
+        fixed_bits += static_cast<uint64_t>(dist_freq[i]) * 5;
+    }
+
+    // Stored bytes, with the worst case alignment of each block header
+    const uint64_t stored_blocks = std::max<uint64_t>(1, (raw_size + MAX_STORED - 1) / MAX_STORED);
+    const uint64_t stored_bits = 8 * (static_cast<uint64_t>(raw_size) + 5 * stored_blocks);
+
+    if (stored_bits <= std::min(dynamic_bits, fixed_bits)) {
+        write_stored(bits, raw, raw_size, final);
+        return;
+    }
+
+    bits.put(final ? 1 : 0, 1);
+
+    if (fixed_bits <= dynamic_bits) {
+        bits.put(1, 2);
+        write_symbols(bits, symbols, count, fixed.litlen_lengths, fixed.litlen, fixed.dist_lengths, fixed.dist);
+        return;
+    }
+
+    bits.put(2, 2);
+    bits.put(hlit - 257, 5);
+    bits.put(hdist - 1, 5);
+    bits.put(hclen - 4, 4);
+    for (int i = 0; i < hclen; i++) {
+        bits.put(codelen_lengths[CODELEN_ORDER[i]], 3);
+    }
+
+    uint16_t codelen_codes[CODELEN_CODES];
+    build_codes(codelen_lengths, CODELEN_CODES, codelen_codes);
+    for (int i = 0; i < rle_count; i++) {
+        const int symbol = rle_symbols[i];
+        bits.put(codelen_codes[symbol], codelen_lengths[symbol]);
+        if (symbol == 16) bits.put(rle_extra[i], 2);
+        else if (symbol == 17) bits.put(rle_extra[i], 3);
+        else if (symbol == 18) bits.put(rle_extra[i], 7);
+    }
+
+    uint16_t litlen_codes[LITLEN_CODES];
+    uint16_t dist_codes[DIST_CODES];
+    build_codes(litlen_lengths, LITLEN_CODES, litlen_codes);
+    build_codes(dist_lengths, DIST_CODES, dist_codes);
+    write_symbols(bits, symbols, count, litlen_lengths, litlen_codes, dist_lengths, dist_codes);
+}
+
+/* Match finder */
+
+inline uint32_t hash3(const uint8_t* p)
+{
+    const uint32_t v = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16);
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+inline uint16_t load16(const uint8_t* p)
+{
+    uint16_t v;
+    std::memcpy(&v, p, 2);
+    return v;
+}
+
+inline int match_length(const uint8_t* a, const uint8_t* b, int max_len)
+{
+    int len = 0;
+    while (len + 8 <= max_len) {
+        uint64_t x, y;
+        std::memcpy(&x, a + len, 8);
+        std::memcpy(&y, b + len, 8);
+        if (x != y) break;
+        len += 8;
+    }
+    while (len < max_len && a[len] == b[len]) {
+        len++;
+    }
+    return len;
+}
+
+} // namespace anonymous
+
+/* Public API */
+
+namespace bpx { namespace detail {
+
+void Deflater::compress(const uint8_t* data, size_t size, size_t history, int level, bool last, std::vector<uint8_t>& out)
+{
+    BitWriter bits(out);
+    level = std::min(std::max(level, DEFLATE_MIN_LEVEL), DEFLATE_MAX_LEVEL);
+
+    if (level == 0) {
+        if (size > 0 || last) {
+            write_stored(bits, data, size, last);
+        }
+        return;
+    }
+
+    // Positions are relative to the start of the history, which must fit the window
+    history = std::min(history, static_cast<size_t>(WINDOW_SIZE));
+    const uint8_t* base = data - history;
+    const int start = static_cast<int>(history);
+    const int total = static_cast<int>(history + size);
+
+    const LevelParams params = LEVELS[level];
+
+    m_head.assign(HASH_SIZE, -1);
+    m_prev.resize(WINDOW_SIZE);
+    m_symbols.clear();
+    m_symbols.reserve(BLOCK_SYMBOLS);
+
+    int32_t* head = m_head.data();
+    int32_t* prev = m_prev.data();
+
+    auto insert = [&](int pos) -> int {
+        const uint32_t h = hash3(base + pos);
+        const int32_t candidate = head[h];
+        prev[pos & WINDOW_MASK] = candidate;
+        head[h] = pos;
+        return candidate;
+    };
+
+    // Longest match at `pos` longer than `best_len`, searching the chain from `candidate`
+    auto find_match = [&](int pos, int candidate, int best_len, int chain, int* dist) -> int {
+        const int max_len = std::min(MAX_MATCH, total - pos);
+        if (max_len < MIN_MATCH || best_len >= max_len) {
+            return 0;
+        }
+        const uint8_t* scan = base + pos;
+        const int limit = std::max(pos - WINDOW_SIZE, -1);   // Also stops on empty heads
+        int best = best_len;
+        while (candidate > limit && chain-- > 0) {
+            const uint8_t* match = base + candidate;
+            // Candidates unable to beat the best match are rejected on its last two bytes first
+            if (load16(match + best - 1) == load16(scan + best - 1) && load16(match) == load16(scan)) {
+                const int len = match_length(scan, match, max_len);
+                if (len > best) {
+                    best = len;
+                    *dist = pos - candidate;
+                    if (len >= params.nice_length || len >= max_len) break;
+                }
+            }
+            const int next = prev[candidate & WINDOW_MASK];
+            if (next >= candidate) break;
+            candidate = next;
+        }
+        if (best == MIN_MATCH && *dist > TOO_FAR) {
+            return 0;
+        }
+        return best > best_len ? best : 0;
+    };
+
+    // History positions are only hashed, the last two wait for the following bytes
+    for (int pos = 0; pos < start && pos + MIN_MATCH <= total; pos++) {
+        insert(pos);
+    }
+
+    int block_start = start;
+    int emitted = start;
+
+    auto flush_if_full = [&]() {
+        if (m_symbols.size() >= BLOCK_SYMBOLS) {
+            write_block(bits, m_symbols.data(), m_symbols.size(), base + block_start, emitted - block_start, false);
+            m_symbols.clear();
+            block_start = emitted;
+        }
+    };
+
+    auto emit_literal = [&](int pos) {
+        m_symbols.push_back({ base[pos], 0 });
+        emitted = pos + 1;
+        flush_if_full();
+    };
+
+    auto emit_match = [&](int pos, int len, int dist) {
+        m_symbols.push_back({ static_cast<uint16_t>(len), static_cast<uint16_t>(dist) });
+        emitted = pos + len;
+        flush_if_full();
+    };
+
+    int pos = start;
+    if (!params.lazy) {
+        while (pos < total) {
+            int len = 0, dist = 0;
+            if (pos + MIN_MATCH <= total) {
+                const int candidate = insert(pos);
+                len = find_match(pos, candidate, MIN_MATCH - 1, params.max_chain, &dist);
+            }
+            if (len >= MIN_MATCH) {
+                emit_match(pos, len, dist);
+                if (len <= params.max_lazy) {
+                    for (int p = pos + 1; p < pos + len && p + MIN_MATCH <= total; p++) {
+                        insert(p);
+                    }
+                }
+                pos += len;
+            } else {
+                emit_literal(pos);
+                pos++;
+            }
+        }
+    } else {
+        // A match at `pos - 1` is only taken if the match at `pos` is not longer
+        bool pending = false;
+        int prev_len = 0, prev_dist = 0;
+        while (pos < total) {
+            int len = 0, dist = 0;
+            if (pos + MIN_MATCH <= total) {
+                const int candidate = insert(pos);
+                if (prev_len < params.max_lazy) {
+                    const int chain = prev_len >= params.good_length ? params.max_chain >> 2 : params.max_chain;
+                    len = find_match(pos, candidate, std::max(prev_len, MIN_MATCH - 1), chain, &dist);
+                }
+            }
+
+            if (pending && prev_len >= MIN_MATCH && len <= prev_len) {
+                const int match_end = pos - 1 + prev_len;
+                emit_match(pos - 1, prev_len, prev_dist);
+                for (int p = pos + 1; p < match_end && p + MIN_MATCH <= total; p++) {
+                    insert(p);
+                }
+                pos = match_end;
+                pending = false;
+                prev_len = 0;
+            } else {
+                if (pending) {
+                    emit_literal(pos - 1);
+                }
+                pending = true;
+                prev_len = len;
+                prev_dist = dist;
+                pos++;
+            }
+        }
+        if (pending) {
+            emit_literal(total - 1);
+        }
+    }
+
+    write_block(bits, m_symbols.data(), m_symbols.size(), base + block_start, emitted - block_start, last);
+
+    // An empty stored block ends the segment on a byte boundary
+    if (!last) {
+        bits.put(0, 3);
+        bits.align();
+        const uint8_t marker[4] = { 0x00, 0x00, 0xFF, 0xFF };
+        bits.put_bytes(marker, 4);
+    }
+    bits.align();
+}
+
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size)
+{
+    constexpr uint32_t BASE = 65521;
+    constexpr size_t NMAX = 5552;   // Largest block whose sums cannot overflow 32 bits
+
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        size_t n = std::min(size, NMAX);
+        size -= n;
+        for (; n >= 4; n -= 4, data += 4) {
+            a += data[0]; b += a;
+            a += data[1]; b += a;
+            a += data[2]; b += a;
+            a += data[3]; b += a;
+        }
+        for (; n > 0; n--, data++) {
+            a += *data; b += a;
+        }
+        a %= BASE;
+        b %= BASE;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+    constexpr uint32_t BASE = 65521;
+
+    const uint32_t rem = static_cast<uint32_t>(size2 % BASE);
+    uint32_t sum1 = adler1 & 0xFFFF;
+    uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % BASE);
+    sum1 += (adler2 & 0xFFFF) + BASE - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + BASE - rem;
+    if (sum1 >= BASE) sum1 -= BASE;
+    if (sum1 >= BASE) sum1 -= BASE;
+    if (sum2 >= (BASE << 1)) sum2 -= (BASE << 1);
+    if (sum2 >= BASE) sum2 -= BASE;
+    return (sum2 << 16) | sum1;
+}
+
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+    static const struct Table {
+        uint32_t entries[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+        }
+    } table;
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+}} // namespace bpx::detail
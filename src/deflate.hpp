@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_DEFLATE_HPP
+#define BPX_DEFLATE_HPP
+
+/*
+    Internal header, not installed.
+
+    Raw deflate (RFC 1951) compressor used by the PNG encoder. A stream can be
+    compressed in independent segments, pigz style: every segment but the last
+    ends with an empty stored block that realigns the output on a byte, so
+    segments compressed on different threads are simply concatenated. Each
+    segment is primed with the 32 KiB of data preceding it, so matches keep
+    reaching back into the previous segment and little ratio is lost.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bpx { namespace detail {
+
+/*
+    Compression levels, 0 (stored blocks) to 9 (longest match searches).
+*/
+constexpr int DEFLATE_MIN_LEVEL = 0;
+constexpr int DEFLATE_MAX_LEVEL = 9;
+
+/*
+    A literal byte, or a match of `length` bytes `dist` bytes back when
+    `dist` is not 0.
+*/
+struct DeflateSymbol
+{
+    uint16_t length;
+    uint16_t dist;
+};
+
+/*
+    Compresses the bytes [data, data + size) as one segment of a raw deflate
+    stream, appended to `out`. The `history` bytes before `data` (at most
+    32 KiB are used) are the end of the previous segments. `last` sets the
+    final block flag, otherwise the segment ends byte aligned.
+
+    The match finder tables are kept between calls, so one Deflater per
+    thread compresses many segments without allocating.
+*/
+class Deflater
+{
+public:
+    void compress(const uint8_t* data, size_t size, size_t history, int level, bool last, std::vector<uint8_t>& out);
+
+private:
+    std::vector<int32_t> m_head;                // Last position of each hash
+    std::vector<int32_t> m_prev;                // Previous position with the same hash, per window slot
+    std::vector<DeflateSymbol> m_symbols;       // Symbols of the current block
+};
+
+/*
+    Adler-32 checksum of zlib streams, `adler` being 1 for empty data.
+*/
+uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size);
+
+/*
+    Checksum of the concatenation of two blocks, from their checksums and the
+    size of the second block.
+*/
+uint32_t adler32_combine(uint32_t adler1, uint32_t adler2, size_t size2);
+
+/*
+    CRC-32 of PNG chunks, `crc` being 0 for empty data.
+*/
+uint32_t crc32(uint32_t crc, const uint8_t* data, size_t size);
+
+}} // namespace bpx::detail
+
+#endif // BPX_DEFLATE_HPP
@@ -0,0 +1,564 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/encode.hpp"
+#include "BPX/algorithm.hpp"
+#include "BPX/image.hpp"
+
+#include "./deflate.hpp"
+#include "./qoi.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#define STBIW_MALLOC(sz)         std::malloc(sz)
+#define STBIW_REALLOC(p,newsz)   std::realloc(p,newsz)
+#define STBIW_FREE(p)            std::free(p)
+
+#include <stb_image_write.h>
+
+/* PNG encoder state */
+
+namespace bpx { namespace detail {
+
+/*
+    Buffers of the PNG encoder, kept by the `ImageEncoder` between calls.
+    Segment `k` is compressed by the deflater of slot `k % slots` into its
+    own IDAT chunk.
+*/
+struct PngState
+{
+    std::vector<uint8_t> filtered;                  // Filter type byte + filtered bytes of every row
+    std::vector<std::vector<uint8_t>> chunks;       // Complete IDAT chunk of each segment
+    std::vector<uint32_t> adlers;                   // Adler-32 of the filtered bytes of each segment
+    std::vector<Deflater> deflaters;                // One per slot
+};
+
+}} // namespace bpx::detail
+
+/* Helper functions */
+
+namespace {
+
+/*
+    Size of the segments of filtered bytes compressed independently. They
+    only depend on the image, so the output does not depend on the threads.
+*/
+constexpr size_t PNG_SEGMENT_SIZE = 256 * 1024;
+
+constexpr size_t DEFLATE_WINDOW = 32768;
+
+/*
+    Byte format handed to the stb and PNG encoders for a channel count, with
+    the bytes in RGB order.
+*/
+bpx::PixelFormat encoder_format(size_t comp)
+{
+    switch (comp) {
+        case 1:  return bpx::PixelFormat::L_U8;
+        case 2:  return bpx::PixelFormat::LA_U8;
+        case 3:  return bpx::PixelFormat::RGB_U8;
+        default: return bpx::PixelFormat::RGBA_U8;
+    }
+}
+
+bool has_alpha(size_t comp)
+{
+    return comp == 2 || comp == 4;
+}
+
+void unpremultiply_row(uint8_t* row, int w, size_t comp)
+{
+    if (comp == 4) {
+        bpx::unpremultiply_span(reinterpret_cast<bpx::Color*>(row), static_cast<size_t>(w));
+        return;
+    }
+    for (int x = 0; x < w; x++, row += 2) {
+        const bpx::Color c = bpx::unpremultiply(bpx::Color{ row[0], row[0], row[0], row[1] });
+        row[0] = c.r;
+    }
+}
+
+void write_to_vector(void* context, const void* data, size_t size)
+{
+    std::vector<uint8_t>& out = *static_cast<std::vector<uint8_t>*>(context);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+void write_to_writer(void* context, const void* data, size_t size)
+{
+    static_cast<const bpx::ImageWriter*>(context)->write(data, size);
+}
+
+/*
+    Output of the stb encoders forwarded to a sink.
+*/
+struct StbOutput
+{
+    void (*sink)(void*, const void*, size_t);
+    void* context;
+};
+
+void write_from_stb(void* context, void* data, int size)
+{
+    const StbOutput* output = static_cast<const StbOutput*>(context);
+    output->sink(output->context, data, static_cast<size_t>(size));
+}
+
+template <typename Encode>
+bool write_file(const std::string& path, Encode&& encode)
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    bpx::ImageWriter writer;
+    writer.write = [file](const void* data, size_t size) {
+        std::fwrite(data, 1, size, file);
+    };
+
+    bool result = encode(writer);
+    result = !std::ferror(file) && result;
+    return (std::fclose(file) == 0) && result;
+}
+
+/* PNG helpers */
+
+void store_be32(uint8_t* dst, uint32_t value)
+{
+    dst[0] = static_cast<uint8_t>(value >> 24);
+    dst[1] = static_cast<uint8_t>(value >> 16);
+    dst[2] = static_cast<uint8_t>(value >> 8);
+    dst[3] = static_cast<uint8_t>(value);
+}
+
+/*
+    Completes a chunk laid out as 4 bytes of length, 4 bytes of type and the
+    data, by filling the length and appending the CRC.
+*/
+void finish_chunk(std::vector<uint8_t>& chunk)
+{
+    store_be32(chunk.data(), static_cast<uint32_t>(chunk.size() - 8));
+    uint8_t crc[4];
+    store_be32(crc, bpx::detail::crc32(0, chunk.data() + 4, chunk.size() - 4));
+    chunk.insert(chunk.end(), crc, crc + 4);
+}
+
+void begin_chunk(std::vector<uint8_t>& chunk, const char* type)
+{
+    chunk.clear();
+    chunk.insert(chunk.end(), 4, uint8_t(0));
+    chunk.insert(chunk.end(), type, type + 4);
+}
+
+inline uint8_t paeth(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+/*
+    Applies filter `TYPE` (1 to 4, see PngFilter) to a row, `up` being the
+    previous row or nullptr for the first one. Returns the sum of the
+    absolute values of the filtered bytes taken as signed, the heuristic
+    used to choose a filter; `dst` may be nullptr to only compute it.
+*/
+template <int TYPE>
+uint32_t filter_row(const uint8_t* row, const uint8_t* up, size_t size, size_t bpp, uint8_t* dst)
+{
+    uint32_t cost = 0;
+    for (size_t i = 0; i < size; i++) {
+        const bool left = i >= bpp;
+        const int a = left ? row[i - bpp] : 0;
+        const int b = up ? up[i] : 0;
+        const int c = (up && left) ? up[i - bpp] : 0;
+
+        int predictor;
+        switch (TYPE) {
+            case 1:  predictor = a; break;
+            case 2:  predictor = b; break;
+            case 3:  predictor = (a + b) >> 1; break;
+            case 4:  predictor = paeth(a, b, c); break;
+            default: predictor = 0; break;
+        }
+
+        const uint8_t value = static_cast<uint8_t>(row[i] - predictor);
+        cost += static_cast<uint32_t>(std::abs(static_cast<int8_t>(value)));
+        if (dst) dst[i] = value;
+    }
+    return cost;
+}
+
+uint32_t filter_row(int type, const uint8_t* row, const uint8_t* up, size_t size, size_t bpp, uint8_t* dst)
+{
+    switch (type) {
+        case 1:  return filter_row<1>(row, up, size, bpp, dst);
+        case 2:  return filter_row<2>(row, up, size, bpp, dst);
+        case 3:  return filter_row<3>(row, up, size, bpp, dst);
+        case 4:  return filter_row<4>(row, up, size, bpp, dst);
+        default: return filter_row<0>(row, up, size, bpp, dst);
+    }
+}
+
+void filter_rows(const uint8_t* rows, size_t stride, int y_begin, int y_end, size_t row_size, size_t bpp,
+                 bpx::PngFilter filter, uint8_t* filtered)
+{
+    for (int y = y_begin; y < y_end; y++) {
+        const uint8_t* row = rows + y * stride;
+        const uint8_t* up = (y > 0) ? row - stride : nullptr;
+        uint8_t* dst = filtered + y * (row_size + 1);
+
+        int type = static_cast<int>(filter);
+        if (filter == bpx::PngFilter::ADAPTIVE) {
+            uint32_t best = filter_row(0, row, up, row_size, bpp, nullptr);
+            type = 0;
+            for (int t = 1; t <= 4; t++) {
+                const uint32_t cost = filter_row(t, row, up, row_size, bpp, nullptr);
+                if (cost < best) {
+                    best = cost;
+                    type = t;
+                }
+            }
+        }
+
+        dst[0] = static_cast<uint8_t>(type);
+        filter_row(type, row, up, row_size, bpp, dst + 1);
+    }
+}
+
+} // namespace anonymous
+
+/* Public API */
+
+namespace bpx {
+
+ImageEncoder::ImageEncoder()
+    : m_png(new detail::PngState())
+{ }
+
+ImageEncoder::~ImageEncoder() = default;
+
+ImageEncoder::ImageEncoder(ImageEncoder&&) noexcept = default;
+ImageEncoder& ImageEncoder::operator=(ImageEncoder&&) noexcept = default;
+
+bool ImageEncoder::encode(ConstImageView image, EncodeFormat format, std::vector<uint8_t>& out, int quality)
+{
+    out.clear();
+    if (!encode_with(image, format, write_to_vector, &out, quality)) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ImageEncoder::encode(ConstImageView image, EncodeFormat format, const ImageWriter& writer, int quality)
+{
+    return encode_with(image, format, write_to_writer, const_cast<ImageWriter*>(&writer), quality);
+}
+
+bool ImageEncoder::encode_png(ConstImageView image, std::vector<uint8_t>& out,
+                              const PngOptions& options, ExecutionPolicy policy)
+{
+    out.clear();
+    if (!encode_png_with(image, options, policy, write_to_vector, &out)) {
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ImageEncoder::encode_png(ConstImageView image, const ImageWriter& writer,
+                              const PngOptions& options, ExecutionPolicy policy)
+{
+    return encode_png_with(image, options, policy, write_to_writer, const_cast<ImageWriter*>(&writer));
+}
+
+/*
+    Returns the rows of the image in the `target` byte format with straight
+    alpha, converted row by row into the staging buffer unless the image
+    already is.
+*/
+const uint8_t* ImageEncoder::prepare(ConstImageView image, PixelFormat target, bool contiguous,
+                                     ExecutionPolicy policy, size_t* stride)
+{
+    const int w = image.width();
+    const bool premultiplied = image.alpha_mode() == AlphaMode::PREMULTIPLIED && has_alpha(pixel_comp(image.format()));
+
+    if (image.format() == target && !premultiplied && (!contiguous || image.is_contiguous())) {
+        *stride = image.pitch();
+        return static_cast<const uint8_t*>(image.data());
+    }
+
+    const size_t comp = pixel_comp(target);
+    const size_t row_size = static_cast<size_t>(w) * comp;
+    m_staging.resize(row_size * image.height());
+
+    detail::parallel_rows(policy, 0, image.height(), w, [&](int y0, int y1) {
+        for (int y = y0; y < y1; y++) {
+            uint8_t* dst = m_staging.data() + y * row_size;
+            convert_pixels(image.format(), image.row(y), target, dst, w);
+            if (premultiplied) {
+                unpremultiply_row(dst, w, comp);
+            }
+        }
+    });
+
+    *stride = row_size;
+    return m_staging.data();
+}
+
+bool ImageEncoder::encode_with(ConstImageView image, EncodeFormat format, Sink sink, void* context, int quality)
+{
+    if (format == EncodeFormat::PNG) {
+        return encode_png_with(image, PngOptions(), ExecutionPolicy(), sink, context);
+    }
+
+    if (image.data() == nullptr || image.width() <= 0 || image.height() <= 0) {
+        return false;
+    }
+
+    const int w = image.width();
+    const int h = image.height();
+    const size_t comp = pixel_comp(image.format());
+
+    // QOI reads the BGRA order and padded rows as is, the other formats are converted to RGB(A)
+    if (format == EncodeFormat::QOI) {
+        const PixelFormat target = detail::is_qoi_format(image.format()) ? image.format()
+                                 : has_alpha(comp) ? PixelFormat::RGBA_U8 : PixelFormat::RGB_U8;
+        size_t stride;
+        const uint8_t* rows = prepare(image, target, false, ExecutionPolicy(), &stride);
+        detail::encode_qoi(rows, stride, w, h, target, static_cast<int>(pixel_comp(target)), sink, context);
+        return true;
+    }
+
+    // Only the PNG encoder takes a stride, padded rows are packed for the others
+    size_t stride;
+    const void* data = prepare(image, encoder_format(comp), true, ExecutionPolicy(), &stride);
+
+    StbOutput output = { sink, context };
+
+    int result = 0;
+    switch (format) {
+        case EncodeFormat::BMP:
+            result = stbi_write_bmp_to_func(write_from_stb, &output, w, h, static_cast<int>(comp), data);
+            break;
+        case EncodeFormat::TGA:
+            result = stbi_write_tga_to_func(write_from_stb, &output, w, h, static_cast<int>(comp), data);
+            break;
+        case EncodeFormat::JPG:
+            result = stbi_write_jpg_to_func(write_from_stb, &output, w, h, static_cast<int>(comp), data, quality);
+            break;
+        default:
+            break;
+    }
+
+    return result != 0;
+}
+
+bool ImageEncoder::encode_png_with(ConstImageView image, const PngOptions& options, ExecutionPolicy policy,
+                                   Sink sink, void* context)
+{
+    if (image.data() == nullptr || image.width() <= 0 || image.height() <= 0) {
+        return false;
+    }
+
+    if (!m_png) {
+        m_png.reset(new detail::PngState());
+    }
+    detail::PngState& png = *m_png;
+
+    const int w = image.width();
+    const int h = image.height();
+    const size_t comp = pixel_comp(image.format());
+    const size_t row_size = static_cast<size_t>(w) * comp;
+    const int level = std::min(std::max(options.compression_level, detail::DEFLATE_MIN_LEVEL), detail::DEFLATE_MAX_LEVEL);
+
+    size_t stride;
+    const uint8_t* rows = prepare(image, encoder_format(comp), false, policy, &stride);
+
+    // Filtering is pointless when the data is stored
+    const PngFilter filter = (level == 0 && options.filter == PngFilter::ADAPTIVE) ? PngFilter::NONE : options.filter;
+
+    const size_t filtered_size = (row_size + 1) * h;
+    png.filtered.resize(filtered_size);
+    detail::parallel_rows(policy, 0, h, w, [&](int y0, int y1) {
+        filter_rows(rows, stride, y0, y1, row_size, comp, filter, png.filtered.data());
+    });
+
+    // Segments are deflated on as many slots as there are threads, each slot owning a deflater
+    const size_t segments = (filtered_size + PNG_SEGMENT_SIZE - 1) / PNG_SEGMENT_SIZE;
+    ThreadPool* pool = policy.pool();
+    const size_t slots = pool ? std::min<size_t>(pool->concurrency(), segments) : 1;
+
+    if (png.chunks.size() < segments) png.chunks.resize(segments);
+    if (png.deflaters.size() < slots) png.deflaters.resize(slots);
+    png.adlers.resize(segments);
+
+    // zlib header: deflate with a 32 KiB window, the level hint, and the check bits
+    const uint8_t cmf = 0x78;
+    const uint8_t flevel = (level < 2) ? 0 : (level < 6) ? 1 : (level == 6) ? 2 : 3;
+    const uint8_t flg = static_cast<uint8_t>((flevel << 6) + 31 - ((cmf * 256 + (flevel << 6)) % 31));
+
+    auto compress_segment = [&](size_t k, detail::Deflater& deflater) {
+        const size_t begin = k * PNG_SEGMENT_SIZE;
+        const size_t size = std::min(PNG_SEGMENT_SIZE, filtered_size - begin);
+        const uint8_t* data = png.filtered.data() + begin;
+
+        std::vector<uint8_t>& chunk = png.chunks[k];
+        begin_chunk(chunk, "IDAT");
+        if (k == 0) {
+            chunk.push_back(cmf);
+            chunk.push_back(flg);
+        }
+        deflater.compress(data, size, std::min(begin, DEFLATE_WINDOW), level, k + 1 == segments, chunk);
+        finish_chunk(chunk);
+        png.adlers[k] = detail::adler32(1, data, size);
+    };
+
+    if (slots == 1) {
+        for (size_t k = 0; k < segments; k++) {
+            compress_segment(k, png.deflaters[0]);
+        }
+    } else {
+        pool->parallel_for(0, static_cast<int>(slots), 1, [&](int slot_begin, int slot_end) {
+            for (int slot = slot_begin; slot < slot_end; slot++) {
+                for (size_t k = slot; k < segments; k += slots) {
+                    compress_segment(k, png.deflaters[slot]);
+                }
+            }
+        });
+    }
+
+    uint32_t adler = png.adlers[0];
+    for (size_t k = 1; k < segments; k++) {
+        const size_t size = std::min(PNG_SEGMENT_SIZE, filtered_size - k * PNG_SEGMENT_SIZE);
+        adler = detail::adler32_combine(adler, png.adlers[k], size);
+    }
+
+    // Signature and header
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    static const uint8_t COLOR_TYPES[5] = { 0, 0, 4, 2, 6 };
+
+    uint8_t header[8 + 25];
+    std::memcpy(header, SIGNATURE, 8);
+    uint8_t* ihdr = header + 8;
+    store_be32(ihdr, 13);
+    std::memcpy(ihdr + 4, "IHDR", 4);
+    store_be32(ihdr + 8, static_cast<uint32_t>(w));
+    store_be32(ihdr + 12, static_cast<uint32_t>(h));
+    ihdr[16] = 8;                   // Bit depth
+    ihdr[17] = COLOR_TYPES[comp];
+    ihdr[18] = 0;                   // Deflate
+    ihdr[19] = 0;                   // Adaptive filtering
+    ihdr[20] = 0;                   // No interlace
+    store_be32(ihdr + 21, detail::crc32(0, ihdr + 4, 17));
+    sink(context, header, sizeof(header));
+
+    for (size_t k = 0; k < segments; k++) {
+        sink(context, png.chunks[k].data(), png.chunks[k].size());
+    }
+
+    // The Adler-32 of the whole stream closes the zlib data in a last IDAT, then IEND
+    uint8_t trailer[16 + 12];
+    store_be32(trailer, 4);
+    std::memcpy(trailer + 4, "IDAT", 4);
+    store_be32(trailer + 8, adler);
+    store_be32(trailer + 12, detail::crc32(0, trailer + 4, 8));
+    store_be32(trailer + 16, 0);
+    std::memcpy(trailer + 20, "IEND", 4);
+    store_be32(trailer + 24, detail::crc32(0, trailer + 20, 4));
+    sink(context, trailer, sizeof(trailer));
+
+    return true;
+}
+
+bool encode_image(ConstImageView image, EncodeFormat format, std::vector<uint8_t>& out, int quality)
+{
+    ImageEncoder encoder;
+    return encoder.encode(image, format, out, quality);
+}
+
+bool encode_image(ConstImageView image, EncodeFormat format, const ImageWriter& writer, int quality)
+{
+    ImageEncoder encoder;
+    return encoder.encode(image, format, writer, quality);
+}
+
+bool encode_png(ConstImageView image, std::vector<uint8_t>& out, const PngOptions& options, ExecutionPolicy policy)
+{
+    ImageEncoder encoder;
+    return encoder.encode_png(image, out, options, policy);
+}
+
+bool write_png(ConstImageView image, const std::string& path)
+{
+    return write_png(image, path, PngOptions());
+}
+
+bool write_png(ConstImageView image, const std::string& path, const PngOptions& options, ExecutionPolicy policy)
+{
+    return write_file(path, [&](const ImageWriter& writer) {
+        ImageEncoder encoder;
+        return encoder.encode_png(image, writer, options, policy);
+    });
+}
+
+bool write_bmp(ConstImageView image, const std::string& path)
+{
+    return write_file(path, [&](const ImageWriter& writer) {
+        return encode_image(image, EncodeFormat::BMP, writer);
+    });
+}
+
+bool write_tga(ConstImageView image, const std::string& path)
+{
+    return write_file(path, [&](const ImageWriter& writer) {
+        return encode_image(image, EncodeFormat::TGA, writer);
+    });
+}
+
+bool write_jpg(ConstImageView image, const std::string& path, int quality)
+{
+    return write_file(path, [&](const ImageWriter& writer) {
+        return encode_image(image, EncodeFormat::JPG, writer, quality);
+    });
+}
+
+bool write_qoi(ConstImageView image, const std::string& path)
+{
+    return write_file(path, [&](const ImageWriter& writer) {
+        return encode_image(image, EncodeFormat::QOI, writer);
+    });
+}
+
+} // namespace bpx
@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/execution.hpp"
+
+#include <exception>
+#include <algorithm>
+#include <deque>
+
+namespace bpx {
+
+struct ThreadPool::Queue
+{
+    std::mutex mutex;
+    std::deque<Task> tasks;
+};
+
+ThreadPool::ThreadPool(unsigned threads)
+    : m_pending(0), m_next(0), m_stop(false)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const size_t workers = threads - 1;
+
+    for (size_t i = 0; i < workers; i++) {
+        m_queues.emplace_back(new Queue);
+    }
+
+    m_threads.reserve(workers);
+    for (size_t i = 0; i < workers; i++) {
+        m_threads.emplace_back(&ThreadPool::worker, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(Task task)
+{
+    Queue& queue = *m_queues[m_next++ % m_queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // Counted under the wake-up mutex so a worker about to sleep cannot miss it
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending++;
+    }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::take(size_t first, Task* task)
+{
+    const size_t count = m_queues.size();
+
+    // The owner takes its most recent task, which is the most likely to be in cache
+    if (first < count) {
+        Queue& queue = *m_queues[first];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            *task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            m_pending--;
+            return true;
+        }
+    }
+
+    // Otherwise the oldest task of another queue is stolen
+    for (size_t i = 1; i <= count; i++) {
+        Queue& queue = *m_queues[(first + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            *task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_pending--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::worker(size_t index)
+{
+    for (;;) {
+        Task task;
+        if (take(index, &task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this] { return m_stop || m_pending > 0; });
+        if (m_stop && m_pending == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallel_for(int begin, int end, int grain, const std::function<void(int, int)>& body)
+{
+    if (begin >= end) {
+        return;
+    }
+
+    grain = std::max(1, grain);
+    const int chunks = (end - begin - 1) / grain + 1;
+
+    if (m_threads.empty() || chunks == 1) {
+        body(begin, end);
+        return;
+    }
+
+    struct Job
+    {
+        std::atomic<int> remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->remaining = chunks;
+
+    for (int c = 0; c < chunks; c++) {
+        const int chunk_begin = begin + c * grain;
+        const int chunk_end = std::min(end, chunk_begin + grain);
+        submit([job, &body, chunk_begin, chunk_end] {
+            try {
+                body(chunk_begin, chunk_end);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                if (!job->error) job->error = std::current_exception();
+            }
+            if (--job->remaining == 0) {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->done.notify_all();
+            }
+        });
+    }
+
+    // Help with the queued work, then wait for the chunks still running elsewhere
+    while (job->remaining > 0) {
+        Task task;
+        if (take(m_queues.size(), &task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->done.wait(lock, [&job] { return job->remaining == 0; });
+    }
+
+    if (job->error) {
+        std::rethrow_exception(job->error);
+    }
+}
+
+} // namespace bpx
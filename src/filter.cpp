@@ -0,0 +1,362 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "./filter.hpp"
+#include "./cpu.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+using bpx::Color;
+using bpx::Filter;
+using bpx::detail::FILTER_BITS;
+using bpx::detail::FILTER_ROW_BITS;
+
+/* Filter kernels */
+
+// Catmull-Rom spline, the cubic interpolating the samples with a = -0.5
+double catmull_rom(double x)
+{
+    x = std::fabs(x);
+    if (x < 1.0) return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0) return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+/* Scalar kernels */
+
+void filter_horizontal_scalar(const Color* src, const int* indices, const int16_t* weights,
+                              int taps, int32_t* dst, int count)
+{
+    constexpr int32_t round = 1 << (FILTER_BITS - FILTER_ROW_BITS - 1);
+    for (int i = 0; i < count; i++, indices += taps, weights += taps, dst += 4) {
+        int32_t r = 0, g = 0, b = 0, a = 0;
+        for (int k = 0; k < taps; k++) {
+            const Color c = src[indices[k]];
+            r += c.r * weights[k];
+            g += c.g * weights[k];
+            b += c.b * weights[k];
+            a += c.a * weights[k];
+        }
+        dst[0] = (r + round) >> (FILTER_BITS - FILTER_ROW_BITS);
+        dst[1] = (g + round) >> (FILTER_BITS - FILTER_ROW_BITS);
+        dst[2] = (b + round) >> (FILTER_BITS - FILTER_ROW_BITS);
+        dst[3] = (a + round) >> (FILTER_BITS - FILTER_ROW_BITS);
+    }
+}
+
+inline uint8_t filter_clamp(int32_t sum)
+{
+    constexpr int shift = FILTER_BITS + FILTER_ROW_BITS;
+    return static_cast<uint8_t>(std::clamp((sum + (1 << (shift - 1))) >> shift, 0, 255));
+}
+
+void filter_vertical_scalar(const int32_t* const* rows, const int16_t* weights, int taps,
+                            Color* dst, int begin, int count)
+{
+    for (int i = begin; i < count; i++) {
+        int32_t sum[4] = { 0, 0, 0, 0 };
+        for (int k = 0; k < taps; k++) {
+            const int32_t* p = rows[k] + i * 4;
+            for (int c = 0; c < 4; c++) {
+                sum[c] += p[c] * weights[k];
+            }
+        }
+        dst[i] = Color(filter_clamp(sum[0]), filter_clamp(sum[1]), filter_clamp(sum[2]), filter_clamp(sum[3]));
+    }
+}
+
+/* x86 kernels */
+
+#if defined(BPX_ARCH_X86)
+
+// Taps are taken in pairs: the channels of two pixels are interleaved and
+// multiplied by their two weights with a single multiply-add
+BPX_TARGET("sse2")
+void filter_horizontal_sse2(const Color* src, const int* indices, const int16_t* weights,
+                            int taps, int32_t* dst, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (FILTER_BITS - FILTER_ROW_BITS - 1));
+
+    for (int i = 0; i < count; i++, indices += taps, weights += taps, dst += 4) {
+        __m128i sum = zero;
+        for (int k = 0; k < taps; k += 2) {
+            uint32_t a, b;
+            std::memcpy(&a, src + indices[k], sizeof(a));
+            std::memcpy(&b, src + indices[k + 1], sizeof(b));
+            const __m128i pa = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(a)), zero);
+            const __m128i pb = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(b)), zero);
+            const __m128i w = _mm_set1_epi32(static_cast<int>((static_cast<uint32_t>(static_cast<uint16_t>(weights[k + 1])) << 16)
+                                                              | static_cast<uint16_t>(weights[k])));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(pa, pb), w));
+        }
+        sum = _mm_srai_epi32(_mm_add_epi32(sum, round), FILTER_BITS - FILTER_ROW_BITS);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), sum);
+    }
+}
+
+BPX_TARGET("sse4.1")
+inline __m128i filter_sum_sse41(const int32_t* const* rows, const int16_t* weights, int taps, int offset)
+{
+    __m128i sum = _mm_setzero_si128();
+    for (int k = 0; k < taps; k++) {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + offset));
+        sum = _mm_add_epi32(sum, _mm_mullo_epi32(p, _mm_set1_epi32(weights[k])));
+    }
+    const int shift = FILTER_BITS + FILTER_ROW_BITS;
+    return _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(1 << (shift - 1))), shift);
+}
+
+BPX_TARGET("sse4.1")
+void filter_vertical_sse41(const int32_t* const* rows, const int16_t* weights, int taps,
+                           Color* dst, int begin, int count)
+{
+    int i = begin;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i p0 = filter_sum_sse41(rows, weights, taps, i * 4);
+        const __m128i p1 = filter_sum_sse41(rows, weights, taps, i * 4 + 4);
+        const __m128i p2 = filter_sum_sse41(rows, weights, taps, i * 4 + 8);
+        const __m128i p3 = filter_sum_sse41(rows, weights, taps, i * 4 + 12);
+        const __m128i r = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), r);
+    }
+    filter_vertical_scalar(rows, weights, taps, dst, i, count);
+}
+
+BPX_TARGET("avx2")
+inline __m256i filter_sum_avx2(const int32_t* const* rows, const int16_t* weights, int taps, int offset)
+{
+    __m256i sum = _mm256_setzero_si256();
+    for (int k = 0; k < taps; k++) {
+        const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k] + offset));
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(p, _mm256_set1_epi32(weights[k])));
+    }
+    const int shift = FILTER_BITS + FILTER_ROW_BITS;
+    return _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(1 << (shift - 1))), shift);
+}
+
+BPX_TARGET("avx2")
+void filter_vertical_avx2(const int32_t* const* rows, const int16_t* weights, int taps,
+                          Color* dst, int begin, int count)
+{
+    int i = begin;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i p0 = filter_sum_avx2(rows, weights, taps, i * 4);
+        const __m256i p1 = filter_sum_avx2(rows, weights, taps, i * 4 + 8);
+        const __m256i p2 = filter_sum_avx2(rows, weights, taps, i * 4 + 16);
+        const __m256i p3 = filter_sum_avx2(rows, weights, taps, i * 4 + 24);
+        // The packs interleave the 128-bit lanes, the permutation puts the pixels back in order
+        const __m256i r = _mm256_permutevar8x32_epi32(
+            _mm256_packus_epi16(_mm256_packs_epi32(p0, p1), _mm256_packs_epi32(p2, p3)),
+            _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), r);
+    }
+    filter_vertical_sse41(rows, weights, taps, dst, i, count);
+}
+
+#endif // BPX_ARCH_X86
+
+/* NEON kernels */
+
+#if defined(BPX_ARCH_NEON) && defined(__aarch64__)
+
+#define BPX_NEON_KERNELS
+
+void filter_horizontal_neon(const Color* src, const int* indices, const int16_t* weights,
+                            int taps, int32_t* dst, int count)
+{
+    for (int i = 0; i < count; i++, indices += taps, weights += taps, dst += 4) {
+        int32x4_t sum = vdupq_n_s32(0);
+        for (int k = 0; k < taps; k++) {
+            uint32_t p;
+            std::memcpy(&p, src + indices[k], sizeof(p));
+            const int16x4_t c = vreinterpret_s16_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(p)))));
+            sum = vmlal_n_s16(sum, c, weights[k]);
+        }
+        vst1q_s32(dst, vrshrq_n_s32(sum, FILTER_BITS - FILTER_ROW_BITS));
+    }
+}
+
+void filter_vertical_neon(const int32_t* const* rows, const int16_t* weights, int taps,
+                          Color* dst, int begin, int count)
+{
+    int i = begin;
+    for (; i + 2 <= count; i += 2) {
+        int32x4_t s0 = vdupq_n_s32(0), s1 = vdupq_n_s32(0);
+        for (int k = 0; k < taps; k++) {
+            s0 = vmlaq_n_s32(s0, vld1q_s32(rows[k] + i * 4), weights[k]);
+            s1 = vmlaq_n_s32(s1, vld1q_s32(rows[k] + i * 4 + 4), weights[k]);
+        }
+        const int16x8_t r = vcombine_s16(vqmovn_s32(vrshrq_n_s32(s0, FILTER_BITS + FILTER_ROW_BITS)),
+                                         vqmovn_s32(vrshrq_n_s32(s1, FILTER_BITS + FILTER_ROW_BITS)));
+        vst1_u8(reinterpret_cast<uint8_t*>(dst + i), vqmovun_s16(r));
+    }
+    filter_vertical_scalar(rows, weights, taps, dst, i, count);
+}
+
+#endif // BPX_ARCH_NEON && __aarch64__
+
+/* Kernel dispatch */
+
+struct FilterKernels
+{
+    void (*horizontal)(const Color*, const int*, const int16_t*, int, int32_t*, int) = filter_horizontal_scalar;
+    void (*vertical)(const int32_t* const*, const int16_t*, int, Color*, int, int) = filter_vertical_scalar;
+};
+
+const FilterKernels& kernels()
+{
+    static const FilterKernels kernels = [] {
+        FilterKernels k;
+        const bpx::detail::CpuFeatures& cpu = bpx::detail::cpu_features();
+        (void)cpu;
+#if defined(BPX_ARCH_X86)
+        if (cpu.sse2) {
+            k.horizontal = filter_horizontal_sse2;
+        }
+        if (cpu.sse41) {
+            k.vertical = filter_vertical_sse41;
+        }
+        if (cpu.avx2) {
+            k.vertical = filter_vertical_avx2;
+        }
+#elif defined(BPX_NEON_KERNELS)
+        if (cpu.neon) {
+            k.horizontal = filter_horizontal_neon;
+            k.vertical = filter_vertical_neon;
+        }
+#endif
+        return k;
+    }();
+    return kernels;
+}
+
+} // namespace anonymous
+
+
+/* Filtering Implementation */
+
+namespace bpx { namespace detail {
+
+FilterWeights compute_filter_weights(Filter filter, int dst_pos, int dst_size, int src_pos, int src_size,
+                                     int begin, int end, int lo, int hi)
+{
+    // Positions in the source are 16.16 fixed-point values, exact for every destination pixel
+    constexpr int64_t ONE = int64_t(1) << 16;
+    const int64_t scale = (static_cast<int64_t>(src_size) << 16) / dst_size;
+
+    FilterWeights result;
+    switch (filter) {
+        case Filter::NEAREST:   result.taps = 1; break;
+        case Filter::BILINEAR:  result.taps = 2; break;
+        case Filter::BICUBIC:   result.taps = 4; break;
+        case Filter::BOX:       result.taps = static_cast<int>((scale + ONE - 1) >> 16) + 1; break;
+    }
+    result.taps += result.taps & 1;
+
+    const int count = end - begin;
+    result.indices.resize(static_cast<size_t>(count) * result.taps);
+    result.weights.resize(static_cast<size_t>(count) * result.taps);
+
+    std::vector<double> weights(result.taps);
+
+    for (int i = 0; i < count; i++) {
+        const int64_t t = begin + i - dst_pos;
+
+        // Edges of the destination pixel and its center, in source pixels
+        const int64_t left = src_pos * ONE + t * src_size * ONE / dst_size;
+        const int64_t right = src_pos * ONE + (t + 1) * src_size * ONE / dst_size;
+        const int64_t center = src_pos * ONE + (2 * t + 1) * src_size * ONE / (2 * static_cast<int64_t>(dst_size));
+
+        int64_t first = 0;
+        int n = 0;
+
+        switch (filter) {
+            case Filter::NEAREST: {
+                first = center >> 16;
+                weights[n++] = 1.0;
+                break;
+            }
+            case Filter::BILINEAR: {
+                const int64_t u = center - ONE / 2;
+                const double f = static_cast<double>(u & (ONE - 1)) / ONE;
+                first = u >> 16;
+                weights[n++] = 1.0 - f;
+                weights[n++] = f;
+                break;
+            }
+            case Filter::BICUBIC: {
+                const int64_t u = center - ONE / 2;
+                const double f = static_cast<double>(u & (ONE - 1)) / ONE;
+                first = (u >> 16) - 1;
+                for (int k = 0; k < 4; k++) {
+                    weights[n++] = catmull_rom(f + 1 - k);
+                }
+                break;
+            }
+            case Filter::BOX: {
+                // Each source pixel weighs the length of its overlap with the destination pixel
+                first = left >> 16;
+                for (int64_t j = first; (j << 16) < right && n < result.taps; j++) {
+                    const int64_t overlap = std::min(right, (j + 1) << 16) - std::max(left, j << 16);
+                    weights[n++] = static_cast<double>(overlap) / (right - left);
+                }
+                break;
+            }
+        }
+
+        // Quantize, then give the rounding error to the largest weight so that the sum is exact
+        int* indices = result.indices.data() + static_cast<size_t>(i) * result.taps;
+        int16_t* quantized = result.weights.data() + static_cast<size_t>(i) * result.taps;
+
+        int sum = 0, largest = 0;
+        for (int k = 0; k < result.taps; k++) {
+            const int64_t j = std::clamp<int64_t>(first + std::min(k, n - 1), lo, hi - 1);
+            indices[k] = static_cast<int>(j - lo);
+            quantized[k] = (k < n) ? static_cast<int16_t>(std::lround(weights[k] * (1 << FILTER_BITS))) : 0;
+            sum += quantized[k];
+            if (quantized[k] > quantized[largest]) {
+                largest = k;
+            }
+        }
+        quantized[largest] = static_cast<int16_t>(quantized[largest] + (1 << FILTER_BITS) - sum);
+    }
+
+    return result;
+}
+
+void filter_horizontal(const Color* src, const FilterWeights& weights, int32_t* dst)
+{
+    const int count = static_cast<int>(weights.indices.size() / weights.taps);
+    kernels().horizontal(src, weights.indices.data(), weights.weights.data(), weights.taps, dst, count);
+}
+
+void filter_vertical(const int32_t* const* rows, const int16_t* weights, int taps, Color* dst, int count)
+{
+    kernels().vertical(rows, weights, taps, dst, 0, count);
+}
+
+}} // namespace bpx::detail
@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_FILTER_HPP
+#define BPX_FILTER_HPP
+
+/*
+    Internal header, not installed.
+
+    Separable resampling used by the filtered `draw`. Along each axis, the
+    contributions of the source pixels to every destination pixel are
+    computed once as fixed-point weights, then rows are filtered
+    horizontally into 32-bit intermediates and combined vertically, both
+    passes with SIMD kernels selected at runtime.
+*/
+
+#include "BPX/algorithm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace bpx { namespace detail {
+
+/*
+    Fractional bits of the weights, which sum to 1 << FILTER_BITS for each
+    destination pixel, and of the horizontally filtered intermediates.
+*/
+constexpr int FILTER_BITS = 14;
+constexpr int FILTER_ROW_BITS = 7;
+
+/*
+    Contributions along one axis: destination pixel i is the sum of the
+    `taps` source pixels indices[i * taps + k] weighted by
+    weights[i * taps + k]. `taps` is even, padding taps have a weight of 0.
+*/
+struct FilterWeights
+{
+    int taps = 0;
+    std::vector<int> indices;
+    std::vector<int16_t> weights;
+};
+
+/*
+    Computes the weights of the destination pixels [begin, end) of the area
+    [dst_pos, dst_pos + dst_size), which is mapped onto the source area
+    [src_pos, src_pos + src_size) with pixel centers aligned. Source
+    indices are clamped to [lo, hi) and given relative to `lo`.
+*/
+FilterWeights compute_filter_weights(Filter filter, int dst_pos, int dst_size, int src_pos, int src_size,
+                                     int begin, int end, int lo, int hi);
+
+/*
+    Filters one row of colors horizontally: dst receives, for each pixel
+    of `weights`, four channels with FILTER_ROW_BITS fractional bits.
+*/
+void filter_horizontal(const Color* src, const FilterWeights& weights, int32_t* dst);
+
+/*
+    Combines `taps` horizontally filtered rows of `count` pixels with the
+    given weights into colors, rounded and clamped to [0, 255].
+*/
+void filter_vertical(const int32_t* const* rows, const int16_t* weights, int taps, Color* dst, int count);
+
+}} // namespace bpx::detail
+
+#endif // BPX_FILTER_HPP
@@ -19,143 +19,152 @@
 
 #include "BPX/generation.hpp"
 
-namespace bpx {
-
-Image generate_gradient_linear_1d(int width, const ColorRamp& ramp, PixelFormat format)
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+
+namespace {
+
+/*
+    Number of pixels generated at once, small enough for the scratch buffer
+    to live on the stack and stay in the L1 cache.
+*/
+constexpr int ROW_CHUNK = 256;
+
+/*
+    Creates an image whose pixels are all produced by `func`, so the storage is
+    not pre-filled. `func` is called as func(Color* colors, int count, int x, int y)
+    for consecutive chunks of each row, concurrently with a parallel policy.
+*/
+template <typename Func>
+bpx::Image generate(int width, int height, bpx::PixelFormat format,
+                    const bpx::ExecutionPolicy& policy, Func&& func)
 {
-    Image image(width, 1, BLANK, format);
-
-    for (int x = 0; x < width; x++) {
-        image.set_unsafe(x, ramp.get(static_cast<float>(x) / width));
+    const size_t size = static_cast<size_t>(std::max(width, 0)) * std::max(height, 0) * bpx::pixel_size(format);
+    void* pixels = std::malloc(size);
+    if (pixels == nullptr && size > 0) {
+        throw std::bad_alloc();
     }
 
+    bpx::Image image(pixels, width, height, format, true);
+
+    bpx::detail::parallel_rows(policy, 0, height, width, [&](int y_begin, int y_end) {
+        bpx::Color buffer[ROW_CHUNK];
+        for (int y = y_begin; y < y_end; y++) {
+            for (int x = 0; x < width; x += ROW_CHUNK) {
+                const int count = std::min(ROW_CHUNK, width - x);
+                func(buffer, count, x, y);
+                image.write_row(x, y, buffer, count);
+            }
+        }
+    });
+
     return image;
 }
 
+} // namespace anonymous
+
+namespace bpx {
+
+Image generate_gradient_linear_1d(int width, const ColorRamp& ramp, PixelFormat format,
+                                  ExecutionPolicy policy)
+{
+    return generate(width, 1, format, policy, [&](Color* colors, int count, int x, int) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = ramp.get(static_cast<float>(x + i) / width);
+        }
+    });
+}
+
 Image generate_gradient_linear(int width, int height, const ColorRamp& ramp,
                                int x_start, int y_start, int x_end, int y_end,
-                               PixelFormat format) 
+                               PixelFormat format, ExecutionPolicy policy)
 {
-    Image image(width, height, BLANK, format);
-
     float dx = x_end - x_start;
     float dy = y_end - y_start;
     float max_distance = std::sqrt(dx * dx + dy * dy);
 
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            float current_dx = x - x_start;
+    return generate(width, height, format, policy, [&](Color* colors, int count, int x, int y) {
+        for (int i = 0; i < count; i++) {
+            float current_dx = x + i - x_start;
             float current_dy = y - y_start;
             float distance = (current_dx * dx + current_dy * dy) / max_distance;
             float t = std::clamp(distance / max_distance, 0.0f, 1.0f);
-            image.set_unsafe(x, y, ramp.get(t));
+            colors[i] = ramp.get(t);
         }
-    }
-
-    return image;
+    });
 }
 
 Image generate_gradient_radial(int width, int height, const ColorRamp& ramp,
                                int x_start, int y_start, int x_end, int y_end,
-                               PixelFormat format) 
+                               PixelFormat format, ExecutionPolicy policy)
 {
-    Image image(width, height, BLANK, format);
-
     float max_distance = std::sqrt(
         (x_end - x_start) * (x_end - x_start) + 
         (y_end - y_start) * (y_end - y_start)
     );
 
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            float dx = x - x_start;
+    return generate(width, height, format, policy, [&](Color* colors, int count, int x, int y) {
+        for (int i = 0; i < count; i++) {
+            float dx = x + i - x_start;
             float dy = y - y_start;
             float distance = std::sqrt(dx * dx + dy * dy);
             float t = std::clamp(distance / max_distance, 0.0f, 1.0f);
-            image.set_unsafe(x, y, ramp.get(t));
+            colors[i] = ramp.get(t);
         }
-    }
-
-    return image;
+    });
 }
 
 Image generate_checkerboard(int width, int height, int square_w, int square_h,
                             const Color& color1, const Color& color2,
-                            PixelFormat format)
+                            PixelFormat format, ExecutionPolicy policy)
 {
-    Image image(width, height, color1);
-
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++)  {
-            image.set(x, y, ((x / square_w + y / square_h) % 2 == 0) ? color1 : color2);
+    return generate(width, height, format, policy, [&](Color* colors, int count, int x, int y) {
+        for (int i = 0; i < count; i++) {
+            colors[i] = (((x + i) / square_w + y / square_h) % 2 == 0) ? color1 : color2;
         }
-    }
-
-    return image;
+    });
 }
 
 Image generate_stripes(int width, int height, int stripe_width,
                        const Color& color1, const Color& color2,
-                       bool vertical, PixelFormat format)
+                       bool vertical, PixelFormat format, ExecutionPolicy policy)
 {
-    Image image(width, height, color1);
-
-    if (vertical) {
-        for (int y = 0; y < height; y += stripe_width) {
-            for (int x = 0; x < width; x += stripe_width) {
-                if ((x / stripe_width + y / stripe_width) % 2 == 0) {
-                    line(image, x, 0, x, height, stripe_width, color2);
-                }
-            }
+    return generate(width, height, format, policy, [&](Color* colors, int count, int x, int y) {
+        for (int i = 0; i < count; i++) {
+            const int band = (vertical ? x + i : y) / stripe_width;
+            colors[i] = (band % 2 == 0) ? color1 : color2;
         }
-    } else {
-        for (int y = 0; y < height; y += stripe_width) {
-            for (int x = 0; x < width; x += stripe_width) {
-                if ((x / stripe_width + y / stripe_width) % 2 == 0) {
-                    line(image, 0, y, width, y, stripe_width, color2);
-                }
-            }
-        }
-    }
-
-    return image;
+    });
 }
 
 Image generate_grid(int width, int height, int cell_size,
                     const Color& line_color, const Color& fill_color,
-                    PixelFormat format)
+                    PixelFormat format, ExecutionPolicy policy)
 {
-    Image image(width, height, fill_color);
-
-    for (int y = 0; y <= height; y += cell_size) {
-        line(image, 0, y, width, y, line_color);
-    }
-
-    for (int x = 0; x <= width; x += cell_size) {
-        line(image, x, 0, x, height, line_color);
-    }
-
-    return image;
+    return generate(width, height, format, policy, [&](Color* colors, int count, int x, int y) {
+        const bool row_line = (y % cell_size == 0);
+        for (int i = 0; i < count; i++) {
+            colors[i] = (row_line || (x + i) % cell_size == 0) ? line_color : fill_color;
+        }
+    });
 }
 
 Image generate_polka_dots(int width, int height, int dot_radius, int spacing,
                           const Color& dot_color, const Color& background_color,
-                          PixelFormat format)
+                          PixelFormat format, ExecutionPolicy policy)
 {
-    Image image(width, height);
-
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int cx = (x / spacing) * spacing + spacing / 2;
+    return generate(width, height, format, policy, [&](Color* colors, int count, int x, int y) {
+        for (int i = 0; i < count; i++) {
+            int cx = ((x + i) / spacing) * spacing + spacing / 2;
             int cy = (y / spacing) * spacing + spacing / 2;
-            int dx = x - cx;
+            int dx = x + i - cx;
             int dy = y - cy;
             bool is_dot = (dx * dx + dy * dy) <= (dot_radius * dot_radius);
-            image.set_unsafe(x, y, is_dot ? dot_color : background_color);
+            colors[i] = is_dot ? dot_color : background_color;
         }
-    }
-
-    return image;
+    });
 }
 
 } // namespace bpx
@@ -0,0 +1,273 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/half.hpp"
+
+#include "./cpu.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+namespace {
+
+/* Conversion tables */
+
+/*
+    Half to float uses the three tables described by Jeroen van der Zijp in
+    "Fast Half Float Conversions": the exponent selects an offset into the
+    mantissa table and a value added to the result, subnormals being
+    normalized ahead of time in the mantissa table.
+
+    Float to half uses a table indexed by the sign and exponent of the float,
+    giving the base bit pattern, how far the mantissa is shifted and whether
+    its implicit leading one is kept (subnormal results). The bits shifted out
+    are then used to round to nearest, ties to even; a carry out of the
+    mantissa correctly bumps the exponent, up to infinity.
+*/
+
+struct HalfTables
+{
+    uint32_t mantissa[2048];
+    uint32_t exponent[64];
+    uint16_t offset[64];
+
+    uint16_t base[512];
+    uint8_t shift[512];
+    uint32_t implicit[512];
+
+    HalfTables()
+    {
+        mantissa[0] = 0;
+        for (uint32_t i = 1; i < 1024; i++) {
+            uint32_t m = i << 13, e = 0;
+            while (!(m & 0x00800000)) {
+                e -= 0x00800000;
+                m <<= 1;
+            }
+            mantissa[i] = (m & ~0x00800000u) | (e + 0x38800000);
+        }
+        for (uint32_t i = 1024; i < 2048; i++) {
+            mantissa[i] = 0x38000000 + ((i - 1024) << 13);
+        }
+
+        for (uint32_t i = 0; i < 64; i++) {
+            const uint32_t sign = (i & 32) ? 0x80000000 : 0;
+            const uint32_t e = i & 31;
+            exponent[i] = sign | ((e == 31) ? 0x47800000 : (e << 23));
+            offset[i] = (e == 0) ? 0 : 1024;
+        }
+
+        for (int i = 0; i < 256; i++) {
+            const int e = i - 127;
+            uint16_t b;
+            uint8_t s;
+            uint32_t imp = 0;
+            if (e < -25) {              // Rounds to zero
+                b = 0x0000, s = 24;
+            } else if (e < -14) {       // Subnormal half
+                b = 0x0000, s = static_cast<uint8_t>(-e - 1), imp = 0x00800000;
+            } else if (e <= 15) {       // Normal half
+                b = static_cast<uint16_t>((e + 15) << 10), s = 13;
+            } else if (e < 128) {       // Overflows to infinity
+                b = 0x7C00, s = 24;
+            } else {                    // Infinity and NaN
+                b = 0x7C00, s = 13;
+            }
+            base[i] = b, base[i | 256] = b | 0x8000;
+            shift[i] = shift[i | 256] = s;
+            implicit[i] = implicit[i | 256] = imp;
+        }
+    }
+};
+
+const HalfTables& tables()
+{
+    static const HalfTables t;
+    return t;
+}
+
+inline float half_to_float_table(const HalfTables& t, uint16_t h)
+{
+    const uint32_t e = h >> 10;
+    uint32_t bits = t.mantissa[t.offset[e] + (h & 0x3FF)] + t.exponent[e];
+    if ((h & 0x7C00) == 0x7C00 && (h & 0x3FF)) {
+        bits |= 0x00400000;     // NaNs come out quiet
+    }
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline uint16_t float_to_half_table(const HalfTables& t, float f)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+
+    const uint32_t i = bits >> 23;
+    const uint32_t m = bits & 0x007FFFFF;
+
+    if ((bits & 0x7FFFFFFF) > 0x7F800000) {
+        return static_cast<uint16_t>(t.base[i] | 0x0200 | (m >> 13));
+    }
+
+    const uint32_t mantissa = m | t.implicit[i];
+    const uint32_t s = t.shift[i];
+    uint32_t h = t.base[i] + (mantissa >> s);
+
+    // Overflow entries shift out a mantissa narrower than their shift, so they never round
+    const uint32_t rest = mantissa & ((1u << s) - 1);
+    const uint32_t half = 1u << (s - 1);
+    if (rest > half || (rest == half && (h & 1))) {
+        h++;
+    }
+
+    return static_cast<uint16_t>(h);
+}
+
+/* Scalar kernels */
+
+void half_to_float_scalar(const uint16_t* src, float* dst, size_t count)
+{
+    const HalfTables& t = tables();
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = half_to_float_table(t, src[i]);
+    }
+}
+
+void float_to_half_scalar(const float* src, uint16_t* dst, size_t count)
+{
+    const HalfTables& t = tables();
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = float_to_half_table(t, src[i]);
+    }
+}
+
+/* F16C kernels */
+
+#if defined(BPX_ARCH_X86)
+
+BPX_TARGET("avx,f16c")
+void half_to_float_f16c(const uint16_t* src, float* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+    half_to_float_scalar(src + i, dst + i, count - i);
+}
+
+BPX_TARGET("avx,f16c")
+void float_to_half_f16c(const float* src, uint16_t* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+    float_to_half_scalar(src + i, dst + i, count - i);
+}
+
+#endif // BPX_ARCH_X86
+
+/* NEON kernels */
+
+#if defined(BPX_ARCH_NEON) && defined(__aarch64__)
+
+#define BPX_NEON_KERNELS
+
+void half_to_float_neon(const uint16_t* src, float* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+    }
+    half_to_float_scalar(src + i, dst + i, count - i);
+}
+
+void float_to_half_neon(const float* src, uint16_t* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+    }
+    float_to_half_scalar(src + i, dst + i, count - i);
+}
+
+#endif // BPX_ARCH_NEON && __aarch64__
+
+/* Kernel dispatch */
+
+struct HalfKernels
+{
+    void (*to_float)(const uint16_t*, float*, size_t) = half_to_float_scalar;
+    void (*to_half)(const float*, uint16_t*, size_t) = float_to_half_scalar;
+};
+
+const HalfKernels& kernels()
+{
+    static const HalfKernels kernels = [] {
+        HalfKernels k;
+        const bpx::detail::CpuFeatures& cpu = bpx::detail::cpu_features();
+        (void)cpu;
+#if defined(BPX_ARCH_X86)
+        if (cpu.f16c) {
+            k.to_float = half_to_float_f16c;
+            k.to_half = float_to_half_f16c;
+        }
+#elif defined(BPX_NEON_KERNELS)
+        if (cpu.neon) {
+            k.to_float = half_to_float_neon;
+            k.to_half = float_to_half_neon;
+        }
+#endif
+        return k;
+    }();
+    return kernels;
+}
+
+} // namespace anonymous
+
+
+/* Half Conversion Implementation */
+
+namespace bpx {
+
+float half_to_float(uint16_t value) noexcept
+{
+    return half_to_float_table(tables(), value);
+}
+
+uint16_t float_to_half(float value) noexcept
+{
+    return float_to_half_table(tables(), value);
+}
+
+void half_to_float(const uint16_t* src, float* dst, size_t count) noexcept
+{
+    kernels().to_float(src, dst, count);
+}
+
+void float_to_half(const float* src, uint16_t* dst, size_t count) noexcept
+{
+    kernels().to_half(src, dst, count);
+}
+
+} // namespace bpx
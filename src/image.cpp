@@ -19,12 +19,21 @@
 
 #include "BPX/image.hpp"
 #include "BPX/algorithm.hpp"
+#include "BPX/half.hpp"
 
+#include "./qoi.hpp"
+
+#include <algorithm>
 #include <stdexcept>
 #include <cstdint>
 #include <cstring>
 #include <cstddef>
 #include <string>
+#include <utility>
+#include <climits>
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 
@@ -34,132 +43,720 @@
 
 #include <stb_image.h>
 
+
+/* Decoding helpers */
+
 namespace {
 
-static inline uint16_t
-float_to_half_i(uint32_t ui)
+using bpx::PixelFormat;
+
+/*
+    Callback streams cannot go back, while the type of the data must be checked
+    before choosing the decoder. The bytes read from the stream are kept in
+    `head` while recording and are served again to every following pass.
+*/
+struct ReplayReader
 {
-    int s = (ui >> 16) & 0x8000;
-    int em = ui & 0x7fffffff;
+    const bpx::ImageReader* reader;
+    std::vector<char> head;
+    size_t pos = 0;
+    bool recording = false;
 
-    // bias exponent and round to nearest; 112 is relative exponent bias (127-15)
-    int h = (em - (112 << 23) + (1 << 12)) >> 13;
+    void rewind() {
+        pos = 0;
+    }
+};
 
-    // underflow: flush to zero; 113 encodes exponent -14
-    h = (em < (113 << 23)) ? 0 : h;
+int replay_read(void* user, char* data, int size)
+{
+    ReplayReader* r = static_cast<ReplayReader*>(user);
 
-    // overflow: infinity; 143 encodes exponent 16
-    h = (em >= (143 << 23)) ? 0x7c00 : h;
+    int n = static_cast<int>(std::min<size_t>(size, r->head.size() - r->pos));
+    if (n > 0) {
+        // An empty head has no storage, so there is nothing to copy from
+        std::memcpy(data, r->head.data() + r->pos, n);
+        r->pos += n;
+    }
 
-    // NaN; note that we convert all types of NaN to qNaN
-    h = (em > (255 << 23)) ? 0x7e00 : h;
+    // Streams may return less than asked before their end, which the decoders take for it
+    while (n < size) {
+        const int m = r->reader->read(data + n, size - n);
+        if (m <= 0) {
+            break;
+        }
+        if (r->recording) {
+            r->head.insert(r->head.end(), data + n, data + n + m);
+            r->pos += m;
+        }
+        n += m;
+    }
 
-    return (uint16_t)(s | h);
+    return n;
 }
 
-static inline uint32_t
-half_to_float_i(uint16_t h)
+void replay_skip(void* user, int count)
 {
-    uint32_t s = (unsigned)(h & 0x8000) << 16;
-    int em = h & 0x7fff;
+    ReplayReader* r = static_cast<ReplayReader*>(user);
+    if (count <= 0) return;
+
+    const int n = static_cast<int>(std::min<size_t>(count, r->head.size() - r->pos));
+    r->pos += n;
+    count -= n;
+
+    if (count > 0 && r->recording) {
+        // Skipped bytes are recorded too, so that the next pass can replay them
+        char buffer[256];
+        while (count > 0) {
+            const int m = r->reader->read(buffer, std::min<int>(count, sizeof(buffer)));
+            if (m <= 0) break;
+            r->head.insert(r->head.end(), buffer, buffer + m);
+            r->pos += m;
+            count -= m;
+        }
+    } else if (count > 0) {
+        r->reader->skip(count);
+    }
+}
 
-    // bias exponent and pad mantissa with 0; 112 is relative exponent bias (127-15)
-    int r = (em + (112 << 10)) << 13;
+int replay_eof(void* user)
+{
+    ReplayReader* r = static_cast<ReplayReader*>(user);
+    return (r->pos < r->head.size()) ? 0 : (r->reader->eof() ? 1 : 0);
+}
 
-    // denormal: flush to zero
-    r = (em < (1 << 10)) ? 0 : r;
+const stbi_io_callbacks replay_callbacks = { replay_read, replay_skip, replay_eof };
 
-    // infinity/NaN; note that we preserve NaN payload as a byproduct of unifying inf/nan cases
-    // 112 is an exponent bias fixup; since we already applied it once, applying it twice converts 31 to 255
-    r += (em >= (31 << 10)) ? (112 << 23) : 0;
+/*
+    Sources of encoded data, all giving access to the three decoders of stb_image
+    (8-bit, 16-bit and float) and to the checks choosing between them.
+*/
 
-    return s | r;
+struct FileSource
+{
+    FILE* file;
+
+    bool is_hdr() { return stbi_is_hdr_from_file(file) != 0; }
+    bool is_16_bit() { return stbi_is_16_bit_from_file(file) != 0; }
+    stbi_uc* load(int* w, int* h, int* c, int req) { return stbi_load_from_file(file, w, h, c, req); }
+    stbi_us* load_16(int* w, int* h, int* c, int req) { return stbi_load_from_file_16(file, w, h, c, req); }
+    float* loadf(int* w, int* h, int* c, int req) { return stbi_loadf_from_file(file, w, h, c, req); }
+};
+
+struct MemorySource
+{
+    const stbi_uc* data;
+    int size;
+
+    bool is_hdr() { return stbi_is_hdr_from_memory(data, size) != 0; }
+    bool is_16_bit() { return stbi_is_16_bit_from_memory(data, size) != 0; }
+    stbi_uc* load(int* w, int* h, int* c, int req) { return stbi_load_from_memory(data, size, w, h, c, req); }
+    stbi_us* load_16(int* w, int* h, int* c, int req) { return stbi_load_16_from_memory(data, size, w, h, c, req); }
+    float* loadf(int* w, int* h, int* c, int req) { return stbi_loadf_from_memory(data, size, w, h, c, req); }
+};
+
+struct CallbackSource
+{
+    ReplayReader replay;
+
+    // The checks record what they read, the decoder replays it
+    bool is_hdr() { check(); return stbi_is_hdr_from_callbacks(&replay_callbacks, &replay) != 0; }
+    bool is_16_bit() { check(); return stbi_is_16_bit_from_callbacks(&replay_callbacks, &replay) != 0; }
+    stbi_uc* load(int* w, int* h, int* c, int req) { decode(); return stbi_load_from_callbacks(&replay_callbacks, &replay, w, h, c, req); }
+    stbi_us* load_16(int* w, int* h, int* c, int req) { decode(); return stbi_load_16_from_callbacks(&replay_callbacks, &replay, w, h, c, req); }
+    float* loadf(int* w, int* h, int* c, int req) { decode(); return stbi_loadf_from_callbacks(&replay_callbacks, &replay, w, h, c, req); }
+
+    void check() { replay.recording = true; replay.rewind(); }
+    void decode() { replay.recording = false; replay.rewind(); }
+};
+
+bpx::Image empty_image()
+{
+    return bpx::Image(nullptr, 0, 0, PixelFormat::RGBA_U8, false);
 }
 
-static inline uint32_t
-float_to_half(float i)
+bool is_float_format(PixelFormat format)
 {
-    union { float f; uint32_t i; } v;
-    v.f = i;
-    return float_to_half_i(v.i);
+    switch (format) {
+        case PixelFormat::L_F16: case PixelFormat::LA_F16: case PixelFormat::RGB_F16:
+        case PixelFormat::BGR_F16: case PixelFormat::RGBA_F16: case PixelFormat::BGRA_F16:
+        case PixelFormat::L_F32: case PixelFormat::LA_F32: case PixelFormat::RGB_F32:
+        case PixelFormat::BGR_F32: case PixelFormat::RGBA_F32: case PixelFormat::BGRA_F32:
+            return true;
+        default:
+            return false;
+    }
 }
 
-static inline uint32_t
-half_to_float(uint16_t y)
+bool is_half_format(PixelFormat format)
 {
-    union { float f; uint32_t i; } v;
-    v.i = half_to_float_i(y);
-    return v.f;
+    switch (format) {
+        case PixelFormat::L_F16: case PixelFormat::LA_F16: case PixelFormat::RGB_F16:
+        case PixelFormat::BGR_F16: case PixelFormat::RGBA_F16: case PixelFormat::BGRA_F16:
+            return true;
+        default:
+            return false;
+    }
 }
 
-} // namespace anonymous
+bool is_bgr_format(PixelFormat format)
+{
+    switch (format) {
+        case PixelFormat::BGR_U8: case PixelFormat::BGR_F16: case PixelFormat::BGR_F32:
+        case PixelFormat::BGRA_U8: case PixelFormat::BGRA_F16: case PixelFormat::BGRA_F32:
+            return true;
+        default:
+            return false;
+    }
+}
+
+PixelFormat u8_format(int channels)
+{
+    switch (channels) {
+        case 1: return PixelFormat::L_U8;
+        case 2: return PixelFormat::LA_U8;
+        case 3: return PixelFormat::RGB_U8;
+        default: return PixelFormat::RGBA_U8;
+    }
+}
+
+PixelFormat f32_format(int channels)
+{
+    switch (channels) {
+        case 1: return PixelFormat::L_F32;
+        case 2: return PixelFormat::LA_F32;
+        case 3: return PixelFormat::RGB_F32;
+        default: return PixelFormat::RGBA_F32;
+    }
+}
+
+// Channels requested from the decoder, 0 keeping those of the file
+int requested_channels(const bpx::DecodeOptions& options)
+{
+    return options.convert ? static_cast<int>(bpx::pixel_comp(options.format)) : 0;
+}
+
+bool decode_failed(const void* data, const std::string& source, std::string* error)
+{
+    if (data) return false;
+    if (error) {
+        const char* reason = stbi_failure_reason();
+        *error = "Fail to load image " + source + (reason ? std::string(" (") + reason + ")" : std::string());
+    }
+    return true;
+}
+
+bool valid_channels(void* data, int comp, const std::string& source, std::string* error)
+{
+    if (comp >= 1 && comp <= 4) return true;
+    stbi_image_free(data);
+    if (error) {
+        *error = "Unsupported number of channels ("
+            + std::to_string(comp)
+            + ") in image ("
+            + source
+            + ")";
+    }
+    return false;
+}
+
+template <typename T>
+void swap_red_blue(T* values, size_t pixels, int comp)
+{
+    for (size_t i = 0; i < pixels; i++, values += comp) {
+        std::swap(values[0], values[2]);
+    }
+}
+
+/*
+    Takes ownership of 8-bit pixels in the `decoded` layout and converts them
+    to `target` in one pass if it differs.
+*/
+bpx::Image adopt_converted(void* data, int w, int h, PixelFormat decoded, PixelFormat target,
+                           const std::string& source, std::string* error)
+{
+    if (decoded == target) {
+        return bpx::Image(data, w, h, decoded, true);
+    }
+
+    void* pixels = std::malloc(static_cast<size_t>(w) * h * bpx::pixel_size(target));
+    if (pixels == nullptr) {
+        std::free(data);
+        if (error) *error = "Fail to load image " + source + " (out of memory)";
+        return empty_image();
+    }
+
+    bpx::convert_pixels(decoded, data, target, pixels, static_cast<size_t>(w) * h);
+    std::free(data);
+
+    return bpx::Image(pixels, w, h, target, true);
+}
+
+/*
+    Takes ownership of the 8-bit pixels returned by stb_image and converts them to
+    the requested format. On failure, the reason is stored in `error` (if not null)
+    and an empty image is returned.
+*/
+bpx::Image adopt_u8(stbi_uc* data, int w, int h, int channels, const bpx::DecodeOptions& options,
+                    const std::string& source, std::string* error)
+{
+    if (decode_failed(data, source, error)) {
+        return empty_image();
+    }
+
+    const int comp = options.convert ? requested_channels(options) : channels;
+    if (!valid_channels(data, comp, source, error)) {
+        return empty_image();
+    }
+
+    // The decoder only produces the 8-bit layouts, other formats are converted
+    const PixelFormat decoded = u8_format(comp);
+    return adopt_converted(data, w, h, decoded, options.convert ? options.format : decoded, source, error);
+}
+
+/*
+    Floats from the HDR decoder are kept as is for single precision formats and
+    converted in place for half precision ones, in chunks staged on the stack.
+*/
+bpx::Image adopt_f32(float* data, int w, int h, PixelFormat target,
+                     const std::string& source, std::string* error)
+{
+    if (decode_failed(data, source, error)) {
+        return empty_image();
+    }
+
+    const int comp = static_cast<int>(bpx::pixel_comp(target));
+    const size_t pixels = static_cast<size_t>(w) * h;
+    const size_t count = pixels * comp;
+
+    void* result = data;
+    if (is_half_format(target)) {
+        uint16_t* halves = reinterpret_cast<uint16_t*>(data);
+        constexpr size_t CHUNK = 1024;
+        uint16_t staged[CHUNK];
+        for (size_t i = 0; i < count; i += CHUNK) {
+            const size_t n = std::min(CHUNK, count - i);
+            bpx::float_to_half(data + i, staged, n);
+            std::memcpy(halves + i, staged, n * sizeof(uint16_t));
+        }
+        swap_red_blue(halves, is_bgr_format(target) ? pixels : 0, comp);
+        result = std::realloc(data, count * sizeof(uint16_t));
+        if (result == nullptr) result = data;
+    } else {
+        swap_red_blue(data, is_bgr_format(target) ? pixels : 0, comp);
+    }
+
+    return bpx::Image(result, w, h, target, true);
+}
+
+/*
+    16-bit channels are normalized in place. Floats being twice as large, the
+    buffer is grown and filled from the end, so that no value is overwritten
+    before being read. Halves have the size of the source values.
+*/
+bpx::Image adopt_u16(stbi_us* data, int w, int h, PixelFormat target,
+                     const std::string& source, std::string* error)
+{
+    if (decode_failed(data, source, error)) {
+        return empty_image();
+    }
+
+    const int comp = static_cast<int>(bpx::pixel_comp(target));
+    const size_t pixels = static_cast<size_t>(w) * h;
+    const size_t count = pixels * comp;
+
+    if (is_half_format(target)) {
+        constexpr size_t CHUNK = 1024;
+        float staged[CHUNK];
+        for (size_t i = 0; i < count; i += CHUNK) {
+            const size_t n = std::min(CHUNK, count - i);
+            for (size_t k = 0; k < n; k++) {
+                staged[k] = data[i + k] / 65535.0f;
+            }
+            bpx::float_to_half(staged, data + i, n);
+        }
+        swap_red_blue(data, is_bgr_format(target) ? pixels : 0, comp);
+        return bpx::Image(data, w, h, target, true);
+    }
+
+    float* values = static_cast<float*>(std::realloc(data, count * sizeof(float)));
+    if (values == nullptr) {
+        stbi_image_free(data);
+        if (error) *error = "Fail to load image " + source + " (out of memory)";
+        return empty_image();
+    }
+
+    // Widen in place from the back, staging each chunk so the 16-bit
+    // source is never read through the float-typed buffer
+    constexpr size_t CHUNK = 1024;
+    stbi_us staged[CHUNK];
+    for (size_t end = count; end > 0; ) {
+        const size_t n = std::min(CHUNK, end);
+        const size_t begin = end - n;
+        std::memcpy(staged, reinterpret_cast<const unsigned char*>(values) + begin * sizeof(stbi_us), n * sizeof(stbi_us));
+        for (size_t k = 0; k < n; k++) {
+            values[begin + k] = staged[k] / 65535.0f;
+        }
+        end = begin;
+    }
+    swap_red_blue(values, is_bgr_format(target) ? pixels : 0, comp);
+
+    return bpx::Image(values, w, h, target, true);
+}
+
+/*
+    Float targets (or high precision without target) decode HDR files with the
+    float decoder and 16-bit files with the 16-bit decoder, straight into the
+    buffer of the image. Everything else goes through the 8-bit decoder.
+*/
+template <typename Source>
+bpx::Image decode_with(Source& src, const bpx::DecodeOptions& options, const std::string& name, std::string* error)
+{
+    // The flip setting is thread local with the `_thread` variant, so concurrent decodes do not interfere
+    stbi_set_flip_vertically_on_load_thread(options.flip_vertically);
+
+    const int req = requested_channels(options);
+    int w{}, h{}, channels{};
+
+    const bool high_precision = options.convert ? is_float_format(options.format) : options.high_precision;
+    if (high_precision) {
+        const bool hdr = src.is_hdr();
+        if (hdr || src.is_16_bit()) {
+            void* data = nullptr;
+            if (hdr) data = src.loadf(&w, &h, &channels, req);
+            else data = src.load_16(&w, &h, &channels, req);
+
+            if (data && !options.convert && !valid_channels(data, channels, name, error)) {
+                return empty_image();
+            }
+
+            const PixelFormat target = options.convert ? options.format : f32_format(channels);
+            return hdr ? adopt_f32(static_cast<float*>(data), w, h, target, name, error)
+                       : adopt_u16(static_cast<stbi_us*>(data), w, h, target, name, error);
+        }
+    }
+
+    stbi_uc* data = src.load(&w, &h, &channels, req);
+    return adopt_u8(data, w, h, channels, options, name, error);
+}
+
+/*
+    QOI files are recognized by their magic before stb_image sees them, and
+    are decoded straight into RGB_U8, RGBA_U8 or BGRA_U8. Other targets are
+    converted from the layout of the file. The pixels having 8 bits, high
+    precision does not apply.
+*/
+bpx::Image decode_qoi(const void* data, size_t size, const bpx::DecodeOptions& options,
+                      const std::string& source, std::string* error)
+{
+    bpx::detail::QoiHeader header;
+    if (!bpx::detail::read_qoi_header(data, size, &header) || !bpx::detail::qoi_holds_pixels(header, size)) {
+        if (error) *error = "Fail to load image " + source + " (corrupt QOI header)";
+        return empty_image();
+    }
+
+    const int w = static_cast<int>(header.width);
+    const int h = static_cast<int>(header.height);
+    const PixelFormat decoded = (options.convert && bpx::detail::is_qoi_format(options.format))
+        ? options.format : u8_format(header.channels);
+
+    const size_t pitch = static_cast<size_t>(w) * bpx::pixel_size(decoded);
+    void* pixels = std::malloc(pitch * h);
+    if (pixels == nullptr) {
+        if (error) *error = "Fail to load image " + source + " (out of memory)";
+        return empty_image();
+    }
+
+    if (!bpx::detail::decode_qoi(data, size, header, decoded, pixels, pitch, options.flip_vertically)) {
+        std::free(pixels);
+        if (error) *error = "Fail to load image " + source + " (truncated QOI data)";
+        return empty_image();
+    }
+
+    return adopt_converted(pixels, w, h, decoded, options.convert ? options.format : decoded, source, error);
+}
+
+// Appends what remains of the stream, `read` returning 0 once it is exhausted
+template <typename Read>
+void read_remaining(std::vector<uint8_t>& data, Read read)
+{
+    constexpr size_t CHUNK = 64 * 1024;
+    for (;;) {
+        const size_t offset = data.size();
+        data.resize(offset + CHUNK);
+        const size_t n = read(data.data() + offset, CHUNK);
+        data.resize(offset + n);
+        if (n == 0) break;
+    }
+}
+
+bpx::Image decode_file(const std::string& file_path, const bpx::DecodeOptions& options, std::string* error)
+{
+    FILE* file = std::fopen(file_path.c_str(), "rb");
+    if (file == nullptr) {
+        if (error) *error = "Fail to load image " + file_path + " (can't fopen)";
+        return empty_image();
+    }
+
+    uint8_t magic[4];
+    const size_t n = std::fread(magic, 1, sizeof(magic), file);
+    if (bpx::detail::is_qoi(magic, n)) {
+        std::vector<uint8_t> data(magic, magic + n);
+        read_remaining(data, [file](uint8_t* dst, size_t size) {
+            return std::fread(dst, 1, size, file);
+        });
+        std::fclose(file);
+        return decode_qoi(data.data(), data.size(), options, file_path, error);
+    }
+    std::rewind(file);
 
+    FileSource src = { file };
+    bpx::Image image = decode_with(src, options, file_path, error);
+    std::fclose(file);
+    return image;
+}
+
+bpx::Image decode_memory(const void* data, size_t size, const bpx::DecodeOptions& options, std::string* error)
+{
+    if (bpx::detail::is_qoi(data, size)) {
+        return decode_qoi(data, size, options, "from memory", error);
+    }
+
+    // stb_image takes the length as an int
+    if (size > static_cast<size_t>(INT_MAX)) {
+        if (error) *error = "Fail to load image from memory (encoded data too large)";
+        return empty_image();
+    }
+
+    MemorySource src = { static_cast<const stbi_uc*>(data), static_cast<int>(size) };
+    return decode_with(src, options, "from memory", error);
+}
+
+bpx::Image decode_callbacks(const bpx::ImageReader& reader, const bpx::DecodeOptions& options, std::string* error)
+{
+    CallbackSource src;
+    src.replay.reader = &reader;
+
+    // The magic is recorded, so that stb_image reads it again for other types
+    char magic[4];
+    src.check();
+    const int n = replay_read(&src.replay, magic, sizeof(magic));
+    if (bpx::detail::is_qoi(magic, n > 0 ? n : 0)) {
+        std::vector<uint8_t> data(magic, magic + n);
+        read_remaining(data, [&reader](uint8_t* dst, size_t size) {
+            const int m = reader.read(reinterpret_cast<char*>(dst), static_cast<int>(size));
+            return static_cast<size_t>(m > 0 ? m : 0);
+        });
+        return decode_qoi(data.data(), data.size(), options, "from callbacks", error);
+    }
+
+    return decode_with(src, options, "from callbacks", error);
+}
+
+// Throws the reason of a failed decode
+bpx::Image checked(bpx::Image image, const std::string& error)
+{
+    if (image.empty()) {
+        throw std::runtime_error(error);
+    }
+    return image;
+}
+
+bpx::DecodeOptions flip_options(bool flip_vertically)
+{
+    bpx::DecodeOptions options;
+    options.flip_vertically = flip_vertically;
+    return options;
+}
+
+bpx::Image load_file_or_throw(const std::string& file_path, const bpx::DecodeOptions& options)
+{
+    std::string error;
+    bpx::Image image = decode_file(file_path, options, &error);
+    return checked(std::move(image), error);
+}
+
+/*
+    The headers are parsed first, which rejects unsupported data early, then the
+    HDR signature and the bit depth are checked. Each check starts over from the
+    beginning of the data but only reads the first bytes of the header.
+*/
+template <typename IsHdr, typename Info, typename Is16>
+bpx::ImageInfo probe_with(IsHdr is_hdr, Info info, Is16 is_16_bit, const std::string& source, std::string* error)
+{
+    bpx::ImageInfo result;
+    int w{}, h{}, channels{};
+
+    if (!info(&w, &h, &channels)) {
+        if (error) {
+            const char* reason = stbi_failure_reason();
+            *error = "Fail to probe image " + source + (reason ? std::string(" (") + reason + ")" : std::string());
+        }
+        return result;
+    }
+
+    result.width = w;
+    result.height = h;
+    result.channels = channels;
+    result.hdr = is_hdr();
+    result.bits_per_channel = result.hdr ? 32 : (is_16_bit() ? 16 : 8);
+
+    return result;
+}
+
+bpx::ImageInfo probe_qoi(const void* data, size_t size, const std::string& source, std::string* error)
+{
+    bpx::ImageInfo result;
+    bpx::detail::QoiHeader header;
+
+    if (!bpx::detail::read_qoi_header(data, size, &header)) {
+        if (error) *error = "Fail to probe image " + source + " (corrupt QOI header)";
+        return result;
+    }
+
+    result.width = static_cast<int>(header.width);
+    result.height = static_cast<int>(header.height);
+    result.channels = header.channels;
+    result.bits_per_channel = 8;
+
+    return result;
+}
+
+bpx::ImageInfo probe_file(const std::string& file_path, std::string* error)
+{
+    FILE* file = std::fopen(file_path.c_str(), "rb");
+    if (file == nullptr) {
+        if (error) *error = "Fail to probe image " + file_path + " (can't fopen)";
+        return bpx::ImageInfo();
+    }
+
+    // stb_image reads its own small chunks, a stdio buffer would only read ahead
+    std::setvbuf(file, nullptr, _IONBF, 0);
+
+    uint8_t header[bpx::detail::QOI_HEADER_SIZE];
+    const size_t n = std::fread(header, 1, sizeof(header), file);
+    if (bpx::detail::is_qoi(header, n)) {
+        std::fclose(file);
+        return probe_qoi(header, n, file_path, error);
+    }
+    std::rewind(file);
+
+    bpx::ImageInfo info = probe_with(
+        [&] { return stbi_is_hdr_from_file(file) != 0; },
+        [&](int* w, int* h, int* c) { return stbi_info_from_file(file, w, h, c) != 0; },
+        [&] { return stbi_is_16_bit_from_file(file) != 0; },
+        file_path, error);
+
+    std::fclose(file);
+    return info;
+}
+
+bpx::ImageInfo probe_memory(const void* data, size_t size, std::string* error)
+{
+    if (bpx::detail::is_qoi(data, size)) {
+        return probe_qoi(data, size, "from memory", error);
+    }
+
+    if (size > static_cast<size_t>(INT_MAX)) {
+        if (error) *error = "Fail to probe image from memory (encoded data too large)";
+        return bpx::ImageInfo();
+    }
+
+    const stbi_uc* bytes = static_cast<const stbi_uc*>(data);
+    const int len = static_cast<int>(size);
+
+    return probe_with(
+        [&] { return stbi_is_hdr_from_memory(bytes, len) != 0; },
+        [&](int* w, int* h, int* c) { return stbi_info_from_memory(bytes, len, w, h, c) != 0; },
+        [&] { return stbi_is_16_bit_from_memory(bytes, len) != 0; },
+        "from memory", error);
+}
+
+} // namespace anonymous
 
 /* Image Implementation */
 
 namespace bpx {
 
 Image::Image(const std::string& filePath, bool flip_vertically)
-    : m_owned(true)
+    : Image(load_file_or_throw(filePath, flip_options(flip_vertically)))
+{ }
+
+Image::Image(const std::string& filePath, const DecodeOptions& options)
+    : Image(load_file_or_throw(filePath, options))
+{ }
+
+Image Image::load_from_memory(const void* data, size_t size, const DecodeOptions& options)
 {
-    stbi_set_flip_vertically_on_load(flip_vertically);
+    std::string error;
+    Image image = decode_memory(data, size, options, &error);
+    return checked(std::move(image), error);
+}
 
-    int channels{};
-    stbi_uc* data = stbi_load(filePath.c_str(), &m_w, &m_h, &channels, 0);
+Image Image::load_from_memory(const void* data, size_t size, std::string* error, const DecodeOptions& options)
+{
+    return decode_memory(data, size, options, error);
+}
+
+Image Image::load_from_callbacks(const ImageReader& reader, const DecodeOptions& options)
+{
+    std::string error;
+    Image image = decode_callbacks(reader, options, &error);
+    return checked(std::move(image), error);
+}
+
+Image Image::load_from_callbacks(const ImageReader& reader, std::string* error, const DecodeOptions& options)
+{
+    return decode_callbacks(reader, options, error);
+}
 
-    if (!data) {
-        throw std::runtime_error("Fail to load image " + std::string(filePath));
+ImageInfo probe(const std::string& file_path)
+{
+    std::string error;
+    const ImageInfo info = probe_file(file_path, &error);
+    if (info.width == 0) {
+        throw std::runtime_error(error);
     }
+    return info;
+}
 
-    switch (channels) {
-        case 1:
-            m_format = PixelFormat::L_U8;
-            break;
-        case 2:
-            m_format = PixelFormat::LA_U8;
-            break;
-        case 3:
-            m_format = PixelFormat::RGB_U8;
-            break;
-        case 4:
-            m_format = PixelFormat::RGBA_U8;
-            break;
-        default:
-            stbi_image_free(data);
-            throw std::runtime_error(
-                "Unsupported number of channels ("
-                + std::to_string(channels)
-                + ") in image ("
-                + std::string(filePath)
-                + ")");
-            break;
+ImageInfo probe(const std::string& file_path, std::string* error)
+{
+    return probe_file(file_path, error);
+}
+
+ImageInfo probe(const void* data, size_t size)
+{
+    std::string error;
+    const ImageInfo info = probe_memory(data, size, &error);
+    if (info.width == 0) {
+        throw std::runtime_error(error);
     }
+    return info;
+}
 
-    m_pixels = data;
+ImageInfo probe(const void* data, size_t size, std::string* error)
+{
+    return probe_memory(data, size, error);
 }
 
 Image::Image(int w, int h, Color color, PixelFormat format)
-    : m_w(w), m_h(h), m_format(format), m_owned(true)
+    : m_format(format), m_w(w), m_h(h), m_owned(true)
 {
-    size_t size = w * h;
-    m_pixels = std::malloc(size * pixel_size(format));
+    m_pixels = std::malloc(data_size());
     if (m_pixels == nullptr) {
-        std::bad_alloc();
-    }
-    for (size_t i = 0; i < size; i++) {
-        set_unsafe(i, color);
+        throw std::bad_alloc();
     }
+    fill(*this, color);
 }
 
 Image::Image(const void* pixels, int w, int h, PixelFormat format)
-    : m_w(w), m_h(h), m_format(format), m_owned(true)
+    : m_format(format), m_w(w), m_h(h), m_owned(true)
 {
-    size_t size = w * h * pixel_size(format);
-    m_pixels = std::malloc(size);
+    m_pixels = std::malloc(data_size());
     if (m_pixels == nullptr) {
-        std::bad_alloc();
+        throw std::bad_alloc();
     }
-    std::memcpy(m_pixels, pixels, size);
+    std::memcpy(m_pixels, pixels, data_size());
 }
 
 Image::Image(void* pixels, int w, int h, PixelFormat format, bool owned)
@@ -180,6 +777,7 @@ Image::Image(Image&& other) noexcept
     , m_w(other.m_w)
     , m_h(other.m_h)
     , m_owned(other.m_owned)
+    , m_alpha(other.m_alpha)
 {
     other.m_pixels = nullptr;
     other.m_owned = false;
@@ -188,11 +786,15 @@ Image::Image(Image&& other) noexcept
 Image& Image::operator=(Image&& other) noexcept
 {
     if (this != &other) {
+        if (m_owned && m_pixels) {
+            std::free(m_pixels);
+        }
         m_pixels = other.m_pixels;
         m_format = other.m_format;
         m_w = other.m_w;
         m_h = other.m_h;
         m_owned = other.m_owned;
+        m_alpha = other.m_alpha;
 
         other.m_pixels = nullptr;
         other.m_owned = false;
@@ -202,391 +804,27 @@ Image& Image::operator=(Image&& other) noexcept
 
 Color Image::get_unsafe(size_t offset) const
 {
-    Color result{};
-
-    switch (m_format) {
-
-        case PixelFormat::L_U8: {
-            uint8_t gray = ((uint8_t*)m_pixels)[offset];
-            result = { gray, gray, gray, 255 };
-        } break;
-
-        case PixelFormat::L_F16: {
-            uint8_t gray = 255 * half_to_float(((uint16_t*)m_pixels)[offset]);
-            result = { gray, gray, gray, 255 };
-        } break;
-
-        case PixelFormat::L_F32: {
-            uint8_t gray = 255 * ((float*)m_pixels)[offset];
-            result = { gray, gray, gray, 255 };
-        } break;
-
-        case PixelFormat::LA_U8: {
-            const uint8_t *pixel = (uint8_t*)m_pixels + 2 * offset;
-            uint8_t gray = pixel[0], alpha = pixel[1];
-            result = { gray, gray, gray, alpha };
-        } break;
-
-        case PixelFormat::LA_F16: {
-            const uint16_t *pixel = (uint16_t*)m_pixels + 2 * offset;
-            uint8_t gray = 255 * half_to_float(pixel[0]);
-            uint8_t alpha = 255 * half_to_float(pixel[1]);
-            result = { gray, gray, gray, alpha };
-        } break;
-
-        case PixelFormat::LA_F32: {
-            const float *pixel = (float*)m_pixels + 2 * offset;
-            uint8_t gray = 255 * pixel[0], alpha = 255 * pixel[1];
-            result = { gray, gray, gray, alpha };
-        } break;
-
-        case PixelFormat::RGB_565: {
-            uint16_t pixel = ((uint16_t*)m_pixels)[offset];
-            result = {
-                static_cast<uint8_t>(((pixel & 0xF800) >> 11) * (255 / 31)),  // 0b1111100000000000
-                static_cast<uint8_t>(((pixel & 0x7E0) >> 5) * (255 / 63)),    // 0b0000011111100000
-                static_cast<uint8_t>((pixel & 0x1F) * (255 / 31)),            // 0b0000000000011111
-                255
-            };
-        } break;
-
-        case PixelFormat::BGR_565: {
-            uint16_t pixel = ((uint16_t*)m_pixels)[offset];
-            result = {
-                static_cast<uint8_t>((pixel & 0x1F) * (255 / 31)),            // 0b0000000000011111
-                static_cast<uint8_t>(((pixel & 0x7E0) >> 5) * (255 / 63)),    // 0b0000011111100000
-                static_cast<uint8_t>(((pixel & 0xF800) >> 11) * (255 / 31)),  // 0b1111100000000000
-                255
-            };
-        } break;
-
-        case PixelFormat::RGB_U8: {
-            const uint8_t* pixel = (uint8_t*)m_pixels + 3 * offset;
-            result = { pixel[0], pixel[1], pixel[2], 255 };
-        } break;
-
-        case PixelFormat::BGR_U8: {
-            const uint8_t* pixel = (uint8_t*)m_pixels + 3 * offset;
-            result = { pixel[2], pixel[1], pixel[0], 255 };
-        } break;
-
-        case PixelFormat::RGB_F16: {
-            const uint16_t *pixel = (uint16_t*)m_pixels + 3 * offset;
-            result = {
-                static_cast<uint8_t>(255 * half_to_float(pixel[0])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[1])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[2])),
-                255
-            };
-        } break;
-
-        case PixelFormat::BGR_F16: {
-            const uint16_t *pixel = (uint16_t*)m_pixels + 3 * offset;
-            result = {
-                static_cast<uint8_t>(255 * half_to_float(pixel[2])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[1])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[0])),
-                255
-            };
-        } break;
-
-        case PixelFormat::RGB_F32: {
-            const float *pixel = (float*)m_pixels + 3 * offset;
-            result = {
-                static_cast<uint8_t>(255 * pixel[0]),
-                static_cast<uint8_t>(255 * pixel[1]),
-                static_cast<uint8_t>(255 * pixel[2]),
-                255
-            };
-        } break;
-
-        case PixelFormat::BGR_F32: {
-            const float *pixel = (float*)m_pixels + 3 * offset;
-            result = {
-                static_cast<uint8_t>(255 * pixel[2]),
-                static_cast<uint8_t>(255 * pixel[1]),
-                static_cast<uint8_t>(255 * pixel[0]),
-                255
-            };
-        } break;
-
-        case PixelFormat::RGBA_5551: {
-            uint16_t pixel = ((uint16_t*)m_pixels)[offset];
-            result = {
-                static_cast<uint8_t>(((pixel & 0xF800) >> 11) * (255 / 31)),    // 0b1111100000000000
-                static_cast<uint8_t>(((pixel & 0x7C0) >> 6) * (255 / 31)),      // 0b0000011111000000
-                static_cast<uint8_t>(((pixel & 0x3E) >> 1) * (255 / 31)),       // 0b0000000000111110
-                static_cast<uint8_t>((pixel & 0x1) * 255)                       // 0b0000000000000001
-            };
-        } break;
-
-        case PixelFormat::BGRA_5551: {
-            uint16_t pixel = ((uint16_t*)m_pixels)[offset];
-            result = {
-                static_cast<uint8_t>(((pixel & 0x3E) >> 1) * (255 / 31)),       // 0b0000000000111110
-                static_cast<uint8_t>(((pixel & 0x7C0) >> 6) * (255 / 31)),      // 0b0000011111000000
-                static_cast<uint8_t>(((pixel & 0xF800) >> 11) * (255 / 31)),    // 0b1111100000000000
-                static_cast<uint8_t>((pixel & 0x1) * 255)                       // 0b0000000000000001
-            };
-        } break;
-
-        case PixelFormat::RGBA_4444: {
-            uint16_t pixel = ((uint16_t*)m_pixels)[offset];
-            result = {
-                static_cast<uint8_t>(((pixel & 0xF000) >> 12) * (255 / 15)),  // 0b1111000000000000
-                static_cast<uint8_t>(((pixel & 0xF00) >> 8) * (255 / 15)),    // 0b0000111100000000
-                static_cast<uint8_t>(((pixel & 0xF0) >> 4) * (255 / 15)),     // 0b0000000011110000
-                static_cast<uint8_t>((pixel & 0xF) * (255 / 15))              // 0b0000000000001111
-            };
-        } break;
-
-        case PixelFormat::BGRA_4444: {
-            uint16_t pixel = ((uint16_t*)m_pixels)[offset];
-            result = {
-                static_cast<uint8_t>(((pixel & 0xF0) >> 4) * (255 / 15)),     // 0b0000000011110000
-                static_cast<uint8_t>(((pixel & 0xF00) >> 8) * (255 / 15)),    // 0b0000111100000000
-                static_cast<uint8_t>(((pixel & 0xF000) >> 12) * (255 / 15)),  // 0b1111000000000000
-                static_cast<uint8_t>((pixel & 0xF) * (255 / 15))              // 0b0000000000001111
-            };
-        } break;
-
-        case PixelFormat::RGBA_U8: {
-            uint8_t *pixel = (uint8_t*)m_pixels + 4 * offset;
-            result = {
-                pixel[0],
-                pixel[1],
-                pixel[2],
-                pixel[3]
-            };
-        } break;
-
-        case PixelFormat::BGRA_U8: {
-            uint8_t *pixel = (uint8_t*)m_pixels + 4 * offset;
-            result = {
-                pixel[2],
-                pixel[1],
-                pixel[0],
-                pixel[3]
-            };
-        } break;
-
-        case PixelFormat::RGBA_F16: {
-            const uint16_t *pixel = (uint16_t*)m_pixels + 4 * offset;
-            result = {
-                static_cast<uint8_t>(255 * half_to_float(pixel[0])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[1])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[2])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[3]))
-            };
-        } break;
-
-        case PixelFormat::BGRA_F16: {
-            const uint16_t *pixel = (uint16_t*)m_pixels + 4 * offset;
-            result = {
-                static_cast<uint8_t>(255 * half_to_float(pixel[2])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[1])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[0])),
-                static_cast<uint8_t>(255 * half_to_float(pixel[3]))
-            };
-        } break;
-
-        case PixelFormat::RGBA_F32: {
-            const float *pixel = (float*)m_pixels + 4 * offset;
-            result = {
-                static_cast<uint8_t>(255 * pixel[0]),
-                static_cast<uint8_t>(255 * pixel[1]),
-                static_cast<uint8_t>(255 * pixel[2]),
-                static_cast<uint8_t>(255 * pixel[3])
-            };
-        } break;
-
-        case PixelFormat::BGRA_F32: {
-            const float *pixel = (float*)m_pixels + 4 * offset;
-            result = {
-                static_cast<uint8_t>(255 * pixel[2]),
-                static_cast<uint8_t>(255 * pixel[1]),
-                static_cast<uint8_t>(255 * pixel[0]),
-                static_cast<uint8_t>(255 * pixel[3])
-            };
-        } break;
-    }
-
+    Color result;
+    decode_pixels(m_format, (const uint8_t*)m_pixels + offset * pixel_size(m_format), &result, 1);
     return result;
 }
 
 Image& Image::set_unsafe(size_t offset, Color color)
 {
-    switch (m_format) {
-
-        case PixelFormat::L_U8: {
-            ((uint8_t*)m_pixels)[offset] = luminance_value(color);
-        } break;
-
-        case PixelFormat::L_F16: {
-            ((uint16_t*)m_pixels)[offset] = float_to_half(luminance_value(color) / 255.0f);
-        } break;
-
-        case PixelFormat::L_F32: {
-            ((float*)m_pixels)[offset] = luminance_value(color) / 255.0f;
-        } break;
-
-        case PixelFormat::LA_U8: {
-            uint8_t *pixel = (uint8_t*)m_pixels + 2 * offset;
-            pixel[0] = luminance_value(color);
-            pixel[1] = color.a;
-        } break;
-
-        case PixelFormat::LA_F16: {
-            uint16_t *pixel = (uint16_t*)m_pixels + 2 * offset;
-            pixel[0] = float_to_half(luminance_value(color) / 255.0f);
-            pixel[1] = float_to_half(color.a / 255.0f);
-        } break;
-
-        case PixelFormat::LA_F32: {
-            float *pixel = (float*)m_pixels + 2 * offset;
-            pixel[0] = luminance_value(color) / 255.0f;
-            pixel[1] = color.a / 255.0f;
-        } break;
-
-        case PixelFormat::RGB_565: {
-            uint16_t r = static_cast<uint16_t>(std::round(color.r * (31.0f / 255)));
-            uint16_t g = static_cast<uint16_t>(std::round(color.g * (63.0f / 255)));
-            uint16_t b = static_cast<uint16_t>(std::round(color.b * (31.0f / 255)));
-            ((uint16_t*)m_pixels)[offset] = (r << 11) | (g << 5) | b;
-        } break;
-
-        case PixelFormat::BGR_565: {
-            uint16_t r = static_cast<uint16_t>(std::round(color.r * (31.0f / 255)));
-            uint16_t g = static_cast<uint16_t>(std::round(color.g * (63.0f / 255)));
-            uint16_t b = static_cast<uint16_t>(std::round(color.b * (31.0f / 255)));
-            ((uint16_t*)m_pixels)[offset] = (b << 11) | (g << 5) | r;
-        } break;
-
-        case PixelFormat::RGB_U8: {
-            uint8_t* pixel = (uint8_t*)m_pixels + 3 * offset;
-            pixel[0] = color.r;
-            pixel[1] = color.g;
-            pixel[2] = color.b;
-        } break;
-
-        case PixelFormat::BGR_U8: {
-            uint8_t* pixel = (uint8_t*)m_pixels + 3 * offset;
-            pixel[0] = color.b;
-            pixel[1] = color.g;
-            pixel[2] = color.r;
-        } break;
-
-        case PixelFormat::RGB_F16: {
-            uint16_t *pixel = (uint16_t*)m_pixels + 3 * offset;
-            pixel[0] = float_to_half(color.r / 255.0f);
-            pixel[1] = float_to_half(color.g / 255.0f);
-            pixel[2] = float_to_half(color.b / 255.0f);
-        } break;
-
-        case PixelFormat::BGR_F16: {
-            uint16_t *pixel = (uint16_t*)m_pixels + 3 * offset;
-            pixel[0] = float_to_half(color.b / 255.0f);
-            pixel[1] = float_to_half(color.g / 255.0f);
-            pixel[2] = float_to_half(color.r / 255.0f);
-        } break;
-
-        case PixelFormat::RGB_F32: {
-            float *pixel = (float*)m_pixels + 3 * offset;
-            pixel[0] = color.r / 255.0f;
-            pixel[1] = color.g / 255.0f;
-            pixel[2] = color.b / 255.0f;
-        } break;
-
-        case PixelFormat::BGR_F32: {
-            float *pixel = (float*)m_pixels + 3 * offset;
-            pixel[0] = color.b / 255.0f;
-            pixel[1] = color.g / 255.0f;
-            pixel[2] = color.r / 255.0f;
-        } break;
-
-        case PixelFormat::RGBA_5551: {
-            uint16_t r = static_cast<uint16_t>(std::round(color.r * (31.0f / 255)));
-            uint16_t g = static_cast<uint16_t>(std::round(color.g * (31.0f / 255)));
-            uint16_t b = static_cast<uint16_t>(std::round(color.b * (31.0f / 255)));
-            uint16_t a = (static_cast<uint16_t>(color.a) > 50) ? 255 : 0;
-            ((uint16_t*)m_pixels)[offset] = (r << 11) | (g << 6) | (b << 1) | a;
-        } break;
-
-        case PixelFormat::BGRA_5551: {
-            uint16_t r = static_cast<uint16_t>(std::round(color.r * (31.0f / 255)));
-            uint16_t g = static_cast<uint16_t>(std::round(color.g * (31.0f / 255)));
-            uint16_t b = static_cast<uint16_t>(std::round(color.b * (31.0f / 255)));
-            uint16_t a = (static_cast<uint16_t>(color.a) > 50) ? 255 : 0;
-            ((uint16_t*)m_pixels)[offset] = (b << 11) | (g << 6) | (r << 1) | a;
-        } break;
-
-        case PixelFormat::RGBA_4444: {
-            uint16_t r = static_cast<uint16_t>(std::round(color.r * (15.0f / 255)));
-            uint16_t g = static_cast<uint16_t>(std::round(color.g * (15.0f / 255)));
-            uint16_t b = static_cast<uint16_t>(std::round(color.b * (15.0f / 255)));
-            uint16_t a = static_cast<uint16_t>(std::round(color.a * (15.0f / 255)));
-            ((uint16_t*)m_pixels)[offset] = (r << 12) | (g << 8) | (b << 4) | a;
-        } break;
-
-        case PixelFormat::BGRA_4444: {
-            uint16_t r = static_cast<uint16_t>(std::round(color.r * (15.0f / 255)));
-            uint16_t g = static_cast<uint16_t>(std::round(color.g * (15.0f / 255)));
-            uint16_t b = static_cast<uint16_t>(std::round(color.b * (15.0f / 255)));
-            uint16_t a = static_cast<uint16_t>(std::round(color.a * (15.0f / 255)));
-            ((uint16_t*)m_pixels)[offset] = (b << 12) | (g << 8) | (r << 4) | a;
-        } break;
-
-        case PixelFormat::RGBA_U8: {
-            uint8_t *pixel = (uint8_t*)m_pixels + 4 * offset;
-            pixel[0] = color.r;
-            pixel[1] = color.g;
-            pixel[2] = color.b;
-            pixel[3] = color.a;
-        } break;
-
-        case PixelFormat::BGRA_U8: {
-            uint8_t *pixel = (uint8_t*)m_pixels + 4 * offset;
-            pixel[0] = color.b;
-            pixel[1] = color.g;
-            pixel[2] = color.r;
-            pixel[3] = color.a;
-        } break;
-
-        case PixelFormat::RGBA_F16: {
-            uint16_t *pixel = (uint16_t*)m_pixels + 4 * offset;
-            pixel[0] = float_to_half(color.r / 255.0f);
-            pixel[1] = float_to_half(color.g / 255.0f);
-            pixel[2] = float_to_half(color.b / 255.0f);
-            pixel[3] = float_to_half(color.a / 255.0f);
-        } break;
-
-        case PixelFormat::BGRA_F16: {
-            uint16_t *pixel = (uint16_t*)m_pixels + 4 * offset;
-            pixel[0] = float_to_half(color.b / 255.0f);
-            pixel[1] = float_to_half(color.g / 255.0f);
-            pixel[2] = float_to_half(color.r / 255.0f);
-            pixel[3] = float_to_half(color.a / 255.0f);
-        } break;
-
-        case PixelFormat::RGBA_F32: {
-            float *pixel = (float*)m_pixels + 4 * offset;
-            pixel[0] = color.r / 255.0f;
-            pixel[1] = color.g / 255.0f;
-            pixel[2] = color.b / 255.0f;
-            pixel[3] = color.a / 255.0f;
-        } break;
-
-        case PixelFormat::BGRA_F32: {
-            float *pixel = (float*)m_pixels + 4 * offset;
-            pixel[0] = color.b / 255.0f;
-            pixel[1] = color.g / 255.0f;
-            pixel[2] = color.r / 255.0f;
-            pixel[3] = color.a / 255.0f;
-        } break;
+    encode_pixels(m_format, &color, (uint8_t*)m_pixels + offset * pixel_size(m_format), 1);
+    return *this;
+}
 
-    }
+void Image::read_row(int x, int y, Color* dst, int count) const
+{
+    const size_t offset = static_cast<size_t>(y) * m_w + x;
+    decode_pixels(m_format, (const uint8_t*)m_pixels + offset * pixel_size(m_format), dst, count);
+}
 
-    return *this;
+void Image::write_row(int x, int y, const Color* src, int count)
+{
+    const size_t offset = static_cast<size_t>(y) * m_w + x;
+    encode_pixels(m_format, src, (uint8_t*)m_pixels + offset * pixel_size(m_format), count);
 }
 
 } // namespace bpx
@@ -0,0 +1,822 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/mipmap.hpp"
+#include "BPX/image.hpp"
+#include "BPX/half.hpp"
+
+#include "./cpu.hpp"
+#include "./packed.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using bpx::MipFilter;
+using bpx::PixelFormat;
+using bpx::detail::PackedLayout;
+
+/*
+    The Kaiser filter spans three pixels of the reduced level on each side,
+    with the window shape used by most texture tools.
+*/
+constexpr double KAISER_RADIUS = 3.0;
+constexpr double KAISER_ALPHA = 4.0;
+
+constexpr double PI = 3.14159265358979323846;
+
+/* Channel storage */
+
+enum class Storage { U8, F16, F32, PACKED };
+
+Storage storage_of(PixelFormat format)
+{
+    switch (format) {
+        case PixelFormat::L_U8:
+        case PixelFormat::LA_U8:
+        case PixelFormat::RGB_U8:
+        case PixelFormat::BGR_U8:
+        case PixelFormat::RGBA_U8:
+        case PixelFormat::BGRA_U8:
+            return Storage::U8;
+        case PixelFormat::L_F16:
+        case PixelFormat::LA_F16:
+        case PixelFormat::RGB_F16:
+        case PixelFormat::BGR_F16:
+        case PixelFormat::RGBA_F16:
+        case PixelFormat::BGRA_F16:
+            return Storage::F16;
+        case PixelFormat::L_F32:
+        case PixelFormat::LA_F32:
+        case PixelFormat::RGB_F32:
+        case PixelFormat::BGR_F32:
+        case PixelFormat::RGBA_F32:
+        case PixelFormat::BGRA_F32:
+            return Storage::F32;
+        default:
+            return Storage::PACKED;
+    }
+}
+
+/* sRGB transfer */
+
+float srgb_to_linear(float x)
+{
+    return x <= 0.04045f ? x / 12.92f : std::pow((x + 0.055f) / 1.055f, 2.4f);
+}
+
+float linear_to_srgb(float x)
+{
+    return x <= 0.0031308f ? x * 12.92f : 1.055f * std::pow(x, 1.0f / 2.4f) - 0.055f;
+}
+
+struct TransferTables
+{
+    float linear[256];      // Byte to float, linear
+    float srgb[256];        // Byte to float, decoded from sRGB
+    float srgb_bounds[255]; // Linear values from which the sRGB encoding rounds to the next byte
+};
+
+const TransferTables& transfer_tables()
+{
+    static const TransferTables tables = [] {
+        TransferTables t;
+        for (int i = 0; i < 256; i++) {
+            t.linear[i] = i / 255.0f;
+            t.srgb[i] = srgb_to_linear(i / 255.0f);
+        }
+        for (int i = 0; i < 255; i++) {
+            t.srgb_bounds[i] = srgb_to_linear((i + 0.5f) / 255.0f);
+        }
+        return t;
+    }();
+    return tables;
+}
+
+/*
+    The sRGB encoding of a linear value is found from a uniform table giving the
+    lowest possible byte, then refined against the exact rounding bounds, which
+    takes at most a couple of steps.
+*/
+constexpr int SRGB_BUCKETS = 4096;
+
+struct SrgbEncoder
+{
+    uint8_t start[SRGB_BUCKETS + 1];
+};
+
+const SrgbEncoder& srgb_encoder()
+{
+    static const SrgbEncoder encoder = [] {
+        const TransferTables& t = transfer_tables();
+        SrgbEncoder e;
+        for (int i = 0; i <= SRGB_BUCKETS; i++) {
+            const float x = static_cast<float>(i) / SRGB_BUCKETS;
+            e.start[i] = static_cast<uint8_t>(std::upper_bound(t.srgb_bounds, t.srgb_bounds + 255, x) - t.srgb_bounds);
+        }
+        return e;
+    }();
+    return encoder;
+}
+
+uint8_t encode_linear_u8(float x)
+{
+    const float v = x * 255.0f + 0.5f;
+    return static_cast<uint8_t>(v <= 0.0f ? 0.0f : (v >= 255.0f ? 255.0f : v));
+}
+
+uint8_t encode_srgb_u8(const TransferTables& t, const SrgbEncoder& e, float x)
+{
+    if (!(x > 0.0f)) return 0;
+    if (x >= 1.0f) return 255;
+    int code = e.start[static_cast<int>(x * SRGB_BUCKETS)];
+    while (code < 255 && x >= t.srgb_bounds[code]) code++;
+    return static_cast<uint8_t>(code);
+}
+
+/*
+    Rows are filtered as floats with `COMP` interleaved channels, in the channel
+    order of the format (RGBA order for the packed formats). The alpha channel,
+    if any, is the last one and is never gamma encoded.
+*/
+template <int COMP>
+struct Channels
+{
+    static constexpr int alpha = (COMP == 2 || COMP == 4) ? COMP - 1 : -1;
+};
+
+template <int COMP>
+void load_u8(const uint8_t* src, float* dst, int count, bool gamma)
+{
+    const TransferTables& t = transfer_tables();
+    const float* color = gamma ? t.srgb : t.linear;
+    for (int i = 0; i < count; i++, src += COMP, dst += COMP) {
+        for (int c = 0; c < COMP; c++) {
+            dst[c] = (c == Channels<COMP>::alpha ? t.linear : color)[src[c]];
+        }
+    }
+}
+
+template <int COMP>
+void store_u8(const float* src, uint8_t* dst, int count, bool gamma)
+{
+    if (!gamma) {
+        for (int i = 0; i < count * COMP; i++) {
+            dst[i] = encode_linear_u8(src[i]);
+        }
+        return;
+    }
+    const TransferTables& t = transfer_tables();
+    const SrgbEncoder& e = srgb_encoder();
+    for (int i = 0; i < count; i++, src += COMP, dst += COMP) {
+        for (int c = 0; c < COMP; c++) {
+            dst[c] = (c == Channels<COMP>::alpha) ? encode_linear_u8(src[c]) : encode_srgb_u8(t, e, src[c]);
+        }
+    }
+}
+
+template <int COMP>
+void decode_gamma(float* values, int count)
+{
+    for (int i = 0; i < count; i++, values += COMP) {
+        for (int c = 0; c < COMP; c++) {
+            if (c != Channels<COMP>::alpha) values[c] = srgb_to_linear(values[c]);
+        }
+    }
+}
+
+template <int COMP>
+void encode_gamma(float* values, int count)
+{
+    for (int i = 0; i < count; i++, values += COMP) {
+        for (int c = 0; c < COMP; c++) {
+            if (c != Channels<COMP>::alpha) values[c] = linear_to_srgb(values[c]);
+        }
+    }
+}
+
+// Calls func<COMP>() for the channel count of a row
+template <template <int> class Op, typename... Args>
+void dispatch_comp(int comp, Args&&... args)
+{
+    switch (comp) {
+        case 1: Op<1>::run(std::forward<Args>(args)...); break;
+        case 2: Op<2>::run(std::forward<Args>(args)...); break;
+        case 3: Op<3>::run(std::forward<Args>(args)...); break;
+        default: Op<4>::run(std::forward<Args>(args)...); break;
+    }
+}
+
+template <int COMP> struct LoadU8 { static void run(const uint8_t* s, float* d, int n, bool g) { load_u8<COMP>(s, d, n, g); } };
+template <int COMP> struct StoreU8 { static void run(const float* s, uint8_t* d, int n, bool g) { store_u8<COMP>(s, d, n, g); } };
+template <int COMP> struct DecodeGamma { static void run(float* v, int n) { decode_gamma<COMP>(v, n); } };
+template <int COMP> struct EncodeGamma { static void run(float* v, int n) { encode_gamma<COMP>(v, n); } };
+
+struct RowCodec
+{
+    PixelFormat format;
+    Storage storage;
+    PackedLayout packed;
+    int comp;
+    bool gamma;
+
+    void load(const void* src, float* dst, int count) const
+    {
+        const size_t n = static_cast<size_t>(count) * comp;
+
+        switch (storage) {
+            case Storage::U8:
+                dispatch_comp<LoadU8>(comp, static_cast<const uint8_t*>(src), dst, count, gamma);
+                return;
+            case Storage::PACKED:
+                bpx::detail::expand_packed(packed, static_cast<const uint16_t*>(src), dst, count, comp);
+                break;
+            case Storage::F16:
+                bpx::half_to_float(static_cast<const uint16_t*>(src), dst, n);
+                break;
+            case Storage::F32:
+                std::memcpy(dst, src, n * sizeof(float));
+                break;
+        }
+
+        if (gamma) {
+            dispatch_comp<DecodeGamma>(comp, dst, count);
+        }
+    }
+
+    // May modify `src`
+    void store(float* src, void* dst, int count) const
+    {
+        const size_t n = static_cast<size_t>(count) * comp;
+
+        if (storage == Storage::U8) {
+            dispatch_comp<StoreU8>(comp, src, static_cast<uint8_t*>(dst), count, gamma);
+            return;
+        }
+
+        if (gamma) {
+            dispatch_comp<EncodeGamma>(comp, src, count);
+        }
+
+        switch (storage) {
+            case Storage::PACKED:
+                bpx::detail::quantize_packed(packed, src, static_cast<uint16_t*>(dst), count, comp);
+                break;
+            case Storage::F16:
+                bpx::float_to_half(src, static_cast<uint16_t*>(dst), n);
+                break;
+            default:
+                std::memcpy(dst, src, n * sizeof(float));
+                break;
+        }
+    }
+};
+
+/* Filter weights */
+
+double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+double kaiser(double x)
+{
+    const double t = x / KAISER_RADIUS;
+    if (t <= -1.0 || t >= 1.0) return 0.0;
+    const double sinc = (x == 0.0) ? 1.0 : std::sin(PI * x) / (PI * x);
+    return sinc * bessel_i0(KAISER_ALPHA * std::sqrt(1.0 - t * t)) / bessel_i0(KAISER_ALPHA);
+}
+
+/*
+    Weights reducing `src_size` pixels to `dst_size`, `taps` per output pixel.
+    Out of bounds samples are clamped to the edge and shorter footprints are
+    padded with null weights on the last pixel.
+*/
+struct AxisWeights
+{
+    int taps = 0;
+    std::vector<int> indices;
+    std::vector<float> weights;
+};
+
+AxisWeights reduce_weights(MipFilter filter, int src_size, int dst_size)
+{
+    const double scale = static_cast<double>(src_size) / dst_size;
+
+    std::vector<std::vector<std::pair<int, double>>> footprints(dst_size);
+    for (int i = 0; i < dst_size; i++) {
+        std::vector<std::pair<int, double>>& fp = footprints[i];
+        double sum = 0.0;
+
+        auto add = [&](int j, double w) {
+            if (w == 0.0) return;
+            j = std::min(std::max(j, 0), src_size - 1);
+            if (!fp.empty() && fp.back().first == j) fp.back().second += w;
+            else fp.emplace_back(j, w);
+            sum += w;
+        };
+
+        if (filter == MipFilter::BOX) {
+            // Overlap of each source pixel with the footprint of the output pixel
+            const double a = i * scale, b = (i + 1) * scale;
+            for (int j = static_cast<int>(std::floor(a)); j < b; j++) {
+                add(j, std::min(b, j + 1.0) - std::max(a, static_cast<double>(j)));
+            }
+        } else {
+            const double center = (i + 0.5) * scale;
+            const double radius = KAISER_RADIUS * scale;
+            const int first = static_cast<int>(std::ceil(center - radius - 0.5));
+            const int last = static_cast<int>(std::floor(center + radius - 0.5));
+            for (int j = first; j <= last; j++) {
+                add(j, kaiser((j + 0.5 - center) / scale));
+            }
+        }
+
+        for (std::pair<int, double>& tap : fp) {
+            tap.second /= sum;
+        }
+    }
+
+    AxisWeights weights;
+    for (const auto& fp : footprints) {
+        weights.taps = std::max(weights.taps, static_cast<int>(fp.size()));
+    }
+
+    weights.indices.resize(static_cast<size_t>(dst_size) * weights.taps);
+    weights.weights.resize(static_cast<size_t>(dst_size) * weights.taps);
+    for (int i = 0; i < dst_size; i++) {
+        const auto& fp = footprints[i];
+        for (int k = 0; k < weights.taps; k++) {
+            const size_t at = static_cast<size_t>(i) * weights.taps + k;
+            const bool used = k < static_cast<int>(fp.size());
+            weights.indices[at] = used ? fp[k].first : fp.back().first;
+            weights.weights[at] = used ? static_cast<float>(fp[k].second) : 0.0f;
+        }
+    }
+
+    return weights;
+}
+
+/* Scalar kernels */
+
+template <int COMP>
+void filter_row(const float* src, const int* indices, const float* weights, int taps, float* dst, int count)
+{
+    for (int i = 0; i < count; i++, indices += taps, weights += taps, dst += COMP) {
+        float sum[COMP] = { };
+        for (int k = 0; k < taps; k++) {
+            const float* pixel = src + indices[k] * COMP;
+            for (int c = 0; c < COMP; c++) {
+                sum[c] += weights[k] * pixel[c];
+            }
+        }
+        for (int c = 0; c < COMP; c++) {
+            dst[c] = sum[c];
+        }
+    }
+}
+
+template <int COMP>
+struct FilterRow
+{
+    static void run(const float* src, const AxisWeights& w, float* dst, int count);
+};
+
+void filter_vertical_scalar(const float* const* rows, const float* weights, int taps, float* dst, size_t begin, size_t count)
+{
+    for (size_t i = begin; i < count; i++) {
+        float sum = 0.0f;
+        for (int k = 0; k < taps; k++) {
+            sum += weights[k] * rows[k][i];
+        }
+        dst[i] = sum;
+    }
+}
+
+void box_2x2_scalar(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int bpp, int count)
+{
+    for (int x = 0; x < count; x++, r0 += 2 * bpp, r1 += 2 * bpp, dst += bpp) {
+        for (int c = 0; c < bpp; c++) {
+            dst[c] = static_cast<uint8_t>((r0[c] + r0[c + bpp] + r1[c] + r1[c + bpp] + 2) >> 2);
+        }
+    }
+}
+
+/*
+    The float kernels accumulate the taps in the same order as the scalar ones,
+    without fused multiply-adds, so every implementation gives the same bits.
+*/
+
+/* x86 kernels */
+
+#if defined(BPX_ARCH_X86)
+
+BPX_TARGET("sse2")
+void filter_row_f32x4_sse2(const float* src, const int* indices, const float* weights, int taps, float* dst, int count)
+{
+    for (int i = 0; i < count; i++, indices += taps, weights += taps) {
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < taps; k++) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(src + indices[k] * 4)));
+        }
+        _mm_storeu_ps(dst + i * 4, sum);
+    }
+}
+
+BPX_TARGET("sse2")
+void filter_vertical_sse2(const float* const* rows, const float* weights, int taps, float* dst, size_t begin, size_t count)
+{
+    size_t i = begin;
+    for (; i + 8 <= count; i += 8) {
+        __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+        for (int k = 0; k < taps; k++) {
+            const __m128 w = _mm_set1_ps(weights[k]);
+            s0 = _mm_add_ps(s0, _mm_mul_ps(w, _mm_loadu_ps(rows[k] + i)));
+            s1 = _mm_add_ps(s1, _mm_mul_ps(w, _mm_loadu_ps(rows[k] + i + 4)));
+        }
+        _mm_storeu_ps(dst + i, s0);
+        _mm_storeu_ps(dst + i + 4, s1);
+    }
+    filter_vertical_scalar(rows, weights, taps, dst, i, count);
+}
+
+BPX_TARGET("avx2")
+void filter_vertical_avx2(const float* const* rows, const float* weights, int taps, float* dst, size_t begin, size_t count)
+{
+    size_t i = begin;
+    for (; i + 16 <= count; i += 16) {
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+        for (int k = 0; k < taps; k++) {
+            const __m256 w = _mm256_set1_ps(weights[k]);
+            s0 = _mm256_add_ps(s0, _mm256_mul_ps(w, _mm256_loadu_ps(rows[k] + i)));
+            s1 = _mm256_add_ps(s1, _mm256_mul_ps(w, _mm256_loadu_ps(rows[k] + i + 8)));
+        }
+        _mm256_storeu_ps(dst + i, s0);
+        _mm256_storeu_ps(dst + i + 8, s1);
+    }
+    filter_vertical_sse2(rows, weights, taps, dst, i, count);
+}
+
+// Reduces 4 source pixels of both rows into 2 output pixels of 4 channels in 16-bit
+BPX_TARGET("sse2")
+inline __m128i box_reduce_sse2(const uint8_t* a, const uint8_t* b)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    const __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(p, zero), _mm_unpacklo_epi8(q, zero));
+    const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(p, zero), _mm_unpackhi_epi8(q, zero));
+    const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+
+BPX_TARGET("sse2")
+void box_2x2_u8x4_sse2(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int count)
+{
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        const __m128i a = box_reduce_sse2(r0 + x * 8, r1 + x * 8);
+        const __m128i b = box_reduce_sse2(r0 + x * 8 + 16, r1 + x * 8 + 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(a, b));
+    }
+    box_2x2_scalar(r0 + x * 8, r1 + x * 8, dst + x * 4, 4, count - x);
+}
+
+// Same as SSE2 in each lane, giving output pixels 0-1 and 2-3 of 8 source pixels
+BPX_TARGET("avx2")
+inline __m256i box_reduce_avx2(const uint8_t* a, const uint8_t* b)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    const __m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    const __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(p, zero), _mm256_unpacklo_epi8(q, zero));
+    const __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(p, zero), _mm256_unpackhi_epi8(q, zero));
+    const __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(2)), 2);
+}
+
+BPX_TARGET("avx2")
+void box_2x2_u8x4_avx2(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int count)
+{
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        const __m256i a = box_reduce_avx2(r0 + x * 8, r1 + x * 8);
+        const __m256i b = box_reduce_avx2(r0 + x * 8 + 32, r1 + x * 8 + 32);
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), packed);
+    }
+    box_2x2_u8x4_sse2(r0 + x * 8, r1 + x * 8, dst + x * 4, count - x);
+}
+
+#endif // BPX_ARCH_X86
+
+/* NEON kernels */
+
+#if defined(BPX_ARCH_NEON) && defined(__aarch64__)
+
+#define BPX_NEON_KERNELS
+
+void filter_row_f32x4_neon(const float* src, const int* indices, const float* weights, int taps, float* dst, int count)
+{
+    for (int i = 0; i < count; i++, indices += taps, weights += taps) {
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (int k = 0; k < taps; k++) {
+            sum = vaddq_f32(sum, vmulq_n_f32(vld1q_f32(src + indices[k] * 4), weights[k]));
+        }
+        vst1q_f32(dst + i * 4, sum);
+    }
+}
+
+void filter_vertical_neon(const float* const* rows, const float* weights, int taps, float* dst, size_t begin, size_t count)
+{
+    size_t i = begin;
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+        for (int k = 0; k < taps; k++) {
+            s0 = vaddq_f32(s0, vmulq_n_f32(vld1q_f32(rows[k] + i), weights[k]));
+            s1 = vaddq_f32(s1, vmulq_n_f32(vld1q_f32(rows[k] + i + 4), weights[k]));
+        }
+        vst1q_f32(dst + i, s0);
+        vst1q_f32(dst + i + 4, s1);
+    }
+    filter_vertical_scalar(rows, weights, taps, dst, i, count);
+}
+
+void box_2x2_u8x4_neon(const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int count)
+{
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        // Even and odd pixels of each row are split, then the four are added
+        const uint32x4x2_t p = vld2q_u32(reinterpret_cast<const uint32_t*>(r0 + x * 8));
+        const uint32x4x2_t q = vld2q_u32(reinterpret_cast<const uint32_t*>(r1 + x * 8));
+        const uint8x16_t p0 = vreinterpretq_u8_u32(p.val[0]), p1 = vreinterpretq_u8_u32(p.val[1]);
+        const uint8x16_t q0 = vreinterpretq_u8_u32(q.val[0]), q1 = vreinterpretq_u8_u32(q.val[1]);
+        uint16x8_t lo = vaddl_u8(vget_low_u8(p0), vget_low_u8(p1));
+        lo = vaddw_u8(vaddw_u8(lo, vget_low_u8(q0)), vget_low_u8(q1));
+        uint16x8_t hi = vaddl_u8(vget_high_u8(p0), vget_high_u8(p1));
+        hi = vaddw_u8(vaddw_u8(hi, vget_high_u8(q0)), vget_high_u8(q1));
+        vst1q_u8(dst + x * 4, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+    }
+    box_2x2_scalar(r0 + x * 8, r1 + x * 8, dst + x * 4, 4, count - x);
+}
+
+#endif // BPX_ARCH_NEON && __aarch64__
+
+/* Kernel dispatch */
+
+struct MipKernels
+{
+    void (*filter_row_f32x4)(const float*, const int*, const float*, int, float*, int) = filter_row<4>;
+    void (*vertical)(const float* const*, const float*, int, float*, size_t, size_t) = filter_vertical_scalar;
+    void (*box_u8x4)(const uint8_t*, const uint8_t*, uint8_t*, int) = [](const uint8_t* r0, const uint8_t* r1, uint8_t* dst, int count) {
+        box_2x2_scalar(r0, r1, dst, 4, count);
+    };
+};
+
+const MipKernels& kernels()
+{
+    static const MipKernels kernels = [] {
+        MipKernels k;
+        const bpx::detail::CpuFeatures& cpu = bpx::detail::cpu_features();
+        (void)cpu;
+#if defined(BPX_ARCH_X86)
+        if (cpu.sse2) {
+            k.filter_row_f32x4 = filter_row_f32x4_sse2;
+            k.vertical = filter_vertical_sse2;
+            k.box_u8x4 = box_2x2_u8x4_sse2;
+        }
+        if (cpu.avx2) {
+            k.vertical = filter_vertical_avx2;
+            k.box_u8x4 = box_2x2_u8x4_avx2;
+        }
+#elif defined(BPX_NEON_KERNELS)
+        if (cpu.neon) {
+            k.filter_row_f32x4 = filter_row_f32x4_neon;
+            k.vertical = filter_vertical_neon;
+            k.box_u8x4 = box_2x2_u8x4_neon;
+        }
+#endif
+        return k;
+    }();
+    return kernels;
+}
+
+template <int COMP>
+void FilterRow<COMP>::run(const float* src, const AxisWeights& w, float* dst, int count)
+{
+    if (COMP == 4) kernels().filter_row_f32x4(src, w.indices.data(), w.weights.data(), w.taps, dst, count);
+    else filter_row<COMP>(src, w.indices.data(), w.weights.data(), w.taps, dst, count);
+}
+
+/* Reductions */
+
+void reduce_float(bpx::ConstImageView src, bpx::ImageView dst, MipFilter filter, const RowCodec& codec,
+                  const bpx::ExecutionPolicy& policy)
+{
+    const int sw = src.width(), dw = dst.width();
+    const int comp = codec.comp;
+
+    const AxisWeights hw = reduce_weights(filter, sw, dw);
+    const AxisWeights vw = reduce_weights(filter, src.height(), dst.height());
+    const MipKernels& k = kernels();
+
+    bpx::detail::parallel_rows(policy, 0, dst.height(), dw, [&](int y_begin, int y_end) {
+        /*
+            Source rows are filtered horizontally once, in increasing order, into a ring
+            of rows. The rows used by an output row span at most `taps` consecutive rows,
+            so a row is only overwritten once no following output row needs it.
+        */
+        const int ring = vw.taps + 1;
+        const size_t row_size = static_cast<size_t>(dw) * comp;
+        std::vector<float> cache(ring * row_size);
+        std::vector<float> line(static_cast<size_t>(std::max(sw, dw)) * comp);
+        std::vector<const float*> rows(vw.taps);
+        std::vector<float> weights(vw.taps);
+
+        int next = -1;
+        for (int y = y_begin; y < y_end; y++) {
+            const int* indices = vw.indices.data() + static_cast<size_t>(y) * vw.taps;
+
+            const int lo = *std::min_element(indices, indices + vw.taps);
+            const int hi = *std::max_element(indices, indices + vw.taps);
+            for (next = std::max(next, lo); next <= hi; next++) {
+                codec.load(src.row(next), line.data(), sw);
+                dispatch_comp<FilterRow>(comp, line.data(), hw, cache.data() + (next % ring) * row_size, dw);
+            }
+
+            // Padding taps are skipped
+            int taps = 0;
+            for (int i = 0; i < vw.taps; i++) {
+                const float w = vw.weights[static_cast<size_t>(y) * vw.taps + i];
+                if (w == 0.0f) continue;
+                rows[taps] = cache.data() + (indices[i] % ring) * row_size;
+                weights[taps++] = w;
+            }
+
+            k.vertical(rows.data(), weights.data(), taps, line.data(), 0, row_size);
+            codec.store(line.data(), dst.row(y), dw);
+        }
+    });
+}
+
+void reduce_box_u8(bpx::ConstImageView src, bpx::ImageView dst, const bpx::ExecutionPolicy& policy)
+{
+    const int bpp = static_cast<int>(bpx::pixel_size(src.format()));
+    const MipKernels& k = kernels();
+
+    bpx::detail::parallel_rows(policy, 0, dst.height(), dst.width(), [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; y++) {
+            const uint8_t* r0 = static_cast<const uint8_t*>(src.row(2 * y));
+            const uint8_t* r1 = static_cast<const uint8_t*>(src.row(2 * y + 1));
+            uint8_t* out = static_cast<uint8_t*>(dst.row(y));
+            if (bpp == 4) k.box_u8x4(r0, r1, out, dst.width());
+            else box_2x2_scalar(r0, r1, out, bpp, dst.width());
+        }
+    });
+}
+
+} // namespace anonymous
+
+namespace bpx {
+
+/* MipChain */
+
+MipChain::MipChain(int w, int h, PixelFormat format, int levels)
+    : m_format(format)
+{
+    if (w <= 0 || h <= 0) {
+        throw std::invalid_argument("The dimensions of a mipmap chain must be positive");
+    }
+    if (levels < 0) {
+        throw std::invalid_argument("The number of mipmap levels cannot be negative");
+    }
+
+    const int full = mip_level_count(w, h);
+    const int count = (levels == 0) ? full : std::min(levels, full);
+
+    // Offsets are multiples of both the alignment and the pixel size
+    const size_t bpp = pixel_size(format);
+    size_t align = MIP_LEVEL_ALIGNMENT;
+    while (align % bpp != 0) align += MIP_LEVEL_ALIGNMENT;
+
+    m_levels.reserve(count);
+    for (int i = 0; i < count; i++) {
+        MipLevel level;
+        level.width = std::max(1, w >> i);
+        level.height = std::max(1, h >> i);
+        level.offset = (m_size + align - 1) / align * align;
+        level.size = static_cast<size_t>(level.width) * level.height * bpp;
+        m_size = level.offset + level.size;
+        m_levels.push_back(level);
+    }
+
+    m_data.reset(new uint8_t[m_size]);
+
+    // The alignment gaps are cleared so that the whole chain is deterministic
+    for (int i = 1; i < count; i++) {
+        const size_t end = m_levels[i - 1].offset + m_levels[i - 1].size;
+        std::memset(m_data.get() + end, 0, m_levels[i].offset - end);
+    }
+}
+
+const MipLevel& MipChain::level(int index) const
+{
+    if (index < 0 || index >= level_count()) {
+        throw std::out_of_range("Mipmap level out of range");
+    }
+    return m_levels[index];
+}
+
+ImageView MipChain::view(int index)
+{
+    const MipLevel& l = level(index);
+    return ImageView(m_data.get() + l.offset, l.width, l.height, m_format, 0, m_alpha);
+}
+
+ConstImageView MipChain::view(int index) const
+{
+    const MipLevel& l = level(index);
+    return ConstImageView(m_data.get() + l.offset, l.width, l.height, m_format, 0, m_alpha);
+}
+
+/* Generation */
+
+int mip_level_count(int w, int h) noexcept
+{
+    if (w <= 0 || h <= 0) return 0;
+    int count = 1;
+    for (int size = std::max(w, h); size > 1; size >>= 1) {
+        count++;
+    }
+    return count;
+}
+
+MipChain generate_mipmaps(ConstImageView image, MipFilter filter, int levels, bool gamma_correct, ExecutionPolicy policy)
+{
+    if (image.width() <= 0 || image.height() <= 0 || image.data() == nullptr) {
+        throw std::invalid_argument("Cannot generate the mipmaps of an empty image");
+    }
+
+    MipChain chain(image.width(), image.height(), image.format(), levels);
+    chain.set_alpha_mode(image.alpha_mode());
+
+    ImageView base = chain.view(0);
+    const size_t row_size = image.width() * pixel_size(image.format());
+    detail::parallel_rows(policy, 0, image.height(), image.width(), [&](int y_begin, int y_end) {
+        for (int y = y_begin; y < y_end; y++) {
+            std::memcpy(base.row(y), image.row(y), row_size);
+        }
+    });
+
+    RowCodec codec;
+    codec.format = image.format();
+    codec.storage = storage_of(image.format());
+    codec.comp = static_cast<int>(pixel_comp(image.format()));
+    if (codec.storage == Storage::PACKED) {
+        codec.packed = detail::packed_layout(image.format());
+    }
+    codec.gamma = gamma_correct;
+
+    for (int i = 1; i < chain.level_count(); i++) {
+        const ConstImageView src = static_cast<const MipChain&>(chain).view(i - 1);
+        const ImageView dst = chain.view(i);
+
+        const bool halves = (src.width() == 2 * dst.width() && src.height() == 2 * dst.height());
+        if (filter == MipFilter::BOX && !gamma_correct && codec.storage == Storage::U8 && halves) {
+            reduce_box_u8(src, dst, policy);
+        } else {
+            reduce_float(src, dst, filter, codec, policy);
+        }
+    }
+
+    return chain;
+}
+
+} // namespace bpx
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_PACKED_HPP
+#define BPX_PACKED_HPP
+
+/*
+    Internal header, not installed.
+
+    Bit fields of the 16-bit packed formats, expanded to floats in [0, 1]
+    and quantized back exactly. The 8-bit colors of the pixel codecs lose
+    a step of the 5-bit channels on the way back (a channel v is read as
+    8 * v and rounded to the nearest of 31 steps), so the operations that
+    must give back the pixels they were given work on these instead.
+*/
+
+#include "BPX/pixel.hpp"
+
+#include <cstdint>
+
+namespace bpx { namespace detail {
+
+/*
+    Shift and width of the channels of a packed format, in RGBA order.
+    Formats without alpha have no bits for it.
+*/
+struct PackedLayout
+{
+    int shift[4];
+    int bits[4];
+};
+
+inline PackedLayout packed_layout(PixelFormat format)
+{
+    switch (format) {
+        case PixelFormat::RGB_565:   return { { 11, 5, 0, 0 }, { 5, 6, 5, 0 } };
+        case PixelFormat::BGR_565:   return { { 0, 5, 11, 0 }, { 5, 6, 5, 0 } };
+        case PixelFormat::RGBA_5551: return { { 11, 6, 1, 0 }, { 5, 5, 5, 1 } };
+        case PixelFormat::BGRA_5551: return { { 1, 6, 11, 0 }, { 5, 5, 5, 1 } };
+        case PixelFormat::RGBA_4444: return { { 12, 8, 4, 0 }, { 4, 4, 4, 4 } };
+        case PixelFormat::BGRA_4444: return { { 4, 8, 12, 0 }, { 4, 4, 4, 4 } };
+        default: return { { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+    }
+}
+
+/*
+    Expands `count` pixels to `comp` floats each, every channel v of n bits
+    becoming v / (2^n - 1).
+*/
+inline void expand_packed(const PackedLayout& packed, const uint16_t* src, float* dst, int count, int comp)
+{
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < comp; c++) {
+            const int max = (1 << packed.bits[c]) - 1;
+            dst[i * comp + c] = static_cast<float>((src[i] >> packed.shift[c]) & max) / max;
+        }
+    }
+}
+
+/*
+    Quantizes `count` pixels of `comp` floats to the nearest steps of the
+    channels, values outside of [0, 1] being clamped.
+*/
+inline void quantize_packed(const PackedLayout& packed, const float* src, uint16_t* dst, int count, int comp)
+{
+    for (int i = 0; i < count; i++) {
+        uint16_t word = 0;
+        for (int c = 0; c < comp; c++) {
+            const int max = (1 << packed.bits[c]) - 1;
+            const float v = src[i * comp + c] * max + 0.5f;
+            const int q = static_cast<int>(v <= 0.0f ? 0.0f : (v >= max ? max : v));
+            word |= static_cast<uint16_t>(q << packed.shift[c]);
+        }
+        dst[i] = word;
+    }
+}
+
+}} // namespace bpx::detail
+
+#endif // BPX_PACKED_HPP
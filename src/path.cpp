@@ -0,0 +1,447 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/path.hpp"
+#include "BPX/ramp.hpp"
+
+#include "./raster.hpp"
+#include "./stroke.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace bpx { namespace detail {
+
+struct ScratchAccess
+{
+    /*
+        Rasterizer of the arena, or the fallback when there is none.
+    */
+    static Rasterizer& rasterizer(ScratchArena* scratch, Rasterizer& fallback)
+    {
+        return scratch != nullptr && scratch->m_rasterizer ? *scratch->m_rasterizer : fallback;
+    }
+};
+
+}} // namespace bpx::detail
+
+namespace {
+
+using namespace bpx;
+using detail::Rasterizer;
+using detail::ROW_CHUNK;
+
+/*
+    Largest distance between a curve and the lines replacing it, in pixels.
+*/
+constexpr float FLATTEN_TOLERANCE = 0.1f;
+
+/*
+    Most lines a single curve is flattened into, whatever its size.
+*/
+constexpr int MAX_CURVE_SEGMENTS = 1024;
+
+/*
+    Number of lines keeping a curve within the tolerance. A parabola whose
+    second derivative is bounded by D deviates from its chords of parameter
+    length 1/n by at most D / (8 n^2), which gives n = sqrt(D / (8 tol));
+    `bound` is D / 8.
+*/
+int curve_segments(float bound)
+{
+    const float n = std::ceil(std::sqrt(bound / FLATTEN_TOLERANCE));
+    if (!(n > 1.0f)) {
+        return 1;   // Also when the curve is not finite, the rasterizer dropping it
+    }
+    return n < MAX_CURVE_SEGMENTS ? static_cast<int>(n) : MAX_CURVE_SEGMENTS;
+}
+
+float length(float x, float y)
+{
+    return std::sqrt(x * x + y * y);
+}
+
+/*
+    Tells whether the polygon is convex: it turns the same way at every
+    vertex and goes down then up only once, so that each row crosses it at
+    most twice. Repeated points are skipped.
+*/
+bool is_convex(const Point* points, size_t count)
+{
+    if (count < 3) {
+        return false;
+    }
+
+    // Starts from the last edge of non-zero length, to compare the first one with it
+    Point prev{ 0.0f, 0.0f };
+    for (size_t i = count; i-- > 0 && prev.x == 0.0f && prev.y == 0.0f;) {
+        const Point& a = points[i];
+        const Point& b = points[(i + 1) % count];
+        prev = Point{ b.x - a.x, b.y - a.y };
+    }
+
+    float turn = 0.0f;
+    float prev_dy = prev.y;
+    int direction_changes = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const Point& a = points[i];
+        const Point& b = points[i + 1 < count ? i + 1 : 0];
+        const Point edge{ b.x - a.x, b.y - a.y };
+        if (edge.x == 0.0f && edge.y == 0.0f) {
+            continue;
+        }
+
+        const float cross = prev.x * edge.y - prev.y * edge.x;
+        if (cross * turn < 0.0f) {
+            return false;
+        }
+        if (turn == 0.0f) {
+            turn = cross;
+        }
+
+        if (edge.y != 0.0f) {
+            if (prev_dy != 0.0f && (edge.y > 0.0f) != (prev_dy > 0.0f)) {
+                direction_changes++;
+            }
+            prev_dy = edge.y;
+        }
+        prev = edge;
+    }
+
+    return turn != 0.0f && direction_changes <= 2;
+}
+
+/*
+    Ramp sampled at the center of the pixels, either linearly along the
+    segment from `start` to `end` or radially around `start`, blended over
+    fully and partially covered spans.
+*/
+class GradientSpan
+{
+public:
+    GradientSpan(const ImageView& image, Point start, Point end, bool radial,
+                 const ColorRamp& ramp, BlendMode mode)
+        : m_image(image), m_ramp(ramp), m_mode(mode), m_start(start)
+        , m_dx(end.x - start.x), m_dy(end.y - start.y), m_radial(radial)
+    {
+        const float len = length(m_dx, m_dy);
+        if (radial) {
+            m_scale = len > 0.0f ? 1.0f / len : std::numeric_limits<float>::max();
+        } else {
+            m_scale = len > 0.0f ? 1.0f / (len * len) : 0.0f;
+        }
+    }
+
+    void operator()(int y, int x0, int x1) const
+    {
+        Color colors[ROW_CHUNK];
+        for (int x = x0; x < x1; x += ROW_CHUNK) {
+            const int n = std::min(ROW_CHUNK, x1 - x);
+            sample(x, y, colors, n);
+            detail::blend_colors(m_image, x, y, colors, n, m_mode);
+        }
+    }
+
+    void operator()(int y, int x, const uint8_t* coverage, int count) const
+    {
+        Color colors[ROW_CHUNK];
+        for (int i = 0; i < count; i += ROW_CHUNK) {
+            const int n = std::min(ROW_CHUNK, count - i);
+            sample(x + i, y, colors, n);
+            detail::blend_coverage(m_image, x + i, y, colors, coverage + i, n, m_mode);
+        }
+    }
+
+private:
+    void sample(int x, int y, Color* colors, int count) const
+    {
+        const float py = y + 0.5f - m_start.y;
+        for (int i = 0; i < count; i++) {
+            const float px = x + i + 0.5f - m_start.x;
+            const float t = m_radial ? length(px, py) * m_scale : (px * m_dx + py * m_dy) * m_scale;
+            colors[i] = m_ramp.get(std::clamp(t, 0.0f, 1.0f));
+        }
+    }
+
+    const ImageView& m_image;
+    const ColorRamp& m_ramp;
+    BlendMode m_mode;
+    Point m_start;
+    float m_dx, m_dy;
+    float m_scale;          // Turns the distance along the gradient into a position on the ramp
+    bool m_radial;
+};
+
+/*
+    Sweeps the outline added by `add` with the paint, which takes the
+    rasterizer, the fill rule and the anti-aliasing of the style, and
+    whether the outline is a single convex polygon.
+*/
+template <typename Add, typename Paint>
+void fill_with(const ImageView& image, const FillStyle& style, ScratchArena* scratch, Add&& add, Paint&& paint)
+{
+    Rasterizer local;
+    Rasterizer& rasterizer = detail::ScratchAccess::rasterizer(scratch, local);
+    rasterizer.reset(0, 0, image.width(), image.height());
+
+    const bool convex = add(rasterizer);
+    paint(rasterizer, style.rule == FillRule::EVEN_ODD, style.antialias, convex);
+}
+
+/*
+    Adders of the outlines, returning whether they are a single convex polygon.
+*/
+auto polygon_outline(const Point* points, size_t count)
+{
+    return [=](Rasterizer& rasterizer) {
+        rasterizer.add_polygon(points, count);
+        return is_convex(points, count);
+    };
+}
+
+auto path_outline(const Path& path)
+{
+    return [&path](Rasterizer& rasterizer) {
+        const Point* points = path.points().data();
+        for (const Path::Contour& contour : path.contours()) {
+            rasterizer.add_polygon(points + contour.begin, contour.end - contour.begin);
+        }
+        if (path.contours().size() != 1) {
+            return false;
+        }
+        const Path::Contour& contour = path.contours().front();
+        return is_convex(points + contour.begin, contour.end - contour.begin);
+    };
+}
+
+/*
+    Paints, sweeping the shape held by a rasterizer onto the image.
+*/
+auto color_paint(const ImageView& image, Color color, BlendMode mode)
+{
+    return [&image, color, mode](Rasterizer& rasterizer, bool even_odd, bool antialias, bool convex) {
+        detail::fill_coverage(rasterizer, image, color, mode, even_odd, antialias, convex);
+    };
+}
+
+auto mapper_paint(const ImageView& image, const Image::Mapper& mapper)
+{
+    return [&image, &mapper](Rasterizer& rasterizer, bool even_odd, bool antialias, bool convex) {
+        detail::sweep(rasterizer, even_odd, antialias, convex,
+            [&](int y, int x0, int x1) {
+                detail::map_span(image, y, x0, x1, mapper);
+            },
+            [&](int y, int x, const uint8_t* coverage, int count) {
+                detail::map_coverage(image, x, y, coverage, count, mapper);
+            });
+    };
+}
+
+auto gradient_paint(const ImageView& image, Point start, Point end, bool radial,
+                    const ColorRamp& ramp, BlendMode mode)
+{
+    return [=, &image, &ramp](Rasterizer& rasterizer, bool even_odd, bool antialias, bool convex) {
+        const GradientSpan span(image, start, end, radial, ramp, mode);
+        detail::sweep(rasterizer, even_odd, antialias, convex, span, span);
+    };
+}
+
+} // namespace
+
+namespace bpx {
+
+/* Path */
+
+Path& Path::move_to(float x, float y)
+{
+    // A contour holding a single point is replaced rather than left behind
+    if (m_open && m_contours.back().end - m_contours.back().begin == 1) {
+        m_points.back() = Point{ x, y };
+    } else {
+        m_contours.push_back(Contour{ m_points.size(), m_points.size() + 1, false });
+        m_points.push_back(Point{ x, y });
+    }
+    m_start = Point{ x, y };
+    m_open = true;
+    return *this;
+}
+
+Path& Path::line_to(float x, float y)
+{
+    if (!m_open && m_contours.empty()) {
+        return move_to(x, y);
+    }
+    ensure_current(x, y);
+    m_points.push_back(Point{ x, y });
+    m_contours.back().end = m_points.size();
+    return *this;
+}
+
+Path& Path::quad_to(float cx, float cy, float x, float y)
+{
+    ensure_current(cx, cy);
+    const Point p0 = m_points.back();
+
+    const int n = curve_segments(length(p0.x - 2.0f * cx + x, p0.y - 2.0f * cy + y) * 0.25f);
+    for (int i = 1; i < n; i++) {
+        const float t = static_cast<float>(i) / n;
+        const float u = 1.0f - t;
+        const float a = u * u, b = 2.0f * u * t, c = t * t;
+        m_points.push_back(Point{ a * p0.x + b * cx + c * x, a * p0.y + b * cy + c * y });
+    }
+    m_points.push_back(Point{ x, y });
+    m_contours.back().end = m_points.size();
+    return *this;
+}
+
+Path& Path::cubic_to(float c1x, float c1y, float c2x, float c2y, float x, float y)
+{
+    ensure_current(c1x, c1y);
+    const Point p0 = m_points.back();
+
+    // The second derivative is bounded by 6 times the larger of these
+    const float d1 = length(p0.x - 2.0f * c1x + c2x, p0.y - 2.0f * c1y + c2y);
+    const float d2 = length(c1x - 2.0f * c2x + x, c1y - 2.0f * c2y + y);
+    const int n = curve_segments(std::max(d1, d2) * 0.75f);
+    for (int i = 1; i < n; i++) {
+        const float t = static_cast<float>(i) / n;
+        const float u = 1.0f - t;
+        const float a = u * u * u, b = 3.0f * u * u * t, c = 3.0f * u * t * t, d = t * t * t;
+        m_points.push_back(Point{ a * p0.x + b * c1x + c * c2x + d * x,
+                                  a * p0.y + b * c1y + c * c2y + d * y });
+    }
+    m_points.push_back(Point{ x, y });
+    m_contours.back().end = m_points.size();
+    return *this;
+}
+
+Path& Path::close()
+{
+    if (m_open) {
+        m_contours.back().closed = true;
+        m_open = false;
+    }
+    return *this;
+}
+
+void Path::clear() noexcept
+{
+    m_points.clear();
+    m_contours.clear();
+    m_start = Point{};
+    m_open = false;
+}
+
+void Path::ensure_current(float x, float y)
+{
+    if (m_open) {
+        return;
+    }
+    if (m_contours.empty()) {
+        move_to(x, y);
+    } else {
+        move_to(m_start.x, m_start.y);  // After close, from the start of the closed contour
+    }
+}
+
+/* ScratchArena */
+
+ScratchArena::ScratchArena()
+    : m_rasterizer(std::make_unique<detail::Rasterizer>())
+{ }
+
+ScratchArena::~ScratchArena() = default;
+ScratchArena::ScratchArena(ScratchArena&&) noexcept = default;
+ScratchArena& ScratchArena::operator=(ScratchArena&&) noexcept = default;
+
+/* Filling */
+
+void fill_polygon(ImageView image, const Point* points, size_t count, Color color, const FillStyle& style,
+                  BlendMode mode, ScratchArena* scratch)
+{
+    fill_with(image, style, scratch, polygon_outline(points, count), color_paint(image, color, mode));
+}
+
+void fill_polygon(ImageView image, const Point* points, size_t count, const Image::Mapper& mapper,
+                  const FillStyle& style, ScratchArena* scratch)
+{
+    fill_with(image, style, scratch, polygon_outline(points, count), mapper_paint(image, mapper));
+}
+
+void fill_polygon_gradient_linear(ImageView image, const Point* points, size_t count, Point start, Point end,
+                                  const ColorRamp& ramp, const FillStyle& style,
+                                  BlendMode mode, ScratchArena* scratch)
+{
+    fill_with(image, style, scratch, polygon_outline(points, count),
+              gradient_paint(image, start, end, false, ramp, mode));
+}
+
+void fill_polygon_gradient_radial(ImageView image, const Point* points, size_t count, Point center, Point end,
+                                  const ColorRamp& ramp, const FillStyle& style,
+                                  BlendMode mode, ScratchArena* scratch)
+{
+    fill_with(image, style, scratch, polygon_outline(points, count),
+              gradient_paint(image, center, end, true, ramp, mode));
+}
+
+void fill_path(ImageView image, const Path& path, Color color, const FillStyle& style,
+               BlendMode mode, ScratchArena* scratch)
+{
+    fill_with(image, style, scratch, path_outline(path), color_paint(image, color, mode));
+}
+
+void fill_path(ImageView image, const Path& path, const Image::Mapper& mapper,
+               const FillStyle& style, ScratchArena* scratch)
+{
+    fill_with(image, style, scratch, path_outline(path), mapper_paint(image, mapper));
+}
+
+void fill_path_gradient_linear(ImageView image, const Path& path, Point start, Point end,
+                               const ColorRamp& ramp, const FillStyle& style,
+                               BlendMode mode, ScratchArena* scratch)
+{
+    fill_with(image, style, scratch, path_outline(path), gradient_paint(image, start, end, false, ramp, mode));
+}
+
+void fill_path_gradient_radial(ImageView image, const Path& path, Point center, Point end,
+                               const ColorRamp& ramp, const FillStyle& style,
+                               BlendMode mode, ScratchArena* scratch)
+{
+    fill_with(image, style, scratch, path_outline(path), gradient_paint(image, center, end, true, ramp, mode));
+}
+
+/* Stroking */
+
+void stroke_path(ImageView image, const Path& path, Color color, const StrokeStyle& style,
+                 BlendMode mode, ScratchArena* scratch)
+{
+    detail::Rasterizer local;
+    detail::Rasterizer& rasterizer = detail::ScratchAccess::rasterizer(scratch, local);
+    rasterizer.reset(0, 0, image.width(), image.height());
+
+    const Point* points = path.points().data();
+    for (const Path::Contour& contour : path.contours()) {
+        detail::add_stroke(rasterizer, points + contour.begin, contour.end - contour.begin, contour.closed, style);
+    }
+    detail::fill_coverage(rasterizer, image, color, mode);
+}
+
+} // namespace bpx
@@ -0,0 +1,1018 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/image.hpp"
+#include "BPX/algorithm.hpp"
+#include "BPX/half.hpp"
+
+#include "./cpu.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+/* Format traits */
+
+using bpx::Color;
+using bpx::PixelFormat;
+using bpx::half_to_float;
+using bpx::float_to_half;
+
+/*
+    Each specialization describes how a single pixel of a given format is
+    decoded to and encoded from a `Color`. The row codecs below are then
+    instantiated once per format, so the format dispatch happens once per
+    row instead of once per pixel.
+*/
+
+template <PixelFormat F>
+struct FormatTraits;
+
+template <>
+struct FormatTraits<PixelFormat::L_U8>
+{
+    static Color load(const void* pixels, size_t i) {
+        uint8_t gray = static_cast<const uint8_t*>(pixels)[i];
+        return { gray, gray, gray, 255 };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        static_cast<uint8_t*>(pixels)[i] = bpx::luminance_value(color);
+    }
+};
+
+template <>
+struct FormatTraits<PixelFormat::L_F16>
+{
+    static Color load(const void* pixels, size_t i) {
+        uint8_t gray = 255 * half_to_float(static_cast<const uint16_t*>(pixels)[i]);
+        return { gray, gray, gray, 255 };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        static_cast<uint16_t*>(pixels)[i] = float_to_half(bpx::luminance_value(color) / 255.0f);
+    }
+};
+
+template <>
+struct FormatTraits<PixelFormat::L_F32>
+{
+    static Color load(const void* pixels, size_t i) {
+        uint8_t gray = 255 * static_cast<const float*>(pixels)[i];
+        return { gray, gray, gray, 255 };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        static_cast<float*>(pixels)[i] = bpx::luminance_value(color) / 255.0f;
+    }
+};
+
+template <>
+struct FormatTraits<PixelFormat::LA_U8>
+{
+    static Color load(const void* pixels, size_t i) {
+        const uint8_t* pixel = static_cast<const uint8_t*>(pixels) + 2 * i;
+        return { pixel[0], pixel[0], pixel[0], pixel[1] };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        uint8_t* pixel = static_cast<uint8_t*>(pixels) + 2 * i;
+        pixel[0] = bpx::luminance_value(color);
+        pixel[1] = color.a;
+    }
+};
+
+template <>
+struct FormatTraits<PixelFormat::LA_F16>
+{
+    static Color load(const void* pixels, size_t i) {
+        const uint16_t* pixel = static_cast<const uint16_t*>(pixels) + 2 * i;
+        uint8_t gray = 255 * half_to_float(pixel[0]);
+        uint8_t alpha = 255 * half_to_float(pixel[1]);
+        return { gray, gray, gray, alpha };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        uint16_t* pixel = static_cast<uint16_t*>(pixels) + 2 * i;
+        pixel[0] = float_to_half(bpx::luminance_value(color) / 255.0f);
+        pixel[1] = float_to_half(color.a / 255.0f);
+    }
+};
+
+template <>
+struct FormatTraits<PixelFormat::LA_F32>
+{
+    static Color load(const void* pixels, size_t i) {
+        const float* pixel = static_cast<const float*>(pixels) + 2 * i;
+        uint8_t gray = 255 * pixel[0], alpha = 255 * pixel[1];
+        return { gray, gray, gray, alpha };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        float* pixel = static_cast<float*>(pixels) + 2 * i;
+        pixel[0] = bpx::luminance_value(color) / 255.0f;
+        pixel[1] = color.a / 255.0f;
+    }
+};
+
+/*
+    Packed 16-bit formats. `R_SHIFT`, `G_SHIFT` and `B_SHIFT` give the position
+    of each channel inside the 16-bit word, which is all that distinguishes
+    the RGB and BGR variants of the same layout. The bit layout is also exposed
+    as constants so that the vectorized codecs can be derived from the traits.
+*/
+
+template <int R_SHIFT, int B_SHIFT>
+struct Packed565Traits
+{
+    static constexpr int r_shift = R_SHIFT, g_shift = 5, b_shift = B_SHIFT, a_shift = 0;
+    static constexpr int rb_bits = 5, g_bits = 6, a_bits = 0;
+
+    static Color load(const void* pixels, size_t i) {
+        uint16_t pixel = static_cast<const uint16_t*>(pixels)[i];
+        return {
+            static_cast<uint8_t>(((pixel >> R_SHIFT) & 0x1F) * (255 / 31)),
+            static_cast<uint8_t>(((pixel >> 5) & 0x3F) * (255 / 63)),
+            static_cast<uint8_t>(((pixel >> B_SHIFT) & 0x1F) * (255 / 31)),
+            255
+        };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        uint16_t r = static_cast<uint16_t>(std::round(color.r * (31.0f / 255)));
+        uint16_t g = static_cast<uint16_t>(std::round(color.g * (63.0f / 255)));
+        uint16_t b = static_cast<uint16_t>(std::round(color.b * (31.0f / 255)));
+        static_cast<uint16_t*>(pixels)[i] = (r << R_SHIFT) | (g << 5) | (b << B_SHIFT);
+    }
+};
+
+template <int R_SHIFT, int B_SHIFT>
+struct Packed5551Traits
+{
+    static constexpr int r_shift = R_SHIFT, g_shift = 6, b_shift = B_SHIFT, a_shift = 0;
+    static constexpr int rb_bits = 5, g_bits = 5, a_bits = 1;
+
+    static Color load(const void* pixels, size_t i) {
+        uint16_t pixel = static_cast<const uint16_t*>(pixels)[i];
+        return {
+            static_cast<uint8_t>(((pixel >> R_SHIFT) & 0x1F) * (255 / 31)),
+            static_cast<uint8_t>(((pixel >> 6) & 0x1F) * (255 / 31)),
+            static_cast<uint8_t>(((pixel >> B_SHIFT) & 0x1F) * (255 / 31)),
+            static_cast<uint8_t>((pixel & 0x1) * 255)
+        };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        uint16_t r = static_cast<uint16_t>(std::round(color.r * (31.0f / 255)));
+        uint16_t g = static_cast<uint16_t>(std::round(color.g * (31.0f / 255)));
+        uint16_t b = static_cast<uint16_t>(std::round(color.b * (31.0f / 255)));
+        uint16_t a = (color.a > 50) ? 1 : 0;
+        static_cast<uint16_t*>(pixels)[i] = (r << R_SHIFT) | (g << 6) | (b << B_SHIFT) | a;
+    }
+};
+
+template <int R_SHIFT, int B_SHIFT>
+struct Packed4444Traits
+{
+    static constexpr int r_shift = R_SHIFT, g_shift = 8, b_shift = B_SHIFT, a_shift = 0;
+    static constexpr int rb_bits = 4, g_bits = 4, a_bits = 4;
+
+    static Color load(const void* pixels, size_t i) {
+        uint16_t pixel = static_cast<const uint16_t*>(pixels)[i];
+        return {
+            static_cast<uint8_t>(((pixel >> R_SHIFT) & 0xF) * (255 / 15)),
+            static_cast<uint8_t>(((pixel >> 8) & 0xF) * (255 / 15)),
+            static_cast<uint8_t>(((pixel >> B_SHIFT) & 0xF) * (255 / 15)),
+            static_cast<uint8_t>((pixel & 0xF) * (255 / 15))
+        };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        uint16_t r = static_cast<uint16_t>(std::round(color.r * (15.0f / 255)));
+        uint16_t g = static_cast<uint16_t>(std::round(color.g * (15.0f / 255)));
+        uint16_t b = static_cast<uint16_t>(std::round(color.b * (15.0f / 255)));
+        uint16_t a = static_cast<uint16_t>(std::round(color.a * (15.0f / 255)));
+        static_cast<uint16_t*>(pixels)[i] = (r << R_SHIFT) | (g << 8) | (b << B_SHIFT) | a;
+    }
+};
+
+template <> struct FormatTraits<PixelFormat::RGB_565> : Packed565Traits<11, 0> { };
+template <> struct FormatTraits<PixelFormat::BGR_565> : Packed565Traits<0, 11> { };
+template <> struct FormatTraits<PixelFormat::RGBA_5551> : Packed5551Traits<11, 1> { };
+template <> struct FormatTraits<PixelFormat::BGRA_5551> : Packed5551Traits<1, 11> { };
+template <> struct FormatTraits<PixelFormat::RGBA_4444> : Packed4444Traits<12, 4> { };
+template <> struct FormatTraits<PixelFormat::BGRA_4444> : Packed4444Traits<4, 12> { };
+
+/*
+    Byte, half and float formats with three or four channels. `R` and `B` are
+    the indices of the red and blue components within a pixel, `N` is the
+    number of components (the alpha channel, if any, is always last).
+*/
+
+template <int N, int R, int B>
+struct U8Traits
+{
+    static constexpr int n = N, r = R, b = B;
+
+    static Color load(const void* pixels, size_t i) {
+        const uint8_t* pixel = static_cast<const uint8_t*>(pixels) + N * i;
+        return { pixel[R], pixel[1], pixel[B], (N == 4) ? pixel[N - 1] : uint8_t(255) };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        uint8_t* pixel = static_cast<uint8_t*>(pixels) + N * i;
+        pixel[R] = color.r;
+        pixel[1] = color.g;
+        pixel[B] = color.b;
+        if (N == 4) pixel[N - 1] = color.a;
+    }
+};
+
+template <int N, int R, int B>
+struct F16Traits
+{
+    static constexpr int n = N, r = R, b = B;
+
+    static Color load(const void* pixels, size_t i) {
+        const uint16_t* pixel = static_cast<const uint16_t*>(pixels) + N * i;
+        return {
+            static_cast<uint8_t>(255 * half_to_float(pixel[R])),
+            static_cast<uint8_t>(255 * half_to_float(pixel[1])),
+            static_cast<uint8_t>(255 * half_to_float(pixel[B])),
+            (N == 4) ? static_cast<uint8_t>(255 * half_to_float(pixel[N - 1])) : uint8_t(255)
+        };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        uint16_t* pixel = static_cast<uint16_t*>(pixels) + N * i;
+        pixel[R] = float_to_half(color.r / 255.0f);
+        pixel[1] = float_to_half(color.g / 255.0f);
+        pixel[B] = float_to_half(color.b / 255.0f);
+        if (N == 4) pixel[N - 1] = float_to_half(color.a / 255.0f);
+    }
+};
+
+template <int N, int R, int B>
+struct F32Traits
+{
+    static constexpr int n = N, r = R, b = B;
+
+    static Color load(const void* pixels, size_t i) {
+        const float* pixel = static_cast<const float*>(pixels) + N * i;
+        return {
+            static_cast<uint8_t>(255 * pixel[R]),
+            static_cast<uint8_t>(255 * pixel[1]),
+            static_cast<uint8_t>(255 * pixel[B]),
+            (N == 4) ? static_cast<uint8_t>(255 * pixel[N - 1]) : uint8_t(255)
+        };
+    }
+    static void store(void* pixels, size_t i, Color color) {
+        float* pixel = static_cast<float*>(pixels) + N * i;
+        pixel[R] = color.r / 255.0f;
+        pixel[1] = color.g / 255.0f;
+        pixel[B] = color.b / 255.0f;
+        if (N == 4) pixel[N - 1] = color.a / 255.0f;
+    }
+};
+
+template <> struct FormatTraits<PixelFormat::RGB_U8> : U8Traits<3, 0, 2> { };
+template <> struct FormatTraits<PixelFormat::BGR_U8> : U8Traits<3, 2, 0> { };
+template <> struct FormatTraits<PixelFormat::RGBA_U8> : U8Traits<4, 0, 2> { };
+template <> struct FormatTraits<PixelFormat::BGRA_U8> : U8Traits<4, 2, 0> { };
+template <> struct FormatTraits<PixelFormat::RGB_F16> : F16Traits<3, 0, 2> { };
+template <> struct FormatTraits<PixelFormat::BGR_F16> : F16Traits<3, 2, 0> { };
+template <> struct FormatTraits<PixelFormat::RGBA_F16> : F16Traits<4, 0, 2> { };
+template <> struct FormatTraits<PixelFormat::BGRA_F16> : F16Traits<4, 2, 0> { };
+template <> struct FormatTraits<PixelFormat::RGB_F32> : F32Traits<3, 0, 2> { };
+template <> struct FormatTraits<PixelFormat::BGR_F32> : F32Traits<3, 2, 0> { };
+template <> struct FormatTraits<PixelFormat::RGBA_F32> : F32Traits<4, 0, 2> { };
+template <> struct FormatTraits<PixelFormat::BGRA_F32> : F32Traits<4, 2, 0> { };
+
+/* Scalar row codecs */
+
+static_assert(sizeof(Color) == 4, "Color is expected to have the memory layout of RGBA_U8");
+
+template <PixelFormat F>
+void decode_row(const void* src, Color* dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = FormatTraits<F>::load(src, i);
+    }
+}
+
+template <PixelFormat F>
+void encode_row(const Color* src, void* dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        FormatTraits<F>::store(dst, i, src[i]);
+    }
+}
+
+// RGBA_U8 shares the memory layout of `Color`, so its codec is a plain copy
+
+template <>
+void decode_row<PixelFormat::RGBA_U8>(const void* src, Color* dst, size_t count)
+{
+    std::memcpy(dst, src, count * sizeof(Color));
+}
+
+template <>
+void encode_row<PixelFormat::RGBA_U8>(const Color* src, void* dst, size_t count)
+{
+    std::memcpy(dst, src, count * sizeof(Color));
+}
+
+using DecodeRowFunc = void(*)(const void*, Color*, size_t);
+using EncodeRowFunc = void(*)(const Color*, void*, size_t);
+
+#define PF_FORMAT_TABLE(FUNC) {             \
+    FUNC<PixelFormat::L_U8>,                \
+    FUNC<PixelFormat::L_F16>,               \
+    FUNC<PixelFormat::L_F32>,               \
+    FUNC<PixelFormat::LA_U8>,               \
+    FUNC<PixelFormat::LA_F16>,              \
+    FUNC<PixelFormat::LA_F32>,              \
+    FUNC<PixelFormat::RGB_565>,             \
+    FUNC<PixelFormat::BGR_565>,             \
+    FUNC<PixelFormat::RGB_U8>,              \
+    FUNC<PixelFormat::BGR_U8>,              \
+    FUNC<PixelFormat::RGB_F16>,             \
+    FUNC<PixelFormat::BGR_F16>,             \
+    FUNC<PixelFormat::RGB_F32>,             \
+    FUNC<PixelFormat::BGR_F32>,             \
+    FUNC<PixelFormat::RGBA_5551>,           \
+    FUNC<PixelFormat::BGRA_5551>,           \
+    FUNC<PixelFormat::RGBA_4444>,           \
+    FUNC<PixelFormat::BGRA_4444>,           \
+    FUNC<PixelFormat::RGBA_U8>,             \
+    FUNC<PixelFormat::BGRA_U8>,             \
+    FUNC<PixelFormat::RGBA_F16>,            \
+    FUNC<PixelFormat::BGRA_F16>,            \
+    FUNC<PixelFormat::RGBA_F32>,            \
+    FUNC<PixelFormat::BGRA_F32>,            \
+}
+
+constexpr size_t FORMAT_COUNT = static_cast<size_t>(PixelFormat::BGRA_F32) + 1;
+
+// Indexed by `PixelFormat`, the order must match the enumeration. These are
+// the reference implementations, the vectorized codecs must match them bit for bit
+constexpr DecodeRowFunc decode_row_table[] = PF_FORMAT_TABLE(decode_row);
+constexpr EncodeRowFunc encode_row_table[] = PF_FORMAT_TABLE(encode_row);
+
+static_assert(sizeof(decode_row_table) / sizeof(DecodeRowFunc) == FORMAT_COUNT,
+              "The row codec tables must cover every pixel format");
+
+#undef PF_FORMAT_TABLE
+
+/* Channel layouts */
+
+/*
+    Byte and float formats with three or four components only differ by the
+    number of components and the position of red and blue, so a conversion
+    between two of them is a byte shuffle, and a float format is its byte
+    counterpart with every component widened or narrowed on its own.
+*/
+
+struct Layout
+{
+    int n, r, b;
+};
+
+constexpr Layout RGBA_LAYOUT = { 4, 0, 2 };
+
+template <PixelFormat F>
+constexpr Layout layout_of()
+{
+    return { FormatTraits<F>::n, FormatTraits<F>::r, FormatTraits<F>::b };
+}
+
+bool u8_layout(PixelFormat format, Layout* layout)
+{
+    switch (format) {
+        case PixelFormat::RGB_U8:   *layout = layout_of<PixelFormat::RGB_U8>(); return true;
+        case PixelFormat::BGR_U8:   *layout = layout_of<PixelFormat::BGR_U8>(); return true;
+        case PixelFormat::RGBA_U8:  *layout = layout_of<PixelFormat::RGBA_U8>(); return true;
+        case PixelFormat::BGRA_U8:  *layout = layout_of<PixelFormat::BGRA_U8>(); return true;
+        default:                    return false;
+    }
+}
+
+/* Scalar kernels */
+
+void swizzle_scalar(const uint8_t* src, Layout s, uint8_t* dst, Layout d, size_t count)
+{
+    // All the components are read before any is written, so `src` and `dst`
+    // may alias when both layouts have the same size
+    for (size_t i = 0; i < count; i++, src += s.n, dst += d.n) {
+        const uint8_t r = src[s.r], g = src[1], b = src[s.b];
+        const uint8_t a = (s.n == 4) ? src[3] : 255;
+        dst[d.r] = r;
+        dst[1] = g;
+        dst[d.b] = b;
+        if (d.n == 4) dst[3] = a;
+    }
+}
+
+void widen_scalar(const uint8_t* src, float* dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = src[i] / 255.0f;
+    }
+}
+
+void narrow_scalar(const float* src, uint8_t* dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = static_cast<uint8_t>(255 * src[i]);
+    }
+}
+
+/* x86 kernels */
+
+#if defined(BPX_ARCH_X86)
+
+void build_swizzle_mask(Layout s, Layout d, uint8_t mask[16], uint8_t fill[16])
+{
+    // Source component feeding each destination component, -1 for an opaque alpha
+    int from[4] = { 0, 1, 0, (s.n == 4) ? 3 : -1 };
+    from[d.r] = s.r;
+    from[d.b] = s.b;
+
+    std::memset(mask, 0x80, 16);
+    std::memset(fill, 0x00, 16);
+
+    for (int k = 0; k < 4; k++) {
+        for (int c = 0; c < d.n; c++) {
+            const int j = k * d.n + c;
+            if (from[c] < 0) fill[j] = 0xFF;
+            else mask[j] = static_cast<uint8_t>(k * s.n + from[c]);
+        }
+    }
+}
+
+BPX_TARGET("ssse3")
+void swizzle_ssse3(const uint8_t* src, Layout s, uint8_t* dst, Layout d, size_t count)
+{
+    alignas(16) uint8_t mask[16], fill[16];
+    build_swizzle_mask(s, d, mask, fill);
+
+    const __m128i m = _mm_load_si128(reinterpret_cast<const __m128i*>(mask));
+    const __m128i f = _mm_load_si128(reinterpret_cast<const __m128i*>(fill));
+
+    // Four pixels per step, but the 16-byte loads and stores of a three-component
+    // layout reach into the next two pixels, which must exist (they are rewritten later)
+    const size_t reach = (s.n == 3 || d.n == 3) ? 6 : 4;
+
+    size_t i = 0;
+    for (; i + reach <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + s.n * i));
+        v = _mm_or_si128(_mm_shuffle_epi8(v, m), f);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + d.n * i), v);
+    }
+
+    swizzle_scalar(src + s.n * i, s, dst + d.n * i, d, count - i);
+}
+
+BPX_TARGET("avx2")
+void swizzle_avx2(const uint8_t* src, Layout s, uint8_t* dst, Layout d, size_t count)
+{
+    size_t i = 0;
+
+    // The shuffle stays within 128-bit lanes, which only fits four-component layouts
+    if (s.n == 4 && d.n == 4) {
+        alignas(16) uint8_t mask[16], fill[16];
+        build_swizzle_mask(s, d, mask, fill);
+
+        const __m256i m = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(mask)));
+        const __m256i f = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(fill)));
+
+        for (; i + 8 <= count; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * i));
+            v = _mm256_or_si256(_mm256_shuffle_epi8(v, m), f);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * i), v);
+        }
+    }
+
+    swizzle_ssse3(src + s.n * i, s, dst + d.n * i, d, count - i);
+}
+
+BPX_TARGET("sse2")
+void widen_sse2(const uint8_t* src, float* dst, size_t count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        _mm_storeu_ps(dst + i + 0, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+        _mm_storeu_ps(dst + i + 8, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+        _mm_storeu_ps(dst + i + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+    }
+
+    widen_scalar(src + i, dst + i, count - i);
+}
+
+BPX_TARGET("sse2")
+void narrow_sse2(const float* src, uint8_t* dst, size_t count)
+{
+    // The scalar cast truncates to a 32-bit integer and keeps its low byte,
+    // masking before the saturating packs reproduces it for any input
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128i low = _mm_set1_epi32(0xFF);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i a = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 0), scale)), low);
+        const __m128i b = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale)), low);
+        const __m128i c = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 8), scale)), low);
+        const __m128i d = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 12), scale)), low);
+        const __m128i v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+
+    narrow_scalar(src + i, dst + i, count - i);
+}
+
+BPX_TARGET("avx2")
+void widen_avx2(const uint8_t* src, float* dst, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+
+    widen_scalar(src + i, dst + i, count - i);
+}
+
+BPX_TARGET("avx2")
+void narrow_avx2(const float* src, uint8_t* dst, size_t count)
+{
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    const __m256i low = _mm256_set1_epi32(0xFF);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m256i a = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src + i + 0), scale)), low);
+        const __m256i b = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale)), low);
+        const __m256i c = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src + i + 16), scale)), low);
+        const __m256i d = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(src + i + 24), scale)), low);
+        // The packs work within 128-bit lanes, the permutation restores the pixel order
+        __m256i v = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        v = _mm256_permutevar8x32_epi32(v, order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+
+    narrow_sse2(src + i, dst + i, count - i);
+}
+
+/*
+    Packed 16-bit formats, eight pixels per step. Channels are expanded and
+    quantized with the same integer results as the scalar traits: expansion
+    multiplies by `255 / max` (integer division), and quantization rounds
+    `c * max / 255` to nearest, which never lands on a tie for byte inputs.
+*/
+
+template <int SHIFT, int BITS>
+BPX_TARGET("sse2")
+inline __m128i unpack_channel(__m128i v)
+{
+    if (BITS == 0) return _mm_set1_epi16(255);
+    const int max = (1 << BITS) - 1;
+    const __m128i c = _mm_and_si128(_mm_srli_epi16(v, SHIFT), _mm_set1_epi16(max));
+    return _mm_mullo_epi16(c, _mm_set1_epi16(255 / (BITS ? max : 1)));
+}
+
+template <int SHIFT, int BITS>
+BPX_TARGET("sse2")
+inline __m128i pack_channel(__m128i c)
+{
+    if (BITS == 0) return _mm_setzero_si128();
+    if (BITS == 1) return _mm_slli_epi16(_mm_srli_epi16(_mm_cmpgt_epi16(c, _mm_set1_epi16(50)), 15), SHIFT);
+    const __m128i t = _mm_add_epi16(_mm_mullo_epi16(c, _mm_set1_epi16((1 << BITS) - 1)), _mm_set1_epi16(128));
+    return _mm_slli_epi16(_mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8), SHIFT);
+}
+
+template <PixelFormat F>
+BPX_TARGET("sse2")
+void decode_packed_sse2(const void* src, Color* dst, size_t count)
+{
+    using T = FormatTraits<F>;
+    const uint16_t* pixels = static_cast<const uint16_t*>(src);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+        const __m128i r = unpack_channel<T::r_shift, T::rb_bits>(v);
+        const __m128i g = unpack_channel<T::g_shift, T::g_bits>(v);
+        const __m128i b = unpack_channel<T::b_shift, T::rb_bits>(v);
+        const __m128i a = unpack_channel<T::a_shift, T::a_bits>(v);
+        const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        const __m128i ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(rg, ba));
+    }
+
+    decode_row<F>(pixels + i, dst + i, count - i);
+}
+
+template <PixelFormat F>
+BPX_TARGET("sse2")
+void encode_packed_sse2(const Color* src, void* dst, size_t count)
+{
+    using T = FormatTraits<F>;
+    uint16_t* pixels = static_cast<uint16_t*>(dst);
+    const __m128i low = _mm_set1_epi32(0xFF);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4));
+        const __m128i r = _mm_packs_epi32(_mm_and_si128(p0, low), _mm_and_si128(p1, low));
+        const __m128i g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), low), _mm_and_si128(_mm_srli_epi32(p1, 8), low));
+        const __m128i b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), low), _mm_and_si128(_mm_srli_epi32(p1, 16), low));
+        const __m128i a = _mm_packs_epi32(_mm_srli_epi32(p0, 24), _mm_srli_epi32(p1, 24));
+        __m128i v = pack_channel<T::r_shift, T::rb_bits>(r);
+        v = _mm_or_si128(v, pack_channel<T::g_shift, T::g_bits>(g));
+        v = _mm_or_si128(v, pack_channel<T::b_shift, T::rb_bits>(b));
+        v = _mm_or_si128(v, pack_channel<T::a_shift, T::a_bits>(a));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), v);
+    }
+
+    encode_row<F>(src + i, pixels + i, count - i);
+}
+
+#endif // BPX_ARCH_X86
+
+/* NEON kernels */
+
+#if defined(BPX_ARCH_NEON) && defined(__aarch64__)
+
+#define BPX_NEON_KERNELS
+
+void swizzle_neon(const uint8_t* src, Layout s, uint8_t* dst, Layout d, size_t count)
+{
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t r, g, b, a;
+        if (s.n == 4) {
+            const uint8x16x4_t v = vld4q_u8(src + 4 * i);
+            r = v.val[s.r], g = v.val[1], b = v.val[s.b], a = v.val[3];
+        } else {
+            const uint8x16x3_t v = vld3q_u8(src + 3 * i);
+            r = v.val[s.r], g = v.val[1], b = v.val[s.b], a = vdupq_n_u8(255);
+        }
+        if (d.n == 4) {
+            uint8x16x4_t v;
+            v.val[d.r] = r, v.val[1] = g, v.val[d.b] = b, v.val[3] = a;
+            vst4q_u8(dst + 4 * i, v);
+        } else {
+            uint8x16x3_t v;
+            v.val[d.r] = r, v.val[1] = g, v.val[d.b] = b;
+            vst3q_u8(dst + 3 * i, v);
+        }
+    }
+
+    swizzle_scalar(src + s.n * i, s, dst + d.n * i, d, count - i);
+}
+
+void widen_neon(const uint8_t* src, float* dst, size_t count)
+{
+    const float32x4_t scale = vdupq_n_f32(255.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16_t v = vld1q_u8(src + i);
+        const uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+        const uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+        vst1q_f32(dst + i + 0, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), scale));
+        vst1q_f32(dst + i + 4, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), scale));
+        vst1q_f32(dst + i + 8, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), scale));
+        vst1q_f32(dst + i + 12, vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), scale));
+    }
+
+    widen_scalar(src + i, dst + i, count - i);
+}
+
+void narrow_neon(const float* src, uint8_t* dst, size_t count)
+{
+    const float32x4_t scale = vdupq_n_f32(255.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const int32x4_t a = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i + 0), scale));
+        const int32x4_t b = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i + 4), scale));
+        const int32x4_t c = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i + 8), scale));
+        const int32x4_t d = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i + 12), scale));
+        const uint16x8_t ab = vreinterpretq_u16_s16(vcombine_s16(vmovn_s32(a), vmovn_s32(b)));
+        const uint16x8_t cd = vreinterpretq_u16_s16(vcombine_s16(vmovn_s32(c), vmovn_s32(d)));
+        vst1q_u8(dst + i, vcombine_u8(vmovn_u16(ab), vmovn_u16(cd)));
+    }
+
+    narrow_scalar(src + i, dst + i, count - i);
+}
+
+#endif // BPX_ARCH_NEON && __aarch64__
+
+/* Kernel dispatch */
+
+using SwizzleFunc = void(*)(const uint8_t*, Layout, uint8_t*, Layout, size_t);
+using WidenFunc = void(*)(const uint8_t*, float*, size_t);
+using NarrowFunc = void(*)(const float*, uint8_t*, size_t);
+
+struct Kernels
+{
+    SwizzleFunc swizzle = swizzle_scalar;
+    WidenFunc widen = widen_scalar;
+    NarrowFunc narrow = narrow_scalar;
+};
+
+const Kernels& kernels()
+{
+    static const Kernels kernels = [] {
+        Kernels k;
+        const bpx::detail::CpuFeatures& cpu = bpx::detail::cpu_features();
+        (void)cpu;
+#if defined(BPX_ARCH_X86)
+        if (cpu.sse2) {
+            k.widen = widen_sse2;
+            k.narrow = narrow_sse2;
+        }
+        if (cpu.ssse3) {
+            k.swizzle = swizzle_ssse3;
+        }
+        if (cpu.avx2) {
+            k.swizzle = swizzle_avx2;
+            k.widen = widen_avx2;
+            k.narrow = narrow_avx2;
+        }
+#elif defined(BPX_NEON_KERNELS)
+        if (cpu.neon) {
+            k.swizzle = swizzle_neon;
+            k.widen = widen_neon;
+            k.narrow = narrow_neon;
+        }
+#endif
+        return k;
+    }();
+    return kernels;
+}
+
+/* Vectorized row codecs */
+
+constexpr size_t CHUNK = 256;
+
+template <PixelFormat F>
+void decode_u8(const void* src, Color* dst, size_t count)
+{
+    kernels().swizzle(static_cast<const uint8_t*>(src), layout_of<F>(),
+                      reinterpret_cast<uint8_t*>(dst), RGBA_LAYOUT, count);
+}
+
+template <PixelFormat F>
+void encode_u8(const Color* src, void* dst, size_t count)
+{
+    kernels().swizzle(reinterpret_cast<const uint8_t*>(src), RGBA_LAYOUT,
+                      static_cast<uint8_t*>(dst), layout_of<F>(), count);
+}
+
+void decode_floats(const float* values, Layout layout, Color* dst, size_t count)
+{
+    const Kernels& k = kernels();
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(dst);
+
+    // Four components narrow straight into the colors, then get reordered in place
+    if (layout.n == 4) {
+        k.narrow(values, bytes, 4 * count);
+        if (layout.r != RGBA_LAYOUT.r) {
+            k.swizzle(bytes, layout, bytes, RGBA_LAYOUT, count);
+        }
+        return;
+    }
+
+    uint8_t buffer[3 * CHUNK];
+    for (size_t i = 0; i < count; i += CHUNK) {
+        const size_t n = std::min(CHUNK, count - i);
+        k.narrow(values + 3 * i, buffer, 3 * n);
+        k.swizzle(buffer, layout, bytes + 4 * i, RGBA_LAYOUT, n);
+    }
+}
+
+void encode_floats(const Color* src, Layout layout, float* values, size_t count)
+{
+    const Kernels& k = kernels();
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(src);
+
+    if (layout.n == 4 && layout.r == RGBA_LAYOUT.r) {
+        k.widen(bytes, values, 4 * count);
+        return;
+    }
+
+    uint8_t buffer[4 * CHUNK];
+    for (size_t i = 0; i < count; i += CHUNK) {
+        const size_t n = std::min(CHUNK, count - i);
+        k.swizzle(bytes + 4 * i, RGBA_LAYOUT, buffer, layout, n);
+        k.widen(buffer, values + layout.n * i, layout.n * n);
+    }
+}
+
+template <PixelFormat F>
+void decode_f32(const void* src, Color* dst, size_t count)
+{
+    decode_floats(static_cast<const float*>(src), layout_of<F>(), dst, count);
+}
+
+template <PixelFormat F>
+void encode_f32(const Color* src, void* dst, size_t count)
+{
+    encode_floats(src, layout_of<F>(), static_cast<float*>(dst), count);
+}
+
+// Half formats go through single precision in chunks, with the batched half conversion
+
+template <PixelFormat F>
+void decode_f16(const void* src, Color* dst, size_t count)
+{
+    constexpr Layout layout = layout_of<F>();
+    const uint16_t* values = static_cast<const uint16_t*>(src);
+
+    float buffer[4 * CHUNK];
+    for (size_t i = 0; i < count; i += CHUNK) {
+        const size_t n = std::min(CHUNK, count - i);
+        half_to_float(values + layout.n * i, buffer, layout.n * n);
+        decode_floats(buffer, layout, dst + i, n);
+    }
+}
+
+template <PixelFormat F>
+void encode_f16(const Color* src, void* dst, size_t count)
+{
+    constexpr Layout layout = layout_of<F>();
+    uint16_t* values = static_cast<uint16_t*>(dst);
+
+    float buffer[4 * CHUNK];
+    for (size_t i = 0; i < count; i += CHUNK) {
+        const size_t n = std::min(CHUNK, count - i);
+        encode_floats(src + i, layout, buffer, n);
+        float_to_half(buffer, values + layout.n * i, layout.n * n);
+    }
+}
+
+struct RowCodecs
+{
+    DecodeRowFunc decode[FORMAT_COUNT];
+    EncodeRowFunc encode[FORMAT_COUNT];
+};
+
+/*
+    Row codecs used for runs of pixels: the scalar reference codecs, with the
+    formats that have a vectorized implementation for this CPU replaced.
+    Luminance formats, and any format without a kernel for this CPU, keep
+    the scalar loops.
+*/
+const RowCodecs& row_codecs()
+{
+    static const RowCodecs codecs = [] {
+        RowCodecs c;
+        std::copy(std::begin(decode_row_table), std::end(decode_row_table), c.decode);
+        std::copy(std::begin(encode_row_table), std::end(encode_row_table), c.encode);
+
+#define PF_SET_CODEC(FORMAT, DECODE, ENCODE)                                    \
+        c.decode[static_cast<int>(PixelFormat::FORMAT)] = DECODE<PixelFormat::FORMAT>; \
+        c.encode[static_cast<int>(PixelFormat::FORMAT)] = ENCODE<PixelFormat::FORMAT>;
+
+        const bpx::detail::CpuFeatures& cpu = bpx::detail::cpu_features();
+
+#if defined(BPX_ARCH_X86)
+        const bool simd_swizzle = cpu.ssse3;
+        const bool simd_float = cpu.sse2;
+#elif defined(BPX_NEON_KERNELS)
+        const bool simd_swizzle = cpu.neon;
+        const bool simd_float = cpu.neon;
+#else
+        const bool simd_swizzle = false;
+        const bool simd_float = false;
+        (void)cpu;
+#endif
+
+        // RGBA_U8 keeps its plain copy
+        if (simd_swizzle) {
+            PF_SET_CODEC(RGB_U8, decode_u8, encode_u8)
+            PF_SET_CODEC(BGR_U8, decode_u8, encode_u8)
+            PF_SET_CODEC(BGRA_U8, decode_u8, encode_u8)
+        }
+
+        if (simd_float) {
+            PF_SET_CODEC(RGB_F32, decode_f32, encode_f32)
+            PF_SET_CODEC(BGR_F32, decode_f32, encode_f32)
+            PF_SET_CODEC(RGBA_F32, decode_f32, encode_f32)
+            PF_SET_CODEC(BGRA_F32, decode_f32, encode_f32)
+
+            // Half formats reuse the float kernels, the half conversion
+            // itself dispatches separately (F16C or its table fallback)
+            PF_SET_CODEC(RGB_F16, decode_f16, encode_f16)
+            PF_SET_CODEC(BGR_F16, decode_f16, encode_f16)
+            PF_SET_CODEC(RGBA_F16, decode_f16, encode_f16)
+            PF_SET_CODEC(BGRA_F16, decode_f16, encode_f16)
+        }
+
+#if defined(BPX_ARCH_X86)
+        if (cpu.sse2) {
+            PF_SET_CODEC(RGB_565, decode_packed_sse2, encode_packed_sse2)
+            PF_SET_CODEC(BGR_565, decode_packed_sse2, encode_packed_sse2)
+            PF_SET_CODEC(RGBA_5551, decode_packed_sse2, encode_packed_sse2)
+            PF_SET_CODEC(BGRA_5551, decode_packed_sse2, encode_packed_sse2)
+            PF_SET_CODEC(RGBA_4444, decode_packed_sse2, encode_packed_sse2)
+            PF_SET_CODEC(BGRA_4444, decode_packed_sse2, encode_packed_sse2)
+        }
+#endif
+
+#undef PF_SET_CODEC
+
+        return c;
+    }();
+    return codecs;
+}
+
+// Below this many pixels the reference loops are cheaper than the vector setup
+constexpr size_t SIMD_THRESHOLD = 8;
+
+} // namespace anonymous
+
+/* Pixel Conversion Implementation */
+
+namespace bpx {
+
+void decode_pixels(PixelFormat format, const void* src, Color* dst, size_t count)
+{
+    if (count < SIMD_THRESHOLD) {
+        decode_row_table[static_cast<int>(format)](src, dst, count);
+    } else {
+        row_codecs().decode[static_cast<int>(format)](src, dst, count);
+    }
+}
+
+void encode_pixels(PixelFormat format, const Color* src, void* dst, size_t count)
+{
+    if (count < SIMD_THRESHOLD) {
+        encode_row_table[static_cast<int>(format)](src, dst, count);
+    } else {
+        row_codecs().encode[static_cast<int>(format)](src, dst, count);
+    }
+}
+
+void convert_pixels(PixelFormat src_format, const void* src, PixelFormat dst_format, void* dst, size_t count)
+{
+    if (src_format == dst_format) {
+        std::memcpy(dst, src, count * pixel_size(src_format));
+        return;
+    }
+
+    // Byte layouts convert with a single shuffle, without going through colors
+    Layout src_layout, dst_layout;
+    if (u8_layout(src_format, &src_layout) && u8_layout(dst_format, &dst_layout)) {
+        kernels().swizzle(static_cast<const uint8_t*>(src), src_layout,
+                          static_cast<uint8_t*>(dst), dst_layout, count);
+        return;
+    }
+
+    // RGBA_U8 has the memory layout of `Color`, so it can be decoded into or encoded from directly
+    if (dst_format == PixelFormat::RGBA_U8) {
+        decode_pixels(src_format, src, static_cast<Color*>(dst), count);
+        return;
+    }
+    if (src_format == PixelFormat::RGBA_U8) {
+        encode_pixels(dst_format, static_cast<const Color*>(src), dst, count);
+        return;
+    }
+
+    // Otherwise the pixels go through a small buffer of colors that stays in cache
+    const size_t src_size = pixel_size(src_format);
+    const size_t dst_size = pixel_size(dst_format);
+
+    Color buffer[CHUNK];
+    for (size_t i = 0; i < count; i += CHUNK) {
+        const size_t n = std::min(CHUNK, count - i);
+        decode_pixels(src_format, static_cast<const uint8_t*>(src) + i * src_size, buffer, n);
+        encode_pixels(dst_format, buffer, static_cast<uint8_t*>(dst) + i * dst_size, n);
+    }
+}
+
+} // namespace bpx
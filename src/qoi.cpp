@@ -0,0 +1,362 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "./qoi.hpp"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t QOI_OP_INDEX = 0x00;     // 00xxxxxx: color of the table
+constexpr uint8_t QOI_OP_DIFF = 0x40;      // 01rrggbb: small difference with the previous pixel
+constexpr uint8_t QOI_OP_LUMA = 0x80;      // 10gggggg rrrrbbbb: green difference, red and blue relative to it
+constexpr uint8_t QOI_OP_RUN = 0xC0;       // 11nnnnnn: previous pixel repeated 1 to 62 times
+constexpr uint8_t QOI_OP_RGB = 0xFE;       // Literal color, same alpha
+constexpr uint8_t QOI_OP_RGBA = 0xFF;      // Literal color and alpha
+
+constexpr int QOI_MAX_RUN = 62;
+
+// The encoder flushes its buffer when less than a run and the longest op could follow
+constexpr size_t QOI_BUFFER_SIZE = 16 * 1024;
+constexpr size_t QOI_MAX_STEP = 6;
+
+const uint8_t QOI_PADDING[bpx::detail::QOI_PADDING_SIZE] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+struct Rgba
+{
+    uint8_t r, g, b, a;
+};
+
+uint32_t bits(Rgba c)
+{
+    uint32_t v;
+    std::memcpy(&v, &c, sizeof(v));
+    return v;
+}
+
+unsigned hash(Rgba c)
+{
+    return (c.r * 3 + c.g * 5 + c.b * 7 + c.a * 11) & 63;
+}
+
+/*
+    Byte orders of the formats the codec works on, the pixels being loaded and
+    stored in place so that no conversion pass is needed.
+*/
+enum class Layout { RGB, RGBA, BGRA };
+
+template <Layout L>
+struct Pixels;
+
+template <>
+struct Pixels<Layout::RGB>
+{
+    static constexpr size_t SIZE = 3;
+    static Rgba load(const uint8_t* p) { return Rgba{ p[0], p[1], p[2], 255 }; }
+    static void store(uint8_t* p, Rgba c) { p[0] = c.r; p[1] = c.g; p[2] = c.b; }
+};
+
+template <>
+struct Pixels<Layout::RGBA>
+{
+    static constexpr size_t SIZE = 4;
+    static Rgba load(const uint8_t* p) { Rgba c; std::memcpy(&c, p, 4); return c; }
+    static void store(uint8_t* p, Rgba c) { std::memcpy(p, &c, 4); }
+};
+
+template <>
+struct Pixels<Layout::BGRA>
+{
+    static constexpr size_t SIZE = 4;
+    static Rgba load(const uint8_t* p) { return Rgba{ p[2], p[1], p[0], p[3] }; }
+    static void store(uint8_t* p, Rgba c) { p[0] = c.b; p[1] = c.g; p[2] = c.r; p[3] = c.a; }
+};
+
+void store_be32(uint8_t* dst, uint32_t value)
+{
+    dst[0] = static_cast<uint8_t>(value >> 24);
+    dst[1] = static_cast<uint8_t>(value >> 16);
+    dst[2] = static_cast<uint8_t>(value >> 8);
+    dst[3] = static_cast<uint8_t>(value);
+}
+
+uint32_t load_be32(const uint8_t* src)
+{
+    return (static_cast<uint32_t>(src[0]) << 24) | (static_cast<uint32_t>(src[1]) << 16)
+         | (static_cast<uint32_t>(src[2]) << 8) | static_cast<uint32_t>(src[3]);
+}
+
+template <Layout L>
+uint8_t* encode_rows(const uint8_t* rows, size_t stride, int w, int h, uint8_t* buffer, uint8_t* p,
+                     void (*sink)(void*, const void*, size_t), void* context)
+{
+    using Px = Pixels<L>;
+    const uint8_t* const limit = buffer + QOI_BUFFER_SIZE - QOI_MAX_STEP;
+
+    Rgba index[64] = {};
+    Rgba prev = { 0, 0, 0, 255 };
+    int run = 0;
+
+    for (int y = 0; y < h; y++) {
+        const uint8_t* src = rows + y * stride;
+        for (int x = 0; x < w; x++, src += Px::SIZE) {
+            if (p > limit) {
+                sink(context, buffer, p - buffer);
+                p = buffer;
+            }
+
+            const Rgba px = Px::load(src);
+            if (bits(px) == bits(prev)) {
+                if (++run == QOI_MAX_RUN) {
+                    *p++ = QOI_OP_RUN | (QOI_MAX_RUN - 1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                *p++ = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            const unsigned slot = hash(px);
+            if (bits(index[slot]) == bits(px)) {
+                *p++ = static_cast<uint8_t>(QOI_OP_INDEX | slot);
+            } else {
+                index[slot] = px;
+                if (px.a == prev.a) {
+                    const int vr = static_cast<int8_t>(px.r - prev.r);
+                    const int vg = static_cast<int8_t>(px.g - prev.g);
+                    const int vb = static_cast<int8_t>(px.b - prev.b);
+                    const int vg_r = vr - vg;
+                    const int vg_b = vb - vg;
+
+                    if (vr >= -2 && vr <= 1 && vg >= -2 && vg <= 1 && vb >= -2 && vb <= 1) {
+                        *p++ = static_cast<uint8_t>(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                    } else if (vg >= -32 && vg <= 31 && vg_r >= -8 && vg_r <= 7 && vg_b >= -8 && vg_b <= 7) {
+                        *p++ = static_cast<uint8_t>(QOI_OP_LUMA | (vg + 32));
+                        *p++ = static_cast<uint8_t>((vg_r + 8) << 4 | (vg_b + 8));
+                    } else {
+                        p[0] = QOI_OP_RGB;
+                        p[1] = px.r;
+                        p[2] = px.g;
+                        p[3] = px.b;
+                        p += 4;
+                    }
+                } else {
+                    p[0] = QOI_OP_RGBA;
+                    p[1] = px.r;
+                    p[2] = px.g;
+                    p[3] = px.b;
+                    p[4] = px.a;
+                    p += 5;
+                }
+            }
+
+            prev = px;
+        }
+    }
+
+    if (run > 0) {
+        *p++ = static_cast<uint8_t>(QOI_OP_RUN | (run - 1));
+    }
+
+    return p;
+}
+
+/*
+    Ops are only read up to the padding, so that a stream cut short fails
+    instead of reading past the data.
+*/
+template <Layout L>
+bool decode_rows(const uint8_t* data, size_t size, int w, int h, uint8_t* pixels, size_t pitch, bool flip)
+{
+    using Px = Pixels<L>;
+
+    const uint8_t* p = data + bpx::detail::QOI_HEADER_SIZE;
+    const uint8_t* const end = data + size - bpx::detail::QOI_PADDING_SIZE;
+
+    Rgba index[64] = {};
+    Rgba px = { 0, 0, 0, 255 };
+    int run = 0;
+
+    for (int y = 0; y < h; y++) {
+        uint8_t* dst = pixels + static_cast<size_t>(flip ? h - 1 - y : y) * pitch;
+        for (int x = 0; x < w; x++, dst += Px::SIZE) {
+            if (run > 0) {
+                run--;
+                Px::store(dst, px);
+                continue;
+            }
+
+            if (p >= end) {
+                return false;
+            }
+
+            const uint8_t b1 = *p++;
+            if (b1 == QOI_OP_RGB) {
+                if (end - p < 3) return false;
+                px.r = p[0];
+                px.g = p[1];
+                px.b = p[2];
+                p += 3;
+            } else if (b1 == QOI_OP_RGBA) {
+                if (end - p < 4) return false;
+                px.r = p[0];
+                px.g = p[1];
+                px.b = p[2];
+                px.a = p[3];
+                p += 4;
+            } else {
+                switch (b1 & 0xC0) {
+                    case QOI_OP_INDEX:
+                        px = index[b1];
+                        break;
+                    case QOI_OP_DIFF:
+                        px.r += ((b1 >> 4) & 3) - 2;
+                        px.g += ((b1 >> 2) & 3) - 2;
+                        px.b += (b1 & 3) - 2;
+                        break;
+                    case QOI_OP_LUMA: {
+                        if (p >= end) return false;
+                        const uint8_t b2 = *p++;
+                        const int vg = (b1 & 0x3F) - 32;
+                        px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+                        px.g += vg;
+                        px.b += vg - 8 + (b2 & 0x0F);
+                        break;
+                    }
+                    default:
+                        run = b1 & 0x3F;
+                        break;
+                }
+            }
+
+            // Runs are stored too: the table holds every pixel seen, as the format requires
+            index[hash(px)] = px;
+            Px::store(dst, px);
+        }
+    }
+
+    return true;
+}
+
+} // namespace anonymous
+
+namespace bpx { namespace detail {
+
+bool is_qoi(const void* data, size_t size)
+{
+    return size >= 4 && std::memcmp(data, "qoif", 4) == 0;
+}
+
+bool read_qoi_header(const void* data, size_t size, QoiHeader* header)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (size < QOI_HEADER_SIZE || !is_qoi(data, size)) {
+        return false;
+    }
+
+    header->width = load_be32(bytes + 4);
+    header->height = load_be32(bytes + 8);
+    header->channels = bytes[12];
+    header->colorspace = bytes[13];
+
+    const uint64_t pixels = static_cast<uint64_t>(header->width) * header->height;
+    return header->width > 0 && header->height > 0
+        && header->width <= INT_MAX && header->height <= INT_MAX && pixels <= SIZE_MAX / 4
+        && header->channels >= 3 && header->channels <= 4 && header->colorspace <= 1;
+}
+
+bool qoi_holds_pixels(const QoiHeader& header, size_t size)
+{
+    if (size < QOI_HEADER_SIZE + QOI_PADDING_SIZE) {
+        return false;
+    }
+    const uint64_t pixels = static_cast<uint64_t>(header.width) * header.height;
+    const uint64_t ops = size - QOI_HEADER_SIZE - QOI_PADDING_SIZE;
+    return pixels <= ops * QOI_MAX_RUN;
+}
+
+bool is_qoi_format(PixelFormat format)
+{
+    return format == PixelFormat::RGB_U8 || format == PixelFormat::RGBA_U8 || format == PixelFormat::BGRA_U8;
+}
+
+void encode_qoi(const uint8_t* rows, size_t stride, int w, int h, PixelFormat format, int channels,
+                void (*sink)(void* context, const void* data, size_t size), void* context)
+{
+    uint8_t buffer[QOI_BUFFER_SIZE];
+
+    std::memcpy(buffer, "qoif", 4);
+    store_be32(buffer + 4, static_cast<uint32_t>(w));
+    store_be32(buffer + 8, static_cast<uint32_t>(h));
+    buffer[12] = static_cast<uint8_t>(channels);
+    buffer[13] = 0;     // sRGB with linear alpha
+    uint8_t* p = buffer + QOI_HEADER_SIZE;
+
+    switch (format) {
+        case PixelFormat::RGB_U8:
+            p = encode_rows<Layout::RGB>(rows, stride, w, h, buffer, p, sink, context);
+            break;
+        case PixelFormat::BGRA_U8:
+            p = encode_rows<Layout::BGRA>(rows, stride, w, h, buffer, p, sink, context);
+            break;
+        default:
+            p = encode_rows<Layout::RGBA>(rows, stride, w, h, buffer, p, sink, context);
+            break;
+    }
+
+    if (p + QOI_PADDING_SIZE > buffer + QOI_BUFFER_SIZE) {
+        sink(context, buffer, p - buffer);
+        p = buffer;
+    }
+    std::memcpy(p, QOI_PADDING, QOI_PADDING_SIZE);
+    p += QOI_PADDING_SIZE;
+
+    sink(context, buffer, p - buffer);
+}
+
+bool decode_qoi(const void* data, size_t size, const QoiHeader& header,
+                PixelFormat format, void* pixels, size_t pitch, bool flip)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint8_t* dst = static_cast<uint8_t*>(pixels);
+    const int w = static_cast<int>(header.width);
+    const int h = static_cast<int>(header.height);
+
+    if (size < QOI_HEADER_SIZE + QOI_PADDING_SIZE) {
+        return false;
+    }
+
+    switch (format) {
+        case PixelFormat::RGB_U8:
+            return decode_rows<Layout::RGB>(bytes, size, w, h, dst, pitch, flip);
+        case PixelFormat::BGRA_U8:
+            return decode_rows<Layout::BGRA>(bytes, size, w, h, dst, pitch, flip);
+        case PixelFormat::RGBA_U8:
+            return decode_rows<Layout::RGBA>(bytes, size, w, h, dst, pitch, flip);
+        default:
+            return false;
+    }
+}
+
+}} // namespace bpx::detail
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_QOI_HPP
+#define BPX_QOI_HPP
+
+/*
+    Internal header, not installed.
+
+    QOI ("Quite OK Image") codec, see https://qoiformat.org. Pixels are coded
+    in one pass against the previous pixel and a 64 entry table of recently
+    seen colors, which makes it several times faster than PNG both ways for
+    a comparable size on most images. Only the byte formats the stream maps
+    to directly are taken (RGB_U8, RGBA_U8 and BGRA_U8), the callers convert
+    the others.
+*/
+
+#include "BPX/pixel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bpx { namespace detail {
+
+constexpr size_t QOI_HEADER_SIZE = 14;
+constexpr size_t QOI_PADDING_SIZE = 8;
+
+/*
+    Fields of the 14 byte header.
+*/
+struct QoiHeader
+{
+    uint32_t width;
+    uint32_t height;
+    uint8_t channels;       // 3 or 4
+    uint8_t colorspace;     // 0 for sRGB with linear alpha, 1 for all channels linear
+};
+
+/*
+    Whether the data starts with the "qoif" magic.
+*/
+bool is_qoi(const void* data, size_t size);
+
+/*
+    Parses and validates the header, rejecting dimensions that an `Image`
+    could not address. Only the first 14 bytes are read.
+*/
+bool read_qoi_header(const void* data, size_t size, QoiHeader* header);
+
+/*
+    Whether a file of `size` bytes can hold the pixels of the header, a byte
+    coding at most a run of 62 pixels. Checked before allocating the pixels,
+    so that a few corrupt bytes cannot claim gigabytes.
+*/
+bool qoi_holds_pixels(const QoiHeader& header, size_t size);
+
+/*
+    Whether `format` is read and written by the codec without conversion.
+*/
+bool is_qoi_format(PixelFormat format);
+
+/*
+    Encodes `h` rows of `w` pixels of a QOI format, `stride` bytes apart, as a
+    complete file with `channels` (3 or 4) channels. The output is handed to
+    `sink` in consecutive chunks of a few KiB from a buffer on the stack.
+*/
+void encode_qoi(const uint8_t* rows, size_t stride, int w, int h, PixelFormat format, int channels,
+                void (*sink)(void* context, const void* data, size_t size), void* context);
+
+/*
+    Decodes a whole file, whose header was validated by `read_qoi_header`,
+    into `pixels` of a QOI format with rows `pitch` bytes apart, the last row
+    first if `flip` is set. Fails if the data ends before the last pixel.
+*/
+bool decode_qoi(const void* data, size_t size, const QoiHeader& header,
+                PixelFormat format, void* pixels, size_t pitch, bool flip);
+
+}} // namespace bpx::detail
+
+#endif // BPX_QOI_HPP
@@ -0,0 +1,739 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "./raster.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+using bpx::BlendMode;
+using bpx::Color;
+using bpx::PixelFormat;
+using bpx::detail::ROW_CHUNK;
+using bpx::detail::SHORT_RUN;
+
+bool is_byte_rgba(PixelFormat format)
+{
+    return format == PixelFormat::RGBA_U8 || format == PixelFormat::BGRA_U8;
+}
+
+Color swap_red_blue(Color c)
+{
+    return Color{ c.b, c.g, c.r, c.a };
+}
+
+/*
+    a * b / 255, rounded, for a and b in [0, 255].
+*/
+uint8_t mul_255(int a, int b)
+{
+    const int v = a * b + 128;
+    return static_cast<uint8_t>((v + (v >> 8)) >> 8);
+}
+
+/*
+    a + (b - a) * t / 255, rounded.
+*/
+uint8_t mix_255(int a, int b, int t)
+{
+    const int v = a * (255 - t) + b * t + 128;
+    return static_cast<uint8_t>((v + (v >> 8)) >> 8);
+}
+
+/*
+    Blends src over dst weighted by the coverage c, see `blend_coverage`.
+*/
+template <BlendMode M>
+Color blend_weighted(Color dst, Color src, int c)
+{
+    if constexpr (M == BlendMode::ALPHA) {
+        src.a = mul_255(src.a, c);
+        return bpx::blend(dst, src, M);
+    } else if constexpr (M == BlendMode::PREMULTIPLIED_ALPHA) {
+        src = Color{ mul_255(src.r, c), mul_255(src.g, c), mul_255(src.b, c), mul_255(src.a, c) };
+        return bpx::blend(dst, src, M);
+    } else {
+        const Color b = M == BlendMode::REPLACE ? src : bpx::blend(dst, src, M);
+        return Color{ mix_255(dst.r, b.r, c), mix_255(dst.g, b.g, c),
+                      mix_255(dst.b, b.b, c), mix_255(dst.a, b.a, c) };
+    }
+}
+
+template <BlendMode M>
+void blend_weighted(Color* dst, const Color* src, size_t step, const uint8_t* coverage, int count)
+{
+    for (int i = 0; i < count; i++, src += step) {
+        dst[i] = blend_weighted<M>(dst[i], *src, coverage[i]);
+    }
+}
+
+/*
+    One loop per blend mode for the short runs, a step of 0 blending a single
+    color, indexed like BlendMode. Pixel by pixel, `blend` gives the results
+    of `blend_span` without its setup.
+*/
+using WeightedFunc = void(*)(Color*, const Color*, size_t, const uint8_t*, int);
+
+constexpr WeightedFunc WEIGHTED_KERNELS[13] = {
+    blend_weighted<BlendMode::REPLACE>,
+    blend_weighted<BlendMode::ALPHA>,
+    blend_weighted<BlendMode::ADD>,
+    blend_weighted<BlendMode::SUB>,
+    blend_weighted<BlendMode::MUL>,
+    blend_weighted<BlendMode::SCREEN>,
+    blend_weighted<BlendMode::DARKEN>,
+    blend_weighted<BlendMode::LIGHTEN>,
+    blend_weighted<BlendMode::DIFFERENCE>,
+    blend_weighted<BlendMode::EXCLUSION>,
+    blend_weighted<BlendMode::DODGE>,
+    blend_weighted<BlendMode::BURN>,
+    blend_weighted<BlendMode::PREMULTIPLIED_ALPHA>,
+};
+
+/*
+    Weights the colors by their coverage, in place of `dst`, which holds the
+    pixels they are blended over.
+*/
+void blend_weighted(Color* dst, const Color* src, const uint8_t* coverage, int count, BlendMode mode)
+{
+    if (count < SHORT_RUN) {
+        WEIGHTED_KERNELS[int(mode)](dst, src, 1, coverage, count);
+        return;
+    }
+
+    Color weighted[ROW_CHUNK];
+
+    switch (mode) {
+        case BlendMode::ALPHA:
+            for (int i = 0; i < count; i++) {
+                weighted[i] = src[i];
+                weighted[i].a = mul_255(src[i].a, coverage[i]);
+            }
+            bpx::blend_span(dst, weighted, count, mode);
+            break;
+
+        case BlendMode::PREMULTIPLIED_ALPHA:
+            for (int i = 0; i < count; i++) {
+                const int c = coverage[i];
+                weighted[i] = Color{ mul_255(src[i].r, c), mul_255(src[i].g, c),
+                                     mul_255(src[i].b, c), mul_255(src[i].a, c) };
+            }
+            bpx::blend_span(dst, weighted, count, mode);
+            break;
+
+        default:
+            if (mode == BlendMode::REPLACE) {
+                std::copy_n(src, count, weighted);
+            } else {
+                std::copy_n(dst, count, weighted);
+                bpx::blend_span(weighted, src, count, mode);
+            }
+            for (int i = 0; i < count; i++) {
+                const int c = coverage[i];
+                dst[i] = Color{ mix_255(dst[i].r, weighted[i].r, c), mix_255(dst[i].g, weighted[i].g, c),
+                                mix_255(dst[i].b, weighted[i].b, c), mix_255(dst[i].a, weighted[i].a, c) };
+            }
+            break;
+    }
+}
+
+} // namespace anonymous
+
+namespace bpx { namespace detail {
+
+SolidSpan::SolidSpan(const ImageView& image, Color color, BlendMode mode)
+    : m_image(image), m_mode(mode)
+    , m_color(image.format() == PixelFormat::BGRA_U8 ? swap_red_blue(color) : color)
+    , m_size(pixel_size(image.format()))
+    , m_in_place(is_byte_rgba(image.format()))
+{
+    encode_pixels(image.format(), &color, m_pixel, 1);
+    m_uniform = std::all_of(m_pixel + 1, m_pixel + m_size, [this](uint8_t b) { return b == m_pixel[0]; });
+}
+
+void SolidSpan::operator()(int y, int x0, int x1) const
+{
+    const int count = x1 - x0;
+    uint8_t* dst = static_cast<uint8_t*>(m_image.pixel(x0, y));
+
+    if (m_mode == BlendMode::REPLACE) {
+        if (m_uniform) {
+            std::memset(dst, m_pixel[0], count * m_size);
+        } else if (m_in_place) {
+            std::fill_n(reinterpret_cast<Color*>(dst), count, m_color);
+        } else {
+            // Copies of the pixels already written, doubling in size
+            const size_t total = count * m_size;
+            size_t done = m_size;
+            std::memcpy(dst, m_pixel, m_size);
+            while (done < total) {
+                const size_t n = std::min(done, total - done);
+                std::memcpy(dst + done, dst, n);
+                done += n;
+            }
+        }
+        return;
+    }
+
+    if (m_in_place) {
+        blend_span(reinterpret_cast<Color*>(dst), m_color, count, m_mode);
+        return;
+    }
+
+    Color buffer[ROW_CHUNK];
+    for (int x = x0; x < x1; x += ROW_CHUNK) {
+        const int n = std::min(ROW_CHUNK, x1 - x);
+        m_image.read_row(x, y, buffer, n);
+        blend_span(buffer, m_color, n, m_mode);
+        m_image.write_row(x, y, buffer, n);
+    }
+}
+
+void blend_colors(const ImageView& image, int x, int y, const Color* colors, int count, BlendMode mode)
+{
+    if (mode == BlendMode::REPLACE) {
+        image.write_row(x, y, colors, count);
+        return;
+    }
+
+    if (image.format() == PixelFormat::RGBA_U8) {
+        blend_span(static_cast<Color*>(image.pixel(x, y)), colors, count, mode);
+        return;
+    }
+
+    Color buffer[ROW_CHUNK];
+    for (int i = 0; i < count; i += ROW_CHUNK) {
+        const int n = std::min(ROW_CHUNK, count - i);
+        image.read_row(x + i, y, buffer, n);
+        blend_span(buffer, colors + i, n, mode);
+        image.write_row(x + i, y, buffer, n);
+    }
+}
+
+void map_span(const ImageView& image, int y, int x0, int x1, const Image::Mapper& mapper)
+{
+    if (image.format() == PixelFormat::RGBA_U8) {
+        Color* colors = static_cast<Color*>(image.pixel(x0, y));
+        for (int x = x0; x < x1; x++, colors++) {
+            *colors = mapper(x, y, *colors);
+        }
+        return;
+    }
+
+    Color buffer[ROW_CHUNK];
+    for (int x = x0; x < x1; x += ROW_CHUNK) {
+        const int n = std::min(ROW_CHUNK, x1 - x);
+        image.read_row(x, y, buffer, n);
+        for (int i = 0; i < n; i++) {
+            buffer[i] = mapper(x + i, y, buffer[i]);
+        }
+        image.write_row(x, y, buffer, n);
+    }
+}
+
+void Rasterizer::reset(int x0, int y0, int x1, int y1)
+{
+    m_clip_x0 = x0;
+    m_clip_y0 = y0;
+    m_clip_x1 = std::max(x0, x1);
+    m_clip_y1 = std::max(y0, y1);
+    m_top = HUGE_VALF;
+    m_bottom = -HUGE_VALF;
+    m_edges.clear();
+    m_active.clear();
+    m_next = 0;
+    m_y = m_y_end = 0;
+}
+
+void Rasterizer::add_line(float x0, float y0, float x1, float y1)
+{
+    if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1)) {
+        return;
+    }
+
+    x0 -= m_clip_x0;
+    x1 -= m_clip_x0;
+
+    const float left = 0.0f;
+    const float right = static_cast<float>(m_clip_x1 - m_clip_x0);
+
+    // Splits the edge where it crosses the bounds, each part then being clamped to them
+    float t[2];
+    int splits = 0;
+    if ((x0 < left) != (x1 < left)) t[splits++] = (left - x0) / (x1 - x0);
+    if ((x0 > right) != (x1 > right)) t[splits++] = (right - x0) / (x1 - x0);
+    if (splits == 2 && t[0] > t[1]) std::swap(t[0], t[1]);
+
+    float px = x0, py = y0;
+    for (int i = 0; i < splits; i++) {
+        const float qx = x0 + t[i] * (x1 - x0);
+        const float qy = y0 + t[i] * (y1 - y0);
+        push_edge(std::clamp(px, left, right), py, std::clamp(qx, left, right), qy);
+        px = qx;
+        py = qy;
+    }
+    push_edge(std::clamp(px, left, right), py, std::clamp(x1, left, right), y1);
+}
+
+void Rasterizer::add_polygon(const Point* points, size_t count)
+{
+    if (count < 3) {
+        return;
+    }
+    for (size_t i = 0, j = count - 1; i < count; j = i++) {
+        add_line(points[j].x, points[j].y, points[i].x, points[i].y);
+    }
+}
+
+void Rasterizer::push_edge(float x0, float y0, float x1, float y1)
+{
+    if (y0 == y1) {
+        return;
+    }
+
+    Edge edge;
+    if (y0 < y1) {
+        edge = { x0, y0, y1, (x1 - x0) / (y1 - y0), 1.0f };
+    } else {
+        edge = { x1, y1, y0, (x0 - x1) / (y0 - y1), -1.0f };
+    }
+
+    m_top = std::min(m_top, edge.y0);
+    m_bottom = std::max(m_bottom, edge.y1);
+    m_edges.push_back(edge);
+}
+
+void Rasterizer::begin(bool even_odd, bool antialias, bool convex)
+{
+    m_even_odd = even_odd;
+    m_antialias = antialias;
+    m_convex = convex;
+    m_next = 0;
+    m_active.clear();
+
+    std::sort(m_edges.begin(), m_edges.end(), [](const Edge& a, const Edge& b) {
+        return a.y0 < b.y0;
+    });
+
+    if (m_edges.empty()) {
+        m_y = m_y_end = 0;
+        return;
+    }
+
+    m_y = static_cast<int>(std::max(std::floor(m_top), static_cast<float>(m_clip_y0)));
+    m_y_end = static_cast<int>(std::min(std::ceil(m_bottom), static_cast<float>(m_clip_y1)));
+
+    // An aliased row has at most a run per crossing; anti-aliased rows grow them as needed
+    if (m_runs.size() < m_edges.size()) {
+        m_runs.resize(m_edges.size());
+    }
+
+    if (antialias) {
+        const size_t cells = m_clip_x1 - m_clip_x0 + 2;
+        m_area.assign(cells, 0.0f);
+        m_coverage.resize(cells);
+    }
+}
+
+Rasterizer::Range Rasterizer::accumulate(const Edge& edge, float ya, float yb, float sign)
+{
+    const float right = static_cast<float>(m_clip_x1 - m_clip_x0);
+    const float xa = std::clamp(edge.x0 + (ya - edge.y0) * edge.dxdy, 0.0f, right);
+    const float xb = std::clamp(edge.x0 + (yb - edge.y0) * edge.dxdy, 0.0f, right);
+
+    const float d = (yb - ya) * sign;
+    const float x0 = std::min(xa, xb);
+    const float x1 = std::max(xa, xb);
+
+    // Both are clamped to be positive, truncating floors them
+    const int x0i = static_cast<int>(x0);
+    const float x0_floor = static_cast<float>(x0i);
+    const int x1i = static_cast<int>(x1) + (static_cast<float>(static_cast<int>(x1)) < x1);
+    const float x1_ceil = static_cast<float>(x1i);
+
+    float* area = m_area.data();
+
+    if (x1i <= x0i + 1) {
+        // Within a single cell: its area is the part left of the mean x of the edge
+        const float xm = 0.5f * (xa + xb) - x0_floor;
+        area[x0i] += d - d * xm;
+        area[x0i + 1] += d * xm;
+        return { x0i, x0i + 1 };
+    }
+
+    // Across several cells: triangles at both ends, equal slices in between
+    const float s = 1.0f / (x1 - x0);
+    const float x0f = x0 - x0_floor;
+    const float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+    const float x1f = x1 - x1_ceil + 1.0f;
+    const float am = 0.5f * s * x1f * x1f;
+
+    area[x0i] += d * a0;
+    if (x1i == x0i + 2) {
+        area[x0i + 1] += d * (1.0f - a0 - am);
+    } else {
+        const float a1 = s * (1.5f - x0f);
+        area[x0i + 1] += d * (a1 - a0);
+        for (int x = x0i + 2; x < x1i - 1; x++) {
+            area[x] += d * s;
+        }
+        const float a2 = a1 + (x1i - x0i - 3) * s;
+        area[x1i - 1] += d * (1.0f - a2 - am);
+    }
+    area[x1i] += d * am;
+
+    return { x0i, x1i };
+}
+
+uint8_t Rasterizer::coverage(float area)
+{
+    return static_cast<uint8_t>(std::min(std::abs(area), 1.0f) * 255.0f + 0.5f);
+}
+
+void Rasterizer::push_run(int x0, int x1, const uint8_t* coverage)
+{
+    m_runs[m_run_count++] = { m_clip_x0 + x0, m_clip_x0 + x1, coverage };
+}
+
+float Rasterizer::sweep_band(float ya, float yb)
+{
+    const auto x_at = [](const Edge& edge, float y) { return edge.x0 + (y - edge.y0) * edge.dxdy; };
+
+    // Orders the edges spanning the band by their abscissa at its middle, then
+    // ends the band where two neighbours cross, until none cross inside it
+    for (int pass = 0; pass < MAX_BAND_SPLITS; pass++) {
+        const float ym = 0.5f * (ya + yb);
+        m_band.clear();
+        for (uint32_t index : m_active) {
+            const Edge& edge = m_edges[index];
+            if (edge.y0 <= ya && edge.y1 >= yb) {
+                const BandEdge e{ index, x_at(edge, ya), x_at(edge, ym), x_at(edge, yb) };
+                size_t j = m_band.size();
+                m_band.push_back(e);
+                for (; j > 0 && m_band[j - 1].xm > e.xm; j--) {
+                    m_band[j] = m_band[j - 1];
+                }
+                m_band[j] = e;
+            }
+        }
+
+        float y_cross = yb;
+        for (size_t i = 0; i + 1 < m_band.size(); i++) {
+            const BandEdge& a = m_band[i];
+            const BandEdge& b = m_band[i + 1];
+            if (b.xa < a.xa || b.xb < a.xb) {
+                const float y = ya + (b.xa - a.xa) / (m_edges[a.index].dxdy - m_edges[b.index].dxdy);
+                if (y > ya + MIN_BAND && y < y_cross) {
+                    y_cross = y;
+                }
+            }
+        }
+        if (y_cross == yb) {
+            break;
+        }
+        yb = y_cross;
+    }
+
+    // Only the edges where the fill rule turns inside or outside bound the
+    // shape: they deposit their area with the sign of that change
+    int winding = 0;
+    for (const BandEdge& e : m_band) {
+        const Edge& edge = m_edges[e.index];
+        const bool was_inside = m_even_odd ? (winding & 1) != 0 : winding != 0;
+        winding += static_cast<int>(edge.dir);
+        const bool inside = m_even_odd ? (winding & 1) != 0 : winding != 0;
+        if (inside != was_inside) {
+            m_ranges.push_back(accumulate(edge, ya, yb, inside ? 1.0f : -1.0f));
+        }
+    }
+
+    return yb;
+}
+
+void Rasterizer::sweep_bands(float fy)
+{
+    // The row is cut into bands at the ends of the edges inside it, so that
+    // every edge of a band crosses it whole
+    m_cuts.clear();
+    m_cuts.push_back(fy);
+    for (uint32_t index : m_active) {
+        const Edge& edge = m_edges[index];
+        if (edge.y0 > fy && edge.y0 < fy + 1.0f) m_cuts.push_back(edge.y0);
+        if (edge.y1 > fy && edge.y1 < fy + 1.0f) m_cuts.push_back(edge.y1);
+    }
+    m_cuts.push_back(fy + 1.0f);
+    std::sort(m_cuts.begin(), m_cuts.end());
+
+    for (size_t c = 0; c + 1 < m_cuts.size(); c++) {
+        float ya = m_cuts[c];
+        while (ya < m_cuts[c + 1]) {
+            ya = sweep_band(ya, m_cuts[c + 1]);
+        }
+    }
+}
+
+bool Rasterizer::sweep_area(int y)
+{
+    const int width = m_clip_x1 - m_clip_x0;
+    const float fy = static_cast<float>(y);
+
+    if (m_active.empty()) {
+        return false;
+    }
+
+    m_ranges.clear();
+    if (m_convex) {
+        // Edges of a convex polygon neither cross nor overlap, each bounds it
+        for (uint32_t index : m_active) {
+            const Edge& edge = m_edges[index];
+            const float ya = std::max(fy, edge.y0);
+            const float yb = std::min(fy + 1.0f, edge.y1);
+            m_ranges.push_back(accumulate(edge, ya, yb, edge.dir));
+        }
+    } else {
+        sweep_bands(fy);
+    }
+
+    // A range per edge and band, in the nearly sorted order of the bands
+    const size_t count = m_ranges.size();
+    if (count == 0) {
+        return false;
+    }
+    Range* ranges = m_ranges.data();
+    for (size_t i = 1; i < count; i++) {
+        const Range range = ranges[i];
+        size_t j = i;
+        for (; j > 0 && ranges[j - 1].x0 > range.x0; j--) {
+            ranges[j] = ranges[j - 1];
+        }
+        ranges[j] = range;
+    }
+    if (m_runs.size() < 2 * count) {
+        m_runs.resize(2 * count);
+    }
+
+    float* area = m_area.data();
+    uint8_t* cover = m_coverage.data();
+    float winding = 0.0f;
+    int x = 0;
+
+    m_run_count = 0;
+    for (size_t r = 0; r < count;) {
+        // Merges the ranges overlapping this one
+        const int x0 = ranges[r].x0;
+        int x1 = ranges[r].x1;
+        for (r++; r < count && ranges[r].x0 <= x1; r++) {
+            x1 = std::max(x1, ranges[r].x1);
+        }
+
+        // Pixels since the last range, all with the winding it left
+        if (x0 > x) {
+            const uint8_t c = coverage(winding);
+            if (c == 255) {
+                push_run(x, x0, nullptr);
+            } else if (c != 0) {
+                std::fill(cover + x, cover + x0, c);
+                push_run(x, x0, cover + x);
+            }
+        }
+
+        // Pixels [x0, x1) touched by the edges, summed one by one. The winding
+        // after cell x1 is that of the pixels up to the next range, and the
+        // cells past the right bound are only cleared.
+        const int end = std::min(x1, width);
+        for (int i = x0; i < end; i++) {
+            winding += area[i];
+            area[i] = 0.0f;
+            cover[i] = coverage(winding);
+        }
+        for (int i = std::max(x0, end); i <= x1; i++) {
+            winding += area[i];
+            area[i] = 0.0f;
+        }
+        if (x0 < end) {
+            push_run(x0, end, cover + x0);
+        }
+
+        x = x1;
+    }
+
+    // The outlines being closed, the winding is back to zero past the last range
+    return m_run_count > 0;
+}
+
+bool Rasterizer::sweep_centers(int y)
+{
+    const float yc = y + 0.5f;
+
+    m_crossings.clear();
+    for (uint32_t index : m_active) {
+        const Edge& edge = m_edges[index];
+        if (edge.y0 <= yc && yc < edge.y1) {
+            m_crossings.push_back({ edge.x0 + (yc - edge.y0) * edge.dxdy, edge.dir });
+        }
+    }
+
+    // Pixel x is inside when its center x + 0.5 lies between two crossings
+    const auto first_pixel = [](float x) { return static_cast<int>(std::ceil(x - 0.5f)); };
+
+    m_run_count = 0;
+
+    if (m_convex && m_crossings.size() == 2) {
+        const float a = m_crossings[0].x, b = m_crossings[1].x;
+        const int x0 = first_pixel(std::min(a, b));
+        const int x1 = first_pixel(std::max(a, b));
+        if (x0 < x1) {
+            push_run(x0, x1, nullptr);
+        }
+        return m_run_count > 0;
+    }
+
+    // Few crossings per row, in the nearly stable order of the active edges
+    for (size_t i = 1; i < m_crossings.size(); i++) {
+        const Crossing c = m_crossings[i];
+        size_t j = i;
+        for (; j > 0 && m_crossings[j - 1].x > c.x; j--) {
+            m_crossings[j] = m_crossings[j - 1];
+        }
+        m_crossings[j] = c;
+    }
+
+    int winding = 0;
+    int start = 0;
+    for (const Crossing& c : m_crossings) {
+        const bool was_inside = m_even_odd ? (winding & 1) != 0 : winding != 0;
+        winding += static_cast<int>(c.dir);
+        const bool inside = m_even_odd ? (winding & 1) != 0 : winding != 0;
+        if (inside && !was_inside) {
+            start = first_pixel(c.x);
+        } else if (!inside && was_inside) {
+            const int end = first_pixel(c.x);
+            if (start < end) {
+                // Spans sharing a pixel boundary are merged
+                if (m_run_count > 0 && m_runs[m_run_count - 1].x1 == m_clip_x0 + start) {
+                    m_runs[m_run_count - 1].x1 = m_clip_x0 + end;
+                } else {
+                    push_run(start, end, nullptr);
+                }
+            }
+        }
+    }
+
+    return m_run_count > 0;
+}
+
+bool Rasterizer::next_row(CoverageRow* row)
+{
+    while (m_y < m_y_end) {
+        const int y = m_y++;
+        const float fy = static_cast<float>(y);
+
+        while (m_next < m_edges.size() && m_edges[m_next].y0 < fy + 1.0f) {
+            m_active.push_back(static_cast<uint32_t>(m_next++));
+        }
+        for (size_t i = 0; i < m_active.size();) {
+            if (m_edges[m_active[i]].y1 <= fy) {
+                m_active[i] = m_active.back();
+                m_active.pop_back();
+            } else {
+                i++;
+            }
+        }
+
+        if (m_antialias ? sweep_area(y) : sweep_centers(y)) {
+            row->y = y;
+            row->runs = m_runs.data();
+            row->count = static_cast<int>(m_run_count);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void blend_coverage(const ImageView& image, int x, int y, const Color* colors,
+                    const uint8_t* coverage, int count, BlendMode mode)
+{
+    if (image.format() == PixelFormat::RGBA_U8) {
+        Color* dst = static_cast<Color*>(image.pixel(x, y));
+        for (int i = 0; i < count; i += ROW_CHUNK) {
+            const int n = std::min(ROW_CHUNK, count - i);
+            blend_weighted(dst + i, colors + i, coverage + i, n, mode);
+        }
+        return;
+    }
+
+    Color buffer[ROW_CHUNK];
+    for (int i = 0; i < count; i += ROW_CHUNK) {
+        const int n = std::min(ROW_CHUNK, count - i);
+        image.read_row(x + i, y, buffer, n);
+        blend_weighted(buffer, colors + i, coverage + i, n, mode);
+        image.write_row(x + i, y, buffer, n);
+    }
+}
+
+CoverageSpan::CoverageSpan(const ImageView& image, Color color, BlendMode mode)
+    : m_image(image), m_mode(mode)
+    , m_color(image.format() == PixelFormat::BGRA_U8 ? swap_red_blue(color) : color)
+    , m_in_place(is_byte_rgba(image.format()))
+{ }
+
+void CoverageSpan::operator()(int y, int x, const uint8_t* coverage, int count) const
+{
+    if (m_in_place && count < SHORT_RUN) {
+        WEIGHTED_KERNELS[int(m_mode)](static_cast<Color*>(m_image.pixel(x, y)), &m_color, 0, coverage, count);
+        return;
+    }
+
+    // The color is swizzled for BGRA, which blend_coverage reads as RGBA
+    const Color color = m_image.format() == PixelFormat::BGRA_U8 ? swap_red_blue(m_color) : m_color;
+    Color colors[ROW_CHUNK];
+    std::fill_n(colors, std::min(ROW_CHUNK, count), color);
+
+    for (int i = 0; i < count; i += ROW_CHUNK) {
+        blend_coverage(m_image, x + i, y, colors, coverage + i, std::min(ROW_CHUNK, count - i), m_mode);
+    }
+}
+
+void map_coverage(const ImageView& image, int x, int y, const uint8_t* coverage, int count,
+                  const Image::Mapper& mapper)
+{
+    Color buffer[ROW_CHUNK];
+    Color mapped[ROW_CHUNK];
+    for (int i = 0; i < count; i += ROW_CHUNK) {
+        const int n = std::min(ROW_CHUNK, count - i);
+        image.read_row(x + i, y, buffer, n);
+        for (int j = 0; j < n; j++) {
+            mapped[j] = mapper(x + i + j, y, buffer[j]);
+        }
+        blend_weighted(buffer, mapped, coverage + i, n, BlendMode::REPLACE);
+        image.write_row(x + i, y, buffer, n);
+    }
+}
+
+void fill_coverage(Rasterizer& rasterizer, const ImageView& image, Color color, BlendMode mode,
+                   bool even_odd, bool antialias, bool convex)
+{
+    sweep(rasterizer, even_odd, antialias, convex, SolidSpan(image, color, mode), CoverageSpan(image, color, mode));
+}
+
+}} // namespace bpx::detail
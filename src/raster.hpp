@@ -0,0 +1,529 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_RASTER_HPP
+#define BPX_RASTER_HPP
+
+/*
+    Internal header, not installed.
+
+    Span rasterization of the drawing primitives. A shape is turned into the
+    runs [x0, x1) of pixels it covers on each row, every row of the shape
+    being produced once and clipped once to the image. The runs are then
+    handed whole to a span writer, which resolves the pixel format and the
+    blend mode once per shape instead of once per pixel.
+
+    Anti-aliased shapes go through the coverage rasterizer: their outlines
+    are accumulated as edges, then swept row by row into the coverage of
+    each pixel. Fully covered runs take the span writers above, the partial
+    ones the coverage writers, so every pixel is blended once whatever the
+    number of edges or overlapping pieces around it.
+*/
+
+#include "BPX/algorithm.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <initializer_list>
+#include <vector>
+
+namespace bpx { namespace detail {
+
+/*
+    Calls span(y, x0, x1) for each row y of the filled circle of center
+    (cx, cy), with [x0, x1) the pixels of the row inside the circle and
+    inside [xmin, xmax) x [ymin, ymax). Rows are produced from the center
+    outwards, each at most once.
+
+    The rows covered are those of the midpoint circle algorithm: at every
+    step (x, y), the rows cy +/- y extend x pixels on both sides of the
+    center and the rows cy +/- x extend y pixels. Row cy +/- y is complete
+    once y is about to decrease; when it meets row cy +/- x at the
+    diagonal, the latter is the wider one and the only one produced.
+*/
+template <typename Span>
+void circle_spans(int cx, int cy, int radius, int xmin, int ymin, int xmax, int ymax, Span&& span)
+{
+    const auto emit = [&](int dy, int half) {
+        const int x0 = std::max(cx - half, xmin);
+        const int x1 = std::min(cx + half + 1, xmax);
+        if (x0 >= x1) return;
+        if (cy + dy >= ymin && cy + dy < ymax) span(cy + dy, x0, x1);
+        if (dy != 0 && cy - dy >= ymin && cy - dy < ymax) span(cy - dy, x0, x1);
+    };
+
+    int x = 0;
+    int y = radius;
+    int d = 3 - 2 * radius;
+
+    while (y >= x) {
+        emit(x, y);
+
+        int next_y = y;
+        if (d > 0) {
+            next_y--;
+            d = d + 4 * (x + 1 - next_y) + 10;
+        } else {
+            d = d + 4 * (x + 1) + 6;
+        }
+
+        if (y > x && (next_y != y || next_y < x + 1)) {
+            emit(y, x);
+        }
+
+        x++;
+        y = next_y;
+    }
+}
+
+/*
+    Calls span(y, x0, x1) for the runs of the outline of the circle of
+    center (cx, cy) drawn by the midpoint circle algorithm, clipped to
+    [xmin, xmax) x [ymin, ymax). Each pixel is produced once.
+
+    At every step (x, y), rows cy +/- x take the pixels cx +/- y, one per
+    step, and rows cy +/- y the pixels cx +/- x, whose steps follow each
+    other until y decreases. Both meet only on the diagonal, at the last
+    step, whose pixel belongs to the latter.
+*/
+template <typename Span>
+void circle_outline_spans(int cx, int cy, int radius, int xmin, int ymin, int xmax, int ymax, Span&& span)
+{
+    // Pixels [cx + a, cx + b] of rows cy +/- dy, and their mirror
+    const auto emit = [&](int dy, int a, int b) {
+        const auto run = [&](int y, int x0, int x1) {
+            x0 = std::max(x0, xmin);
+            x1 = std::min(x1, xmax);
+            if (x0 < x1) span(y, x0, x1);
+        };
+        for (int y : { cy + dy, cy - dy }) {
+            if (y >= ymin && y < ymax) {
+                if (a == 0) {
+                    run(y, cx - b, cx + b + 1);
+                } else {
+                    run(y, cx - b, cx - a + 1);
+                    run(y, cx + a, cx + b + 1);
+                }
+            }
+            if (dy == 0) break;
+        }
+    };
+
+    int x = 0;
+    int y = radius;
+    int d = 3 - 2 * radius;
+    int first = 0;          // First step on row cy +/- y
+
+    while (y >= x) {
+        if (x != y) {
+            emit(x, y, y);
+        }
+
+        const int last = x++;
+        if (d > 0) {
+            emit(y, first, last);
+            first = x;
+            y--;
+            d = d + 4 * (x - y) + 10;
+        } else {
+            d = d + 4 * x + 6;
+            if (y < x) {
+                emit(y, first, last);
+            }
+        }
+    }
+}
+
+/*
+    Calls span(y, x0, x1) for the runs of the ring between the outline of
+    the circle of radius `inner` and the one of radius `outer`, both
+    included, clipped to [xmin, xmax) x [ymin, ymax). Rows are produced
+    from top to bottom, each pixel once.
+
+    The ring is the filled circle of radius `outer` without the pixels
+    strictly inside the outline of radius `inner`: on each row, it takes
+    the pixels from the inner outline to the edge of the outer circle on
+    both sides, so no pixel is left out between consecutive radii. Rows
+    the inner circle does not reach are taken whole.
+*/
+template <typename Span>
+void ring_spans(int cx, int cy, int outer, int inner, int xmin, int ymin, int xmax, int ymax, Span&& span)
+{
+    if (outer < 0) return;
+    inner = std::min(inner, outer);
+
+    // Half width of each row of the outer circle, and first pixel of the
+    // inner outline from the center on each row of the inner circle
+    std::vector<int> outer_half(outer + 1, 0);
+    std::vector<int> inner_first(std::max(inner + 1, 0), outer + 1);
+    circle_spans(0, 0, outer, 0, 0, outer + 1, outer + 1, [&](int y, int, int x1) {
+        outer_half[y] = x1 - 1;
+    });
+    if (inner >= 0) {
+        circle_outline_spans(0, 0, inner, 0, 0, inner + 1, inner + 1, [&](int y, int x0, int) {
+            inner_first[y] = std::min(inner_first[y], x0);
+        });
+    }
+
+    const auto run = [&](int y, int x0, int x1) {
+        x0 = std::max(x0, xmin);
+        x1 = std::min(x1, xmax);
+        if (x0 < x1) span(y, x0, x1);
+    };
+
+    const int y_begin = std::max(cy - outer, ymin);
+    const int y_end = std::min(cy + outer + 1, ymax);
+    for (int y = y_begin; y < y_end; y++) {
+        const int dy = std::abs(y - cy);
+        const int half = outer_half[dy];
+        const int first = (dy <= inner) ? std::min(inner_first[dy], half) : 0;
+        if (first == 0) {
+            run(y, cx - half, cx + half + 1);
+        } else {
+            run(y, cx - half, cx - first + 1);
+            run(y, cx + first, cx + half + 1);
+        }
+    }
+}
+
+/*
+    Calls span(y, x0, x1) for the runs of the outline of the rectangle whose
+    corners are the pixels (x0, y0) and (x1, y1), included, widened by
+    `half` pixels on both sides of its edges, clipped to [xmin, xmax) x
+    [ymin, ymax). The outline is cut into four disjoint bands, the top and
+    bottom ones taking the corners, so each pixel is produced once.
+*/
+template <typename Span>
+void rect_outline_spans(int x0, int y0, int x1, int y1, int half, int xmin, int ymin, int xmax, int ymax,
+                        Span&& span)
+{
+    // Outer bounds [ox0, ox1) x [oy0, oy1), and the hole [ix0, ix1) x [iy0, iy1)
+    const int ox0 = x0 - half, ox1 = x1 + half + 1;
+    const int oy0 = y0 - half, oy1 = y1 + half + 1;
+    const int ix0 = x0 + half + 1, ix1 = x1 - half;
+    const int iy0 = y0 + half + 1, iy1 = y1 - half;
+    const bool hole = (ix0 < ix1 && iy0 < iy1);
+
+    const auto run = [&](int y, int a, int b) {
+        a = std::max(a, xmin);
+        b = std::min(b, xmax);
+        if (a < b) span(y, a, b);
+    };
+
+    const int y_begin = std::max(oy0, ymin);
+    const int y_end = std::min(oy1, ymax);
+    for (int y = y_begin; y < y_end; y++) {
+        if (hole && y >= iy0 && y < iy1) {
+            run(y, ox0, ix0);
+            run(y, ix1, ox1);
+        } else {
+            run(y, ox0, ox1);
+        }
+    }
+}
+
+/*
+    Solid color written or blended over spans of pixels. For REPLACE, the
+    color is encoded once to the format of the image and the spans are
+    filled with its bytes. The other modes blend the spans in place when
+    the image is 8-bit RGBA or BGRA (the color being swizzled once for the
+    latter, every mode treating the color channels alike), and decode them
+    in chunks otherwise.
+*/
+class SolidSpan
+{
+public:
+    SolidSpan(const ImageView& image, Color color, BlendMode mode);
+
+    void operator()(int y, int x0, int x1) const;
+
+private:
+    ImageView m_image;
+    BlendMode m_mode;
+    Color m_color;              // Color blended in place, in the byte order of the image
+    uint8_t m_pixel[16];        // Encoded color written by REPLACE
+    size_t m_size;              // Size of an encoded pixel
+    bool m_uniform;             // All the bytes of the encoded color are equal
+    bool m_in_place;            // Spans are blended without decoding
+};
+
+/*
+    Blends `count` colors over the pixels starting at (x, y), already clipped.
+    REPLACE encodes them directly, the other modes blend 8-bit RGBA pixels in
+    place and decode the other formats in chunks.
+*/
+void blend_colors(const ImageView& image, int x, int y, const Color* colors, int count, BlendMode mode);
+
+/*
+    Replaces the pixels [x0, x1) of row y, already clipped, with what the
+    mapper returns for them. 8-bit RGBA pixels are passed in place, the
+    other formats are decoded in chunks.
+*/
+void map_span(const ImageView& image, int y, int x0, int x1, const Image::Mapper& mapper);
+
+/*
+    Run of pixels [x0, x1) of a row produced by the rasterizer, either fully
+    covered (no coverage) or with the coverage of each of its pixels, from
+    0 (outside) to 255 (fully covered).
+*/
+struct CoverageRun
+{
+    int x0;
+    int x1;
+    const uint8_t* coverage;    // Coverage of pixel x at coverage[x - x0], null when full
+};
+
+/*
+    Runs of the pixels of row y covered by the shape, ordered from left to
+    right; the pixels between them are not covered.
+*/
+struct CoverageRow
+{
+    int y;
+    const CoverageRun* runs;
+    int count;
+};
+
+/*
+    Scanline rasterizer of a set of closed outlines.
+
+    Edges are clipped to the horizontal bounds when added (the parts beyond
+    becoming vertical edges on the bounds, which leaves the coverage inside
+    unchanged), stored in an edge table sorted by their top when the sweep
+    begins, and each row only visits the active edges crossing it.
+
+    Anti-aliased rows compute the exact area of the filled region. A row is
+    cut into bands at the ends of its edges and at the points where two of
+    them cross, so that the edges keep the same order through each band.
+    The fill rule is resolved there: only the edges where the winding turns
+    inside or outside bound the region, and they alone deposit the signed
+    area they cover in the cells they cross and the cover they carry to the
+    right of them, a running sum over the row giving the coverage of each
+    pixel, as in font rasterizers. Overlapping outlines are thus unioned
+    rather than summed. Only the cells touched by an edge are summed one by
+    one; the pixels between them share the same coverage and come out as a
+    single run, so the cost of a row follows its edges and not its width.
+
+    Aliased rows sample the center of the pixels: the crossings of the
+    active edges with the middle of the row are sorted and walked with the
+    fill rule. Convex shapes cross it twice, which needs neither.
+
+    The buffers are kept from one shape to the next, a reused rasterizer
+    does not allocate once they have grown to the largest shape.
+*/
+class Rasterizer
+{
+public:
+    /*
+        Starts a new shape, clipped to [x0, x1) x [y0, y1).
+    */
+    void reset(int x0, int y0, int x1, int y1);
+
+    /*
+        Adds the edge from (x0, y0) to (x1, y1). Horizontal edges carry no
+        coverage and are dropped, as are non-finite ones.
+    */
+    void add_line(float x0, float y0, float x1, float y1);
+
+    /*
+        Adds the closed polygon of `count` points, its last point joined to
+        the first. Its orientation gives the sign of its winding.
+    */
+    void add_polygon(const Point* points, size_t count);
+
+    /*
+        Starts the sweep of the shape, over the rows it covers inside the
+        clip. With `even_odd`, pixels are inside when their winding is odd,
+        otherwise when it is not zero. Without `antialias`, the pixels whose
+        center is inside are fully covered and the others not at all.
+        `convex` tells that the outlines form a single convex polygon.
+    */
+    void begin(bool even_odd, bool antialias, bool convex = false);
+
+    /*
+        Produces the runs of the next row holding any, false at the end.
+        The row stays valid until the next call.
+    */
+    bool next_row(CoverageRow* row);
+
+private:
+    struct Edge
+    {
+        float x0, y0;           // Top point, relative to the left bound
+        float y1;               // Bottom
+        float dxdy;             // Slope
+        float dir;              // +1 going down, -1 going up
+    };
+
+    struct Range
+    {
+        int x0, x1;             // Cells [x0, x1] touched by an edge
+    };
+
+    struct Crossing
+    {
+        float x;
+        float dir;
+    };
+
+    struct BandEdge
+    {
+        uint32_t index;
+        float xa, xm, xb;       // Abscissas at the top, middle and bottom of the band
+    };
+
+    static constexpr int MAX_BAND_SPLITS = 32;
+    static constexpr float MIN_BAND = 1.0f / 1024.0f;   // Crossings closer to the top are ignored
+
+    void push_edge(float x0, float y0, float x1, float y1);
+    Range accumulate(const Edge& edge, float ya, float yb, float sign);
+    float sweep_band(float ya, float yb);
+    void sweep_bands(float fy);
+    bool sweep_area(int y);
+    bool sweep_centers(int y);
+    void push_run(int x0, int x1, const uint8_t* coverage);
+    static uint8_t coverage(float area);
+
+    std::vector<Edge> m_edges;
+    std::vector<uint32_t> m_active;         // Indices of the edges crossing the current row
+    std::vector<float> m_area;              // Signed area per cell, two cells past the right bound
+    std::vector<uint8_t> m_coverage;
+    std::vector<Range> m_ranges;
+    std::vector<Crossing> m_crossings;
+    std::vector<float> m_cuts;              // Band limits of the current row
+    std::vector<BandEdge> m_band;           // Edges of the current band, left to right
+    std::vector<CoverageRun> m_runs;
+    size_t m_run_count = 0;
+    size_t m_next = 0;                      // First edge not yet active
+    int m_clip_x0 = 0, m_clip_y0 = 0;
+    int m_clip_x1 = 0, m_clip_y1 = 0;
+    float m_top = 0, m_bottom = 0;          // Vertical extent of the edges
+    int m_y = 0, m_y_end = 0;               // Rows left to sweep
+    bool m_even_odd = false;
+    bool m_antialias = true;
+    bool m_convex = false;
+};
+
+/*
+    Runs of partially covered pixels shorter than this are passed whole to
+    the writers, which is cheaper than splitting them further.
+*/
+constexpr int SHORT_RUN = 8;
+
+/*
+    Calls full(y, x0, x1) for the runs of fully covered pixels of the row and
+    partial(y, x, coverage, count) for the others. Partial runs shorter than
+    SHORT_RUN may hold coverages of 0 and 255, to be left untouched and
+    blended whole; the pixels of longer runs are split by their coverage.
+*/
+template <typename Full, typename Partial>
+void for_each_run(const CoverageRow& row, Full&& full, Partial&& partial)
+{
+    for (int r = 0; r < row.count; r++) {
+        const CoverageRun& run = row.runs[r];
+        const uint8_t* coverage = run.coverage;
+        const int count = run.x1 - run.x0;
+
+        if (coverage == nullptr) {
+            full(row.y, run.x0, run.x1);
+            continue;
+        }
+        if (count < SHORT_RUN) {
+            partial(row.y, run.x0, coverage, count);
+            continue;
+        }
+
+        int i = 0;
+        while (i < count) {
+            const uint8_t c = coverage[i];
+            int j = i + 1;
+            if (c == 255) {
+                while (j < count && coverage[j] == 255) j++;
+                full(row.y, run.x0 + i, run.x0 + j);
+            } else if (c != 0) {
+                while (j < count && coverage[j] != 0 && coverage[j] != 255) j++;
+                partial(row.y, run.x0 + i, coverage + i, j - i);
+            }
+            i = j;
+        }
+    }
+}
+
+/*
+    Sweeps the shape held by the rasterizer, handing its runs to the writers
+    as for_each_run does.
+*/
+template <typename Full, typename Partial>
+void sweep(Rasterizer& rasterizer, bool even_odd, bool antialias, bool convex, Full&& full, Partial&& partial)
+{
+    CoverageRow row;
+    rasterizer.begin(even_odd, antialias, convex);
+    while (rasterizer.next_row(&row)) {
+        for_each_run(row, full, partial);
+    }
+}
+
+/*
+    Blends `count` colors over the pixels starting at (x, y), already clipped,
+    each weighted by its coverage. ALPHA and PREMULTIPLIED_ALPHA scale the
+    opacity of the colors, the other modes mix the pixel with its blended
+    result in proportion to the coverage; both then reduce to `blend_span`.
+*/
+void blend_coverage(const ImageView& image, int x, int y, const Color* colors,
+                    const uint8_t* coverage, int count, BlendMode mode);
+
+/*
+    Solid color blended over partially covered spans, see `blend_coverage`.
+    Like `SolidSpan`, short spans of 8-bit RGBA or BGRA are blended in place.
+    Coverages of 0 and 255 are also handled, leaving the pixel untouched and
+    blending the color whole.
+*/
+class CoverageSpan
+{
+public:
+    CoverageSpan(const ImageView& image, Color color, BlendMode mode);
+
+    void operator()(int y, int x, const uint8_t* coverage, int count) const;
+
+private:
+    ImageView m_image;
+    BlendMode m_mode;
+    Color m_color;              // In the byte order of the image
+    bool m_in_place;
+};
+
+/*
+    Replaces the pixels starting at (x, y), already clipped, with what the
+    mapper returns for them, weighted by their coverage.
+*/
+void map_coverage(const ImageView& image, int x, int y, const uint8_t* coverage, int count,
+                  const Image::Mapper& mapper);
+
+/*
+    Sweeps the shape held by the rasterizer and draws it with a solid color,
+    with the nonzero rule and anti-aliased unless told otherwise.
+*/
+void fill_coverage(Rasterizer& rasterizer, const ImageView& image, Color color, BlendMode mode,
+                   bool even_odd = false, bool antialias = true, bool convex = false);
+
+}} // namespace bpx::detail
+
+#endif // BPX_RASTER_HPP
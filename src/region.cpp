@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/region.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+using bpx::Rect;
+
+int64_t area(const Rect& r)
+{
+    return static_cast<int64_t>(r.w) * r.h;
+}
+
+Rect bounding(const Rect& a, const Rect& b)
+{
+    const int x0 = std::min(a.x, b.x), y0 = std::min(a.y, b.y);
+    const int x1 = std::max(a.x + a.w, b.x + b.w), y1 = std::max(a.y + a.h, b.y + b.h);
+    return Rect{ x0, y0, x1 - x0, y1 - y0 };
+}
+
+/*
+    Pixels the bounding box of two rectangles covers and neither of them
+    does. Zero or less when merging them loses nothing.
+*/
+int64_t waste(const Rect& a, const Rect& b)
+{
+    return area(bounding(a, b)) - area(a) - area(b) + area(bpx::intersection(a, b));
+}
+
+} // namespace
+
+namespace bpx {
+
+Rect intersection(const Rect& a, const Rect& b) noexcept
+{
+    const int x0 = std::max(a.x, b.x), y0 = std::max(a.y, b.y);
+    const int x1 = std::min(a.x + a.w, b.x + b.w), y1 = std::min(a.y + a.h, b.y + b.h);
+    if (x0 >= x1 || y0 >= y1) {
+        return Rect{};
+    }
+    return Rect{ x0, y0, x1 - x0, y1 - y0 };
+}
+
+Region::Region(int max_rects)
+    : m_max_rects(std::max(max_rects, 1))
+{ }
+
+Region::Region(const Rect& rect, int max_rects)
+    : Region(max_rects)
+{
+    add(rect);
+}
+
+void Region::add(const Rect& rect)
+{
+    if (rect.empty()) {
+        return;
+    }
+
+    // Absorbs the rectangles overlapping the new one or lying flush with it,
+    // again after every merge since the grown rectangle may reach others
+
+    Rect merged = rect;
+    for (size_t i = 0; i < m_rects.size();) {
+        if (!intersection(m_rects[i], merged).empty() || waste(m_rects[i], merged) <= 0) {
+            merged = bounding(m_rects[i], merged);
+            m_rects[i] = m_rects.back();
+            m_rects.pop_back();
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    m_rects.push_back(merged);
+
+    if (static_cast<int>(m_rects.size()) <= m_max_rects) {
+        return;
+    }
+
+    // Too many rectangles: merges the pair wasting the fewest pixels
+
+    size_t best_i = 0, best_j = 1;
+    int64_t best_waste = waste(m_rects[0], m_rects[1]);
+    for (size_t i = 0; i < m_rects.size(); i++) {
+        for (size_t j = i + 1; j < m_rects.size(); j++) {
+            const int64_t w = waste(m_rects[i], m_rects[j]);
+            if (w < best_waste) {
+                best_i = i, best_j = j, best_waste = w;
+            }
+        }
+    }
+
+    const Rect pair = bounding(m_rects[best_i], m_rects[best_j]);
+    m_rects[best_j] = m_rects.back();
+    m_rects.pop_back();
+    m_rects[best_i] = m_rects.back();
+    m_rects.pop_back();
+    add(pair);
+}
+
+void Region::add(const Region& region)
+{
+    for (const Rect& rect : region.m_rects) {
+        add(rect);
+    }
+}
+
+Rect Region::bounds() const noexcept
+{
+    if (m_rects.empty()) {
+        return Rect{};
+    }
+    Rect result = m_rects[0];
+    for (const Rect& rect : m_rects) {
+        result = bounding(result, rect);
+    }
+    return result;
+}
+
+int64_t Region::area() const noexcept
+{
+    int64_t result = 0;
+    for (const Rect& rect : m_rects) {
+        result += ::area(rect);
+    }
+    return result;
+}
+
+bool Region::intersects(const Rect& rect) const noexcept
+{
+    return std::any_of(m_rects.begin(), m_rects.end(), [&](const Rect& r) {
+        return !intersection(r, rect).empty();
+    });
+}
+
+void Region::intersect(const Rect& rect)
+{
+    size_t count = 0;
+    for (const Rect& r : m_rects) {
+        const Rect common = intersection(r, rect);
+        if (!common.empty()) {
+            m_rects[count++] = common;
+        }
+    }
+    m_rects.resize(count);
+}
+
+} // namespace bpx
@@ -0,0 +1,304 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "./stroke.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using bpx::LineCap;
+using bpx::LineJoin;
+using bpx::Point;
+using bpx::detail::Rasterizer;
+
+constexpr float PI = 3.14159265358979323846f;
+
+/*
+    Largest distance between a circle and the polygon replacing it, in pixels.
+*/
+constexpr float CIRCLE_TOLERANCE = 0.1f;
+
+Point operator+(Point a, Point b) { return Point{ a.x + b.x, a.y + b.y }; }
+Point operator-(Point a, Point b) { return Point{ a.x - b.x, a.y - b.y }; }
+Point operator*(Point a, float s) { return Point{ a.x * s, a.y * s }; }
+
+float dot(Point a, Point b) { return a.x * b.x + a.y * b.y; }
+float cross(Point a, Point b) { return a.x * b.y - a.y * b.x; }
+
+/*
+    Adds a piece of a stroke wound the normal way whatever the order of its
+    points, so that all the pieces add up under the nonzero rule.
+*/
+void add_piece(Rasterizer& rasterizer, const Point* points, int count)
+{
+    float area = 0.0f;
+    for (int i = 0, j = count - 1; i < count; j = i++) {
+        area += cross(points[j], points[i]);
+    }
+
+    if (area > 0.0f) {
+        rasterizer.add_polygon(points, count);
+    } else if (area < 0.0f) {
+        for (int i = 0, j = count - 1; i < count; j = i++) {
+            rasterizer.add_line(points[i].x, points[i].y, points[j].x, points[j].y);
+        }
+    }
+}
+
+/*
+    Half the width along the left normal of the unit direction d.
+*/
+Point normal(Point d, float half_width)
+{
+    return Point{ -d.y * half_width, d.x * half_width };
+}
+
+void add_segment(Rasterizer& rasterizer, Point a, Point b, Point d, float half_width)
+{
+    const Point n = normal(d, half_width);
+    const Point quad[4] = { a + n, b + n, b - n, a - n };
+    add_piece(rasterizer, quad, 4);
+}
+
+/*
+    Fills the outer side of the turn at p from direction d0 to direction d1,
+    the inner side being covered by the overlapping segments.
+*/
+void add_join(Rasterizer& rasterizer, Point p, Point d0, Point d1, float half_width,
+              const bpx::StrokeStyle& style)
+{
+    const float turn = cross(d0, d1);
+    const bool straight = std::abs(turn) < 1e-6f && dot(d0, d1) > 0.0f;
+
+    if (straight) {
+        return;
+    }
+
+    if (style.join == LineJoin::ROUND) {
+        bpx::detail::add_circle(rasterizer, p.x, p.y, half_width);
+        return;
+    }
+
+    const float side = turn > 0.0f ? -1.0f : 1.0f;
+    const Point n0 = normal(d0, half_width * side);
+    const Point n1 = normal(d1, half_width * side);
+
+    if (style.join == LineJoin::MITER) {
+        // The miter tip lies along the mean of the normals, 1 / cos of half their angle away
+        const Point u = (n0 + n1) * 0.5f;
+        const float u2 = dot(u, u);
+        const float hw2 = half_width * half_width;
+        if (u2 > 0.0f && hw2 <= style.miter_limit * style.miter_limit * u2) {
+            const Point quad[4] = { p, p + n0, p + u * (hw2 / u2), p + n1 };
+            add_piece(rasterizer, quad, 4);
+            return;
+        }
+    }
+
+    const Point triangle[3] = { p, p + n0, p + n1 };
+    add_piece(rasterizer, triangle, 3);
+}
+
+/*
+    Adds the cap ending the stroke at p, d pointing out of it.
+*/
+void add_cap(Rasterizer& rasterizer, Point p, Point d, float half_width, LineCap cap)
+{
+    switch (cap) {
+        case LineCap::BUTT:
+            break;
+
+        case LineCap::SQUARE:
+            add_segment(rasterizer, p, p + d * half_width, d, half_width);
+            break;
+
+        case LineCap::ROUND:
+            bpx::detail::add_circle(rasterizer, p.x, p.y, half_width);
+            break;
+    }
+}
+
+/*
+    Sides of a polygon close enough to a circle of the given radius, the
+    chords staying within the tolerance of the circle.
+*/
+int circle_sides(float radius)
+{
+    if (!(radius > CIRCLE_TOLERANCE)) {
+        return 8;
+    }
+    const float step = std::acos(1.0f - CIRCLE_TOLERANCE / radius);
+    return std::clamp(static_cast<int>(std::ceil(PI / step)), 8, 4096);
+}
+
+Point direction(Point a, Point b)
+{
+    const Point d = b - a;
+    return d * (1.0f / std::sqrt(dot(d, d)));
+}
+
+bool same_point(Point a, Point b)
+{
+    const Point d = b - a;
+    return dot(d, d) < 1e-12f;
+}
+
+} // namespace anonymous
+
+namespace bpx { namespace detail {
+
+void add_circle(Rasterizer& rasterizer, float cx, float cy, float radius, bool reverse)
+{
+    if (!(radius > 0.0f)) {
+        return;
+    }
+
+    // Vertices pushed out for the polygon to have the area of the circle
+    const int sides = circle_sides(radius);
+    const float angle = 2.0f * PI / sides;
+    const float r = radius * std::sqrt(angle / std::sin(angle));
+
+    float px = cx + r, py = cy;
+    for (int i = 1; i <= sides; i++) {
+        const float a = (reverse ? -angle : angle) * (i == sides ? 0 : i);
+        const float qx = cx + r * std::cos(a);
+        const float qy = cy + r * std::sin(a);
+        rasterizer.add_line(px, py, qx, qy);
+        px = qx;
+        py = qy;
+    }
+}
+
+void add_line_stroke(Rasterizer& rasterizer, Point a, Point b, const StrokeStyle& style)
+{
+    const float half_width = 0.5f * style.width;
+    if (!(half_width > 0.0f)) {
+        return;
+    }
+
+    if (same_point(a, b)) {
+        const Point points[2] = { a, b };
+        add_stroke(rasterizer, points, 2, false, style);
+        return;
+    }
+
+    const Point d = direction(a, b);
+    const Point n = normal(d, half_width);
+
+    if (style.cap != LineCap::ROUND) {
+        const Point e = style.cap == LineCap::SQUARE ? d * half_width : Point{ 0.0f, 0.0f };
+        const Point quad[4] = { a - e + n, b + e + n, b + e - n, a - e - n };
+        add_piece(rasterizer, quad, 4);
+        return;
+    }
+
+    // Both sides joined by half circles around the ends. Their inner vertices
+    // are pushed out as for a whole circle, the first and last ones staying
+    // on the sides for the outline to remain convex, and the arcs take as
+    // many steps as a whole circle to keep the chords next to them close.
+    const int steps = circle_sides(half_width);
+    const float angle = PI / steps;
+    const float scale = std::sqrt(angle / std::sin(angle));
+
+    Point p = a + n;
+    const auto arc = [&](Point c, Point u, Point v) {
+        for (int i = 1; i < steps; i++) {
+            const float s = scale * std::sin(angle * i);
+            const float k = scale * std::cos(angle * i);
+            const Point q = c + u * k + v * s;
+            rasterizer.add_line(p.x, p.y, q.x, q.y);
+            p = q;
+        }
+        const Point q = c - u;
+        rasterizer.add_line(p.x, p.y, q.x, q.y);
+        p = q;
+    };
+
+    const Point side = d * half_width;
+    rasterizer.add_line(p.x, p.y, b.x + n.x, b.y + n.y);
+    p = b + n;
+    arc(b, n, side);
+    rasterizer.add_line(p.x, p.y, a.x - n.x, a.y - n.y);
+    p = a - n;
+    arc(a, n * -1.0f, side * -1.0f);
+}
+
+void add_stroke(Rasterizer& rasterizer, const Point* points, size_t count,
+                bool closed, const StrokeStyle& style)
+{
+    const float half_width = 0.5f * style.width;
+    if (count == 0 || !(half_width > 0.0f)) {
+        return;
+    }
+
+    // Walks the segments between distinct points, joining each to the previous one
+    Point first = points[0];
+    Point last = first;
+    Point first_dir{}, last_dir{};
+    bool any = false;
+
+    for (size_t i = 1; i < count; i++) {
+        const Point p = points[i];
+        if (same_point(last, p)) {
+            continue;
+        }
+        const Point d = direction(last, p);
+        add_segment(rasterizer, last, p, d, half_width);
+        if (any) {
+            add_join(rasterizer, last, last_dir, d, half_width, style);
+        } else {
+            first_dir = d;
+            any = true;
+        }
+        last = p;
+        last_dir = d;
+    }
+
+    if (!any) {
+        // A lone point: only its caps are left, facing an arbitrary direction
+        if (style.cap == LineCap::ROUND) {
+            add_circle(rasterizer, first.x, first.y, half_width);
+        } else if (style.cap == LineCap::SQUARE) {
+            const Point square[4] = {
+                { first.x - half_width, first.y - half_width }, { first.x + half_width, first.y - half_width },
+                { first.x + half_width, first.y + half_width }, { first.x - half_width, first.y + half_width }
+            };
+            add_piece(rasterizer, square, 4);
+        }
+        return;
+    }
+
+    if (!closed) {
+        add_cap(rasterizer, first, first_dir * -1.0f, half_width, style.cap);
+        add_cap(rasterizer, last, last_dir, half_width, style.cap);
+        return;
+    }
+
+    if (!same_point(last, first)) {
+        const Point d = direction(last, first);
+        add_segment(rasterizer, last, first, d, half_width);
+        add_join(rasterizer, last, last_dir, d, half_width, style);
+        last_dir = d;
+    }
+    add_join(rasterizer, first, last_dir, first_dir, half_width, style);
+}
+
+}} // namespace bpx::detail
@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#ifndef BPX_STROKE_HPP
+#define BPX_STROKE_HPP
+
+/*
+    Internal header, not installed.
+
+    Outlines of strokes and round shapes, added to a coverage rasterizer.
+
+    A stroke is not traced as a single offset outline but as the union of
+    its pieces: a rectangle per segment, a wedge or a disc per join and the
+    caps at both ends, all wound the same way. The nonzero rule merges them
+    where they overlap, so a pixel is blended once however many pieces
+    cover it, and sharp turns or self-crossings need no special case.
+*/
+
+#include "./raster.hpp"
+
+namespace bpx { namespace detail {
+
+/*
+    Adds the circle of center (cx, cy) as a polygon close enough for the
+    coverage to be exact to a fraction of a pixel. `reverse` winds it the
+    other way, which cuts it out of a shape wound the normal way.
+*/
+void add_circle(Rasterizer& rasterizer, float cx, float cy, float radius, bool reverse = false);
+
+/*
+    Adds the stroke of the segment from a to b and its caps as a single
+    convex polygon, whose edges neither cross nor overlap.
+*/
+void add_line_stroke(Rasterizer& rasterizer, Point a, Point b, const StrokeStyle& style);
+
+/*
+    Adds the stroke of the `count` points with the given style. A closed
+    polyline also joins its last point to the first, and has no caps.
+*/
+void add_stroke(Rasterizer& rasterizer, const Point* points, size_t count,
+                bool closed, const StrokeStyle& style);
+
+}} // namespace bpx::detail
+
+#endif // BPX_STROKE_HPP
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "BPX/view.hpp"
+
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+
+/* ImageView Implementation */
+
+namespace bpx {
+
+ConstImageView::ConstImageView(const void* pixels, int w, int h, PixelFormat format, size_t pitch, AlphaMode alpha)
+    : m_pixels(static_cast<uint8_t*>(const_cast<void*>(pixels)))
+    , m_format(format), m_w(w), m_h(h)
+    , m_pitch(pitch ? pitch : w * pixel_size(format))
+    , m_alpha(alpha)
+{
+    if (w < 0 || h < 0) {
+        throw std::invalid_argument("The dimensions of a view cannot be negative");
+    }
+    if (m_pitch < row_size()) {
+        throw std::invalid_argument(
+            "The pitch of a view (" + std::to_string(m_pitch)
+            + ") is smaller than a row of pixels ("
+            + std::to_string(row_size()) + ")");
+    }
+}
+
+ConstImageView ConstImageView::sub(int x, int y, int w, int h) const
+{
+    if (x < 0 || y < 0 || w < 0 || h < 0 || x > m_w - w || y > m_h - h) {
+        throw std::out_of_range("The region of a sub-view must lie within the view");
+    }
+    return ConstImageView(pixel(x, y), w, h, m_format, m_pitch, m_alpha);
+}
+
+Color ConstImageView::get_unsafe(int x, int y) const
+{
+    Color result;
+    decode_pixels(m_format, pixel(x, y), &result, 1);
+    return result;
+}
+
+void ConstImageView::read_row(int x, int y, Color* dst, int count) const
+{
+    decode_pixels(m_format, pixel(x, y), dst, count);
+}
+
+void ImageView::set_unsafe(int x, int y, Color color) const
+{
+    encode_pixels(m_format, &color, pixel(x, y), 1);
+}
+
+void ImageView::write_row(int x, int y, const Color* src, int count) const
+{
+    encode_pixels(m_format, src, pixel(x, y), count);
+}
+
+} // namespace bpx
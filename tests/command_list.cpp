@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+/*
+    Executing a command list must give the same pixels as calling the
+    drawing functions one after another. Every primitive that can be
+    recorded is drawn at random, partly outside an image spanning several
+    tiles, in a few pixel formats. The list is executed sequentially, on a
+    thread pool, and on a region only, whose pixels must match the
+    immediate drawing while those outside it are left untouched.
+*/
+
+#include <BPX/BPX.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace bpx;
+
+constexpr int WIDTH = 301;
+constexpr int HEIGHT = 203;
+
+constexpr int KINDS = 25;
+
+uint32_t seed = 2024;
+
+int random(int lo, int hi)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return lo + static_cast<int>((seed >> 8) % static_cast<uint32_t>(hi - lo + 1));
+}
+
+/*
+    The arguments of a primitive, drawn at random.
+*/
+struct Shape
+{
+    int kind;
+    int x1, y1, x2, y2;
+    int w, h;
+    int sx, sy, sw, sh;
+    int thick;
+    int radius;
+    Color color;
+    BlendMode mode;
+    Filter filter;
+};
+
+Shape random_shape(int kind)
+{
+    Shape s;
+    s.kind = kind;
+    s.x1 = random(-40, WIDTH + 40);
+    s.y1 = random(-40, HEIGHT + 40);
+    s.x2 = random(-40, WIDTH + 40);
+    s.y2 = random(-40, HEIGHT + 40);
+    s.w = random(-60, 150);
+    s.h = random(-60, 150);
+    s.sx = random(0, 20);
+    s.sy = random(0, 15);
+    s.sw = random(1, 20);
+    s.sh = random(1, 15);
+    s.thick = random(1, 12);
+    s.radius = random(0, 90);
+    s.color = Color{ static_cast<uint8_t>(random(0, 255)), static_cast<uint8_t>(random(0, 255)),
+                     static_cast<uint8_t>(random(0, 255)), static_cast<uint8_t>(random(0, 255)) };
+    s.mode = random(0, 1) ? BlendMode::REPLACE : BlendMode::ALPHA;
+    s.filter = random(0, 1) ? Filter::NEAREST : Filter::BILINEAR;
+    return s;
+}
+
+Color mapper(int x, int y, Color color)
+{
+    return Color{ static_cast<uint8_t>(x * 7), static_cast<uint8_t>(y * 5), color.b, 255 };
+}
+
+void record(CommandList& list, const Shape& s, const ColorRamp& ramp, ConstImageView sprite)
+{
+    switch (s.kind) {
+        case 0: list.point(s.x1, s.y1, s.color, s.mode); break;
+        case 1: list.line(s.x1, s.y1, s.x2, s.y2, s.color, s.mode); break;
+        case 2: list.line(s.x1, s.y1, s.x2, s.y2, mapper); break;
+        case 3: list.line(s.x1, s.y1, s.x2, s.y2, s.thick, s.color, s.mode); break;
+        case 4: list.line(s.x1, s.y1, s.x2, s.y2, s.thick, mapper); break;
+        case 5: list.line_gradient(s.x1, s.y1, s.x2, s.y2, ramp, s.mode); break;
+        case 6: list.line_gradient(s.x1, s.y1, s.x2, s.y2, s.thick, ramp, s.mode); break;
+        case 7: list.rectangle(s.x1, s.y1, s.w, s.h, s.color, s.mode); break;
+        case 8: list.rectangle(s.x1, s.y1, s.w, s.h, mapper); break;
+        case 9: list.rectangle_gradient_linear(s.x1, s.y1, s.w, s.h, s.x1, s.y1, s.x2, s.y2, ramp, s.mode); break;
+        case 10: list.rectangle_gradient_radial(s.x1, s.y1, s.w, s.h, s.x1, s.y1, s.x2, s.y2, ramp, s.mode); break;
+        case 11: list.rectangle_lines(s.x1, s.y1, s.w, s.h, s.color, s.mode); break;
+        case 12: list.rectangle_lines(s.x1, s.y1, s.w, s.h, mapper); break;
+        case 13: list.rectangle_lines(s.x1, s.y1, s.w, s.h, s.thick, s.color, s.mode); break;
+        case 14: list.rectangle_lines(s.x1, s.y1, s.w, s.h, s.thick, mapper); break;
+        case 15: list.circle(s.x1, s.y1, s.radius, s.color, s.mode); break;
+        case 16: list.circle(s.x1, s.y1, s.radius, mapper); break;
+        case 17: list.circle_gradient(s.x1, s.y1, s.radius, ramp, s.mode); break;
+        case 18: list.circle_lines(s.x1, s.y1, s.radius, s.color, s.mode); break;
+        case 19: list.circle_lines(s.x1, s.y1, s.radius, mapper); break;
+        case 20: list.circle_lines(s.x1, s.y1, s.radius, s.thick, s.color, s.mode); break;
+        case 21: list.circle_lines(s.x1, s.y1, s.radius, s.thick, mapper); break;
+        case 22: list.draw(s.x1, s.y1, s.w, s.h, sprite, s.mode, s.filter); break;
+        case 23: list.draw(s.x1, s.y1, s.w, s.h, sprite, s.sx, s.sy, s.sw, s.sh, s.mode, s.filter); break;
+        default: list.draw(s.x1, s.y1, sprite.width(), sprite.height(), sprite, s.mode); break;
+    }
+}
+
+void draw_now(ImageView image, const Shape& s, const ColorRamp& ramp, ConstImageView sprite)
+{
+    switch (s.kind) {
+        case 0: point(image, s.x1, s.y1, s.color, s.mode); break;
+        case 1: line(image, s.x1, s.y1, s.x2, s.y2, s.color, s.mode); break;
+        case 2: line(image, s.x1, s.y1, s.x2, s.y2, mapper); break;
+        case 3: line(image, s.x1, s.y1, s.x2, s.y2, s.thick, s.color, s.mode); break;
+        case 4: line(image, s.x1, s.y1, s.x2, s.y2, s.thick, mapper); break;
+        case 5: line_gradient(image, s.x1, s.y1, s.x2, s.y2, ramp, s.mode); break;
+        case 6: line_gradient(image, s.x1, s.y1, s.x2, s.y2, s.thick, ramp, s.mode); break;
+        case 7: rectangle(image, s.x1, s.y1, s.w, s.h, s.color, s.mode); break;
+        case 8: rectangle(image, s.x1, s.y1, s.w, s.h, mapper); break;
+        case 9: rectangle_gradient_linear(image, s.x1, s.y1, s.w, s.h, s.x1, s.y1, s.x2, s.y2, ramp, s.mode); break;
+        case 10: rectangle_gradient_radial(image, s.x1, s.y1, s.w, s.h, s.x1, s.y1, s.x2, s.y2, ramp, s.mode); break;
+        case 11: rectangle_lines(image, s.x1, s.y1, s.w, s.h, s.color, s.mode); break;
+        case 12: rectangle_lines(image, s.x1, s.y1, s.w, s.h, mapper); break;
+        case 13: rectangle_lines(image, s.x1, s.y1, s.w, s.h, s.thick, s.color, s.mode); break;
+        case 14: rectangle_lines(image, s.x1, s.y1, s.w, s.h, s.thick, mapper); break;
+        case 15: circle(image, s.x1, s.y1, s.radius, s.color, s.mode); break;
+        case 16: circle(image, s.x1, s.y1, s.radius, mapper); break;
+        case 17: circle_gradient(image, s.x1, s.y1, s.radius, ramp, s.mode); break;
+        case 18: circle_lines(image, s.x1, s.y1, s.radius, s.color, s.mode); break;
+        case 19: circle_lines(image, s.x1, s.y1, s.radius, mapper); break;
+        case 20: circle_lines(image, s.x1, s.y1, s.radius, s.thick, s.color, s.mode); break;
+        case 21: circle_lines(image, s.x1, s.y1, s.radius, s.thick, mapper); break;
+        case 22: draw(image, s.x1, s.y1, s.w, s.h, sprite, s.mode, s.filter); break;
+        case 23: draw(image, s.x1, s.y1, s.w, s.h, sprite, s.sx, s.sy, s.sw, s.sh, s.mode, s.filter); break;
+        default: draw(image, s.x1, s.y1, sprite.width(), sprite.height(), sprite, s.mode); break;
+    }
+}
+
+Image make_noise(PixelFormat format)
+{
+    Image image(WIDTH, HEIGHT, BLACK, format);
+    uint8_t* bytes = static_cast<uint8_t*>(image.data());
+    for (size_t i = 0; i < image.data_size(); i++) {
+        bytes[i] = static_cast<uint8_t>(random(0, 255));
+    }
+    return image;
+}
+
+/*
+    Compares two images pixel by pixel, reporting the first difference.
+*/
+bool same_pixels(const Image& expected, const Image& actual, const char* what, PixelFormat format)
+{
+    const size_t bpp = expected.data_size() / (static_cast<size_t>(WIDTH) * HEIGHT);
+    const uint8_t* a = static_cast<const uint8_t*>(expected.data());
+    const uint8_t* b = static_cast<const uint8_t*>(actual.data());
+
+    for (size_t i = 0; i < static_cast<size_t>(WIDTH) * HEIGHT; i++) {
+        if (std::memcmp(a + i * bpp, b + i * bpp, bpp) != 0) {
+            std::fprintf(stderr, "format %d, %s: pixel %d, %d differs from the immediate drawing\n",
+                         static_cast<int>(format), what, static_cast<int>(i % WIDTH), static_cast<int>(i / WIDTH));
+            return false;
+        }
+    }
+    return true;
+}
+
+int test_format(PixelFormat format, ThreadPool& pool, ConstImageView sprite)
+{
+    const ColorRamp ramp{ { RED, 0.0f }, { GREEN, 0.4f }, { BLUE, 1.0f } };
+    const Image base = make_noise(format);
+    int failures = 0;
+
+    for (int scene = 0; scene < 4; scene++) {
+        // Every primitive a few times, in a random order
+        std::vector<Shape> shapes;
+        for (int i = 0; i < 4 * KINDS; i++) {
+            shapes.push_back(random_shape(random(0, KINDS - 1)));
+        }
+        for (int kind = 0; kind < KINDS; kind++) {
+            shapes.push_back(random_shape(kind));
+        }
+
+        Image expected = copy(base);
+        CommandList list;
+        for (const Shape& shape : shapes) {
+            draw_now(expected, shape, ramp, sprite);
+            record(list, shape, ramp, sprite);
+        }
+
+        Image sequential = copy(base);
+        list.execute(sequential);
+        failures += !same_pixels(expected, sequential, "sequential", format);
+
+        Image pooled = copy(base);
+        list.execute(pooled, pool);
+        failures += !same_pixels(expected, pooled, "thread pool", format);
+
+        // Only the pixels of the region are drawn, the others keep the base
+        Region region;
+        for (int i = 0; i < 3; i++) {
+            region.add(Rect{ random(-20, WIDTH), random(-20, HEIGHT), random(0, 120), random(0, 90) });
+        }
+
+        Image masked = copy(base);
+        for (const Rect& rect : region.rects()) {
+            const Rect part = intersection(rect, Rect{ 0, 0, WIDTH, HEIGHT });
+            if (!part.empty()) {
+                draw(masked, part.x, part.y, part.w, part.h, expected, part.x, part.y, part.w, part.h);
+            }
+        }
+
+        Image partial = copy(base);
+        list.execute(partial, region, scene % 2 ? ExecutionPolicy(pool) : ExecutionPolicy());
+        failures += !same_pixels(masked, partial, "region", format);
+    }
+
+    return failures;
+}
+
+} // namespace
+
+int main()
+{
+    Image sprite(23, 17, BLACK, PixelFormat::RGBA_U8);
+    map(sprite, [](int x, int y, Color) {
+        return Color{ static_cast<uint8_t>(x * 11), static_cast<uint8_t>(y * 15), 128, static_cast<uint8_t>(x * y) };
+    });
+
+    ThreadPool pool(4);
+    int failures = 0;
+
+    for (PixelFormat format : { PixelFormat::RGBA_U8, PixelFormat::BGR_U8, PixelFormat::RGB_565,
+                                PixelFormat::LA_U8, PixelFormat::RGBA_F32 }) {
+        failures += test_format(format, pool, sprite);
+    }
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d executions failed\n", failures);
+        return 1;
+    }
+
+    std::printf("All command list executions match the immediate drawing\n");
+    return 0;
+}
@@ -0,0 +1,260 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+/*
+    A container must open only when its header and records describe levels
+    lying within the file. A container of a plain image and a mipmap chain
+    is written, checked to open with its pixels intact, then opened again
+    truncated at every length and with each field of its header and
+    records corrupted, which must all be rejected. Random bytes are also
+    flipped in the records: the container may still open, but its levels
+    must then be readable without leaving the file.
+*/
+
+#include <BPX/BPX.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace bpx;
+
+const std::string PATH = "container_validation.bpx";
+
+// Layout of the records, see src/container.cpp
+constexpr size_t HEADER_SIZE = 32;
+constexpr size_t IMAGE_RECORD_SIZE = 16;
+constexpr size_t LEVEL_RECORD_SIZE = 24;
+
+bool save(const std::vector<uint8_t>& bytes)
+{
+    FILE* file = std::fopen(PATH.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool result = bytes.empty() || std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return std::fclose(file) == 0 && result;
+}
+
+template <typename T>
+void patch(std::vector<uint8_t>& bytes, size_t offset, T value)
+{
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+bool same_rows(ConstImageView a, ConstImageView b)
+{
+    if (a.width() != b.width() || a.height() != b.height() || a.format() != b.format()) {
+        return false;
+    }
+    const size_t row_size = static_cast<size_t>(a.width()) * pixel_size(a.format());
+    for (int y = 0; y < a.height(); y++) {
+        if (std::memcmp(a.row(y), b.row(y), row_size) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    Reads every byte of every level, so that a level reaching past the end
+    of the file faults (or is reported by the sanitizers).
+*/
+uint32_t touch(const MappedContainer& container)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < container.size(); i++) {
+        for (int l = 0; l < container.level_count(i); l++) {
+            const ConstImageView view = container.view(i, l);
+            const size_t row_size = static_cast<size_t>(view.width()) * pixel_size(view.format());
+            for (int y = 0; y < view.height(); y++) {
+                const uint8_t* row = static_cast<const uint8_t*>(view.row(y));
+                for (size_t x = 0; x < row_size; x++) {
+                    sum += row[x];
+                }
+            }
+        }
+    }
+    return sum;
+}
+
+/*
+    Opens the bytes as a container, expecting a failure.
+*/
+int expect_rejected(const std::vector<uint8_t>& bytes, const char* what)
+{
+    if (!save(bytes)) {
+        std::fprintf(stderr, "%s: can't write %s\n", what, PATH.c_str());
+        return 1;
+    }
+
+    std::string error;
+    const MappedContainer container = MappedContainer::open(PATH, &error);
+    if (error.empty() || !container.empty()) {
+        std::fprintf(stderr, "%s: the container was accepted\n", what);
+        return 1;
+    }
+
+    try {
+        MappedContainer thrown(PATH);
+        std::fprintf(stderr, "%s: the constructor did not throw\n", what);
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+
+    return 0;
+}
+
+} // namespace
+
+int main()
+{
+    int failures = 0;
+
+    Image image(61, 47, BLACK, PixelFormat::RGB_U8);
+    map(image, [](int x, int y, Color) {
+        return Color{ static_cast<uint8_t>(x * 4), static_cast<uint8_t>(y * 5), static_cast<uint8_t>(x ^ y), 255 };
+    });
+    const MipChain chain = generate_mipmaps(convert(image, PixelFormat::RGBA_F16));
+
+    ContainerWriter writer;
+    writer.add(image);
+    writer.add(chain);
+
+    std::vector<uint8_t> valid;
+    writer.write(ImageWriter{ [&valid](const void* data, size_t size) {
+        valid.insert(valid.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    } });
+
+    // The intact container gives the pixels back
+    {
+        if (!save(valid)) {
+            std::fprintf(stderr, "can't write %s\n", PATH.c_str());
+            return 1;
+        }
+        std::string error;
+        const MappedContainer container = MappedContainer::open(PATH, &error);
+        bool intact = error.empty() && container.size() == 2 && container.level_count(0) == 1
+                   && container.level_count(1) == chain.level_count() && same_rows(container.view(0), image);
+        for (int l = 0; intact && l < chain.level_count(); l++) {
+            intact = same_rows(container.view(1, l), chain.view(l));
+        }
+        if (!intact) {
+            std::fprintf(stderr, "the intact container does not hold the images written (%s)\n", error.c_str());
+            std::remove(PATH.c_str());
+            return 1;
+        }
+    }
+
+    // Truncated at every length of the records, then at a few lengths within the pixels
+    const size_t level_count = static_cast<size_t>(1 + chain.level_count());
+    const size_t records_end = HEADER_SIZE + 2 * IMAGE_RECORD_SIZE + level_count * LEVEL_RECORD_SIZE;
+    for (size_t size = 0; size < valid.size(); size += (size < records_end + 8 ? 1 : 997)) {
+        const std::vector<uint8_t> truncated(valid.begin(), valid.begin() + size);
+        failures += expect_rejected(truncated, ("truncated to " + std::to_string(size) + " bytes").c_str());
+    }
+
+    // Every field checked by the reader, corrupted
+    struct Corruption {
+        const char* what;
+        size_t offset;
+        uint64_t value;
+        size_t size;
+    };
+
+    const size_t image1 = HEADER_SIZE + IMAGE_RECORD_SIZE;
+    const size_t level0 = HEADER_SIZE + 2 * IMAGE_RECORD_SIZE;
+    const size_t level1 = level0 + LEVEL_RECORD_SIZE;
+    uint64_t offset0;
+    std::memcpy(&offset0, valid.data() + level0 + 16, sizeof(offset0));
+
+    const Corruption corruptions[] = {
+        { "magic", 1, 'b', 1 },
+        { "version", 8, 2, 4 },
+        { "byte order mark", 12, 0x04030201, 4 },
+        { "image count", 16, 0x7FFFFFFF, 4 },
+        { "image count past the records", 16, 60, 4 },
+        { "level count", 20, 0xFFFFFFFF, 4 },
+        { "file size", 24, valid.size() + 1, 8 },
+        { "pixel format", HEADER_SIZE, 24, 4 },
+        { "alpha mode", HEADER_SIZE + 4, 2, 4 },
+        { "first level", image1 + 8, level_count, 4 },
+        { "level count of an image", image1 + 12, 0, 4 },
+        { "level count past the levels", image1 + 12, level_count, 4 },
+        { "width", level0, 0, 4 },
+        { "height", level0 + 4, 0, 4 },
+        { "huge width", level1, 0xFFFFFFFF, 4 },
+        { "huge height", level0 + 4, 0x7FFFFFFF, 4 },
+        { "pitch below the row size", level0 + 8, 61 * 3 - 3, 8 },
+        { "pitch not a multiple of the pixel size", level0 + 8, 61 * 3 + 1, 8 },
+        { "huge pitch", level0 + 8, uint64_t(1) << 62, 8 },
+        { "misaligned offset", level0 + 16, offset0 + 1, 8 },
+        { "offset within the records", level0 + 16, 0, 8 },
+        { "offset past the file", level1 + 16, uint64_t(valid.size()) + CONTAINER_ALIGNMENT * 4, 8 },
+        { "huge offset", level1 + 16, ~uint64_t(0) - (CONTAINER_ALIGNMENT - 1), 8 },
+    };
+
+    for (const Corruption& c : corruptions) {
+        std::vector<uint8_t> corrupt = valid;
+        switch (c.size) {
+            case 1: patch<uint8_t>(corrupt, c.offset, static_cast<uint8_t>(c.value)); break;
+            case 4: patch<uint32_t>(corrupt, c.offset, static_cast<uint32_t>(c.value)); break;
+            default: patch<uint64_t>(corrupt, c.offset, c.value); break;
+        }
+        failures += expect_rejected(corrupt, c.what);
+    }
+
+    // Random damage to the records: rejected, or levels within the file
+    uint32_t seed = 2024;
+    for (int i = 0; i < 2000; i++) {
+        std::vector<uint8_t> corrupt = valid;
+        for (int n = 0; n < 3; n++) {
+            seed = seed * 1664525u + 1013904223u;
+            const size_t offset = HEADER_SIZE + (seed >> 8) % (records_end - HEADER_SIZE);
+            corrupt[offset] ^= static_cast<uint8_t>(1u << ((seed >> 4) % 8));
+        }
+        if (!save(corrupt)) {
+            failures++;
+            break;
+        }
+        std::string error;
+        const MappedContainer container = MappedContainer::open(PATH, &error);
+        if (error.empty()) {
+            touch(container);
+        } else if (!container.empty()) {
+            std::fprintf(stderr, "a rejected container holds images\n");
+            failures++;
+        }
+    }
+
+    std::remove(PATH.c_str());
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d containers were not validated\n", failures);
+        return 1;
+    }
+
+    std::printf("All truncated and corrupted containers were rejected\n");
+    return 0;
+}
@@ -0,0 +1,261 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+/*
+    The fill rule must decide which parts of overlapping contours are
+    inside. Shapes whose inside differs between the rules are filled in
+    white on black, anti-aliased, and the covered area (the sum of the
+    coverage) is compared with the exact area of the inside:
+
+    - a pentagram, crossing itself, whose center is inside with NON_ZERO
+      and a hole with EVEN_ODD;
+    - a square wound twice, filled with NON_ZERO and empty with EVEN_ODD;
+    - a square with a square hole wound the same way, a hole only with
+      EVEN_ODD, and wound the other way, a hole with both rules.
+
+    Aliased, the pixels filled must be exactly those whose center has a
+    non-zero or odd winding number.
+*/
+
+#include <BPX/BPX.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+using namespace bpx;
+
+constexpr int SIZE = 128;
+constexpr double PI = 3.14159265358979323846;
+
+using Contour = std::vector<Point>;
+
+struct Shape
+{
+    const char* name;
+    std::vector<Contour> contours;
+    double non_zero_area;
+    double even_odd_area;
+};
+
+double shoelace(const Contour& contour)
+{
+    double area = 0.0;
+    for (size_t i = 0; i < contour.size(); i++) {
+        const Point& a = contour[i];
+        const Point& b = contour[(i + 1) % contour.size()];
+        area += static_cast<double>(a.x) * b.y - static_cast<double>(b.x) * a.y;
+    }
+    return std::fabs(area) / 2.0;
+}
+
+double perimeter(const std::vector<Contour>& contours)
+{
+    double length = 0.0;
+    for (const Contour& contour : contours) {
+        for (size_t i = 0; i < contour.size(); i++) {
+            const Point& a = contour[i];
+            const Point& b = contour[(i + 1) % contour.size()];
+            length += std::hypot(b.x - a.x, b.y - a.y);
+        }
+    }
+    return length;
+}
+
+Contour rectangle(float x0, float y0, float x1, float y1, bool clockwise)
+{
+    if (clockwise) {
+        return { { x0, y0 }, { x1, y0 }, { x1, y1 }, { x0, y1 } };
+    }
+    return { { x0, y0 }, { x0, y1 }, { x1, y1 }, { x1, y0 } };
+}
+
+/*
+    Points on a circle, every `step` of `count` evenly spaced angles.
+*/
+Contour star(double cx, double cy, double radius, int count, int step, double phase)
+{
+    Contour contour;
+    for (int i = 0; i < count; i++) {
+        const double angle = phase + 2.0 * PI * ((i * step) % count) / count;
+        contour.push_back({ static_cast<float>(cx + radius * std::cos(angle)),
+                            static_cast<float>(cy + radius * std::sin(angle)) });
+    }
+    return contour;
+}
+
+std::vector<Shape> make_shapes()
+{
+    std::vector<Shape> shapes;
+
+    // Pentagram: its outline is a ten-sided polygon, its center a pentagon
+    const double cx = 61.3, cy = 63.7, outer = 52.1, phase = -PI / 2.0;
+    const double inner = outer * std::cos(2.0 * PI / 5.0) / std::cos(PI / 5.0);
+    Contour outline;
+    for (int i = 0; i < 10; i++) {
+        const double angle = phase + PI * i / 5.0;
+        const double radius = (i % 2 == 0) ? outer : inner;
+        outline.push_back({ static_cast<float>(cx + radius * std::cos(angle)),
+                            static_cast<float>(cy + radius * std::sin(angle)) });
+    }
+    const double pentagon = shoelace(star(cx, cy, inner, 5, 1, phase + PI / 5.0));
+    shapes.push_back({ "pentagram", { star(cx, cy, outer, 5, 2, phase) },
+                       shoelace(outline), shoelace(outline) - pentagon });
+
+    // Square wound twice
+    Contour twice = rectangle(20.25f, 15.5f, 100.75f, 90.25f, true);
+    const Contour again = twice;
+    twice.insert(twice.end(), again.begin(), again.end());
+    shapes.push_back({ "square wound twice", { twice }, 80.5 * 74.75, 0.0 });
+
+    // Square with a hole, wound the same way then the other way
+    const double ring = 100.5 * 90.25 - 40.0 * 30.5;
+    shapes.push_back({ "hole wound the same way",
+                       { rectangle(10.25f, 20.5f, 110.75f, 110.75f, true), rectangle(40.5f, 50.25f, 80.5f, 80.75f, true) },
+                       100.5 * 90.25, ring });
+    shapes.push_back({ "hole wound the other way",
+                       { rectangle(10.25f, 20.5f, 110.75f, 110.75f, true), rectangle(40.5f, 50.25f, 80.5f, 80.75f, false) },
+                       ring, ring });
+
+    return shapes;
+}
+
+/*
+    Winding number of the contours around a point, counting the edges
+    crossing the horizontal ray to its right, signed by their direction.
+*/
+int winding(const std::vector<Contour>& contours, double x, double y)
+{
+    int number = 0;
+    for (const Contour& contour : contours) {
+        for (size_t i = 0; i < contour.size(); i++) {
+            const Point& a = contour[i];
+            const Point& b = contour[(i + 1) % contour.size()];
+            if ((a.y <= y) == (b.y <= y)) {
+                continue;
+            }
+            const double t = (y - a.y) / (b.y - a.y);
+            if (a.x + t * (b.x - a.x) > x) {
+                number += (b.y > a.y) ? 1 : -1;
+            }
+        }
+    }
+    return number;
+}
+
+Path make_path(const std::vector<Contour>& contours)
+{
+    Path path;
+    for (const Contour& contour : contours) {
+        path.move_to(contour[0].x, contour[0].y);
+        for (size_t i = 1; i < contour.size(); i++) {
+            path.line_to(contour[i].x, contour[i].y);
+        }
+        path.close();
+    }
+    return path;
+}
+
+double covered_area(const Image& image)
+{
+    const uint8_t* pixels = static_cast<const uint8_t*>(image.data());
+    double sum = 0.0;
+    for (size_t i = 0; i < static_cast<size_t>(SIZE) * SIZE; i++) {
+        sum += pixels[i];
+    }
+    return sum / 255.0;
+}
+
+int check(const Shape& shape, FillRule rule)
+{
+    const char* rule_name = (rule == FillRule::NON_ZERO) ? "NON_ZERO" : "EVEN_ODD";
+    const double expected = (rule == FillRule::NON_ZERO) ? shape.non_zero_area : shape.even_odd_area;
+    const Path path = make_path(shape.contours);
+    int failures = 0;
+
+    // Anti-aliased, the coverage is quantized to 8 bits along the edges
+    FillStyle style;
+    style.rule = rule;
+    style.antialias = true;
+
+    const double tolerance = 0.5 + perimeter(shape.contours) / 255.0;
+    Image filled(SIZE, SIZE, BLACK, PixelFormat::L_U8);
+    fill_path(filled, path, WHITE, style);
+
+    const double area = covered_area(filled);
+    if (std::fabs(area - expected) > tolerance) {
+        std::fprintf(stderr, "%s, %s: covers %.2f pixels instead of %.2f\n", shape.name, rule_name, area, expected);
+        failures++;
+    }
+
+    // A single contour gives the same coverage as a polygon
+    if (shape.contours.size() == 1) {
+        Image polygon(SIZE, SIZE, BLACK, PixelFormat::L_U8);
+        fill_polygon(polygon, shape.contours[0].data(), shape.contours[0].size(), WHITE, style);
+        if (std::fabs(covered_area(polygon) - expected) > tolerance) {
+            std::fprintf(stderr, "%s, %s: the polygon covers %.2f pixels instead of %.2f\n", shape.name, rule_name,
+                         covered_area(polygon), expected);
+            failures++;
+        }
+    }
+
+    // Aliased, the pixels whose center is inside
+    style.antialias = false;
+    Image sampled(SIZE, SIZE, BLACK, PixelFormat::L_U8);
+    fill_path(sampled, path, WHITE, style);
+
+    const uint8_t* pixels = static_cast<const uint8_t*>(sampled.data());
+    for (int y = 0; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) {
+            const int number = winding(shape.contours, x + 0.5, y + 0.5);
+            const bool inside = (rule == FillRule::NON_ZERO) ? number != 0 : number % 2 != 0;
+            if ((pixels[y * SIZE + x] != 0) != inside) {
+                std::fprintf(stderr, "%s, %s aliased: pixel %d, %d should be %s\n", shape.name, rule_name, x, y,
+                             inside ? "filled" : "empty");
+                failures++;
+                return failures;
+            }
+        }
+    }
+
+    return failures;
+}
+
+} // namespace
+
+int main()
+{
+    int failures = 0;
+
+    for (const Shape& shape : make_shapes()) {
+        failures += check(shape, FillRule::NON_ZERO);
+        failures += check(shape, FillRule::EVEN_ODD);
+    }
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d fills failed\n", failures);
+        return 1;
+    }
+
+    std::printf("All fill rules cover the expected areas\n");
+    return 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+/*
+    Round trip of the PNG encoder through the decoder: images of one to four
+    channels, small ones and ones spanning several 256 KiB segments, are
+    encoded at every compression level with every row filter, decoded with
+    `Image::load_from_memory` and compared byte for byte. Large images are
+    also encoded on a thread pool, which must give the same file.
+*/
+
+#include <BPX/BPX.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace bpx;
+
+constexpr PixelFormat FORMATS[] = {
+    PixelFormat::L_U8, PixelFormat::LA_U8, PixelFormat::RGB_U8, PixelFormat::RGBA_U8
+};
+
+constexpr PngFilter FILTERS[] = {
+    PngFilter::NONE, PngFilter::SUB, PngFilter::UP, PngFilter::AVERAGE, PngFilter::PAETH, PngFilter::ADAPTIVE
+};
+
+constexpr const char* FILTER_NAMES[] = { "NONE", "SUB", "UP", "AVERAGE", "PAETH", "ADAPTIVE" };
+
+/*
+    Gradients with some noise and flat areas, so that every filter wins on
+    some rows and the deflater finds both matches and literals.
+*/
+Image make_image(int w, int h, PixelFormat format)
+{
+    Image image(w, h, BLACK, format);
+    const int comp = static_cast<int>(pixel_size(format));
+    uint32_t seed = 12345;
+
+    for (int y = 0; y < h; y++) {
+        uint8_t* row = static_cast<uint8_t*>(image.data()) + static_cast<size_t>(y) * w * comp;
+        for (int x = 0; x < w; x++) {
+            for (int c = 0; c < comp; c++) {
+                seed = seed * 1664525u + 1013904223u;
+                const int noise = (y / 16) % 3 == 0 ? static_cast<int>(seed >> 29) : 0;
+                row[x * comp + c] = static_cast<uint8_t>((x * (c + 1) + y * (3 - c) + noise) & 0xFF);
+            }
+        }
+    }
+
+    return image;
+}
+
+bool round_trip(const Image& image, const PngOptions& options, ExecutionPolicy policy, std::vector<uint8_t>& png)
+{
+    if (!encode_png(image, png, options, policy)) {
+        std::fprintf(stderr, "  encoding failed\n");
+        return false;
+    }
+
+    std::string error;
+    const Image decoded = Image::load_from_memory(png.data(), png.size(), &error);
+    if (!error.empty()) {
+        std::fprintf(stderr, "  decoding failed: %s\n", error.c_str());
+        return false;
+    }
+    if (decoded.width() != image.width() || decoded.height() != image.height() || decoded.format() != image.format()) {
+        std::fprintf(stderr, "  decoded a %dx%d image of another format\n", decoded.width(), decoded.height());
+        return false;
+    }
+    if (std::memcmp(decoded.data(), image.data(), image.data_size()) != 0) {
+        std::fprintf(stderr, "  decoded pixels differ\n");
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    ThreadPool pool(4);
+    int failures = 0;
+    std::vector<uint8_t> png, parallel_png;
+
+    for (PixelFormat format : FORMATS) {
+        const int comp = static_cast<int>(pixel_size(format));
+
+        // About 600 KiB of filtered rows, three segments whatever the channels
+        const Image small = make_image(67, 23, format);
+        const Image large = make_image(640 / comp * 2, 480, format);
+
+        for (int level = 0; level <= 9; level++) {
+            for (int f = 0; f < 6; f++) {
+                const PngOptions options{ level, FILTERS[f] };
+
+                if (!round_trip(small, options, {}, png)) {
+                    std::fprintf(stderr, "small image, %d channels, level %d, %s\n", comp, level, FILTER_NAMES[f]);
+                    failures++;
+                }
+
+                if (!round_trip(large, options, {}, png)) {
+                    std::fprintf(stderr, "large image, %d channels, level %d, %s\n", comp, level, FILTER_NAMES[f]);
+                    failures++;
+                } else if (!encode_png(large, parallel_png, options, pool) || parallel_png != png) {
+                    std::fprintf(stderr, "large image, %d channels, level %d, %s: "
+                                 "the thread pool gives another file\n", comp, level, FILTER_NAMES[f]);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d round trips failed\n", failures);
+        return 1;
+    }
+
+    std::printf("All PNG round trips passed\n");
+    return 0;
+}
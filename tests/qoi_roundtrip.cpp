@@ -0,0 +1,238 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+/*
+    Encoding an image to QOI and decoding it must give the original pixels
+    back. Images mixing runs, small and large color steps, and alpha changes
+    (to use every QOI chunk) are encoded in the three formats QOI reads as
+    is, to memory, to a writer and to a file, including a sub-view whose
+    rows are padded, and decoded from memory, from callbacks reading a few
+    bytes at a time, and from the file, in their own format or converted.
+*/
+
+#include <BPX/BPX.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace bpx;
+
+uint32_t seed = 2024;
+
+uint8_t random_byte()
+{
+    seed = seed * 1664525u + 1013904223u;
+    return static_cast<uint8_t>(seed >> 24);
+}
+
+/*
+    Bands of flat color, smooth gradients, noise and a moving alpha, so that
+    runs, index hits, small and luma differences and full pixels all occur.
+*/
+Image make_image(int w, int h, PixelFormat format)
+{
+    Image image(w, h, BLACK, PixelFormat::RGBA_U8);
+    uint8_t* bytes = static_cast<uint8_t*>(image.data());
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint8_t* p = bytes + (static_cast<size_t>(y) * w + x) * 4;
+            switch ((x / 16 + y / 8) % 5) {
+                case 0:     // runs
+                    p[0] = 200; p[1] = 30; p[2] = 90; p[3] = 255;
+                    break;
+                case 1:     // small steps
+                    p[0] = static_cast<uint8_t>(x); p[1] = static_cast<uint8_t>(x + y); p[2] = static_cast<uint8_t>(y); p[3] = 255;
+                    break;
+                case 2:     // luma steps
+                    p[0] = static_cast<uint8_t>(x * 9); p[1] = static_cast<uint8_t>(x * 11); p[2] = static_cast<uint8_t>(x * 13); p[3] = 255;
+                    break;
+                case 3:     // a few colors seen before
+                    p[0] = (x % 3) * 100; p[1] = (x % 2) * 200; p[2] = 50; p[3] = 255;
+                    break;
+                default:    // noise with alpha
+                    p[0] = random_byte(); p[1] = random_byte(); p[2] = random_byte(); p[3] = random_byte();
+                    break;
+            }
+        }
+    }
+
+    return convert(image, format);
+}
+
+/*
+    Compares the pixels of two views row by row, in the format of `expected`.
+*/
+bool same_pixels(ConstImageView expected, ConstImageView actual)
+{
+    if (expected.width() != actual.width() || expected.height() != actual.height()) {
+        return false;
+    }
+    if (expected.format() != actual.format()) {
+        return same_pixels(expected, convert(actual, expected.format()));
+    }
+    const size_t row_size = static_cast<size_t>(expected.width()) * pixel_size(expected.format());
+    for (int y = 0; y < expected.height(); y++) {
+        if (std::memcmp(expected.row(y), actual.row(y), row_size) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    Decodes from callbacks handing out at most 7 bytes per read.
+*/
+Image decode_streamed(const std::vector<uint8_t>& encoded, const DecodeOptions& options, std::string* error)
+{
+    size_t pos = 0;
+    ImageReader reader;
+    reader.read = [&](char* buffer, int size) {
+        const size_t n = std::min({ static_cast<size_t>(size), encoded.size() - pos, size_t(7) });
+        std::memcpy(buffer, encoded.data() + pos, n);
+        pos += n;
+        return static_cast<int>(n);
+    };
+    reader.skip = [&](int count) {
+        pos = static_cast<size_t>(std::max<long long>(0, std::min<long long>(static_cast<long long>(pos) + count,
+                                                                            static_cast<long long>(encoded.size()))));
+    };
+    reader.eof = [&]() { return pos >= encoded.size(); };
+    return Image::load_from_callbacks(reader, error, options);
+}
+
+int check(ConstImageView image, const char* what)
+{
+    const int format = static_cast<int>(image.format());
+    int failures = 0;
+
+    std::vector<uint8_t> encoded;
+    if (!encode_image(image, EncodeFormat::QOI, encoded)) {
+        std::fprintf(stderr, "format %d, %s: encoding failed\n", format, what);
+        return 1;
+    }
+
+    std::vector<uint8_t> streamed;
+    encode_image(image, EncodeFormat::QOI, ImageWriter{ [&streamed](const void* data, size_t size) {
+        streamed.insert(streamed.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    } });
+    if (streamed != encoded) {
+        std::fprintf(stderr, "format %d, %s: the writer gets other bytes than the vector\n", format, what);
+        failures++;
+    }
+
+    DecodeOptions same;
+    same.convert = true;
+    same.format = image.format();
+
+    std::string error;
+    const Image decoded = Image::load_from_memory(encoded.data(), encoded.size(), &error, same);
+    if (!error.empty() || !same_pixels(image, decoded) || decoded.format() != image.format()) {
+        std::fprintf(stderr, "format %d, %s: decoding from memory changes the pixels (%s)\n", format, what, error.c_str());
+        failures++;
+    }
+
+    // Without conversion, the file gives RGB_U8 or RGBA_U8
+    const Image native = Image::load_from_memory(encoded.data(), encoded.size(), &error);
+    if (!error.empty() || !same_pixels(image, native)) {
+        std::fprintf(stderr, "format %d, %s: decoding to the file layout changes the pixels (%s)\n", format, what, error.c_str());
+        failures++;
+    }
+
+    const Image from_stream = decode_streamed(encoded, same, &error);
+    if (!error.empty() || !same_pixels(image, from_stream)) {
+        std::fprintf(stderr, "format %d, %s: decoding from callbacks changes the pixels (%s)\n", format, what, error.c_str());
+        failures++;
+    }
+
+    DecodeOptions flipped = same;
+    flipped.flip_vertically = true;
+    Image upside_down = Image::load_from_memory(encoded.data(), encoded.size(), &error, flipped);
+    flip_vertical(upside_down);
+    if (!error.empty() || !same_pixels(image, upside_down)) {
+        std::fprintf(stderr, "format %d, %s: decoding flipped gives other pixels (%s)\n", format, what, error.c_str());
+        failures++;
+    }
+
+    // A truncated file is rejected
+    const Image truncated = Image::load_from_memory(encoded.data(), encoded.size() / 2, &error);
+    if (error.empty() || truncated.width() != 0) {
+        std::fprintf(stderr, "format %d, %s: a truncated file was decoded\n", format, what);
+        failures++;
+    }
+
+    return failures;
+}
+
+} // namespace
+
+int main()
+{
+    int failures = 0;
+
+    for (PixelFormat format : { PixelFormat::RGB_U8, PixelFormat::RGBA_U8, PixelFormat::BGRA_U8 }) {
+        struct Size { int w, h; };
+        for (const Size& size : { Size{ 1, 1 }, Size{ 1, 37 }, Size{ 53, 1 }, Size{ 301, 203 } }) {
+            failures += check(make_image(size.w, size.h, format), "whole image");
+        }
+
+        // Rows of the sub-view are as far apart as those of the whole image
+        Image image = make_image(257, 131, format);
+        const ImageView view = ImageView(image).sub(13, 7, 201, 97);
+        failures += check(view, "sub-view");
+
+        // The file functions give the same pixels
+        const std::string path = "qoi_roundtrip.qoi";
+        std::string error;
+        DecodeOptions same;
+        same.convert = true;
+        same.format = format;
+        if (!write_qoi(view, path)) {
+            std::fprintf(stderr, "format %d: can't write %s\n", static_cast<int>(format), path.c_str());
+            failures++;
+        } else if (!same_pixels(view, Image(path, same))) {
+            std::fprintf(stderr, "format %d: the file holds other pixels\n", static_cast<int>(format));
+            failures++;
+        }
+        std::remove(path.c_str());
+    }
+
+    // Formats QOI does not read are converted to 8-bit RGB(A) first
+    const Image wide = make_image(97, 61, PixelFormat::RGBA_F16);
+    std::vector<uint8_t> encoded;
+    encode_image(wide, EncodeFormat::QOI, encoded);
+    if (!same_pixels(convert(wide, PixelFormat::RGBA_U8), Image::load_from_memory(encoded.data(), encoded.size()))) {
+        std::fprintf(stderr, "an RGBA_F16 image is not stored as its 8-bit colors\n");
+        failures++;
+    }
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d round trips failed\n", failures);
+        return 1;
+    }
+
+    std::printf("All QOI round trips give the original pixels back\n");
+    return 0;
+}
@@ -0,0 +1,328 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+/*
+    A region must keep disjoint rectangles, at most `max_rects` of them,
+    covering every pixel added, with `area` counting exactly the pixels of
+    its rectangles. Random rectangles are added and the region is checked
+    against a mask after each one.
+
+    A canvas must report every pixel it changes in its damage, and change
+    none outside its clip. Random primitives are drawn on noise, with and
+    without a clip, and the pixels changed by each call are compared with
+    the damage.
+*/
+
+#include <BPX/BPX.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using namespace bpx;
+
+constexpr int WIDTH = 157;
+constexpr int HEIGHT = 113;
+
+uint32_t seed = 2024;
+
+int random(int lo, int hi)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return lo + static_cast<int>((seed >> 8) % static_cast<uint32_t>(hi - lo + 1));
+}
+
+bool contains(const Rect& rect, int x, int y)
+{
+    return x >= rect.x && x < rect.x + rect.w && y >= rect.y && y < rect.y + rect.h;
+}
+
+bool contains(const Region& region, int x, int y)
+{
+    for (const Rect& rect : region.rects()) {
+        if (contains(rect, x, y)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+    Checks the invariants of a region holding at least the pixels set in
+    `added`, a WIDTH x HEIGHT mask, returning the number of failures.
+*/
+int check_region(const Region& region, int max_rects, const std::vector<uint8_t>& added, const char* what)
+{
+    int failures = 0;
+
+    if (static_cast<int>(region.rects().size()) > max_rects) {
+        std::fprintf(stderr, "%s: %d rectangles, more than %d\n", what,
+                     static_cast<int>(region.rects().size()), max_rects);
+        failures++;
+    }
+
+    std::vector<uint8_t> covered(added.size(), 0);
+    int64_t area = 0;
+
+    for (const Rect& rect : region.rects()) {
+        if (rect.empty()) {
+            std::fprintf(stderr, "%s: empty rectangle\n", what);
+            failures++;
+            continue;
+        }
+        area += static_cast<int64_t>(rect.w) * rect.h;
+        for (int y = rect.y; y < rect.y + rect.h; y++) {
+            for (int x = rect.x; x < rect.x + rect.w; x++) {
+                if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+                    continue;
+                }
+                if (covered[y * WIDTH + x]++ == 1) {
+                    std::fprintf(stderr, "%s: rectangles overlap at %d, %d\n", what, x, y);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    if (region.area() != area) {
+        std::fprintf(stderr, "%s: area %lld, the rectangles hold %lld pixels\n", what,
+                     static_cast<long long>(region.area()), static_cast<long long>(area));
+        failures++;
+    }
+
+    for (size_t i = 0; i < added.size(); i++) {
+        if (added[i] && !covered[i]) {
+            std::fprintf(stderr, "%s: pixel %d, %d added but not covered\n", what,
+                         static_cast<int>(i % WIDTH), static_cast<int>(i / WIDTH));
+            failures++;
+            break;
+        }
+    }
+
+    return failures;
+}
+
+int test_region()
+{
+    int failures = 0;
+
+    for (int max_rects : { 1, 4, 16 }) {
+        Region region(max_rects);
+        std::vector<uint8_t> added(WIDTH * HEIGHT, 0);
+
+        for (int i = 0; i < 300; i++) {
+            // Rectangles inside the mask, some empty, some sharing edges
+            const int w = random(-2, 30);
+            const int h = random(-2, 30);
+            const Rect rect{ random(0, WIDTH - 31), random(0, HEIGHT - 31), w, h };
+
+            region.add(rect);
+            for (int y = rect.y; y < rect.y + rect.h; y++) {
+                for (int x = rect.x; x < rect.x + rect.w; x++) {
+                    added[y * WIDTH + x] = 1;
+                }
+            }
+
+            if (check_region(region, max_rects, added, "Region::add") > 0) {
+                std::fprintf(stderr, "max_rects %d, after adding rectangle %d\n", max_rects, i);
+                failures++;
+                break;
+            }
+
+            if (i % 50 == 49) {
+                region.clear();
+                std::fill(added.begin(), added.end(), 0);
+            }
+        }
+    }
+
+    // Rectangles far apart are kept as they are, so the area is the sum of theirs
+    Region region;
+    int64_t expected = 0;
+    for (int i = 0; i < 16; i++) {
+        const Rect rect{ (i % 4) * 40, (i / 4) * 28, random(1, 30), random(1, 20) };
+        region.add(rect);
+        expected += static_cast<int64_t>(rect.w) * rect.h;
+    }
+    if (region.area() != expected || region.rects().size() != 16) {
+        std::fprintf(stderr, "16 separate rectangles: %d rectangles of %lld pixels, expected 16 of %lld\n",
+                     static_cast<int>(region.rects().size()), static_cast<long long>(region.area()),
+                     static_cast<long long>(expected));
+        failures++;
+    }
+
+    // Adding a rectangle already covered changes nothing
+    const int64_t before = region.area();
+    region.add(Rect{ 1, 1, 1, 1 });
+    if (region.area() != before) {
+        std::fprintf(stderr, "adding a covered pixel changed the area\n");
+        failures++;
+    }
+
+    return failures;
+}
+
+/*
+    Draws the primitive `kind` at random on the canvas.
+*/
+void draw_random(Canvas& canvas, int kind, const ColorRamp& ramp, ConstImageView sprite)
+{
+    const int x1 = random(-20, WIDTH + 20), y1 = random(-20, HEIGHT + 20);
+    const int x2 = random(-20, WIDTH + 20), y2 = random(-20, HEIGHT + 20);
+    const int w = random(-40, 80), h = random(-40, 80);
+    const int thick = random(1, 9);
+    const int radius = random(0, 50);
+    const Color color{ static_cast<uint8_t>(random(0, 255)), static_cast<uint8_t>(random(0, 255)),
+                       static_cast<uint8_t>(random(0, 255)), static_cast<uint8_t>(random(0, 255)) };
+    const BlendMode mode = random(0, 1) ? BlendMode::REPLACE : BlendMode::ALPHA;
+    const auto mapper = [](int x, int y, Color c) {
+        return Color{ static_cast<uint8_t>(x * 7), static_cast<uint8_t>(y * 5), c.b, 255 };
+    };
+
+    switch (kind) {
+        case 0: canvas.point(x1, y1, color, mode); break;
+        case 1: canvas.line(x1, y1, x2, y2, color, mode); break;
+        case 2: canvas.line(x1, y1, x2, y2, mapper); break;
+        case 3: canvas.line(x1, y1, x2, y2, thick, color, mode); break;
+        case 4: canvas.line(x1, y1, x2, y2, thick, mapper); break;
+        case 5: canvas.line_gradient(x1, y1, x2, y2, ramp, mode); break;
+        case 6: canvas.line_gradient(x1, y1, x2, y2, thick, ramp, mode); break;
+        case 7: canvas.rectangle(x1, y1, w, h, color, mode); break;
+        case 8: canvas.rectangle(x1, y1, w, h, mapper); break;
+        case 9: canvas.rectangle_gradient_linear(x1, y1, w, h, x1, y1, x2, y2, ramp, mode); break;
+        case 10: canvas.rectangle_gradient_radial(x1, y1, w, h, x1, y1, x2, y2, ramp, mode); break;
+        case 11: canvas.rectangle_lines(x1, y1, w, h, color, mode); break;
+        case 12: canvas.rectangle_lines(x1, y1, w, h, mapper); break;
+        case 13: canvas.rectangle_lines(x1, y1, w, h, thick, color, mode); break;
+        case 14: canvas.rectangle_lines(x1, y1, w, h, thick, mapper); break;
+        case 15: canvas.circle(x1, y1, radius, color, mode); break;
+        case 16: canvas.circle(x1, y1, radius, mapper); break;
+        case 17: canvas.circle_gradient(x1, y1, radius, ramp, mode); break;
+        case 18: canvas.circle_lines(x1, y1, radius, color, mode); break;
+        case 19: canvas.circle_lines(x1, y1, radius, mapper); break;
+        case 20: canvas.circle_lines(x1, y1, radius, thick, color, mode); break;
+        case 21: canvas.circle_lines(x1, y1, radius, thick, mapper); break;
+        case 22: canvas.draw(x1, y1, w, h, sprite, mode, Filter::BILINEAR); break;
+        case 23: canvas.map(x1, y1, w, h, mapper); break;
+        case 24: canvas.invert(); break;
+        case 25: canvas.brightness(1.3f); break;
+        case 26: canvas.flip_horizontal(); break;
+        case 27: canvas.rotate_180(); break;
+        default: canvas.fill(color); break;
+    }
+}
+
+constexpr int KINDS = 29;
+
+int test_canvas(PixelFormat format)
+{
+    int failures = 0;
+
+    Image image(WIDTH, HEIGHT, BLACK, format);
+    uint8_t* bytes = static_cast<uint8_t*>(image.data());
+    for (size_t i = 0; i < image.data_size(); i++) {
+        bytes[i] = static_cast<uint8_t>(random(0, 255));
+    }
+
+    Image sprite(23, 17, BLACK, PixelFormat::RGBA_U8);
+    map(sprite, [](int x, int y, Color) {
+        return Color{ static_cast<uint8_t>(x * 11), static_cast<uint8_t>(y * 15), 128, 200 };
+    });
+
+    const ColorRamp ramp(RED, BLUE);
+    Canvas canvas(image);
+    Image before(WIDTH, HEIGHT, BLACK, format);
+
+    for (int i = 0; i < 40 * KINDS; i++) {
+        const int kind = i % KINDS;
+        const bool clipped = (i / KINDS) % 2 == 1;
+
+        Region clip;
+        if (clipped) {
+            clip.add(Rect{ random(-10, WIDTH), random(-10, HEIGHT), random(0, 60), random(0, 60) });
+            clip.add(Rect{ random(-10, WIDTH), random(-10, HEIGHT), random(0, 60), random(0, 60) });
+            canvas.set_clip(clip);
+        } else {
+            canvas.reset_clip();
+        }
+
+        std::memcpy(before.data(), image.data(), image.data_size());
+        canvas.clear_damage();
+        draw_random(canvas, kind, ramp, sprite);
+
+        const uint8_t* a = static_cast<const uint8_t*>(before.data());
+        const uint8_t* b = static_cast<const uint8_t*>(image.data());
+        const size_t bpp = image.data_size() / (static_cast<size_t>(WIDTH) * HEIGHT);
+
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < WIDTH; x++) {
+                const size_t offset = (static_cast<size_t>(y) * WIDTH + x) * bpp;
+                if (std::memcmp(a + offset, b + offset, bpp) == 0) {
+                    continue;
+                }
+                if (!contains(canvas.damage(), x, y)) {
+                    std::fprintf(stderr, "format %d, primitive %d%s: pixel %d, %d changed outside the damage\n",
+                                 static_cast<int>(format), kind, clipped ? " (clipped)" : "", x, y);
+                    failures++;
+                    y = HEIGHT;
+                    break;
+                }
+                if (clipped && !contains(clip, x, y)) {
+                    std::fprintf(stderr, "format %d, primitive %d: pixel %d, %d changed outside the clip\n",
+                                 static_cast<int>(format), kind, x, y);
+                    failures++;
+                    y = HEIGHT;
+                    break;
+                }
+            }
+        }
+
+        for (const Rect& rect : canvas.damage().rects()) {
+            if (rect.x < 0 || rect.y < 0 || rect.x + rect.w > WIDTH || rect.y + rect.h > HEIGHT) {
+                std::fprintf(stderr, "format %d, primitive %d: damage outside the image\n",
+                             static_cast<int>(format), kind);
+                failures++;
+            }
+        }
+    }
+
+    return failures;
+}
+
+} // namespace
+
+int main()
+{
+    int failures = test_region();
+
+    for (PixelFormat format : { PixelFormat::RGBA_U8, PixelFormat::RGB_565, PixelFormat::LA_F32 }) {
+        failures += test_canvas(format);
+    }
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d region and damage checks failed\n", failures);
+        return 1;
+    }
+
+    std::printf("All regions and canvas damage checks passed\n");
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2024 Le Juez Victor
+ *
+ * This software is provided "as-is", without any express or implied warranty. In no event 
+ * will the authors be held liable for any damages arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose, including commercial 
+ * applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must not claim that you 
+ *   wrote the original software. If you use this software in a product, an acknowledgment 
+ *   in the product documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must not be misrepresented
+ *   as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source distribution.
+ */
+
+/*
+    A resize on a thread pool must give the same pixels as the sequential
+    one. Every pixel format is upscaled and downscaled with every filter and
+    edge mode, to sizes large enough for the output rows to be split over
+    the threads, and both results are compared byte for byte.
+*/
+
+#include <BPX/BPX.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+using namespace bpx;
+
+constexpr PixelFormat FORMATS[] = {
+    PixelFormat::L_U8, PixelFormat::L_F16, PixelFormat::L_F32,
+    PixelFormat::LA_U8, PixelFormat::LA_F16, PixelFormat::LA_F32,
+    PixelFormat::RGB_565, PixelFormat::BGR_565,
+    PixelFormat::RGB_U8, PixelFormat::BGR_U8, PixelFormat::RGB_F16, PixelFormat::BGR_F16,
+    PixelFormat::RGB_F32, PixelFormat::BGR_F32,
+    PixelFormat::RGBA_5551, PixelFormat::BGRA_5551, PixelFormat::RGBA_4444, PixelFormat::BGRA_4444,
+    PixelFormat::RGBA_U8, PixelFormat::BGRA_U8, PixelFormat::RGBA_F16, PixelFormat::BGRA_F16,
+    PixelFormat::RGBA_F32, PixelFormat::BGRA_F32
+};
+
+constexpr Filter FILTERS[] = { Filter::NEAREST, Filter::BILINEAR, Filter::BICUBIC, Filter::BOX };
+constexpr const char* FILTER_NAMES[] = { "NEAREST", "BILINEAR", "BICUBIC", "BOX" };
+
+constexpr EdgeMode EDGES[] = { EdgeMode::CLAMP, EdgeMode::REFLECT, EdgeMode::WRAP, EdgeMode::ZERO };
+
+/*
+    Noise, converted from 8-bit colors so that the float formats hold
+    values in [0, 1] and the packed ones use all of their steps.
+*/
+Image make_image(int w, int h, PixelFormat format)
+{
+    Image noise(w, h, BLACK, PixelFormat::RGBA_U8);
+    uint8_t* bytes = static_cast<uint8_t*>(noise.data());
+    uint32_t seed = 2024;
+
+    for (size_t i = 0; i < noise.data_size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        bytes[i] = static_cast<uint8_t>(seed >> 24);
+    }
+
+    return convert(noise, format);
+}
+
+} // namespace
+
+int main()
+{
+    // Sources and sizes for which the output rows make several splits
+    struct Case { int src_w, src_h, dst_w, dst_h; };
+    constexpr Case CASES[] = {
+        { 173, 91, 301, 139 },
+        { 640, 360, 301, 139 },
+        { 97, 211, 157, 419 },
+    };
+
+    ThreadPool pool(4);
+    int failures = 0;
+
+    for (PixelFormat format : FORMATS) {
+        for (const Case& c : CASES) {
+            const Image image = make_image(c.src_w, c.src_h, format);
+
+            for (int f = 0; f < 4; f++) {
+                for (EdgeMode edge : EDGES) {
+                    const Image sequential = resize(image, c.dst_w, c.dst_h, FILTERS[f], edge);
+                    const Image pooled = resize(image, c.dst_w, c.dst_h, FILTERS[f], edge, pool);
+
+                    if (std::memcmp(sequential.data(), pooled.data(), sequential.data_size()) != 0) {
+                        std::fprintf(stderr, "format %d, %dx%d to %dx%d, %s, edge %d: the thread pool gives other pixels\n",
+                                     static_cast<int>(format), c.src_w, c.src_h, c.dst_w, c.dst_h,
+                                     FILTER_NAMES[f], static_cast<int>(edge));
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+
+    if (failures > 0) {
+        std::fprintf(stderr, "%d resizes failed\n", failures);
+        return 1;
+    }
+
+    std::printf("All pooled resizes match the sequential ones\n");
+    return 0;
+}